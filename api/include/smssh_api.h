@@ -120,6 +120,34 @@ namespace SecurityManager
         std::string overall_risk_level;
     };
 
+    /**
+    * @brief Результат проверки sshd_config одного хоста
+    */
+    struct SSHHostAudit
+    {
+        std::string host;
+        std::string config_path;
+        std::string config_hash;    // Одинаковый у хостов с одинаковым файлом
+        int score;                  // critical 10, high 5, medium 2, low 1
+        std::vector<SSHConfigIssue> issues;
+        std::string error;          // Файл не прочитан
+    };
+
+    /**
+    * @brief Сводный отчет по конфигурациям парка хостов
+    */
+    struct SSHFleetAuditReport
+    {
+        int total_hosts;
+        int unique_configs;
+        int failed_hosts;
+        double seconds;
+        std::map<std::string, int> issue_hosts;     // Параметр -> число хостов с проблемой
+        std::vector<std::string> worst_hosts;       // По убыванию score
+        std::vector<SSHHostAudit> hosts;
+        std::string json_lines;                     // По строке JSON на хост
+    };
+
     /**
     * @brief Класс менеджера безопасности SSH
     */
@@ -136,6 +164,22 @@ namespace SecurityManager
         */
         SSHResult<SSHSecurityReport> analyzeConfiguration(const std::string& config_path = "/etc/ssh/sshd_config");
 
+        /**
+        * @brief Проверить sshd_config всех хостов каталога параллельно
+        * @param directory Каталог (host/sshd_config или файл на хост)
+        * @param threads Число потоков (0 - по числу ядер)
+        * @return Сводный отчет; одинаковые файлы анализируются один раз
+        */
+        SSHResult<SSHFleetAuditReport> auditConfigDirectory(const std::string& directory, int threads = 0);
+
+        /**
+        * @brief Проверить набор sshd_config параллельно
+        * @param config_paths Хост -> путь к его sshd_config
+        * @param threads Число потоков (0 - по числу ядер)
+        * @return Сводный отчет
+        */
+        SSHResult<SSHFleetAuditReport> auditConfigurations(const std::map<std::string, std::string>& config_paths, int threads = 0);
+
         /**
         * @brief Применить рекомендации по усилению безопасности
         * @param config_path Путь к sshd_config
@@ -162,9 +206,12 @@ namespace SecurityManager
         * @brief Поиск SSH атак в реально времени
         * @param log_path Путь к логу
         * @param callback Функция которая будет вызвана при обнаружении атаки
+        * @param state_path Файл снимка детектора и позиции в логе
+        *        (по умолчанию: /var/lib/smssh/api-monitor.state, "off" - без снимка)
         * @return Удача/Неудача
         */
-        SSHResult<bool> monitorAttacks(const std::string& log_path, std::function<void(const SSHAttackAlert&)> callback);
+        SSHResult<bool> monitorAttacks(const std::string& log_path, std::function<void(const SSHAttackAlert&)> callback,
+                                       const std::string& state_path = "");
 
         /**
         * @brief Остановка мониторинга
@@ -182,6 +229,18 @@ namespace SecurityManager
         */
         SSHResult<bool> generateKeyPair(const std::string& key_name, const std::string& key_path = "", const std::string& key_type = "rsa", int key_size = 4096);
 
+        /**
+        * @brief Сгенерировать много пар ключей параллельно (например, для служебных учетных записей)
+        * @param key_names Имена ключей (файлы <key_path>/<имя> и <имя>.pub)
+        * @param key_path Путь для сохранения ключей (по умолчанию: ~/.ssh)
+        * @param key_type Тип ключей (ed25519, ecdsa, rsa)
+        * @param key_size Размер ключей в битах (0 - 4096 для RSA, 256 для ECDSA)
+        * @param threads Число потоков (0 - по числу ядер)
+        * @return Имя -> отпечаток SHA256 для созданных ключей
+        */
+        SSHResult<std::map<std::string, std::string>> generateKeyPairs(const std::vector<std::string>& key_names, const std::string& key_path = "",
+                                                                       const std::string& key_type = "ed25519", int key_size = 0, int threads = 0);
+
         /**
         * @brief Получить статус SSH сервера
         * @return Информация о сервере
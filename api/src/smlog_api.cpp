@@ -34,47 +34,54 @@ namespace SecurityManager
         */
         std::map<std::string, bool> monitoring_active;
 
-        LogEntry parseSyslogLine(const std::string& line)
+        LogEntry parseSyslogLine(const std::string& line, LogFormat format = LogFormat::Unknown)
         {
             LogEntry entry;
             entry.raw_line = line;
+            entry.process_id = 0;
 
-            std::regex syslog_regex(R"((\w+\s+\d+\s+\d+:\d+:\d+)\s+(\w+)\s+([^:\[]+)(?:\[(\d+)\])?:\s*(.*))");
-            std::smatch match;
-
-            if (std::regex_match(line, match, syslog_regex))
+            LogRecord record;
+            if (LogParserRegistry::instance().parse(line, record, format))
             {
-                entry.timestamp = match[1].str();
-                entry.hostname = match[2].str();
-                entry.process_name = match[3].str();
-
-                if (match[4].matched)
-                    entry.process_id = std::stoi(match[4].str());
+                entry.timestamp = std::string(record.timestamp);
+                entry.hostname = std::string(record.hostname);
+                entry.process_name = std::string(record.service);
+                entry.message = std::string(record.message);
 
-                entry.message = match[5].str();
-
-                std::string lower_message = entry.message;
-                std::transform(lower_message.begin(), lower_message.end(), lower_message.begin(), ::tolower);
+                if (!record.pid.empty() && std::all_of(record.pid.begin(), record.pid.end(), ::isdigit))
+                    entry.process_id = std::stoi(std::string(record.pid));
 
-                if (lower_message.find("error") != std::string::npos || lower_message.find("failed") != std::string::npos)
-                {
-                    entry.level = "ERROR";
-                    entry.priority = 3;
-                }
-                else if (lower_message.find("warning") != std::string::npos || lower_message.find("warn") != std::string::npos)
-                {
-                    entry.level = "WARNING";
-                    entry.priority = 4;
-                }
-                else if (lower_message.find("debug") != std::string::npos)
+                if (!record.level.empty())
                 {
-                    entry.level = "DEBUG";
-                    entry.priority = 7;
+                    // Уровень задан самим форматом
+                    entry.level = std::string(record.level);
+                    entry.priority = record.severity;
                 }
                 else
                 {
-                    entry.level = "INFO";
-                    entry.priority = 6;
+                    std::string lower_message = entry.message;
+                    std::transform(lower_message.begin(), lower_message.end(), lower_message.begin(), ::tolower);
+
+                    if (lower_message.find("error") != std::string::npos || lower_message.find("failed") != std::string::npos)
+                    {
+                        entry.level = "ERROR";
+                        entry.priority = 3;
+                    }
+                    else if (lower_message.find("warning") != std::string::npos || lower_message.find("warn") != std::string::npos)
+                    {
+                        entry.level = "WARNING";
+                        entry.priority = 4;
+                    }
+                    else if (lower_message.find("debug") != std::string::npos)
+                    {
+                        entry.level = "DEBUG";
+                        entry.priority = 7;
+                    }
+                    else
+                    {
+                        entry.level = "INFO";
+                        entry.priority = 6;
+                    }
                 }
 
                 if (entry.process_name == "sshd")
@@ -92,6 +99,16 @@ namespace SecurityManager
                     entry.source = "systemd";
                     entry.facility = "daemon";
                 }
+                else if (record.format == LogFormat::Auditd)
+                {
+                    entry.source = "audit";
+                    entry.facility = "authpriv";
+                }
+                else if (record.format == LogFormat::CombinedAccess)
+                {
+                    entry.source = "http";
+                    entry.facility = "local7";
+                }
                 else
                 {
                     entry.source = "system";
@@ -143,29 +160,27 @@ namespace SecurityManager
         {
             std::vector<LogEntry> entries;
 
-            std::ifstream file(filepath);
-            if (!file.is_open())
-                throw std::runtime_error("Cannot open log file: " + filepath);
-
-            std::string line;
+            LogFormat format = LogParserRegistry::instance().detectFile(filepath);
             size_t line_count = 0;
 
-            while (std::getline(file, line))
+            bool readable = BulkReader::forEachLine(filepath, [&](std::string_view line)
             {
                 if (line.empty())
-                    continue;
+                    return true;
 
-                auto entry = parseSyslogLine(line);
+                auto entry = parseSyslogLine(std::string(line), format);
 
                 if (!matchesFilter(entry, filter))
-                    continue;
+                    return true;
 
                 entries.push_back(entry);
                 line_count++;
 
-                if (max_lines > 0 && line_count >= max_lines)
-                    break;
-            }
+                return max_lines == 0 || line_count < max_lines;
+            });
+
+            if (!readable)
+                throw std::runtime_error("Cannot open log file: " + filepath);
 
             return entries;
         }
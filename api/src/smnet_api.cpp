@@ -89,9 +89,9 @@ public:
         for (const auto& conn : scanner_connections)
         {
             ConnectionInfo info;
-            info.local_address = conn.local_address;
+            info.local_address = conn.local_address.toString();
             info.local_port = conn.local_port;
-            info.remote_address = conn.remote_address;
+            info.remote_address = conn.remote_address.toString();
             info.remote_port = conn.remote_port;
             info.protocol = conn.protocol;
             info.state = conn.state;
@@ -258,23 +258,14 @@ private:
         if (colon_pos == std::string::npos)
             throw std::runtime_error("Invalid address format");
 
-        std::string ip_hex = hex_addr.substr(0, colon_pos);
         std::string port_hex = hex_addr.substr(colon_pos + 1);
 
-        if (ip_hex.length() != 8)
+        IpAddress address;
+        if (!IpAddress::fromProcHex(std::string_view(hex_addr).substr(0, colon_pos), address))
             throw std::runtime_error("Invalid IP format");
 
-        std::string ip_str;
-        for (int i = 6; i >= 0; i -= 2)
-        {
-            std::string octet = ip_hex.substr(i, 2);
-            ip_str += std::to_string(std::stoi(octet, nullptr, 16));
-            if (i > 0)
-                ip_str += ".";
-        }
-
         int port = std::stoi(port_hex, nullptr, 16);
-        return {ip_str, port};
+        return {address.toString(), port};
     }
 
     std::string getStateString(int state)
@@ -8,11 +8,16 @@
 #include "smssh_api.h"
 #include "../../smssh/sshConfig.h"
 #include "../../smssh/sshAttackDetector.h"
+#include "../../smssh/detectorState.h"
+#include "../../smssh/logTailer.h"
+#include "../../smssh/configAudit.h"
+#include "../../smssh/sshKeyGen.h"
+#include "../../bulkreader/bulkreader.h"
 #include <fstream>
 #include <sstream>
-#include <regex>
 #include <thread>
 #include <atomic>
+#include <filesystem>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -98,90 +103,33 @@ private:
         try
         {
             SSHAttackDetector detector;
-            std::ifstream log_file(log_path);
 
-            if (!log_file.is_open())
-                return alerts;
-
-            std::regex failed_password_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Failed password for (invalid user )?(\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+) ssh2)");
-            std::regex accepted_password_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Accepted password for (\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+) ssh2)");
-            std::regex accepted_pubkey_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Accepted publickey for (\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+) ssh2)");
-            std::regex invalid_user_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Invalid user (\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+))");
+            std::vector<AttackAlert> attacks;
+            size_t line_count = 0;
 
-            std::string line;
-            while (std::getline(log_file, line))
+            // Окна по времени событий: оповещения по всей истории лога, а не за последний час
+            bool readable = BulkReader::forEachLine(log_path, [&](std::string_view line)
             {
-                std::smatch match;
-                std::string ip, username;
-                int port = 22;
-                bool success = false;
+                SshLogEvent event;
+                if (parseSshLogLine(line, event))
+                    detector.addLogEvent(event);
 
-                if (std::regex_search(line, match, failed_password_regex))
-                {
-                    username = match[3].str();
-                    ip = match[4].str();
-                    port = std::stoi(match[5].str());
-                    success = false;
-                    detector.addConnectionAttempt(ip, username, success, port);
-                }
-                else if (std::regex_search(line, match, accepted_password_regex) ||
-                         std::regex_search(line, match, accepted_pubkey_regex))
-                {
-                    username = match[2].str();
-                    ip = match[3].str();
-                    port = std::stoi(match[4].str());
-                    success = true;
-                    detector.addConnectionAttempt(ip, username, success, port);
-                }
-                else if (std::regex_search(line, match, invalid_user_regex))
+                if (++line_count % 1000 == 0)
                 {
-                    username = match[2].str();
-                    ip = match[3].str();
-                    port = std::stoi(match[4].str());
-                    success = false;
-                    detector.addConnectionAttempt(ip, username, success, port);
+                    auto closed = detector.pollAlerts();
+                    attacks.insert(attacks.end(), closed.begin(), closed.end());
                 }
-            }
+                return true;
+            });
 
-            log_file.close();
+            if (!readable)
+                return alerts;
 
-            auto attacks = detector.analyze();
+            auto closed = detector.flushAlerts();
+            attacks.insert(attacks.end(), closed.begin(), closed.end());
 
             for (const auto& attack : attacks)
-            {
-                SSHAttackAlert alert;
-                alert.attack_type = attack.type;
-                alert.severity = attack.severity;
-                alert.ip_address = attack.ip;
-                alert.username = attack.username;
-                alert.description = attack.description;
-                alert.timestamp = attack.timestamp.empty() ? getCurrentTimestamp() : attack.timestamp;
-
-                for (const auto& [key, value] : attack.details)
-                {
-                    alert.details[key] = value;
-                }
-
-                auto recent_attempts = detector.getRecentAttempts(60);
-                int attempt_count = 0;
-                for (const auto& attempt : recent_attempts)
-                {
-                    if (attempt.ip == attack.ip && attempt.username == attack.username && !attempt.success)
-                        attempt_count++;
-                }
-                alert.attempt_count = attempt_count;
-
-                if (attack.type == "brute_force")
-                    alert.recommended_action = "Block IP address and enable fail2ban";
-                else if (attack.type == "dictionary_attack")
-                    alert.recommended_action = "Disable password authentication";
-                else if (attack.type == "root_attack")
-                    alert.recommended_action = "Disable root login and use sudo";
-                else
-                    alert.recommended_action = "Review SSH configuration";
-
-                alerts.push_back(alert);
-            }
+                alerts.push_back(toApiAlert(attack));
         }
         catch (const std::exception& e)
         {
@@ -193,6 +141,35 @@ private:
         return alerts;
     }
 
+    SSHAttackAlert toApiAlert(const AttackAlert& attack)
+    {
+        SSHAttackAlert alert;
+        alert.attack_type = attack.type;
+        alert.severity = attack.severity;
+        alert.ip_address = attack.ip;
+        alert.username = attack.username;
+        alert.description = attack.description;
+        alert.timestamp = attack.timestamp.empty() ? getCurrentTimestamp() : attack.timestamp;
+
+        for (const auto& [key, value] : attack.details)
+        {
+            alert.details[key] = value;
+        }
+
+        alert.attempt_count = attack.failed_attempts;
+
+        if (attack.type == "brute_force")
+            alert.recommended_action = "Block IP address and enable fail2ban";
+        else if (attack.type == "dictionary_attack")
+            alert.recommended_action = "Disable password authentication";
+        else if (attack.type == "root_attack")
+            alert.recommended_action = "Disable root login and use sudo";
+        else
+            alert.recommended_action = "Review SSH configuration";
+
+        return alert;
+    }
+
     std::string getCurrentTimestamp()
     {
         auto now = std::chrono::system_clock::now();
@@ -206,17 +183,35 @@ private:
     }
 
     bool generateSSHKey(const std::string& key_name, const std::string& key_path,
-                       const std::string& key_type, int key_size)
+                       const std::string& key_type, int key_size, std::string& error)
     {
-        std::string full_key_path = key_path.empty() ?
-            std::string(getenv("HOME")) + "/.ssh/" + key_name :
-            key_path + "/" + key_name;
+        auto results = generateSSHKeys({key_name}, key_path, key_type, key_size, 1, error);
+        if (results.empty())
+            return false;
+        error = results.front().error;
+        return error.empty();
+    }
 
-        std::string cmd = "ssh-keygen -t " + key_type + " -b " + std::to_string(key_size) +
-                         " -f " + full_key_path + " -N \"\"";
+    std::vector<SSHKeyResult> generateSSHKeys(const std::vector<std::string>& key_names, const std::string& key_path,
+                                              const std::string& key_type, int key_size, unsigned threads, std::string& error)
+    {
+        SSHKeySpec spec;
+        if (!SSHKeyGenerator::parseType(key_type, spec.type))
+        {
+            error = "Unknown key type: " + key_type;
+            return {};
+        }
+        spec.bits = spec.type == SSHKeyType::Ed25519 ? 0 : key_size;
 
-        int result = system(cmd.c_str());
-        return result == 0;
+        const char* home = getenv("HOME");
+        std::string directory = key_path.empty() ? std::string(home ? home : ".") + "/.ssh" : key_path;
+        std::vector<SSHKeySpec> specs;
+        for (const auto& name : key_names)
+        {
+            spec.name = name;
+            specs.push_back(spec);
+        }
+        return SSHKeyGenerator::generateBatch(directory, specs, threads);
     }
 
 public:
@@ -274,6 +269,59 @@ public:
         return report;
     }
 
+    SSHFleetAuditReport toFleetReport(const ConfigAuditReport& audit)
+    {
+        SSHFleetAuditReport report;
+        report.total_hosts = static_cast<int>(audit.hosts.size());
+        report.unique_configs = static_cast<int>(audit.uniqueConfigs());
+        report.failed_hosts = static_cast<int>(audit.failed);
+        report.seconds = audit.seconds;
+
+        for (const auto& issue : audit.issues)
+            report.issue_hosts[issue.key] = static_cast<int>(issue.hosts);
+        for (const HostAudit* host : audit.worstHosts(10))
+            report.worst_hosts.push_back(host->host);
+
+        // Проблемы переводятся один раз на уникальную конфигурацию и копируются хостам
+        std::vector<std::vector<SSHConfigIssue>> issues(audit.issues_by_config.size());
+        for (size_t config = 0; config < audit.issues_by_config.size(); ++config)
+        {
+            for (const auto& rec : audit.issues_by_config[config])
+            {
+                SSHConfigIssue issue;
+                issue.parameter = rec.key;
+                issue.current_value = rec.current_value;
+                issue.recommended_value = rec.recommended_value;
+                issue.description = rec.description;
+                issue.severity = rec.severity;
+                issue.is_compliant = false;
+                issues[config].push_back(issue);
+            }
+        }
+
+        char hash[17];
+        for (const HostAudit& host : audit.hosts)
+        {
+            SSHHostAudit result;
+            result.host = host.host;
+            result.config_path = host.path;
+            result.score = host.score;
+            result.error = host.error;
+            if (host.error.empty())
+            {
+                snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(host.config_hash));
+                result.config_hash = hash;
+                result.issues = issues[host.config];
+            }
+            report.hosts.push_back(std::move(result));
+        }
+
+        std::ostringstream json;
+        audit.writeJsonLines(json);
+        report.json_lines = json.str();
+        return report;
+    }
+
     bool applySecurityHardening(const std::string& config_path, const std::string& backup_path)
     {
         try
@@ -328,23 +376,85 @@ public:
         return detectAttacksFromLogs(log_path);
     }
 
-    bool monitorAttacks(const std::string& log_path, std::function<void(const SSHAttackAlert&)> callback)
+    bool monitorAttacks(const std::string& log_path, std::function<void(const SSHAttackAlert&)> callback,
+                        const std::string& state_path)
     {
         if (monitoring_active)
             return false;
 
+        std::string snapshot_path = state_path.empty() ? "/var/lib/smssh/api-monitor.state" : state_path;
+        if (snapshot_path == "off")
+        {
+            snapshot_path.clear();
+        }
+        else
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(snapshot_path).parent_path(), ec);
+        }
+
+        // Детектор и курсор живут весь сеанс: каждая строка лога разбирается один раз
+        MonitorState saved;
+        std::unique_ptr<SSHAttackDetector> detector;
+        if (!snapshot_path.empty() && loadMonitorState(snapshot_path, saved) && saved.cursor.path == log_path)
+            detector = SSHAttackDetector::fromState(saved.detector);
+
+        auto tailer = std::make_shared<LogTailer>(log_path);
+        if (detector)
+        {
+            tailer->setCursor(saved.cursor);
+        }
+        else
+        {
+            detector = std::make_unique<SSHAttackDetector>();
+            if (!tailer->seekToEnd())
+                return false;
+        }
+
+        // Окна оцениваются каждую секунду, а не раз в окно перебора;
+        // повтор той же атаки подавляется детектором, поэтому оповещение приходит один раз
+        detector->setEvaluationInterval(std::chrono::seconds(1));
+        detector->setAllowedLateness(std::chrono::seconds(2));
+        detector->watchUserDirectory();
+
         monitoring_active = true;
 
-        monitor_thread = std::thread([this, log_path, callback]()
+        monitor_thread = std::thread([this, tailer, snapshot_path, callback,
+                                      detector = std::shared_ptr<SSHAttackDetector>(std::move(detector))]()
         {
-            while (monitoring_active)
+            auto last_save = std::chrono::steady_clock::now();
+            while (true)
             {
-                auto alerts = detectAttacksFromLogs(log_path);
-                for (const auto& alert : alerts)
+                tailer->poll([&](std::string_view line)
+                {
+                    // Строка только что дописана: без разборной метки - время чтения
+                    SshLogEvent event;
+                    std::chrono::system_clock::time_point time;
+                    if (!parseSshLogLine(line, event))
+                        return;
+                    if (!parseSshTimestamp(event.timestamp, time))
+                        time = std::chrono::system_clock::now();
+                    detector->addLogEvent(event, time);
+                });
+
+                detector->advanceWatermark(std::chrono::system_clock::now() - std::chrono::seconds(2));
+                for (const auto& attack : detector->pollAlerts())
+                    callback(toApiAlert(attack));
+
+                bool stopping = !monitoring_active;
+                auto now = std::chrono::steady_clock::now();
+                if (!snapshot_path.empty() && (stopping || now - last_save >= std::chrono::seconds(30)))
                 {
-                    callback(alert);
+                    MonitorState state;
+                    state.cursor = tailer->cursor();
+                    detector->saveState(state.detector);
+                    saveMonitorState(snapshot_path, state);
+                    last_save = now;
                 }
-                std::this_thread::sleep_for(std::chrono::seconds(30));
+                if (stopping)
+                    break;
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(250));
             }
         });
 
@@ -365,9 +475,15 @@ public:
     }
 
     bool generateKeyPair(const std::string& key_name, const std::string& key_path,
-                        const std::string& key_type, int key_size)
+                        const std::string& key_type, int key_size, std::string& error)
+    {
+        return generateSSHKey(key_name, key_path, key_type, key_size, error);
+    }
+
+    std::vector<SSHKeyResult> generateKeyPairs(const std::vector<std::string>& key_names, const std::string& key_path,
+                                               const std::string& key_type, int key_size, unsigned threads, std::string& error)
     {
-        return generateSSHKey(key_name, key_path, key_type, key_size);
+        return generateSSHKeys(key_names, key_path, key_type, key_size, threads, error);
     }
 
     std::map<std::string, std::string> getServerStatus()
@@ -439,6 +555,34 @@ SSHResult<SSHSecurityReport> SSHSecurity::analyzeConfiguration(const std::string
     }
 }
 
+/**
+ * @brief Проверяет sshd_config всех хостов каталога
+ * @param directory Каталог с конфигурациями
+ * @param threads Число потоков (0 - по числу ядер)
+ * @return Результат со сводным отчетом
+ */
+SSHResult<SSHFleetAuditReport> SSHSecurity::auditConfigDirectory(const std::string& directory, int threads)
+{
+    ConfigAudit audit(static_cast<unsigned>(std::max(0, threads)));
+    ConfigAuditReport report;
+    if (!audit.auditDirectory(directory, report))
+        return SSHResult<SSHFleetAuditReport>(SSHError::FILE_NOT_FOUND, "Directory not found: " + directory);
+    return SSHResult<SSHFleetAuditReport>(SSHError::SUCCESS, "", impl_->toFleetReport(report));
+}
+
+/**
+ * @brief Проверяет набор sshd_config
+ * @param config_paths Хост -> путь к sshd_config
+ * @param threads Число потоков (0 - по числу ядер)
+ * @return Результат со сводным отчетом
+ */
+SSHResult<SSHFleetAuditReport> SSHSecurity::auditConfigurations(const std::map<std::string, std::string>& config_paths, int threads)
+{
+    ConfigAudit audit(static_cast<unsigned>(std::max(0, threads)));
+    std::vector<std::pair<std::string, std::string>> hosts(config_paths.begin(), config_paths.end());
+    return SSHResult<SSHFleetAuditReport>(SSHError::SUCCESS, "", impl_->toFleetReport(audit.auditFiles(hosts)));
+}
+
 /**
  * @brief Применяет усиление безопасности к SSH конфигурации
  * @param config_path Путь к файлу SSH конфигурации
@@ -500,15 +644,17 @@ SSHResult<std::vector<SSHAttackAlert>> SSHSecurity::detectAttacks(const std::str
  * @brief Начинает мониторинг SSH атак в реальном времени
  * @param log_path Путь к SSH лог файлу
  * @param callback Функция обратного вызова для оповещений об атаках
+ * @param state_path Файл снимка для продолжения после перезапуска
  * @return Результат с true при успехе, false при ошибке
  */
-SSHResult<bool> SSHSecurity::monitorAttacks(const std::string& log_path, std::function<void(const SSHAttackAlert&)> callback)
+SSHResult<bool> SSHSecurity::monitorAttacks(const std::string& log_path, std::function<void(const SSHAttackAlert&)> callback,
+                                            const std::string& state_path)
 {
     try
     {
-        bool success = impl_->monitorAttacks(log_path, callback);
+        bool success = impl_->monitorAttacks(log_path, callback, state_path);
         return SSHResult<bool>(success ? SSHError::SUCCESS : SSHError::INVALID_CONFIG,
-                             success ? "" : "Already monitoring", success);
+                             success ? "" : "Already monitoring or log not readable", success);
     }
     catch (const std::exception& e)
     {
@@ -547,9 +693,10 @@ SSHResult<bool> SSHSecurity::generateKeyPair(const std::string& key_name, const
 {
     try
     {
-        bool success = impl_->generateKeyPair(key_name, key_path, key_type, key_size);
+        std::string error;
+        bool success = impl_->generateKeyPair(key_name, key_path, key_type, key_size, error);
         return SSHResult<bool>(success ? SSHError::SUCCESS : SSHError::PERMISSION_DENIED,
-                             success ? "" : "Failed to generate key pair", success);
+                             success ? "" : "Failed to generate key pair: " + error, success);
     }
     catch (const std::exception& e)
     {
@@ -557,6 +704,41 @@ SSHResult<bool> SSHSecurity::generateKeyPair(const std::string& key_name, const
     }
 }
 
+/**
+ * @brief Генерирует пары ключей параллельно (служебные учетные записи)
+ * @param key_names Имена ключей
+ * @param key_path Каталог для файлов ключей (по умолчанию: ~/.ssh)
+ * @param key_type Тип ключей (ed25519, ecdsa, rsa)
+ * @param key_size Размер ключа в битах (0 - по умолчанию для типа)
+ * @param threads Число потоков (0 - по числу ядер)
+ * @return Результат с картой имя -> отпечаток SHA256 созданных ключей
+ */
+SSHResult<std::map<std::string, std::string>> SSHSecurity::generateKeyPairs(const std::vector<std::string>& key_names,
+                                                                           const std::string& key_path,
+                                                                           const std::string& key_type,
+                                                                           int key_size, int threads)
+{
+    std::string error;
+    auto results = impl_->generateKeyPairs(key_names, key_path, key_type, key_size,
+                                           static_cast<unsigned>(std::max(0, threads)), error);
+    if (!error.empty())
+        return SSHResult<std::map<std::string, std::string>>(SSHError::INVALID_CONFIG, error);
+
+    std::map<std::string, std::string> fingerprints;
+    size_t failed = 0;
+    for (const auto& result : results)
+    {
+        if (result.error.empty())
+            fingerprints[result.name] = result.fingerprint;
+        else if (failed++ == 0)
+            error = result.name + ": " + result.error;
+    }
+    if (failed > 0)
+        return SSHResult<std::map<std::string, std::string>>(SSHError::PERMISSION_DENIED,
+            std::to_string(failed) + " of " + std::to_string(results.size()) + " keys failed, first: " + error, fingerprints);
+    return SSHResult<std::map<std::string, std::string>>(SSHError::SUCCESS, "", fingerprints);
+}
+
 /**
  * @brief Получает информацию о статусе SSH сервера
  * @return Результат с картой информации о статусе
@@ -0,0 +1,610 @@
+/**
+ * @file bulkreader.cpp
+ * @brief Реализация потокового чтения файлов через io_uring
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#include "bulkreader.h"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t kAlignment = 4096;  ///< Выравнивание буферов и смещений для O_DIRECT
+
+    std::mutex g_defaults_mutex;
+    BulkReader::Options g_defaults;
+
+    size_t align_up(size_t value)
+    {
+        return (value + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    int sys_io_uring_setup(unsigned entries, io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+}
+
+/**
+ * @brief Минимальная обертка над кольцами io_uring
+ */
+struct BulkReader::Ring
+{
+    int fd = -1;
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_size = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned to_submit = 0;
+
+    bool setup(unsigned entries)
+    {
+        io_uring_params params{};
+        fd = sys_io_uring_setup(entries, &params);
+        if (fd < 0)
+            return false;
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap)
+            sq_size = cq_size = std::max(sq_size, cq_size);
+
+        sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED)
+            return false;
+
+        cq_ptr = single_mmap ? sq_ptr
+                             : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED)
+            return false;
+
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+            return false;
+
+        char* sq = static_cast<char*>(sq_ptr);
+        char* cq = static_cast<char*>(cq_ptr);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqes_size);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+            munmap(cq_ptr, cq_size);
+        if (sq_ptr != MAP_FAILED)
+            munmap(sq_ptr, sq_size);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    void queue_read(int file_fd, iovec* iov, uint64_t offset, void* user_data)
+    {
+        // Ядро читает хвост очереди отправки, мы - единственный производитель
+        unsigned tail = *sq_tail;
+        unsigned index = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = file_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(iov);
+        sqe->len = 1;
+        sqe->off = offset;
+        sqe->user_data = reinterpret_cast<uint64_t>(user_data);
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        to_submit++;
+    }
+
+    /**
+     * @brief Отправить накопленные запросы и, если нужно, дождаться завершения
+     * @return False при ошибке io_uring_enter
+     */
+    bool enter(bool wait)
+    {
+        while (to_submit > 0 || wait)
+        {
+            int rc = sys_io_uring_enter(fd, to_submit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+            if (rc < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    continue;
+                return false;
+            }
+            to_submit -= std::min<unsigned>(to_submit, rc);
+            if (wait)
+                break;
+        }
+        return true;
+    }
+
+    bool pop(void*& user_data, int& result)
+    {
+        unsigned head = *cq_head;
+        if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+            return false;
+
+        const io_uring_cqe& cqe = cqes[head & *cq_mask];
+        user_data = reinterpret_cast<void*>(cqe.user_data);
+        result = cqe.res;
+        __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+};
+
+struct BulkReader::File
+{
+    std::string path;
+    int fd = -1;
+    uint64_t size = 0;
+    uint64_t next_offset = 0;   ///< Следующий блок к отправке
+    unsigned outstanding = 0;   ///< Блоков в полете
+    bool opened = false;
+    bool direct = false;
+    bool stopped = false;       ///< Обработчик отказался от файла или ошибка чтения
+};
+
+struct BulkReader::Block
+{
+    size_t file = 0;
+    int fd = -1;
+    bool direct = false;
+    uint64_t offset = 0;
+    size_t length = 0;
+    char* buffer = nullptr;
+    iovec iov{};
+    int result = 0;
+    bool done = false;
+};
+
+BulkReader::BulkReader(const Options& options) : options_(options)
+{
+    options_.block_size = align_up(std::max<size_t>(options_.block_size, kAlignment));
+    options_.queue_depth = std::clamp(options_.queue_depth, 1u, 256u);
+
+    if (options_.use_uring)
+    {
+        auto ring = std::make_unique<Ring>();
+        if (ring->setup(options_.queue_depth))
+            ring_ = std::move(ring);
+    }
+}
+
+BulkReader::~BulkReader() = default;
+
+bool BulkReader::open_file(File& file)
+{
+    file.opened = true;
+
+    int flags = O_RDONLY | O_CLOEXEC;
+    if (options_.cache == CacheMode::Direct)
+    {
+        file.fd = open(file.path.c_str(), flags | O_DIRECT);
+        file.direct = file.fd >= 0;
+    }
+    if (file.fd < 0)
+        file.fd = open(file.path.c_str(), flags);
+
+    struct stat st;
+    if (file.fd < 0 || fstat(file.fd, &st) < 0)
+    {
+        last_error_ = "Не удалось открыть файл: " + file.path + ": " + strerror(errno);
+        close_file(file);
+        file.stopped = true;
+        return false;
+    }
+
+    file.size = static_cast<uint64_t>(st.st_size);
+    stats_.files++;
+    stats_.direct = stats_.direct || file.direct;
+    if (!file.direct)
+        posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return true;
+}
+
+void BulkReader::close_file(File& file)
+{
+    if (file.fd < 0)
+        return;
+
+    // Ничего из прочитанного не оставляем в кэше
+    if (options_.cache != CacheMode::Normal && !file.direct)
+        posix_fadvise(file.fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(file.fd);
+    file.fd = -1;
+}
+
+bool BulkReader::readChunks(const std::vector<std::string>& paths, const ChunkCallback& callback)
+{
+    stats_ = Stats{};
+    stats_.uring = ring_ != nullptr;
+    last_error_.clear();
+
+    std::vector<File> files(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+        files[i].path = paths[i];
+
+    // Буферы выделяются один раз на чтение, выровнены для O_DIRECT
+    std::vector<Block> blocks(options_.queue_depth);
+    std::vector<Block*> free_blocks;
+    for (auto& block : blocks)
+    {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, kAlignment, options_.block_size) != 0)
+        {
+            for (Block* allocated : free_blocks)
+                free(allocated->buffer);
+            last_error_ = "Недостаточно памяти для буферов чтения";
+            return false;
+        }
+        block.buffer = static_cast<char*>(memory);
+        free_blocks.push_back(&block);
+    }
+
+    std::deque<Block*> pending;  // В порядке файлов и смещений
+    size_t submit_file = 0;
+    bool ok = true;
+
+    while (true)
+    {
+        // Держим в полете до queue_depth блоков, в том числе из следующих файлов
+        while (!free_blocks.empty() && submit_file < files.size())
+        {
+            File& file = files[submit_file];
+            if (!file.opened && !open_file(file))
+            {
+                ok = false;
+                submit_file++;
+                continue;
+            }
+            if (file.stopped || file.next_offset >= file.size)
+            {
+                if (file.outstanding == 0)
+                    close_file(file);
+                submit_file++;
+                continue;
+            }
+
+            Block* block = free_blocks.back();
+            free_blocks.pop_back();
+            block->file = submit_file;
+            block->fd = file.fd;
+            block->direct = file.direct;
+            block->offset = file.next_offset;
+            block->length = std::min<uint64_t>(options_.block_size, file.size - file.next_offset);
+            block->done = false;
+            block->result = 0;
+            block->iov.iov_base = block->buffer;
+            block->iov.iov_len = file.direct ? align_up(block->length) : block->length;
+            file.next_offset += options_.block_size;
+            file.outstanding++;
+
+            submit(*block);
+            pending.push_back(block);
+            stats_.reads++;
+            stats_.max_in_flight = std::max<uint64_t>(stats_.max_in_flight, pending.size());
+        }
+
+        if (ring_ && !ring_->enter(false))
+        {
+            last_error_ = "Ошибка io_uring_enter: " + std::string(strerror(errno));
+            ok = false;
+            break;
+        }
+
+        if (pending.empty())
+            break;
+
+        Block* block = pending.front();
+        if (!complete(*block))
+        {
+            ok = false;
+            break;
+        }
+        pending.pop_front();
+
+        File& file = files[block->file];
+        int result = block->result;
+        size_t received = result > 0 ? static_cast<size_t>(result) : 0;
+
+        // Ошибка O_DIRECT или короткое чтение: дочитываем синхронно без O_DIRECT
+        if (result < 0 || (received < block->length && block->offset + received < file.size))
+        {
+            if (file.direct)
+            {
+                fcntl(file.fd, F_SETFL, fcntl(file.fd, F_GETFL) & ~O_DIRECT);
+                file.direct = false;
+                received = 0;
+            }
+            while (received < block->length)
+            {
+                ssize_t n = pread(file.fd, block->buffer + received, block->length - received, block->offset + received);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                received += n;
+                stats_.reads++;
+            }
+            if (received == 0 && result < 0)
+            {
+                last_error_ = "Ошибка чтения " + file.path + ": " + strerror(-result);
+                file.stopped = true;
+                ok = false;
+            }
+        }
+
+        received = std::min(received, block->length);
+        if (!file.stopped && received > 0)
+        {
+            stats_.bytes += received;
+            if (!callback(block->file, std::string_view(block->buffer, received)))
+                file.stopped = true;
+        }
+
+        if (options_.cache != CacheMode::Normal && !file.direct)
+            posix_fadvise(file.fd, block->offset, received, POSIX_FADV_DONTNEED);
+
+        file.outstanding--;
+        if (file.outstanding == 0 && (file.stopped || file.next_offset >= file.size))
+            close_file(file);
+        free_blocks.push_back(block);
+    }
+
+    // При аварийном выходе ядро еще может писать в буферы: дожидаемся их
+    while (ring_ && !pending.empty() && complete(*pending.front()))
+        pending.pop_front();
+
+    for (auto& file : files)
+        close_file(file);
+    if (pending.empty())
+    {
+        for (auto& block : blocks)
+            free(block.buffer);
+    }
+    return ok;
+}
+
+void BulkReader::submit(Block& block)
+{
+    if (ring_)
+    {
+        ring_->queue_read(block.fd, &block.iov, block.offset, &block);
+        return;
+    }
+
+    // Без io_uring просим ядро начать чтение заранее, сам pread - при выдаче блока
+    if (!block.direct)
+        posix_fadvise(block.fd, block.offset, block.iov.iov_len, POSIX_FADV_WILLNEED);
+}
+
+bool BulkReader::complete(Block& block)
+{
+    if (!ring_)
+    {
+        ssize_t n;
+        do
+            n = pread(block.fd, block.buffer, block.iov.iov_len, block.offset);
+        while (n < 0 && errno == EINTR);
+        block.result = n < 0 ? -errno : static_cast<int>(n);
+        block.done = true;
+        return true;
+    }
+
+    while (!block.done)
+    {
+        void* user_data = nullptr;
+        int result = 0;
+        if (!ring_->pop(user_data, result))
+        {
+            if (!ring_->enter(true))
+            {
+                last_error_ = "Ошибка io_uring_enter: " + std::string(strerror(errno));
+                return false;
+            }
+            continue;
+        }
+
+        Block* finished = static_cast<Block*>(user_data);
+        finished->result = result;
+        finished->done = true;
+    }
+    return true;
+}
+
+bool BulkReader::readLines(const std::vector<std::string>& paths, const LineCallback& callback)
+{
+    size_t current = static_cast<size_t>(-1);
+    bool current_stopped = false;
+    std::string carry;
+
+    auto finish_file = [&]() {
+        if (current != static_cast<size_t>(-1) && !current_stopped && !carry.empty())
+            callback(current, carry);
+        carry.clear();
+    };
+
+    bool ok = readChunks(paths, [&](size_t file, std::string_view data) {
+        if (file != current)
+        {
+            finish_file();
+            current = file;
+            current_stopped = false;
+        }
+
+        size_t start = 0;
+        while (true)
+        {
+            const void* found = memchr(data.data() + start, '\n', data.size() - start);
+            if (!found)
+                break;
+            size_t newline = static_cast<const char*>(found) - data.data();
+
+            bool keep_going;
+            if (carry.empty())
+                keep_going = callback(file, data.substr(start, newline - start));
+            else
+            {
+                carry.append(data.substr(start, newline - start));
+                keep_going = callback(file, carry);
+                carry.clear();
+            }
+            if (!keep_going)
+            {
+                current_stopped = true;
+                return false;
+            }
+            start = newline + 1;
+        }
+
+        carry.append(data.substr(start));
+        return true;
+    });
+
+    finish_file();
+    return ok;
+}
+
+bool BulkReader::forEachLine(const std::string& path, const std::function<bool(std::string_view line)>& callback)
+{
+    BulkReader reader;
+    return reader.readLines({path}, [&callback](size_t, std::string_view line) {
+        return callback(line);
+    });
+}
+
+BulkReader::Options BulkReader::defaultOptions()
+{
+    std::lock_guard<std::mutex> lock(g_defaults_mutex);
+    return g_defaults;
+}
+
+void BulkReader::setDefaultOptions(const Options& options)
+{
+    std::lock_guard<std::mutex> lock(g_defaults_mutex);
+    g_defaults = options;
+}
+
+bool BulkReader::parseCacheMode(const std::string& name, CacheMode& mode)
+{
+    if (name == "normal")
+        mode = CacheMode::Normal;
+    else if (name == "dontneed" || name == "drop")
+        mode = CacheMode::DropBehind;
+    else if (name == "direct")
+        mode = CacheMode::Direct;
+    else
+        return false;
+    return true;
+}
+
+const char* BulkReader::cacheModeName(CacheMode mode)
+{
+    switch (mode)
+    {
+        case CacheMode::DropBehind: return "dontneed";
+        case CacheMode::Direct: return "direct";
+        default: return "normal";
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        munmap(data_, size_);
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        last_error_ = "Не удалось открыть файл: " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        last_error_ = "Не обычный файл: " + path;
+        close(fd);
+        return false;
+    }
+
+    // Пустой файл отобразить нельзя, но и читать в нем нечего
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0)
+    {
+        void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            last_error_ = "Ошибка mmap: " + path + ": " + strerror(errno);
+            size_ = 0;
+            close(fd);
+            return false;
+        }
+        // Каждая часть читается от начала к концу: ядру стоит читать вперед крупнее
+        madvise(map, size_, MADV_SEQUENTIAL);
+        data_ = map;
+    }
+    close(fd);
+    return true;
+}
+
+std::vector<std::string_view> MappedFile::splitLines(std::string_view data, size_t parts)
+{
+    std::vector<std::string_view> result;
+    size_t target = std::max<size_t>(1, data.size() / std::max<size_t>(1, parts));
+
+    size_t start = 0;
+    while (start < data.size())
+    {
+        size_t end = std::min(start + target, data.size());
+        if (end < data.size())
+        {
+            // Граница сдвигается за ближайший '\n', строки не делятся между частями
+            const void* found = memchr(data.data() + end - 1, '\n', data.size() - end + 1);
+            end = found ? static_cast<const char*>(found) - data.data() + 1 : data.size();
+        }
+        result.push_back(data.substr(start, end - start));
+        start = end;
+    }
+    return result;
+}
@@ -0,0 +1,222 @@
+/**
+ * @file bulkreader.h
+ * @brief Потоковое чтение больших файлов логов через io_uring с откатом на pread
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#ifndef BULK_READER_H
+#define BULK_READER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+/**
+ * @brief Чтение набора файлов большими блоками с несколькими запросами в полете
+ *
+ * Файлы читаются как одна последовательность блоков: пока обрабатывается
+ * текущий блок, ядро уже читает следующие, в том числе из следующих
+ * файлов. Основной путь - io_uring (системные вызовы напрямую, без
+ * liburing); если io_uring недоступен (старое ядро, seccomp), используется
+ * pread с подсказкой POSIX_FADV_WILLNEED для блоков впереди.
+ *
+ * Режимы кэша позволяют ночным отчетам не вытеснять из page cache данные
+ * рабочих сервисов: DropBehind сбрасывает прочитанные страницы через
+ * posix_fadvise(DONTNEED), Direct читает с O_DIRECT мимо кэша (если
+ * файловая система не поддерживает O_DIRECT, используется DropBehind).
+ *
+ * Блоки каждого файла передаются обработчику строго по порядку, файлы -
+ * в порядке списка.
+ */
+class BulkReader
+{
+public:
+    /**
+     * @brief Режим работы с page cache
+     */
+    enum class CacheMode
+    {
+        Normal,      ///< Обычное чтение через кэш
+        DropBehind,  ///< Сбрасывать прочитанные страницы (POSIX_FADV_DONTNEED)
+        Direct       ///< O_DIRECT мимо кэша
+    };
+
+    /**
+     * @brief Параметры чтения
+     */
+    struct Options
+    {
+        size_t block_size = 1 << 20;      ///< Размер блока (кратен 4096)
+        unsigned queue_depth = 8;         ///< Блоков в полете
+        CacheMode cache = CacheMode::Normal;
+        bool use_uring = true;            ///< False - всегда pread
+    };
+
+    /**
+     * @brief Статистика последнего чтения
+     */
+    struct Stats
+    {
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+        uint64_t reads = 0;          ///< Выполнено запросов чтения
+        uint64_t max_in_flight = 0;  ///< Наибольшее число одновременных запросов
+        bool uring = false;          ///< Использовался io_uring
+        bool direct = false;         ///< Хотя бы один файл читался с O_DIRECT
+    };
+
+    /**
+     * @brief Обработчик блока файла
+     * @return False - прекратить чтение этого файла
+     */
+    using ChunkCallback = std::function<bool(size_t file, std::string_view data)>;
+
+    /**
+     * @brief Обработчик строки файла (без '\n')
+     * @return False - прекратить чтение этого файла
+     */
+    using LineCallback = std::function<bool(size_t file, std::string_view line)>;
+
+    explicit BulkReader(const Options& options = defaultOptions());
+    ~BulkReader();
+
+    BulkReader(const BulkReader&) = delete;
+    BulkReader& operator=(const BulkReader&) = delete;
+
+    /**
+     * @brief Прочитать файлы блоками
+     * @param paths Пути к файлам
+     * @param callback Обработчик блоков
+     * @return False если хотя бы один файл не удалось прочитать (см. getLastError)
+     */
+    bool readChunks(const std::vector<std::string>& paths, const ChunkCallback& callback);
+
+    /**
+     * @brief Прочитать файлы построчно
+     * @param paths Пути к файлам
+     * @param callback Обработчик строк
+     * @return False если хотя бы один файл не удалось прочитать (см. getLastError)
+     */
+    bool readLines(const std::vector<std::string>& paths, const LineCallback& callback);
+
+    /**
+     * @brief Получить статистику последнего чтения
+     */
+    const Stats& stats() const
+    {
+        return stats_;
+    }
+
+    /**
+     * @brief Получить последнюю ошибку
+     */
+    const std::string& getLastError() const
+    {
+        return last_error_;
+    }
+
+    /**
+     * @brief Прочитать один файл построчно с параметрами по умолчанию
+     * @param path Путь к файлу
+     * @param callback Обработчик строки, false - остановиться
+     * @return False если файл не удалось открыть
+     */
+    static bool forEachLine(const std::string& path, const std::function<bool(std::string_view line)>& callback);
+
+    /**
+     * @brief Параметры по умолчанию для всех сканирований процесса
+     */
+    static Options defaultOptions();
+
+    /**
+     * @brief Задать параметры по умолчанию (например, из конфигурации)
+     * @param options Параметры
+     */
+    static void setDefaultOptions(const Options& options);
+
+    /**
+     * @brief Разобрать название режима кэша ("normal", "dontneed", "direct")
+     * @param name Название
+     * @param mode Режим для заполнения
+     * @return True если название известно
+     */
+    static bool parseCacheMode(const std::string& name, CacheMode& mode);
+
+    /**
+     * @brief Название режима кэша
+     */
+    static const char* cacheModeName(CacheMode mode);
+
+private:
+    struct Ring;
+    struct File;
+    struct Block;
+
+    bool open_file(File& file);
+    void close_file(File& file);
+    void submit(Block& block);
+    bool complete(Block& block);
+
+    Options options_;
+    std::unique_ptr<Ring> ring_;
+    Stats stats_;
+    std::string last_error_;
+};
+
+/**
+ * @brief Файл, целиком отображенный в память только для чтения
+ *
+ * Нужен, когда один большой файл разбирается в несколько потоков: каждый
+ * поток берет свою часть, а строки остаются string_view на отображение и
+ * не копируются, пока жив объект.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Отобразить файл
+     * @param path Путь к файлу
+     * @return False если это не обычный файл (канал, устройство) или mmap не удался
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Содержимое файла
+     */
+    std::string_view data() const
+    {
+        return {static_cast<const char*>(data_), size_};
+    }
+
+    /**
+     * @brief Получить последнюю ошибку
+     */
+    const std::string& getLastError() const
+    {
+        return last_error_;
+    }
+
+    /**
+     * @brief Разбить текст на части примерно равного размера по границам строк
+     * @param data Текст
+     * @param parts Желаемое число частей
+     * @return Части по порядку; каждая кончается '\n' или концом текста
+     */
+    static std::vector<std::string_view> splitLines(std::string_view data, size_t parts);
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    std::string last_error_;
+};
+
+#endif
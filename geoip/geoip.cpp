@@ -0,0 +1,288 @@
+/**
+ * @file geoip.cpp
+ * @brief Реализация службы GeoIP с кэшем диапазонов
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#include "geoip.h"
+#include "../logger/logger.h"
+#include <algorithm>
+#include <cstring>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <maxminddb.h>
+
+GeoIPService& GeoIPService::instance()
+{
+    static GeoIPService service;
+    return service;
+}
+
+GeoIPService::~GeoIPService()
+{
+    if (mmdb_)
+    {
+        MMDB_close(mmdb_);
+        delete mmdb_;
+    }
+}
+
+size_t GeoIPService::RangeHash::operator()(const Range& range) const
+{
+    return range.network.hash() ^ range.prefix;
+}
+
+const char* GeoIPService::specialCountry(const IpAddress& address)
+{
+    if (address.isV4())
+    {
+        const uint8_t* v4 = address.data() + 12;
+        if (v4[0] == 10 || v4[0] == 127 ||
+            (v4[0] == 172 && (v4[1] & 0xf0) == 16) ||
+            (v4[0] == 192 && v4[1] == 168) ||
+            (v4[0] == 169 && v4[1] == 254))  // Link-local
+            return "LOCAL";
+        if (v4[0] == 0 || (v4[0] == 255 && v4[1] == 255 && v4[2] == 255 && v4[3] == 255))
+            return "RESERVED";
+        return nullptr;
+    }
+
+    if ((address.high() == 0 && address.low() == 1) ||
+        (address[0] & 0xfe) == 0xfc ||                   // fc00::/7 - уникальные локальные
+        (address[0] == 0xfe && (address[1] & 0xc0) == 0x80))  // fe80::/10 - link-local
+        return "LOCAL";
+    if (address.isUnspecified())
+        return "RESERVED";
+    return nullptr;
+}
+
+void GeoIPService::ensureOpen()
+{
+    std::call_once(open_once_, [this]()
+    {
+        if (mmdb_)
+            return;
+
+        // Пути к базе данных GeoLite2 (проверить несколько возможных мест)
+        const char* db_paths[] = {
+            "/usr/share/GeoIP/GeoLite2-Country.mmdb",
+            "/var/lib/GeoIP/GeoLite2-Country.mmdb",
+            "/usr/local/share/GeoIP/GeoLite2-Country.mmdb",
+            "./GeoLite2-Country.mmdb"
+        };
+
+        for (const char* path : db_paths)
+        {
+            if (access(path, F_OK) != 0)
+                continue;
+
+            auto* mmdb = new MMDB_s();
+            int status = MMDB_open(path, MMDB_MODE_MMAP, mmdb);
+            if (status == MMDB_SUCCESS)
+            {
+                LogInfo(std::string("Loaded GeoIP database from: ") + path);
+                mmdb_ = mmdb;
+                return;
+            }
+            LogWarning(std::string("Failed to open GeoIP database at ") + path + ": " + MMDB_strerror(status));
+            delete mmdb;
+        }
+
+        LogWarning("GeoIP database not found. Install GeoLite2-Country.mmdb or run: "
+                   "wget https://git.io/GeoLite2-Country.mmdb -O /usr/share/GeoIP/GeoLite2-Country.mmdb");
+    });
+}
+
+bool GeoIPService::open(const std::string& path)
+{
+    auto* mmdb = new MMDB_s();
+    int status = MMDB_open(path.c_str(), MMDB_MODE_MMAP, mmdb);
+    if (status != MMDB_SUCCESS)
+    {
+        LogWarning("Failed to open GeoIP database at " + path + ": " + MMDB_strerror(status));
+        delete mmdb;
+        return false;
+    }
+
+    // Базу нужно указать до первого запроса: дальше она читается без блокировок
+    bool installed = false;
+    std::call_once(open_once_, [&]()
+    {
+        mmdb_ = mmdb;
+        installed = true;
+    });
+    if (!installed)
+    {
+        MMDB_close(mmdb);
+        delete mmdb;
+        LogWarning("GeoIP database already opened, ignoring " + path);
+    }
+    return installed;
+}
+
+std::string GeoIPService::queryDatabase(const IpAddress& address, uint8_t& prefix)
+{
+    bool v4 = address.isV4();
+    prefix = 128;
+    if (!mmdb_)
+        return "UNKNOWN";
+
+    sockaddr_storage storage{};
+    if (v4)
+    {
+        auto* in = reinterpret_cast<sockaddr_in*>(&storage);
+        in->sin_family = AF_INET;
+        std::memcpy(&in->sin_addr, address.data() + 12, 4);
+    }
+    else
+    {
+        auto* in6 = reinterpret_cast<sockaddr_in6*>(&storage);
+        in6->sin6_family = AF_INET6;
+        std::memcpy(&in6->sin6_addr, address.data(), 16);
+    }
+
+    int mmdb_error = MMDB_SUCCESS;
+    MMDB_lookup_result_s result = MMDB_lookup_sockaddr(mmdb_, reinterpret_cast<sockaddr*>(&storage), &mmdb_error);
+    if (mmdb_error != MMDB_SUCCESS)
+    {
+        LogDebug(std::string("GeoIP lookup error: ") + MMDB_strerror(mmdb_error));
+        return "UNKNOWN";
+    }
+    stats_.db_lookups++;
+
+    // Для IPv4 в IPv6 базе netmask считается от корня IPv6 дерева (96 + длина IPv4)
+    int bits = result.netmask;
+    if (v4)
+    {
+        if (bits > 32)
+            bits -= 96;
+        bits = std::max(0, std::min(bits, 32)) + 96;
+    }
+    prefix = static_cast<uint8_t>(std::max(0, std::min(bits, 128)));
+
+    if (!result.found_entry)
+        return "UNKNOWN";
+
+    MMDB_entry_data_s entry_data;
+    int status = MMDB_get_value(&result.entry, &entry_data, "country", "iso_code", NULL);
+    if (status == MMDB_SUCCESS && entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING)
+        return std::string(entry_data.utf8_string, entry_data.data_size);
+
+    // Попытка получить registered_country если country не найден
+    status = MMDB_get_value(&result.entry, &entry_data, "registered_country", "iso_code", NULL);
+    if (status == MMDB_SUCCESS && entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING)
+        return std::string(entry_data.utf8_string, entry_data.data_size);
+
+    return "UNKNOWN";
+}
+
+std::string GeoIPService::lookupLocked(const IpAddress& address)
+{
+    stats_.lookups++;
+    if (const char* special = specialCountry(address))
+    {
+        stats_.special++;
+        return special;
+    }
+
+    // Диапазоны MMDB не пересекаются: первый найденный и есть ответ
+    int family = address.isV4() ? 0 : 1;
+    for (int prefix = 128; prefix >= 0; --prefix)
+    {
+        if (!prefixes_[family].test(prefix))
+            continue;
+        auto it = ranges_.find(Range{address.masked(static_cast<uint8_t>(prefix)), static_cast<uint8_t>(prefix)});
+        if (it != ranges_.end())
+        {
+            stats_.hits++;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->country;
+        }
+    }
+
+    uint8_t prefix = 128;
+    std::string country = queryDatabase(address, prefix);
+    if (!mmdb_)
+        return country;  // Без базы кэшировать нечего
+
+    Range range{address.masked(prefix), prefix};
+    lru_.push_front(Entry{range, country});
+    ranges_.emplace(range, lru_.begin());
+    prefixes_[family].set(prefix);
+    prefix_counts_[family][prefix]++;
+
+    while (ranges_.size() > capacity_)
+    {
+        const Entry& oldest = lru_.back();
+        int oldest_family = oldest.range.network.isV4() ? 0 : 1;
+        if (--prefix_counts_[oldest_family][oldest.range.prefix] == 0)
+            prefixes_[oldest_family].reset(oldest.range.prefix);
+        ranges_.erase(oldest.range);
+        lru_.pop_back();
+        stats_.evictions++;
+    }
+    return country;
+}
+
+std::string GeoIPService::country(const IpAddress& address)
+{
+    ensureOpen();
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lookupLocked(address);
+}
+
+std::string GeoIPService::country(std::string_view ip)
+{
+    IpAddress address;
+    if (!IpAddress::parse(ip, address))
+        return "UNKNOWN";
+    return country(address);
+}
+
+std::vector<std::string> GeoIPService::countries(const std::vector<std::string>& ips)
+{
+    ensureOpen();
+
+    std::vector<IpAddress> addresses(ips.size());
+    std::vector<bool> valid(ips.size());
+    for (size_t i = 0; i < ips.size(); ++i)
+        valid[i] = IpAddress::parse(ips[i], addresses[i]);
+
+    std::vector<std::string> result(ips.size());
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < ips.size(); ++i)
+        result[i] = valid[i] ? lookupLocked(addresses[i]) : "UNKNOWN";
+    return result;
+}
+
+std::vector<std::string> GeoIPService::countries(const std::vector<IpAddress>& addresses)
+{
+    ensureOpen();
+
+    std::vector<std::string> result(addresses.size());
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < addresses.size(); ++i)
+        result[i] = lookupLocked(addresses[i]);
+    return result;
+}
+
+void GeoIPService::setCapacity(size_t ranges)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = std::max<size_t>(ranges, 1);
+}
+
+GeoIPService::Stats GeoIPService::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.ranges = ranges_.size();
+    stats.database = mmdb_ != nullptr;
+    return stats;
+}
+
+void GeoIPService::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Stats();
+}
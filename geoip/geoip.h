@@ -0,0 +1,136 @@
+/**
+ * @file geoip.h
+ * @brief Определение страны по IP через MaxMind GeoLite2 с кэшем диапазонов
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#ifndef GEOIP_H
+#define GEOIP_H
+
+#include "../ipaddress/ipaddress.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct MMDB_s;
+
+/**
+ * @brief Служба GeoIP, общая для процесса
+ *
+ * База открывается один раз (при первом запросе) и дальше читается из всех
+ * потоков без блокировок. Поиск идет по двоичному адресу; ответ MMDB
+ * действует на всю сеть, которую возвращает netmask, поэтому в кэш кладется
+ * диапазон, и один поиск по базе отвечает на всю /24 или более крупную сеть.
+ * Кэш ограничен и вытесняет давно не использованные диапазоны (LRU).
+ *
+ * Частные, loopback и link-local адреса дают "LOCAL", 0.0.0.0/8 и
+ * широковещательный - "RESERVED", без базы или без записи - "UNKNOWN".
+ */
+class GeoIPService
+{
+public:
+    /**
+     * @brief Счетчики кэша
+     */
+    struct Stats
+    {
+        uint64_t lookups = 0;     ///< Запросов
+        uint64_t hits = 0;        ///< Ответов из кэша
+        uint64_t db_lookups = 0;  ///< Поисков по базе
+        uint64_t special = 0;     ///< Частных и зарезервированных адресов (без поиска)
+        uint64_t evictions = 0;   ///< Вытеснено диапазонов
+        size_t ranges = 0;        ///< Диапазонов в кэше
+        bool database = false;    ///< База открыта
+
+        double hitRate() const { return lookups > 0 ? static_cast<double>(hits + special) / lookups : 0.0; }
+    };
+
+    /**
+     * @brief Общий экземпляр
+     */
+    static GeoIPService& instance();
+
+    /**
+     * @brief Страна по текстовому адресу (ISO код)
+     */
+    std::string country(std::string_view ip);
+
+    /**
+     * @brief Страна по двоичному адресу (ISO код)
+     */
+    std::string country(const IpAddress& address);
+
+    /**
+     * @brief Страны для набора адресов за одну блокировку кэша
+     * @param ips Адреса
+     * @return Коды стран в том же порядке
+     */
+    std::vector<std::string> countries(const std::vector<std::string>& ips);
+    std::vector<std::string> countries(const std::vector<IpAddress>& addresses);
+
+    /**
+     * @brief Ограничить число диапазонов в кэше
+     */
+    void setCapacity(size_t ranges);
+
+    /**
+     * @brief Открыть базу по указанному пути вместо стандартных
+     * @return True если база открыта
+     */
+    bool open(const std::string& path);
+
+    Stats getStats();
+    void resetStats();
+
+    GeoIPService(const GeoIPService&) = delete;
+    GeoIPService& operator=(const GeoIPService&) = delete;
+
+private:
+    GeoIPService() = default;
+    ~GeoIPService();
+
+    struct Range
+    {
+        IpAddress network;
+        uint8_t prefix;  ///< Длина префикса в 128-битном пространстве
+
+        bool operator==(const Range& other) const { return prefix == other.prefix && network == other.network; }
+    };
+
+    struct RangeHash
+    {
+        size_t operator()(const Range& range) const;
+    };
+
+    struct Entry
+    {
+        Range range;
+        std::string country;
+    };
+
+    void ensureOpen();
+    std::string lookupLocked(const IpAddress& address);
+    std::string queryDatabase(const IpAddress& address, uint8_t& prefix);
+    static const char* specialCountry(const IpAddress& address);
+
+    std::once_flag open_once_;
+    MMDB_s* mmdb_ = nullptr;
+
+    std::mutex mutex_;
+    std::list<Entry> lru_;  ///< Сначала недавно использованные
+    std::unordered_map<Range, std::list<Entry>::iterator, RangeHash> ranges_;
+    // Длины префиксов, которые есть в кэше, отдельно для IPv4 и IPv6: поиск
+    // пробует только их, от длинных к коротким
+    std::bitset<129> prefixes_[2];
+    std::array<uint32_t, 129> prefix_counts_[2]{};
+    size_t capacity_ = 65536;
+    Stats stats_;
+};
+
+#endif
@@ -0,0 +1,354 @@
+/**
+ * @file ipaddress.cpp
+ * @brief Разбор и запись IP адресов без inet_pton/inet_ntop
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#include "ipaddress.h"
+
+namespace
+{
+    int hex_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        c = static_cast<char>(c | 0x20);
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        return -1;
+    }
+
+    /**
+     * @brief a.b.c.d: ровно четыре числа до 255 без ведущих нулей, как у inet_pton
+     */
+    bool parse_v4(std::string_view text, uint8_t* out)
+    {
+        size_t i = 0;
+        for (int part = 0; part < 4; ++part)
+        {
+            if (part > 0)
+            {
+                if (i >= text.size() || text[i] != '.')
+                    return false;
+                ++i;
+            }
+            size_t start = i;
+            unsigned value = 0;
+            while (i < text.size() && text[i] >= '0' && text[i] <= '9' && i - start < 3)
+                value = value * 10 + (text[i++] - '0');
+            if (i == start || value > 255 || (text[start] == '0' && i - start > 1))
+                return false;
+            out[part] = static_cast<uint8_t>(value);
+        }
+        return i == text.size();
+    }
+
+    bool parse_v6(std::string_view text, uint8_t* out)
+    {
+        uint16_t groups[8] = {};
+        int count = 0;
+        int gap = -1;  // Куда вставляются нули "::"
+        size_t i = 0;
+        size_t n = text.size();
+
+        if (n >= 2 && text[0] == ':' && text[1] == ':')
+        {
+            gap = 0;
+            i = 2;
+        }
+        else if (n == 0 || text[0] == ':')
+        {
+            return false;
+        }
+
+        while (i < n)
+        {
+            if (count == 8)
+                return false;
+
+            size_t end = i;
+            unsigned value = 0;
+            int digit;
+            while (end < n && (digit = hex_value(text[end])) >= 0)
+            {
+                if (end - i == 4)
+                    return false;
+                value = (value << 4) | static_cast<unsigned>(digit);
+                ++end;
+            }
+
+            // Последние 32 бита могут быть записаны как IPv4 (::ffff:1.2.3.4)
+            if (end < n && text[end] == '.')
+            {
+                uint8_t v4[4];
+                if (count > 6 || !parse_v4(text.substr(i), v4))
+                    return false;
+                groups[count++] = static_cast<uint16_t>(v4[0] << 8 | v4[1]);
+                groups[count++] = static_cast<uint16_t>(v4[2] << 8 | v4[3]);
+                i = n;
+                break;
+            }
+            if (end == i)
+                return false;
+            groups[count++] = static_cast<uint16_t>(value);
+            i = end;
+            if (i == n)
+                break;
+            if (text[i] != ':')
+                return false;
+            if (++i == n)
+                return false;
+            if (text[i] == ':')
+            {
+                if (gap >= 0)
+                    return false;
+                gap = count;
+                ++i;
+            }
+        }
+
+        if (gap < 0 ? count != 8 : count == 8)
+            return false;
+
+        int zeros = 8 - count;
+        std::memset(out, 0, 16);
+        for (int g = 0; g < count; ++g)
+        {
+            int word = gap >= 0 && g >= gap ? g + zeros : g;
+            out[word * 2] = static_cast<uint8_t>(groups[g] >> 8);
+            out[word * 2 + 1] = static_cast<uint8_t>(groups[g]);
+        }
+        return true;
+    }
+
+    char* write_decimal(char* out, unsigned value)
+    {
+        if (value >= 100)
+            *out++ = static_cast<char>('0' + value / 100);
+        if (value >= 10)
+            *out++ = static_cast<char>('0' + value / 10 % 10);
+        *out++ = static_cast<char>('0' + value % 10);
+        return out;
+    }
+
+    char* write_v4(char* out, const uint8_t* bytes)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            if (i > 0)
+                *out++ = '.';
+            out = write_decimal(out, bytes[i]);
+        }
+        return out;
+    }
+
+    char* write_hex(char* out, unsigned value)
+    {
+        static const char digits[] = "0123456789abcdef";
+        bool started = false;
+        for (int shift = 12; shift >= 0; shift -= 4)
+        {
+            unsigned digit = (value >> shift) & 0xf;
+            if (digit || started || shift == 0)
+            {
+                *out++ = digits[digit];
+                started = true;
+            }
+        }
+        return out;
+    }
+}
+
+IpAddress IpAddress::fromV4(uint32_t address)
+{
+    IpAddress result;
+    result.bytes_[10] = 0xff;
+    result.bytes_[11] = 0xff;
+    result.bytes_[12] = static_cast<uint8_t>(address >> 24);
+    result.bytes_[13] = static_cast<uint8_t>(address >> 16);
+    result.bytes_[14] = static_cast<uint8_t>(address >> 8);
+    result.bytes_[15] = static_cast<uint8_t>(address);
+    return result;
+}
+
+IpAddress IpAddress::fromBytes(const uint8_t* bytes)
+{
+    IpAddress result;
+    std::memcpy(result.bytes_.data(), bytes, 16);
+    return result;
+}
+
+bool IpAddress::parse(std::string_view text, IpAddress& address)
+{
+    if (text.empty() || text.size() >= kMaxText)
+        return false;
+    if (text.find(':') == std::string_view::npos)
+    {
+        address = IpAddress();
+        address.bytes_[10] = 0xff;
+        address.bytes_[11] = 0xff;
+        return parse_v4(text, address.bytes_.data() + 12);
+    }
+    return parse_v6(text, address.bytes_.data());
+}
+
+bool IpAddress::fromProcHex(std::string_view hex, IpAddress& address)
+{
+    if (hex.size() != 8 && hex.size() != 32)
+        return false;
+
+    uint8_t bytes[16];
+    for (size_t word = 0; word < hex.size() / 8; ++word)
+    {
+        uint32_t value = 0;
+        for (size_t i = word * 8; i < word * 8 + 8; ++i)
+        {
+            int digit = hex_value(hex[i]);
+            if (digit < 0)
+                return false;
+            value = (value << 4) | static_cast<uint32_t>(digit);
+        }
+        // Слово напечатано как число в порядке хоста; его байты в памяти - сетевой порядок
+        std::memcpy(bytes + word * 4, &value, sizeof(value));
+    }
+
+    if (hex.size() == 8)
+    {
+        address = IpAddress();
+        address.bytes_[10] = 0xff;
+        address.bytes_[11] = 0xff;
+        std::memcpy(address.bytes_.data() + 12, bytes, 4);
+    }
+    else
+    {
+        address = fromBytes(bytes);
+    }
+    return true;
+}
+
+IpAddress IpAddress::masked(uint8_t length) const
+{
+    IpAddress result;
+    size_t full = length / 8;
+    std::memcpy(result.bytes_.data(), bytes_.data(), full);
+    if (full < 16 && length % 8)
+        result.bytes_[full] = bytes_[full] & static_cast<uint8_t>(0xff << (8 - length % 8));
+    return result;
+}
+
+size_t IpAddress::format(char* out) const
+{
+    char* start = out;
+    if (isV4())
+        return write_v4(out, bytes_.data() + 12) - start;
+
+    unsigned words[8];
+    for (int i = 0; i < 8; ++i)
+        words[i] = static_cast<unsigned>(bytes_[i * 2] << 8 | bytes_[i * 2 + 1]);
+
+    // Самая длинная (первая из равных) серия нулевых слов длиной от двух сворачивается в "::"
+    int best = -1, best_length = 0;
+    for (int i = 0; i < 8;)
+    {
+        if (words[i] != 0)
+        {
+            ++i;
+            continue;
+        }
+        int j = i;
+        while (j < 8 && words[j] == 0)
+            ++j;
+        if (j - i > best_length)
+        {
+            best = i;
+            best_length = j - i;
+        }
+        i = j;
+    }
+    if (best_length < 2)
+        best = -1;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        if (i == best)
+        {
+            *out++ = ':';
+            i += best_length - 1;
+            if (i == 7)
+                *out++ = ':';
+            continue;
+        }
+        if (i > 0)
+            *out++ = ':';
+        // Совместимые с IPv4 адреса ::a.b.c.d glibc пишет с точками
+        if (i == 6 && best == 0 && best_length == 6)
+        {
+            out = write_v4(out, bytes_.data() + 12);
+            break;
+        }
+        out = write_hex(out, words[i]);
+    }
+    return out - start;
+}
+
+std::string IpAddress::toString() const
+{
+    char buffer[kMaxText];
+    return std::string(buffer, format(buffer));
+}
+
+bool IpPrefix::parse(std::string_view cidr, IpPrefix& prefix)
+{
+    size_t slash = cidr.find('/');
+    IpAddress address;
+    if (!IpAddress::parse(cidr.substr(0, slash), address))
+        return false;
+
+    int max_length = address.isV4() ? 32 : 128;
+    int bits = max_length;
+    if (slash != std::string_view::npos)
+    {
+        std::string_view text = cidr.substr(slash + 1);
+        if (text.empty() || text.size() > 3)
+            return false;
+        bits = 0;
+        for (char c : text)
+        {
+            if (c < '0' || c > '9')
+                return false;
+            bits = bits * 10 + (c - '0');
+        }
+        if (bits > max_length)
+            return false;
+    }
+
+    prefix.length = static_cast<uint8_t>(bits + (128 - max_length));
+    prefix.network = address.masked(prefix.length);
+    return true;
+}
+
+std::string IpPrefix::toString() const
+{
+    char buffer[IpAddress::kMaxText + 4];
+    size_t size = 0;
+    int bits = length;
+    if (network.isV4() && length >= 96)
+    {
+        bits -= 96;
+    }
+    else if (network.isV4())
+    {
+        // Сеть шире /96 с адресом ::ffff:a.b.c.d пишется как IPv6
+        std::memcpy(buffer, "::ffff:", 7);
+        size = 7;
+    }
+    size += network.format(buffer + size);
+
+    buffer[size++] = '/';
+    if (bits >= 100)
+        buffer[size++] = static_cast<char>('0' + bits / 100);
+    if (bits >= 10)
+        buffer[size++] = static_cast<char>('0' + bits / 10 % 10);
+    buffer[size++] = static_cast<char>('0' + bits % 10);
+    return std::string(buffer, size);
+}
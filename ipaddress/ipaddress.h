@@ -0,0 +1,183 @@
+/**
+ * @file ipaddress.h
+ * @brief Двоичный IP адрес: разбор, запись, хеш и операции с префиксами
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+
+#include <array>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <version>
+
+/**
+ * @brief IP адрес в 16 байтах: IPv6, IPv4 как ::ffff:a.b.c.d
+ *
+ * Один тип для адресов во всех модулях: детектор, менеджер блокировок,
+ * списки сетей, GeoIP, топ адресов smlog и таблица соединений smnet хранят и
+ * сравнивают адреса в двоичном виде, а в строку переводят только при выводе.
+ * Разбор и запись не выделяют памяти и не вызывают inet_pton/inet_ntop;
+ * результат совпадает с ними (запись IPv6 - как у glibc).
+ *
+ * Порядок сравнения - числовой, IPv4 идут перед остальными адресами ::ffff:0:0/96.
+ * Длины префиксов везде в 128-битном пространстве: IPv4 /24 - это 96 + 24.
+ */
+class IpAddress
+{
+public:
+    static constexpr size_t kMaxText = 46;  ///< Самая длинная запись, как INET6_ADDRSTRLEN
+
+    constexpr IpAddress() = default;
+
+    /**
+     * @brief IPv4 из числа в порядке хоста (0x7f000001 - 127.0.0.1)
+     */
+    static IpAddress fromV4(uint32_t address);
+
+    /**
+     * @brief 16 байт в сетевом порядке (in6_addr)
+     */
+    static IpAddress fromBytes(const uint8_t* bytes);
+
+    /**
+     * @brief Разобрать текстовый IPv4 или IPv6 адрес
+     * @return False если это не адрес; address тогда не определен
+     */
+    static bool parse(std::string_view text, IpAddress& address);
+
+    /**
+     * @brief Адрес из /proc/net/tcp (8 hex цифр) или /proc/net/tcp6 (32 цифры)
+     *
+     * Ядро печатает адрес 32-битными словами в порядке байт хоста, поэтому
+     * слова переводятся обратно в сетевой порядок.
+     */
+    static bool fromProcHex(std::string_view hex, IpAddress& address);
+
+    bool isV4() const { return high() == 0 && (low() >> 32) == 0xffff; }
+
+    /**
+     * @brief IPv4 в порядке хоста (для isV4())
+     */
+    uint32_t v4() const { return static_cast<uint32_t>(low()); }
+
+    bool isUnspecified() const { return high() == 0 && low() == 0; }
+
+    /**
+     * @brief Старшие и младшие 64 бита как числа
+     */
+    uint64_t high() const { return load(0); }
+    uint64_t low() const { return load(8); }
+
+    /**
+     * @brief Бит с номером index, 0 - старший
+     */
+    int bit(int index) const { return (bytes_[index >> 3] >> (7 - (index & 7))) & 1; }
+
+    /**
+     * @brief Адрес с обнуленными битами после первых length
+     */
+    IpAddress masked(uint8_t length) const;
+
+    /**
+     * @brief Входит ли адрес в сеть network/length
+     */
+    bool inPrefix(const IpAddress& network, uint8_t length) const { return masked(length) == network; }
+
+    /**
+     * @brief Записать адрес в буфер (без завершающего нуля)
+     * @param out Не меньше kMaxText байт
+     * @return Длина записи
+     */
+    size_t format(char* out) const;
+
+    std::string toString() const;
+
+    size_t hash() const
+    {
+        uint64_t h = high() * 0x9e3779b97f4a7c15ULL ^ low();
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+    const uint8_t* data() const { return bytes_.data(); }
+    uint8_t* data() { return bytes_.data(); }
+    static constexpr size_t size() { return 16; }
+    uint8_t operator[](size_t index) const { return bytes_[index]; }
+    uint8_t& operator[](size_t index) { return bytes_[index]; }
+
+    auto operator<=>(const IpAddress&) const = default;
+    bool operator==(const IpAddress&) const = default;
+
+private:
+    uint64_t load(size_t offset) const
+    {
+        uint64_t value;
+        std::memcpy(&value, bytes_.data() + offset, sizeof(value));
+        if constexpr (std::endian::native == std::endian::little)
+            value = __builtin_bswap64(value);
+        return value;
+    }
+
+    std::array<uint8_t, 16> bytes_{};
+};
+
+/**
+ * @brief Сеть: адрес с обнуленными битами хоста и длина префикса
+ */
+struct IpPrefix
+{
+    IpAddress network;
+    uint8_t length = 128;  ///< В 128-битном пространстве
+
+    /**
+     * @brief Разобрать адрес или CIDR (203.0.113.0/24, 2001:db8::/32); биты хоста обнуляются
+     * @return False если адрес не разобран или длина больше 32/128
+     */
+    static bool parse(std::string_view cidr, IpPrefix& prefix);
+
+    bool contains(const IpAddress& address) const { return address.inPrefix(network, length); }
+
+    /**
+     * @brief CIDR в обычной записи (IPv4 без ::ffff:)
+     */
+    std::string toString() const;
+
+    auto operator<=>(const IpPrefix&) const = default;
+    bool operator==(const IpPrefix&) const = default;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const IpAddress& address)
+{
+    char buffer[IpAddress::kMaxText];
+    return out.write(buffer, static_cast<std::streamsize>(address.format(buffer)));
+}
+
+template <>
+struct std::hash<IpAddress>
+{
+    size_t operator()(const IpAddress& address) const { return address.hash(); }
+};
+
+#if defined(__cpp_lib_format)
+#include <format>
+
+template <>
+struct std::formatter<IpAddress> : std::formatter<std::string_view>
+{
+    auto format(const IpAddress& address, std::format_context& ctx) const
+    {
+        char buffer[IpAddress::kMaxText];
+        return std::formatter<std::string_view>::format(std::string_view(buffer, address.format(buffer)), ctx);
+    }
+};
+#endif
+
+#endif
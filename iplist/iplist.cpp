@@ -0,0 +1,564 @@
+/**
+ * @file iplist.cpp
+ * @brief Реализация сжатого префиксного дерева списков сетей
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#include "iplist.h"
+#include "../logger/logger.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char kMagic[8] = {'S', 'M', 'I', 'P', 'L', 'S', 'T', '1'};
+    const uint32_t kVersion = 1;
+    const uint32_t kLeaf = 0x80000000u;
+    const int kDirectBits = 16;
+    const int kStride = 6;
+    const size_t kDirectSize = size_t(1) << kDirectBits;
+
+    using Key = unsigned __int128;
+
+    /**
+     * @brief Ключ дерева: IPv4 - 32 бита, IPv6 - 128, выровнены по старшему биту
+     */
+    Key make_key(const IpAddress& address, int& family)
+    {
+        // ::ffff:a.b.c.d - IPv4, ключ из последних 32 бит
+        family = address.isV4() ? 0 : 1;
+        if (family == 0)
+            return Key(address.v4()) << 96;
+        return (Key(address.high()) << 64) | address.low();
+    }
+
+    unsigned slot(Key key, int offset)
+    {
+        return static_cast<unsigned>((key << offset) >> (128 - kStride));
+    }
+
+    // Биты 0..index включительно
+    uint64_t mask_through(unsigned index)
+    {
+        return ~0ULL >> (63 - index);
+    }
+
+    size_t align8(size_t size)
+    {
+        return (size + 7) & ~size_t(7);
+    }
+
+    template <typename T>
+    void append(std::string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void append_array(std::string& out, const T* data, size_t count)
+    {
+        out.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+        out.resize(align8(out.size()), '\0');
+    }
+}
+
+PrefixMatcher::PrefixMatcher()
+{
+    // Пустые деревья: вся прямая таблица - лист "нет совпадения"
+    for (int family = 0; family < 2; ++family)
+    {
+        direct_storage_[family].assign(kDirectSize, kLeaf);
+        tries_[family].direct = direct_storage_[family].data();
+    }
+}
+
+PrefixMatcher::~PrefixMatcher()
+{
+    unmap();
+}
+
+void PrefixMatcher::unmap()
+{
+    if (map_)
+        munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+}
+
+uint16_t PrefixMatcher::addList(const std::string& name, Kind kind)
+{
+    lists_.push_back(List{name, kind, 0});
+    return static_cast<uint16_t>(lists_.size() - 1);
+}
+
+bool PrefixMatcher::add(uint16_t list, std::string_view cidr)
+{
+    if (list >= lists_.size())
+        return false;
+
+    IpPrefix prefix;
+    if (!IpPrefix::parse(cidr, prefix))
+        return false;
+
+    int family;
+    Key key = make_key(prefix.network, family);
+    int length = family == 0 ? prefix.length - 96 : prefix.length;
+    pending_[family].push_back(Prefix{key, static_cast<uint8_t>(length), static_cast<uint16_t>(list + 1)});
+    lists_[list].prefixes++;
+    return true;
+}
+
+long PrefixMatcher::loadFeed(uint16_t list, const std::string& path, size_t* skipped)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return -1;
+
+    long added = 0;
+    size_t bad = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::string_view view(line);
+        view = view.substr(0, view.find_first_of(";#"));
+        size_t start = view.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos)
+            continue;
+        view = view.substr(start);
+        view = view.substr(0, view.find_first_of(" \t\r"));
+
+        if (add(list, view))
+            added++;
+        else
+            bad++;
+    }
+
+    if (skipped)
+        *skipped = bad;
+    return added;
+}
+
+void PrefixMatcher::build()
+{
+    unmap();
+    for (int family = 0; family < 2; ++family)
+        buildTrie(family);
+}
+
+void PrefixMatcher::buildTrie(int family)
+{
+    // Короткие префиксы раньше длинных: длинный перезаписывает то, что
+    // покрыл короткий, а узел при создании наследует значение своей позиции.
+    // При равной длине разрешающий список идет последним и побеждает
+    std::vector<Prefix>& prefixes = pending_[family];
+    std::sort(prefixes.begin(), prefixes.end(), [this](const Prefix& a, const Prefix& b)
+    {
+        if (a.length != b.length)
+            return a.length < b.length;
+        return lists_[a.value - 1].kind < lists_[b.value - 1].kind;
+    });
+
+    struct BuildNode
+    {
+        uint32_t child[64];  ///< Номер узла + 1
+        uint16_t value[64];
+    };
+
+    std::vector<uint32_t> direct(kDirectSize, kLeaf);
+    std::vector<BuildNode> nodes;
+    auto create = [&nodes](uint16_t value)
+    {
+        nodes.emplace_back();
+        std::fill(std::begin(nodes.back().child), std::end(nodes.back().child), 0);
+        std::fill(std::begin(nodes.back().value), std::end(nodes.back().value), value);
+        return static_cast<uint32_t>(nodes.size() - 1);
+    };
+
+    for (const Prefix& prefix : prefixes)
+    {
+        size_t top = static_cast<size_t>(prefix.key >> (128 - kDirectBits));
+        if (prefix.length <= kDirectBits)
+        {
+            size_t span = size_t(1) << (kDirectBits - prefix.length);
+            std::fill(direct.begin() + top, direct.begin() + top + span, kLeaf | prefix.value);
+            continue;
+        }
+
+        if (direct[top] & kLeaf)
+            direct[top] = create(static_cast<uint16_t>(direct[top] & 0xffff));
+        uint32_t node = direct[top];
+
+        for (int offset = kDirectBits;; offset += kStride)
+        {
+            unsigned index = slot(prefix.key, offset);
+            int remaining = prefix.length - offset;
+            if (remaining <= kStride)
+            {
+                unsigned span = 1u << (kStride - remaining);
+                unsigned first = index & ~(span - 1);
+                for (unsigned i = first; i < first + span; ++i)
+                    nodes[node].value[i] = prefix.value;
+                break;
+            }
+
+            if (nodes[node].child[index] == 0)
+            {
+                uint32_t child = create(nodes[node].value[index]);
+                nodes[node].child[index] = child + 1;
+            }
+            node = nodes[node].child[index] - 1;
+        }
+    }
+
+    // Сжатие обходом в ширину: потомки каждого узла лежат подряд, листья тоже
+    std::vector<Node>& out_nodes = node_storage_[family];
+    std::vector<uint16_t>& out_leaves = leaf_storage_[family];
+    out_nodes.clear();
+    out_leaves.clear();
+    std::deque<std::pair<uint32_t, uint32_t>> queue;  // узел сборки, номер в выходном массиве
+
+    for (size_t i = 0; i < kDirectSize; ++i)
+    {
+        if (direct[i] & kLeaf)
+            continue;
+        uint32_t out = static_cast<uint32_t>(out_nodes.size());
+        out_nodes.emplace_back();
+        queue.emplace_back(direct[i], out);
+        direct[i] = out;
+    }
+
+    while (!queue.empty())
+    {
+        auto [build_index, out] = queue.front();
+        queue.pop_front();
+        const BuildNode& source = nodes[build_index];
+
+        Node node{0, 0, static_cast<uint32_t>(out_leaves.size()), static_cast<uint32_t>(out_nodes.size())};
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            if (source.child[i] == 0)
+                continue;
+            node.vector |= 1ULL << i;
+            queue.emplace_back(source.child[i] - 1, static_cast<uint32_t>(out_nodes.size()));
+            out_nodes.emplace_back();
+        }
+
+        bool has_leaf = false;
+        uint16_t previous = 0;
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            if (source.child[i] != 0)
+                continue;
+            if (!has_leaf || source.value[i] != previous)
+            {
+                node.leafvec |= 1ULL << i;
+                out_leaves.push_back(source.value[i]);
+                previous = source.value[i];
+                has_leaf = true;
+            }
+        }
+        out_nodes[out] = node;
+    }
+
+    direct_storage_[family] = std::move(direct);
+    Trie& trie = tries_[family];
+    trie.direct = direct_storage_[family].data();
+    trie.nodes = out_nodes.data();
+    trie.node_count = out_nodes.size();
+    trie.leaves = out_leaves.data();
+    trie.leaf_count = out_leaves.size();
+
+    prefixes.clear();
+    prefixes.shrink_to_fit();
+}
+
+const PrefixMatcher::List* PrefixMatcher::match(const IpAddress& address) const
+{
+    int family;
+    Key key = make_key(address, family);
+    const Trie& trie = tries_[family];
+
+    uint32_t entry = trie.direct[static_cast<size_t>(key >> (128 - kDirectBits))];
+    uint16_t value;
+    if (entry & kLeaf)
+    {
+        value = static_cast<uint16_t>(entry & 0xffff);
+    }
+    else
+    {
+        const Node* node = &trie.nodes[entry];
+        for (int offset = kDirectBits;; offset += kStride)
+        {
+            unsigned index = slot(key, offset);
+            uint64_t through = mask_through(index);
+            if ((node->vector >> index) & 1)
+            {
+                // Ниже последнего уровня узлов не бывает; защита от испорченного файла
+                if (offset + kStride >= 128)
+                {
+                    value = 0;
+                    break;
+                }
+                node = &trie.nodes[node->base1 + std::popcount(node->vector & through) - 1];
+                continue;
+            }
+            value = trie.leaves[node->base0 + std::popcount(node->leafvec & through) - 1];
+            break;
+        }
+    }
+    return value ? &lists_[value - 1] : nullptr;
+}
+
+const PrefixMatcher::List* PrefixMatcher::match(std::string_view ip) const
+{
+    IpAddress address;
+    if (!IpAddress::parse(ip, address))
+        return nullptr;
+    return match(address);
+}
+
+size_t PrefixMatcher::memoryUsage() const
+{
+    size_t bytes = 0;
+    for (const Trie& trie : tries_)
+        bytes += kDirectSize * sizeof(uint32_t) + trie.node_count * sizeof(Node) + trie.leaf_count * sizeof(uint16_t);
+    return bytes;
+}
+
+bool PrefixMatcher::save(const std::string& path) const
+{
+    std::string data(kMagic, sizeof(kMagic));
+    append(data, kVersion);
+    append(data, static_cast<uint32_t>(lists_.size()));
+    for (const Trie& trie : tries_)
+    {
+        append(data, static_cast<uint64_t>(trie.node_count));
+        append(data, static_cast<uint64_t>(trie.leaf_count));
+    }
+    for (const List& list : lists_)
+    {
+        append(data, static_cast<uint8_t>(list.kind));
+        append(data, list.prefixes);
+        append(data, static_cast<uint32_t>(list.name.size()));
+        data += list.name;
+    }
+    data.resize(align8(data.size()), '\0');
+
+    // Массивы выровнены по 8 байт, чтобы читать их прямо из отображения
+    for (const Trie& trie : tries_)
+    {
+        append_array(data, trie.direct, kDirectSize);
+        append_array(data, trie.nodes, trie.node_count);
+        append_array(data, trie.leaves, trie.leaf_count);
+    }
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good())
+            return false;
+    }
+    return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool PrefixMatcher::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(kMagic) + 40))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const char* base = static_cast<const char*>(map);
+    size_t pos = sizeof(kMagic);
+    auto read = [&](auto& value)
+    {
+        if (size - pos < sizeof(value))
+            return false;
+        std::memcpy(&value, base + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    };
+
+    uint32_t version = 0;
+    uint32_t list_count = 0;
+    uint64_t counts[2][2] = {};
+    bool ok = std::memcmp(base, kMagic, sizeof(kMagic)) == 0 && read(version) && version == kVersion &&
+              read(list_count) && list_count < 0xffff &&
+              read(counts[0][0]) && read(counts[0][1]) && read(counts[1][0]) && read(counts[1][1]);
+
+    std::vector<List> lists;
+    for (uint32_t i = 0; ok && i < list_count; ++i)
+    {
+        List list;
+        uint8_t kind = 0;
+        uint32_t name_size = 0;
+        ok = read(kind) && kind <= 1 && read(list.prefixes) && read(name_size) && size - pos >= name_size;
+        if (ok)
+        {
+            list.kind = static_cast<Kind>(kind);
+            list.name.assign(base + pos, name_size);
+            pos += name_size;
+            lists.push_back(std::move(list));
+        }
+    }
+
+    Trie tries[2];
+    pos = align8(pos);
+    for (int family = 0; ok && family < 2; ++family)
+    {
+        // Размеры проверяются до умножения, чтобы испорченный счетчик не переполнил сумму
+        if (counts[family][0] > size / sizeof(Node) || counts[family][1] > size / sizeof(uint16_t))
+        {
+            ok = false;
+            break;
+        }
+        size_t direct_bytes = kDirectSize * sizeof(uint32_t);
+        size_t node_bytes = align8(counts[family][0] * sizeof(Node));
+        size_t leaf_bytes = align8(counts[family][1] * sizeof(uint16_t));
+        if (pos > size || size - pos < direct_bytes + node_bytes + leaf_bytes)
+        {
+            ok = false;
+            break;
+        }
+        tries[family].direct = reinterpret_cast<const uint32_t*>(base + pos);
+        tries[family].nodes = reinterpret_cast<const Node*>(base + pos + direct_bytes);
+        tries[family].node_count = counts[family][0];
+        tries[family].leaves = reinterpret_cast<const uint16_t*>(base + pos + direct_bytes + node_bytes);
+        tries[family].leaf_count = counts[family][1];
+        pos += direct_bytes + node_bytes + leaf_bytes;
+    }
+    ok = ok && pos == size;
+
+    if (!ok)
+    {
+        munmap(map, size);
+        return false;
+    }
+
+    std::vector<List> previous_lists = std::move(lists_);
+    Trie previous_tries[2] = {tries_[0], tries_[1]};
+    void* previous_map = map_;
+    size_t previous_size = map_size_;
+
+    lists_ = std::move(lists);
+    tries_[0] = tries[0];
+    tries_[1] = tries[1];
+    map_ = map;
+    map_size_ = size;
+    if (!validate())
+    {
+        lists_ = std::move(previous_lists);
+        tries_[0] = previous_tries[0];
+        tries_[1] = previous_tries[1];
+        map_ = previous_map;
+        map_size_ = previous_size;
+        munmap(map, size);
+        return false;
+    }
+
+    if (previous_map)
+        munmap(previous_map, previous_size);
+    for (int family = 0; family < 2; ++family)
+    {
+        direct_storage_[family].clear();
+        node_storage_[family].clear();
+        leaf_storage_[family].clear();
+        pending_[family].clear();
+    }
+    return true;
+}
+
+bool PrefixMatcher::validate() const
+{
+    // Поиск не проверяет границы, поэтому их проверяет загрузка: каждый индекс
+    // узла и листа, который может получиться при поиске, лежит в массиве
+    for (const Trie& trie : tries_)
+    {
+        for (size_t i = 0; i < kDirectSize; ++i)
+        {
+            uint32_t entry = trie.direct[i];
+            if ((entry & kLeaf) ? (entry & 0xffff) > lists_.size() : entry >= trie.node_count)
+                return false;
+        }
+        for (size_t i = 0; i < trie.node_count; ++i)
+        {
+            const Node& node = trie.nodes[i];
+            uint64_t leaves = ~node.vector;
+            if ((node.leafvec & node.vector) != 0)
+                return false;
+            // Первая позиция без потомка обязана начинать серию листьев
+            if (leaves != 0 && (node.leafvec & (leaves & -leaves)) == 0)
+                return false;
+            if (node.base1 + static_cast<uint64_t>(std::popcount(node.vector)) > trie.node_count ||
+                node.base0 + static_cast<uint64_t>(std::popcount(node.leafvec)) > trie.leaf_count)
+                return false;
+        }
+        for (size_t i = 0; i < trie.leaf_count; ++i)
+        {
+            if (trie.leaves[i] > lists_.size())
+                return false;
+        }
+    }
+    return true;
+}
+
+IpListService& IpListService::instance()
+{
+    static IpListService service;
+    return service;
+}
+
+std::shared_ptr<const PrefixMatcher> IpListService::lists()
+{
+    std::call_once(open_once_, [this]()
+    {
+        if (lists_.load())
+            return;
+
+        const char* paths[] = {
+            "/var/lib/security-manager/iplists.bin",
+            "./iplists.bin"
+        };
+        for (const char* path : paths)
+        {
+            if (access(path, F_OK) == 0 && open(path))
+            {
+                LogInfo(std::string("Loaded IP lists from: ") + path);
+                return;
+            }
+        }
+    });
+    return lists_.load(std::memory_order_acquire);
+}
+
+bool IpListService::open(const std::string& path)
+{
+    auto matcher = std::make_shared<PrefixMatcher>();
+    if (!matcher->open(path))
+    {
+        LogWarning("Failed to open IP lists " + path);
+        return false;
+    }
+    lists_.store(std::move(matcher), std::memory_order_release);
+    return true;
+}
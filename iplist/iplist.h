@@ -0,0 +1,180 @@
+/**
+ * @file iplist.h
+ * @brief Списки сетей (threat-intel, allowlist): сжатое префиксное дерево с загрузкой через mmap
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#ifndef IPLIST_H
+#define IPLIST_H
+
+#include "../ipaddress/ipaddress.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Поиск самого длинного совпадающего префикса по спискам сетей
+ *
+ * Устройство как у poptrie: первые 16 бит адреса - индекс в прямой таблице,
+ * дальше узлы по 6 бит. В узле два 64-битных вектора: где дочерние узлы и где
+ * начинается новая серия одинаковых листьев; номер потомка или листа - это
+ * popcount по вектору до нужной позиции, поэтому узел занимает 24 байта, а
+ * соседние одинаковые листья хранятся один раз. IPv4 и IPv6 - отдельные
+ * деревья. Поиск - несколько обращений к памяти без ветвлений по списку
+ * префиксов, десятки наносекунд.
+ *
+ * Собранные деревья сохраняются в файл, который открывается через mmap без
+ * разбора: загрузка занимает время проверки индексов, а не сборки. Если
+ * адрес входит и в блокирующий, и в разрешающий список, побеждает более
+ * длинный префикс, при равной длине - разрешающий.
+ */
+class PrefixMatcher
+{
+public:
+    enum class Kind : uint8_t
+    {
+        Block = 0,  ///< Атакующие сети: повысить серьезность
+        Allow = 1   ///< Доверенные сети: не оповещать
+    };
+
+    struct List
+    {
+        std::string name;
+        Kind kind = Kind::Block;
+        uint64_t prefixes = 0;  ///< Префиксов при сборке
+    };
+
+    PrefixMatcher();
+    ~PrefixMatcher();
+    PrefixMatcher(const PrefixMatcher&) = delete;
+    PrefixMatcher& operator=(const PrefixMatcher&) = delete;
+
+    /**
+     * @brief Добавить список
+     * @return Номер списка для add() и loadFeed()
+     */
+    uint16_t addList(const std::string& name, Kind kind);
+
+    /**
+     * @brief Добавить адрес или сеть в список
+     * @return False если CIDR не разобран
+     */
+    bool add(uint16_t list, std::string_view cidr);
+
+    /**
+     * @brief Загрузить текстовый фид: сеть в начале строки, комментарии после ';' или '#'
+     * @param skipped Сколько непустых строк не разобрано
+     * @return Число добавленных префиксов или -1 если файл не открыт
+     */
+    long loadFeed(uint16_t list, const std::string& path, size_t* skipped = nullptr);
+
+    /**
+     * @brief Собрать деревья из добавленных префиксов
+     */
+    void build();
+
+    /**
+     * @brief Сохранить собранные деревья для open()
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * @brief Открыть файл save() через mmap
+     * @return False если файл не найден, поврежден или от другой версии
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Список самого длинного совпавшего префикса
+     * @return nullptr если адрес ни в одном списке
+     */
+    const List* match(const IpAddress& address) const;
+    const List* match(std::string_view ip) const;
+
+    const std::vector<List>& lists() const { return lists_; }
+
+    /**
+     * @brief Узлов, листьев и байт в деревьях
+     */
+    size_t nodeCount() const { return tries_[0].node_count + tries_[1].node_count; }
+    size_t leafCount() const { return tries_[0].leaf_count + tries_[1].leaf_count; }
+    size_t memoryUsage() const;
+
+private:
+    struct Node
+    {
+        uint64_t vector;   ///< Позиции с дочерними узлами
+        uint64_t leafvec;  ///< Позиции, где начинается новая серия листьев
+        uint32_t base0;    ///< Первый лист узла
+        uint32_t base1;    ///< Первый дочерний узел
+    };
+
+    struct Trie
+    {
+        const uint32_t* direct = nullptr;  ///< 65536 записей: узел или лист (старший бит)
+        const Node* nodes = nullptr;
+        size_t node_count = 0;
+        const uint16_t* leaves = nullptr;  ///< Номер списка + 1, 0 - нет совпадения
+        size_t leaf_count = 0;
+    };
+
+    struct Prefix
+    {
+        unsigned __int128 key;  ///< Адрес, выровненный по старшему биту
+        uint8_t length;
+        uint16_t value;
+    };
+
+    void buildTrie(int family);
+    bool validate() const;
+    void unmap();
+
+    std::vector<List> lists_;
+    std::vector<Prefix> pending_[2];
+    Trie tries_[2];
+
+    std::vector<uint32_t> direct_storage_[2];
+    std::vector<Node> node_storage_[2];
+    std::vector<uint16_t> leaf_storage_[2];
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+};
+
+/**
+ * @brief Списки сетей, общие для процесса
+ *
+ * Файл списков (собирается командой smssh iplist build) открывается при
+ * первом обращении из стандартных мест или явно через open(); замена
+ * атомарна, и уже выданные указатели остаются действительными.
+ */
+class IpListService
+{
+public:
+    static IpListService& instance();
+
+    /**
+     * @brief Текущие списки (nullptr если файла нет)
+     */
+    std::shared_ptr<const PrefixMatcher> lists();
+
+    /**
+     * @brief Открыть указанный файл вместо стандартных
+     */
+    bool open(const std::string& path);
+
+    IpListService(const IpListService&) = delete;
+    IpListService& operator=(const IpListService&) = delete;
+
+private:
+    IpListService() = default;
+
+    std::once_flag open_once_;
+    std::atomic<std::shared_ptr<const PrefixMatcher>> lists_;
+};
+
+#endif
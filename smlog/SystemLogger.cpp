@@ -1,9 +1,14 @@
 #include "SystemLogger.h"
+#include "../geoip/geoip.h"
+#include "../userdir/userdir.h"
+#include "../iplist/iplist.h"
+#include "../ipaddress/ipaddress.h"
 #include <sys/stat.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <cstring>
 #include <ctime>
+#include <unordered_map>
 
 // ===============  КОСТРОКТОРЫ И ДЕСМТРУКТОРЫ ===============
 
@@ -71,6 +76,14 @@ void SystemLogger::startMonitoring()
     monitoring_active_ = true;
     monitor_thread_ = std::thread(&SystemLogger::monitor_loop, this);
     std::cout << "Мониторинг логов запущен\n";
+
+    if (server_config_ && !receiver_)
+    {
+        if (startSyslogServer(*server_config_))
+            std::cout << "Прием syslog на порту " << receiver_->port() << " (" << receiver_->threads() << " потоков)\n";
+        else
+            std::cerr << last_error_ << std::endl;
+    }
 }
 
 void SystemLogger::stopMonitoring()
@@ -80,6 +93,7 @@ void SystemLogger::stopMonitoring()
 
     monitoring_active_ = false;
     monitor_cv_.notify_all();
+    stopSyslogServer();
 
     if (monitor_thread_.joinable())
         monitor_thread_.join();
@@ -129,26 +143,31 @@ std::vector<std::string> SystemLogger::searchLog(const std::string& logPath, con
             return {};
         }
         
-        auto lines = read_lines(logPath);
+        LogFormat format = detectLogFormat(logPath);
         
-        for (const auto& line : lines)
+        // Файл не загружается целиком: в памяти остаются только совпадения
+        bool readable = BulkReader::forEachLine(logPath, [&](std::string_view line)
         {
-            if (line.find(keyword) == std::string::npos)
-                continue;
+            if (line.find(keyword) == std::string_view::npos)
+                return true;
             
             // Проверяем временной диапазон
             if (!timeFrom.empty() || !timeTo.empty())
             {
-                auto entry = parse_log_line(line);
+                auto entry = parse_log_line(std::string(line), format);
                 if (!entry)
-                    continue;
+                    return true;
                 
                 if (!is_time_in_range(entry->timestamp, timeFrom, timeTo))
-                    continue;
+                    return true;
             }
             
-            results.push_back(line);
-        }
+            results.emplace_back(line);
+            return true;
+        });
+        
+        if (!readable)
+            throw std::runtime_error("Не удалось открыть файл: " + logPath);
         
         return results;
         
@@ -301,10 +320,18 @@ std::map<std::string, int> SystemLogger::countByLevel(const std::string& logPath
     try
     {
         auto lines = readLog(logPath, 0);
+        LogFormat format = detectLogFormat(logPath);
+        const auto& registry = LogParserRegistry::instance();
+        LogRecord record;
         
         for (const auto& line : lines)
         {
-            auto level = extract_level_from_line(line);
+            // Уровень из самого формата (PRI, поле level, код ответа), иначе по ключевым словам
+            std::string level;
+            if (registry.parse(line, record, format) && !record.level.empty())
+                level = std::string(record.level);
+            else
+                level = extract_level_from_line(line);
             if (!level.empty())
                 counts[level]++;
         }
@@ -321,30 +348,75 @@ std::map<std::string, int> SystemLogger::countByLevel(const std::string& logPath
 
 std::map<std::string, int> SystemLogger::findTopIPs(const std::string& logPath, int topN)
 {
-    std::map<std::string, int> ip_counts;
+    // Адреса считаются в двоичном виде (разные записи одного IPv6 - один ключ),
+    // в строку переводятся только попавшие в топ
+    std::unordered_map<IpAddress, int> ip_counts;
+    std::map<std::string, int> host_counts;  // Имена хостов вместо адресов (UseDNS)
     
     try
     {
         auto lines = readLog(logPath, 0);
+        LogFormat format = detectLogFormat(logPath);
+        const auto& registry = LogParserRegistry::instance();
+        LogRecord record;
         
         for (const auto& line : lines)
         {
-            auto ip = extract_ip_from_line(line);
-            if (!ip.empty())
-                ip_counts[ip]++;
+            std::string text;
+            if (registry.parse(line, record, format) && !record.client_ip.empty())
+                text = std::string(record.client_ip);
+            else
+                text = extract_ip_from_line(line);
+            if (text.empty())
+                continue;
+            IpAddress address;
+            if (IpAddress::parse(text, address))
+                ip_counts[address]++;
+            else
+                host_counts[text]++;
         }
         
-        // Сортируем по количеству
-        std::vector<std::pair<std::string, int>> sorted(ip_counts.begin(), ip_counts.end());
-        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        // Доверенные сети из списков не попадают в топ
+        if (auto lists = IpListService::instance().lists())
+        {
+            std::erase_if(ip_counts, [&](const auto& entry)
+            {
+                const PrefixMatcher::List* list = lists->match(entry.first);
+                return list && list->kind == PrefixMatcher::Kind::Allow;
+            });
+        }
+
+        // Сортируем по количеству, при равенстве - по адресу
+        std::vector<std::pair<IpAddress, int>> sorted(ip_counts.begin(), ip_counts.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b)
+        {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        std::vector<std::pair<std::string, int>> hosts(host_counts.begin(), host_counts.end());
+        std::stable_sort(hosts.begin(), hosts.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
         
-        // Берем топ N
+        // Берем топ N из обоих списков
         std::map<std::string, int> result;
-        int count = 0;
-        for (const auto& [ip, cnt] : sorted)
+        size_t ip_index = 0;
+        size_t host_index = 0;
+        for (int count = 0; count < topN; ++count)
         {
-            if (count++ >= topN) break;
-            result[ip] = cnt;
+            bool take_ip = ip_index < sorted.size() &&
+                           (host_index == hosts.size() || sorted[ip_index].second >= hosts[host_index].second);
+            if (take_ip)
+            {
+                result[sorted[ip_index].first.toString()] = sorted[ip_index].second;
+                ++ip_index;
+            }
+            else if (host_index < hosts.size())
+            {
+                result[hosts[host_index].first] = hosts[host_index].second;
+                ++host_index;
+            }
+            else
+            {
+                break;
+            }
         }
         
         return result;
@@ -364,10 +436,17 @@ std::map<std::string, int> SystemLogger::findTopUsers(const std::string& logPath
     try
     {
         auto lines = readLog(logPath, 0);
+        LogFormat format = detectLogFormat(logPath);
+        const auto& registry = LogParserRegistry::instance();
+        LogRecord record;
         
         for (const auto& line : lines)
         {
-            auto user = extract_user_from_line(line);
+            std::string user;
+            if (registry.parse(line, record, format) && !record.user.empty())
+                user = std::string(record.user);
+            else
+                user = extract_user_from_line(line);
             if (!user.empty())
                 user_counts[user]++;
         }
@@ -396,9 +475,77 @@ std::map<std::string, int> SystemLogger::findTopUsers(const std::string& logPath
     }
 }
 
+// =============== АУДИТ ===============
+
+std::vector<std::string> SystemLogger::readAuditEvents(const std::string& logPath, int maxEvents)
+{
+    std::vector<std::string> events;
+
+    try
+    {
+        if (!file_exists(logPath))
+        {
+            last_error_ = "Файл не найден: " + logPath;
+            return {};
+        }
+
+        reassemble_audit_file(logPath, [&events](const AuditEvent& event) {
+            events.push_back(event.summary());
+        });
+
+        if (maxEvents > 0 && events.size() > static_cast<size_t>(maxEvents))
+            events.erase(events.begin(), events.end() - maxEvents);
+
+        return events;
+    }
+    catch (const std::exception& e)
+    {
+        last_error_ = "Ошибка чтения аудита: " + std::string(e.what());
+        return {};
+    }
+}
+
+std::map<std::string, int> SystemLogger::getAuditStats(const std::string& logPath)
+{
+    std::map<std::string, int> stats;
+
+    try
+    {
+        if (!file_exists(logPath))
+        {
+            last_error_ = "Файл не найден: " + logPath;
+            return {};
+        }
+
+        auto totals = reassemble_audit_file(logPath, [&stats](const AuditEvent& event) {
+            std::string type = event.type();
+            if (event.failed())
+            {
+                stats["failed"]++;
+                if (type == "USER_LOGIN" || type == "USER_AUTH" || type == "USER_ERR")
+                    stats["failed_logins"]++;
+            }
+            if (event.find("EXECVE"))
+                stats["execve"]++;
+            if (type == "USER_CMD")
+                stats["user_cmd"]++;
+        });
+
+        stats["records"] = static_cast<int>(totals.records);
+        stats["events"] = static_cast<int>(totals.events);
+        stats["evicted"] = static_cast<int>(totals.evicted);
+        return stats;
+    }
+    catch (const std::exception& e)
+    {
+        last_error_ = "Ошибка анализа аудита: " + std::string(e.what());
+        return {};
+    }
+}
+
 // =============== МОНИТОРИНГ И ПРАВИЛА ===============
 
-void SystemLogger::addWatchRule(const std::string& ruleName, const std::string& pattern, const std::string& action, bool checkJournal)
+void SystemLogger::addWatchRule(const std::string& ruleName, const std::string& pattern, const std::string& action, bool checkJournal, bool security)
 {
     std::lock_guard<std::mutex> lock(log_mutex_);
     
@@ -409,6 +556,7 @@ void SystemLogger::addWatchRule(const std::string& ruleName, const std::string&
     rule.created = std::chrono::system_clock::now();
     rule.enabled = true;
     rule.check_journal = checkJournal;
+    rule.security = security;
     
     watch_rules_[ruleName] = rule;
     
@@ -433,6 +581,185 @@ std::vector<std::string> SystemLogger::listWatchRules() const
     return rules;
 }
 
+void SystemLogger::processLogLines(const std::string& logPath, const std::vector<std::string>& lines)
+{
+    if (lines.empty())
+        return;
+    
+    // Пачки одного источника идут по порядку (серии повторов, сборка auditd),
+    // разные источники - например, потоки приема syslog - обрабатываются параллельно
+    std::mutex* source_mutex;
+    AuditReassembler* audit;
+    bool shedding;
+    {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        source_mutex = &source_mutexes_[logPath];
+        audit = audit_reassembler_for(logPath);
+    }
+    std::lock_guard<std::mutex> source_lock(*source_mutex);
+    
+    // Снимок правил берется один раз на пачку, а не под мьютексом на каждую строку
+    std::vector<WatchRule> security_rules;
+    std::vector<WatchRule> other_rules;
+    {
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        for (const auto& [name, rule] : watch_rules_)
+        {
+            if (!rule.enabled)
+                continue;
+            if (rule.security)
+                security_rules.push_back(rule);
+            else
+                other_rules.push_back(rule);
+        }
+    }
+    
+    LogFormat format = detectLogFormat(logPath);
+    bool priority = audit != nullptr || is_priority_source(logPath);
+    
+    {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        shedder_.observe(logPath, lines.size(), priority);
+        shedding = shedder_.isShedding(logPath);
+    }
+    
+    const auto& registry = LogParserRegistry::instance();
+    LogRecord record;
+    std::string notice;
+    size_t passed = 0;
+    
+    for (const auto& line : lines)
+    {
+        if (audit && audit->feed(line))
+            continue;
+        
+        if (check_rules_for_file_line(logPath, line, security_rules))
+        {
+            check_rules_for_file_line(logPath, line, other_rules);
+            forward_line(logPath, line, format);
+            continue;
+        }
+        
+        // Без защиты решение всегда "обработать", счетчики обновляются разом в конце
+        if (!shedding)
+        {
+            passed++;
+            check_rules_for_file_line(logPath, line, other_rules);
+            forward_line(logPath, line, format);
+            continue;
+        }
+        
+        // Повторы сравниваются по тексту сообщения: время и PID при перезапусках меняются
+        std::string_view message = line;
+        if (registry.parse(line, record, format) && !record.message.empty())
+            message = record.message;
+        
+        LoadShedder::Verdict verdict;
+        {
+            std::lock_guard<std::mutex> lock(pipeline_mutex_);
+            verdict = shedder_.admit(logPath, message, notice);
+        }
+        if (!notice.empty())
+        {
+            check_rules_for_file_line(logPath, notice, other_rules);
+            forward_line(logPath, notice, LogFormat::Unknown);
+        }
+        if (verdict == LoadShedder::Verdict::Process)
+        {
+            check_rules_for_file_line(logPath, line, other_rules);
+            forward_line(logPath, line, format);
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        if (passed > 0)
+            shedder_.pass(logPath, passed);
+        notice = shedder_.flush(logPath);
+    }
+    if (!notice.empty())
+    {
+        check_rules_for_file_line(logPath, notice, other_rules);
+        forward_line(logPath, notice, LogFormat::Unknown);
+    }
+}
+
+std::map<std::string, LoadShedder::SourceStats> SystemLogger::getShedStats()
+{
+    std::lock_guard<std::mutex> lock(pipeline_mutex_);
+    return shedder_.stats();
+}
+
+bool SystemLogger::enableForwarding(const LogForwarder::Config& config)
+{
+    disableForwarding();
+    
+    auto forwarder = std::make_unique<LogForwarder>(config);
+    if (!forwarder->start())
+    {
+        last_error_ = forwarder->getLastError();
+        return false;
+    }
+    
+    forwarder_ = std::move(forwarder);
+    return true;
+}
+
+void SystemLogger::disableForwarding()
+{
+    if (forwarder_)
+    {
+        forwarder_->stop();
+        forwarder_.reset();
+    }
+}
+
+bool SystemLogger::flushForwarding(int timeoutMs)
+{
+    return forwarder_ ? forwarder_->flush(timeoutMs) : true;
+}
+
+std::optional<LogForwarder::Counters> SystemLogger::getForwardStats() const
+{
+    if (!forwarder_)
+        return std::nullopt;
+    return forwarder_->counters();
+}
+
+bool SystemLogger::startSyslogServer(const SyslogReceiver::Config& config)
+{
+    stopSyslogServer();
+
+    auto receiver = std::make_unique<SyslogReceiver>(config,
+        [this](const std::string& source, const std::vector<std::string>& messages) {
+            processLogLines(source, messages);
+        });
+    if (!receiver->start())
+    {
+        last_error_ = receiver->getLastError();
+        return false;
+    }
+
+    receiver_ = std::move(receiver);
+    return true;
+}
+
+void SystemLogger::stopSyslogServer()
+{
+    if (receiver_)
+    {
+        receiver_->stop();
+        receiver_.reset();
+    }
+}
+
+std::optional<SyslogReceiver::Counters> SystemLogger::getSyslogServerStats() const
+{
+    if (!receiver_)
+        return std::nullopt;
+    return receiver_->counters();
+}
+
 // =============== УПРАВЛЕНИЕ ЛОГАМИ ===============
 
 bool SystemLogger::rotateLog(const std::string& logPath)
@@ -550,21 +877,37 @@ std::string SystemLogger::generateDailyReport()
     report << "Дистрибутив: " << distribution_ << "\n";
     report << "Поддержка journald: " << (has_journal_support_ ? "да" : "нет") << "\n\n";
     
-    // Статистика по основным логам
+    // Статистика по основным логам: все файлы читаются одним проходом,
+    // чтение следующего файла идет, пока считается текущий
     report << "СТАТИСТИКА ЛОГОВ:\n";
+    std::vector<std::string> names;
+    std::vector<std::string> paths;
     for (const auto& [name, path] : log_paths_)
     {
         if (file_exists(path))
         {
-            auto size = fs::file_size(path);
-            auto lines = read_lines(path, 10000);
-            
-            report << "  " << std::left << std::setw(15) << name 
-                   << ": " << std::setw(10) << lines.size() << " записей, "
-                   << std::setw(10) << size << " байт\n";
+            names.push_back(name);
+            paths.push_back(path);
         }
     }
     
+    std::vector<size_t> line_counts(paths.size(), 0);
+    BulkReader reader;
+    reader.readLines(paths, [&line_counts](size_t file, std::string_view)
+    {
+        return ++line_counts[file] < 10000;
+    });
+    
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        std::error_code ec;
+        auto size = fs::file_size(paths[i], ec);
+        
+        report << "  " << std::left << std::setw(15) << names[i] 
+               << ": " << std::setw(10) << line_counts[i] << " записей, "
+               << std::setw(10) << (ec ? 0 : size) << " байт\n";
+    }
+    
     // SSH статистика
     std::string auth_log;
     if (log_paths_.count("auth"))
@@ -585,9 +928,19 @@ std::string SystemLogger::generateDailyReport()
         {
             auto top_ips = findTopIPs(auth_log, 5);
             report << "  Топ IP с ошибками:\n";
-            for (const auto& [ip, count] : top_ips)\
+            std::vector<std::string> ips;
+            for (const auto& entry : top_ips)
+                ips.push_back(entry.first);
+            auto countries = GeoIPService::instance().countries(ips);
+            auto lists = IpListService::instance().lists();
+
+            size_t index = 0;
+            for (const auto& [ip, count] : top_ips)
             {
-                report << "    " << ip << ": " << count << " попыток\n";
+                report << "    " << ip << " [" << countries[index++] << "]: " << count << " попыток";
+                if (const PrefixMatcher::List* list = lists ? lists->match(ip) : nullptr)
+                    report << " (в списке " << list->name << ")";
+                report << "\n";
             }
         }
     }
@@ -612,20 +965,33 @@ std::string SystemLogger::generateSecurityReport() {
     if (!auth_log.empty() && file_exists(auth_log)) {
         report << "АУТЕНТИФИКАЦИЯ:\n";
         
-        // Неудачные попытки
-        auto failed = searchLog(auth_log, "Failed password");
-        auto invalid = searchLog(auth_log, "Invalid user");
+        // Все счетчики собираются за один проход по логу
+        // Вход под root - это вход под любой учетной записью с UID 0
+        auto users = UserDirectory::instance().snapshot();
+        size_t failed = 0, invalid = 0, root_logins = 0, sudo_events = 0;
+        BulkReader::forEachLine(auth_log, [&](std::string_view line) {
+            failed += line.find("Failed password") != std::string_view::npos;
+            invalid += line.find("Invalid user") != std::string_view::npos;
+            size_t accepted = line.find("Accepted ");
+            if (accepted != std::string_view::npos)
+            {
+                size_t user_start = line.find(" for ", accepted);
+                size_t user_end = user_start == std::string_view::npos ? user_start : line.find(" from ", user_start);
+                if (user_end != std::string_view::npos)
+                    root_logins += users->isSuperuser(line.substr(user_start + 5, user_end - user_start - 5));
+            }
+            sudo_events += line.find("sudo:") != std::string_view::npos;
+            return true;
+        });
         
-        report << "  Неудачных попыток: " << failed.size() << "\n";
-        report << "  Несуществующих пользователей: " << invalid.size() << "\n";
+        report << "  Неудачных попыток: " << failed << "\n";
+        report << "  Несуществующих пользователей: " << invalid << "\n";
         
         // Root логины
-        auto root_logins = searchLog(auth_log, "Accepted.*root");
-        report << "  Входов под root: " << root_logins.size() << "\n";
+        report << "  Входов под root: " << root_logins << "\n";
         
         // Подозрительные активности
-        auto sudo_events = searchLog(auth_log, "sudo:");
-        report << "  Sudo команд: " << sudo_events.size() << "\n";
+        report << "  Sudo команд: " << sudo_events << "\n";
     }
     
     // Проверяем syslog на ошибки
@@ -648,6 +1014,17 @@ std::string SystemLogger::generateSecurityReport() {
         }
     }
     
+    // Аудит: события собираются из записей SYSCALL/EXECVE/PATH/...
+    if (log_paths_.count("audit") && file_exists(log_paths_["audit"])) {
+        auto audit = getAuditStats(log_paths_["audit"]);
+        report << "\nАУДИТ:\n";
+        report << "  Событий: " << audit["events"] << " (записей: " << audit["records"] << ")\n";
+        report << "  Неуспешных событий: " << audit["failed"] << "\n";
+        report << "  Неудачных входов: " << audit["failed_logins"] << "\n";
+        report << "  Запусков программ: " << audit["execve"] << "\n";
+        report << "  Команд через sudo: " << audit["user_cmd"] << "\n";
+    }
+    
     report << "\nАКТИВНЫЕ ПРАВИЛА МОНИТОРИНГА: " << watch_rules_.size() << "\n";
     
     return report.str();
@@ -669,6 +1046,39 @@ std::string SystemLogger::generateSystemReport() {
         }
     }
     
+    if (auto server = getSyslogServerStats()) {
+        report << "\nПРИЕМ SYSLOG:\n";
+        report << "  Порт: " << receiver_->port() << " (" << receiver_->threads() << " потоков)\n";
+        report << "  Принято: UDP " << server->udp_messages << ", TCP " << server->tcp_messages
+               << " сообщений, " << server->bytes << " байт\n";
+        report << "  Соединений: " << server->active_connections << " активных, " << server->connections
+               << " всего, отклонено " << server->rejected << "\n";
+        report << "  Обрезано: " << server->truncated << ", ошибок кадрирования: " << server->framing_errors << "\n";
+    }
+    
+    if (auto forward = getForwardStats()) {
+        report << "\nПЕРЕСЫЛКА НА КОЛЛЕКТОР:\n";
+        report << "  Соединение: " << (forward->connected ? "установлено" : "нет") << "\n";
+        report << "  Отправлено: " << forward->sent << " событий, " << forward->batches_sent << " пачек, "
+               << forward->bytes_sent << " байт (до сжатия " << forward->bytes_raw << ")\n";
+        report << "  Отставание: " << forward->lag << " событий (в спуле " << forward->spool_files << " пачек, "
+               << forward->spool_bytes << " байт)\n";
+        report << "  Скорость: " << std::fixed << std::setprecision(0) << forward->throughput << " событий/с\n";
+        report << "  Потеряно: " << forward->dropped << "\n";
+    }
+    
+    auto shed_stats = getShedStats();
+    if (!shed_stats.empty()) {
+        report << "\nЗАЩИТА ОТ ПЕРЕГРУЗКИ:\n";
+        for (const auto& [source, stats] : shed_stats) {
+            report << "  " << source << ": " << std::fixed << std::setprecision(0) << stats.rate << " строк/с"
+                   << (stats.shedding ? " (прореживание 1/" + std::to_string(stats.sample_every) + ")" : "")
+                   << ", обработано " << stats.processed
+                   << ", отброшено " << stats.sampled_out
+                   << ", свернуто " << stats.collapsed << "\n";
+        }
+    }
+    
     return report.str();
 }
 
@@ -858,6 +1268,31 @@ bool SystemLogger::isLogFile(const std::string& path) {
     return false;
 }
 
+LogFormat SystemLogger::detectLogFormat(const std::string& logPath)
+{
+    // Сетевые источники (syslog://) определяются построчно
+    if (logPath.find("://") != std::string::npos)
+        return LogFormat::Unknown;
+
+    {
+        std::lock_guard<std::mutex> lock(formats_mutex_);
+        auto it = log_formats_.find(logPath);
+        if (it != log_formats_.end())
+            return it->second;
+    }
+
+    LogFormat format = LogParserRegistry::instance().detectFile(logPath);
+
+    // Пустой или нечитаемый файл не кэшируем - формат определится позже
+    if (format != LogFormat::Unknown)
+    {
+        std::lock_guard<std::mutex> lock(formats_mutex_);
+        log_formats_[logPath] = format;
+    }
+
+    return format;
+}
+
 // =============== ПРИВАТНЫЕ МЕТОДЫ - ФАЙЛЫ ===============
 
 bool SystemLogger::file_exists(const std::string& path) {
@@ -867,21 +1302,17 @@ bool SystemLogger::file_exists(const std::string& path) {
 
 std::vector<std::string> SystemLogger::read_lines(const std::string& path, int max_lines) {
     std::vector<std::string> lines;
-    std::ifstream file(path);
-    
-    if (!file.is_open()) {
-        throw std::runtime_error("Не удалось открыть файл: " + path);
-    }
     
-    std::string line;
-    int count = 0;
-    
-    while (std::getline(file, line)) {
-        if (max_lines > 0 && count >= max_lines) {
-            break;
+    bool readable = BulkReader::forEachLine(path, [&](std::string_view line) {
+        if (max_lines > 0 && static_cast<int>(lines.size()) >= max_lines) {
+            return false;
         }
-        lines.push_back(line);
-        count++;
+        lines.emplace_back(line);
+        return true;
+    });
+    
+    if (!readable && lines.empty()) {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
     }
     
     return lines;
@@ -948,7 +1379,7 @@ std::string SystemLogger::get_file_size_human(const std::string& path) {
 
 // =============== ПРИВАТНЫЕ МЕТОДЫ - ПАРСИНГ ===============
 
-std::optional<SystemLogger::LogEntry> SystemLogger::parse_log_line(const std::string& line) {
+std::optional<SystemLogger::LogEntry> SystemLogger::parse_log_line(const std::string& line, LogFormat format) {
     if (line.empty()) {
         return std::nullopt;
     }
@@ -956,36 +1387,18 @@ std::optional<SystemLogger::LogEntry> SystemLogger::parse_log_line(const std::st
     LogEntry entry;
     entry.raw_line = line;
     
-    try {
-        // Пример формата: "Jan 15 10:30:45 hostname service[pid]: message"
-        std::regex syslog_regex(R"(^(\w{3}\s+\d{1,2}\s+\d{2}:\d{2}:\d{2})\s+(\S+)\s+(\S+)\[(\d+)\]:\s+(.+)$)");
-        std::smatch match;
-        
-        if (std::regex_search(line, match, syslog_regex) && match.size() == 6) {
-            entry.timestamp = match[1].str();
-            entry.hostname = match[2].str();
-            entry.service = match[3].str();
-            entry.pid = match[4].str();
-            entry.message = match[5].str();
-            return entry;
-        }
-    } catch (...) {
-        // Не удалось распарсить как syslog
-    }
-    
-    // Простой парсинг для других форматов
-    if (line.length() > 15) {
-        entry.timestamp = line.substr(0, 15);
-    }
-    
-    size_t first_space = line.find(' ', 16);
-    if (first_space != std::string::npos) {
-        size_t second_space = line.find(' ', first_space + 1);
-        if (second_space != std::string::npos) {
-            entry.hostname = line.substr(first_space + 1, second_space - first_space - 1);
-        }
+    LogRecord record;
+    if (LogParserRegistry::instance().parse(line, record, format)) {
+        entry.timestamp = std::string(record.timestamp);
+        entry.hostname = std::string(record.hostname);
+        entry.service = std::string(record.service);
+        entry.pid = std::string(record.pid);
+        entry.level = std::string(record.level);
+        entry.message = std::string(record.message);
+        return entry;
     }
     
+    // Неизвестный формат - сохраняем строку целиком
     entry.message = line;
     return entry;
 }
@@ -1269,16 +1682,72 @@ std::string SystemLogger::parse_relative_time(const std::string& rel_time) {
 
 // =============== ПРИВАТНЫЕ МЕТОДЫ - ОБРАБОТКА ПРАВИЛ ===============
 
-void SystemLogger::check_rules_for_file_line(const std::string& logPath, const std::string& line) {
-    std::lock_guard<std::mutex> lock(log_mutex_);
+bool SystemLogger::check_rules_for_file_line(const std::string& logPath,
+                                             const std::string& line,
+                                             const std::vector<WatchRule>& rules) {
+    bool matched = false;
     
-    for (const auto& [name, rule] : watch_rules_) {
-        if (!rule.enabled) continue;
-        
+    for (const auto& rule : rules) {
         if (line.find(rule.pattern) != std::string::npos) {
             execute_rule_action(rule, logPath, line);
+            matched = true;
         }
     }
+    
+    return matched;
+}
+
+AuditReassembler* SystemLogger::audit_reassembler_for(const std::string& logPath) {
+    // Записи auditd сначала собираются в события
+    if (detectLogFormat(logPath) != LogFormat::Auditd) {
+        return nullptr;
+    }
+    
+    auto& reassembler = audit_reassemblers_[logPath];
+    if (!reassembler) {
+        reassembler = std::make_unique<AuditReassembler>(
+            [this, logPath](const AuditEvent& event) {
+                check_rules_for_audit_event(logPath, event);
+            });
+    }
+    return reassembler.get();
+}
+
+void SystemLogger::forward_line(const std::string& logPath, const std::string& line, LogFormat format) {
+    if (!forwarder_) {
+        return;
+    }
+    
+    ForwardEvent event;
+    event.source = logPath;
+    
+    LogRecord record;
+    if (LogParserRegistry::instance().parse(line, record, format)) {
+        event.timestamp = std::string(record.timestamp);
+        event.hostname = std::string(record.hostname);
+        event.service = std::string(record.service);
+        event.pid = std::string(record.pid);
+        event.level = std::string(record.level);
+        event.message = record.format == LogFormat::JsonLines ? jsonUnescape(record.message)
+                                                              : std::string(record.message);
+        event.severity = record.severity;
+    } else {
+        event.message = line;
+    }
+    
+    forwarder_->forward(event);
+}
+
+bool SystemLogger::is_priority_source(const std::string& logPath) const {
+    static const std::vector<std::string> security_logs = {"auth", "secure", "audit", "fail2ban"};
+    
+    for (const auto& name : security_logs) {
+        auto it = log_paths_.find(name);
+        if (it != log_paths_.end() && it->second == logPath) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void SystemLogger::check_rules_for_journal_entry(const JournalEntry& entry) {
@@ -1294,14 +1763,56 @@ void SystemLogger::check_rules_for_journal_entry(const JournalEntry& entry) {
     }
 }
 
+void SystemLogger::check_rules_for_audit_event(const std::string& logPath, const AuditEvent& event) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    
+    // Правила проверяются по описанию всего события, а не по отдельным записям
+    std::string summary = event.summary();
+    for (const auto& [name, rule] : watch_rules_) {
+        if (!rule.enabled) continue;
+        
+        if (summary.find(rule.pattern) != std::string::npos) {
+            execute_rule_action(rule, logPath, summary);
+        }
+    }
+}
+
+AuditReassembler::Stats SystemLogger::reassemble_audit_file(const std::string& path,
+                                                            const AuditReassembler::EventCallback& callback) {
+    AuditReassembler reassembler(callback);
+    bool readable = BulkReader::forEachLine(path, [&reassembler](std::string_view line) {
+        reassembler.feed(line);
+        return true;
+    });
+    if (!readable) {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
+    }
+    reassembler.flush();
+    
+    return reassembler.stats();
+}
+
 void SystemLogger::execute_rule_action(const WatchRule& rule, 
                                       const std::string& source, 
                                       const std::string& message) {
+    // Потоки приема syslog выводят алерты одновременно: блок не должен перемешиваться
+    std::unique_lock<std::mutex> alert_lock(alert_mutex_);
     std::cout << "⚡ СРАБОТАЛО ПРАВИЛО: " << rule.name << std::endl;
     std::cout << "   Источник: " << source << std::endl;
     std::cout << "   Сообщение: " << message << std::endl;
     std::cout << "   Действие: " << rule.action << std::endl;
     std::cout << std::string(50, '-') << std::endl;
+    alert_lock.unlock();
+    
+    if (forwarder_) {
+        ForwardEvent alert;
+        alert.type = "alert";
+        alert.source = source;
+        alert.rule = rule.name;
+        alert.level = "ALERT";
+        alert.message = message;
+        forwarder_->forward(alert);
+    }
     
     // Здесь можно добавить реальные действия:
     // - Отправка email
@@ -1370,10 +1881,12 @@ void SystemLogger::check_file_log_changes() {
                     if (file.is_open()) {
                         file.seekg(last_size);
                         
+                        std::vector<std::string> lines;
                         std::string line;
                         while (std::getline(file, line)) {
-                            check_rules_for_file_line(path, line);
+                            lines.push_back(std::move(line));
                         }
+                        processLogLines(path, lines);
                     }
                 }
             }
@@ -1415,6 +1928,8 @@ bool SystemLogger::load_config() {
     
     try {
         auto lines = read_lines(config_path_);
+        LogForwarder::Config forward_config;
+        std::string forward_target;
         
         for (const auto& line : lines) {
             // Простой парсинг конфига формата key=value
@@ -1423,6 +1938,51 @@ bool SystemLogger::load_config() {
                 std::string key = line.substr(0, equals_pos);
                 std::string value = line.substr(equals_pos + 1);
                 
+                // Лимиты защиты от перегрузки
+                if (key == "shed.source_rate" || key == "shed.total_rate") {
+                    auto limits = shedder_.limits();
+                    (key == "shed.source_rate" ? limits.source_rate : limits.total_rate) = std::stod(value);
+                    shedder_.setLimits(limits);
+                }
+                
+                // Пересылка на коллектор
+                if (key == "forward.target") {
+                    forward_target = value;
+                } else if (key == "forward.format") {
+                    forward_config.framing = value == "json" ? LogForwarder::Framing::JsonLines
+                                                             : LogForwarder::Framing::OctetCounted;
+                } else if (key == "forward.spool") {
+                    forward_config.spool_dir = value;
+                } else if (key == "forward.compress") {
+                    forward_config.compress = value != "false";
+                }
+                
+                // Массовое чтение файлов (отчеты, поиск)
+                if (key == "scan.cache" || key == "scan.queue_depth" || key == "scan.block_kb") {
+                    auto options = BulkReader::defaultOptions();
+                    if (key == "scan.cache") {
+                        BulkReader::parseCacheMode(value, options.cache);
+                    } else if (key == "scan.queue_depth") {
+                        options.queue_depth = std::stoul(value);
+                    } else {
+                        options.block_size = std::stoul(value) * 1024;
+                    }
+                    BulkReader::setDefaultOptions(options);
+                }
+                
+                // Прием syslog по сети
+                if (key == "server.listen") {
+                    SyslogReceiver::Config server_config = server_config_.value_or(SyslogReceiver::Config{});
+                    if (SyslogReceiver::parseListen(value, server_config)) {
+                        server_config_ = server_config;
+                    }
+                } else if (key == "server.threads" && server_config_) {
+                    server_config_->threads = std::stoul(value);
+                } else if (key == "server.protocols" && server_config_) {
+                    server_config_->udp = value.find("udp") != std::string::npos;
+                    server_config_->tcp = value.find("tcp") != std::string::npos;
+                }
+                
                 // Обрабатываем правила
                 if (key.find("rule.") == 0) {
                     // Формат: rule.name.pattern=value или rule.name.action=value
@@ -1431,6 +1991,10 @@ bool SystemLogger::load_config() {
             }
         }
         
+        if (!forward_target.empty() && LogForwarder::parseTarget(forward_target, forward_config)) {
+            enableForwarding(forward_config);
+        }
+        
         return true;
         
     } catch (...) {
@@ -1454,11 +2018,40 @@ bool SystemLogger::save_config() {
             config_file << name << "=" << path << "\n";
         }
         
+        config_file << "\n[Shedding]\n";
+        config_file << "shed.source_rate=" << shedder_.limits().source_rate << "\n";
+        config_file << "shed.total_rate=" << shedder_.limits().total_rate << "\n";
+        
+        auto scan = BulkReader::defaultOptions();
+        config_file << "\n[Scanning]\n";
+        config_file << "scan.cache=" << BulkReader::cacheModeName(scan.cache) << "\n";
+        config_file << "scan.queue_depth=" << scan.queue_depth << "\n";
+        config_file << "scan.block_kb=" << scan.block_size / 1024 << "\n";
+        
+        if (forwarder_) {
+            const auto& forward = forwarder_->config();
+            config_file << "\n[Forwarding]\n";
+            config_file << "forward.target=" << forward.host << ":" << forward.port << "\n";
+            config_file << "forward.format=" << (forward.framing == LogForwarder::Framing::JsonLines ? "json" : "syslog") << "\n";
+            config_file << "forward.spool=" << forward.spool_dir << "\n";
+            config_file << "forward.compress=" << (forward.compress ? "true" : "false") << "\n";
+        }
+        
+        if (server_config_) {
+            config_file << "\n[Server]\n";
+            config_file << "server.listen=" << server_config_->address << ":" << server_config_->port << "\n";
+            config_file << "server.threads=" << server_config_->threads << "\n";
+            config_file << "server.protocols=" << (server_config_->udp ? "udp" : "")
+                        << (server_config_->udp && server_config_->tcp ? "," : "")
+                        << (server_config_->tcp ? "tcp" : "") << "\n";
+        }
+        
         config_file << "\n[Rules]\n";
         for (const auto& [name, rule] : watch_rules_) {
             config_file << "rule." << name << ".pattern=" << rule.pattern << "\n";
             config_file << "rule." << name << ".action=" << rule.action << "\n";
             config_file << "rule." << name << ".journal=" << (rule.check_journal ? "true" : "false") << "\n";
+            config_file << "rule." << name << ".security=" << (rule.security ? "true" : "false") << "\n";
         }
         
         config_file.close();
@@ -28,6 +28,13 @@
 #include <array>
 #include <functional>
 
+#include "logParsers.h"
+#include "auditReassembler.h"
+#include "loadShedder.h"
+#include "logForwarder.h"
+#include "syslogReceiver.h"
+#include "../bulkreader/bulkreader.h"
+
 namespace fs = std::filesystem;
 
 /**
@@ -173,6 +180,23 @@ public:
      */
     std::map<std::string, int> findTopUsers(const std::string& logPath,
                                            int topN = 10);
+
+    // Аудит (auditd)
+    /**
+     * @brief Прочитать события аудита, собранные из отдельных записей
+     * @param logPath Путь к audit.log
+     * @param maxEvents Количество последних событий (0 = все)
+     * @return Вектор описаний событий
+     */
+    std::vector<std::string> readAuditEvents(const std::string& logPath,
+                                             int maxEvents = 50);
+
+    /**
+     * @brief Получить статистику событий аудита
+     * @param logPath Путь к audit.log
+     * @return Карта показатель -> количество (events, failed, failed_logins, execve, records, evicted)
+     */
+    std::map<std::string, int> getAuditStats(const std::string& logPath);
     
     // Мониторинг и правила
     /**
@@ -181,11 +205,13 @@ public:
      * @param pattern Шаблон для поиска
      * @param action Действие при срабатывании
      * @param checkJournal Проверять ли journal (по умолчанию true)
+     * @param security Правило безопасности - совпадающие строки обрабатываются даже под нагрузкой
      */
     void addWatchRule(const std::string& ruleName,
                      const std::string& pattern,
                      const std::string& action,
-                     bool checkJournal = true);
+                     bool checkJournal = true,
+                     bool security = false);
 
     /**
      * @brief Удалить правило наблюдения
@@ -198,6 +224,71 @@ public:
      * @return Вектор имен правил
      */
     std::vector<std::string> listWatchRules() const;
+
+    /**
+     * @brief Прогнать новые строки лога через конвейер мониторинга
+     *
+     * Правила снимаются один раз на пачку. Под нагрузкой строки источников
+     * низкого приоритета сворачиваются и прореживаются; строки, совпавшие
+     * с правилами безопасности, обрабатываются всегда.
+     * @param logPath Путь к файлу лога (источник)
+     * @param lines Новые строки
+     */
+    void processLogLines(const std::string& logPath, const std::vector<std::string>& lines);
+
+    /**
+     * @brief Получить статистику сброса нагрузки по источникам
+     * @return Карта источник -> статистика
+     */
+    std::map<std::string, LoadShedder::SourceStats> getShedStats();
+
+    // Пересылка на коллектор
+    /**
+     * @brief Включить пересылку записей и алертов на удаленный коллектор
+     * @param config Настройки пересылки
+     * @return True если пересылка запущена
+     */
+    bool enableForwarding(const LogForwarder::Config& config);
+
+    /**
+     * @brief Остановить пересылку (неотправленное сохраняется в спул)
+     */
+    void disableForwarding();
+
+    /**
+     * @brief Дождаться отправки накопленных событий
+     * @param timeoutMs Максимальное ожидание
+     * @return True если все отправлено
+     */
+    bool flushForwarding(int timeoutMs = 5000);
+
+    /**
+     * @brief Получить счетчики пересылки
+     * @return Счетчики или std::nullopt если пересылка выключена
+     */
+    std::optional<LogForwarder::Counters> getForwardStats() const;
+
+    // Прием syslog по сети
+    /**
+     * @brief Запустить прием syslog по UDP/TCP (режим коллектора)
+     *
+     * Сообщения каждого хоста проходят тот же конвейер, что и строки файлов,
+     * с источником "syslog://<ip>".
+     * @param config Настройки сервера
+     * @return True если сервер запущен
+     */
+    bool startSyslogServer(const SyslogReceiver::Config& config);
+
+    /**
+     * @brief Остановить прием syslog
+     */
+    void stopSyslogServer();
+
+    /**
+     * @brief Получить счетчики приема syslog
+     * @return Счетчики или std::nullopt если сервер не запущен
+     */
+    std::optional<SyslogReceiver::Counters> getSyslogServerStats() const;
     
     // Управление ротацией и очисткой
     /**
@@ -332,6 +423,13 @@ public:
      */
     static bool isLogFile(const std::string& path);
 
+    /**
+     * @brief Определить формат файла лога (результат кэшируется по пути)
+     * @param logPath Путь к файлу лога
+     * @return Формат лога или LogFormat::Unknown
+     */
+    LogFormat detectLogFormat(const std::string& logPath);
+
 private:
     // Структуры данных
     struct LogEntry {
@@ -372,11 +470,13 @@ private:
         std::chrono::system_clock::time_point created;
         bool enabled;
         bool check_journal;
+        bool security;
         
         std::string toString() const
         {
             return name + ": '" + pattern + "' -> " + action +
-                   " [journal: " + (check_journal ? "yes" : "no") + "]";
+                   " [journal: " + (check_journal ? "yes" : "no") +
+                   (security ? ", security" : "") + "]";
         }
     };
     
@@ -419,7 +519,7 @@ private:
     std::string get_file_size_human(const std::string& path);
     
     // Приватные методы - парсинг
-    std::optional<LogEntry> parse_log_line(const std::string& line);
+    std::optional<LogEntry> parse_log_line(const std::string& line, LogFormat format = LogFormat::Unknown);
     std::optional<JournalEntry> parse_journal_json(const std::string& json_line);
     std::string extract_ip_from_line(const std::string& line);
     std::string extract_user_from_line(const std::string& line);
@@ -441,8 +541,16 @@ private:
     std::string parse_relative_time(const std::string& rel_time);
     
     // Приватные методы - обработка правил
-    void check_rules_for_file_line(const std::string& logPath, const std::string& line);
+    bool check_rules_for_file_line(const std::string& logPath,
+                                   const std::string& line,
+                                   const std::vector<WatchRule>& rules);
+    AuditReassembler* audit_reassembler_for(const std::string& logPath);
+    bool is_priority_source(const std::string& logPath) const;
+    void forward_line(const std::string& logPath, const std::string& line, LogFormat format);
     void check_rules_for_journal_entry(const JournalEntry& entry);
+    void check_rules_for_audit_event(const std::string& logPath, const AuditEvent& event);
+    AuditReassembler::Stats reassemble_audit_file(const std::string& path,
+                                                  const AuditReassembler::EventCallback& callback);
     void execute_rule_action(const WatchRule& rule, 
                             const std::string& source, 
                             const std::string& message);
@@ -471,9 +579,20 @@ private:
     std::map<std::string, size_t> last_file_sizes_;
     std::map<std::string, std::string> log_paths_;
     std::map<std::string, std::string> journal_cursors_;
+    std::map<std::string, LogFormat> log_formats_;
+    std::map<std::string, std::unique_ptr<AuditReassembler>> audit_reassemblers_;
     
     std::thread monitor_thread_;
     std::mutex log_mutex_;
+    std::mutex formats_mutex_;
+    std::mutex pipeline_mutex_;   ///< Общее состояние конвейера: shedder_, сборщики auditd
+    std::mutex alert_mutex_;
+    std::map<std::string, std::mutex> source_mutexes_;  ///< Порядок пачек внутри источника
+    
+    LoadShedder shedder_;
+    std::unique_ptr<LogForwarder> forwarder_;
+    std::unique_ptr<SyslogReceiver> receiver_;
+    std::optional<SyslogReceiver::Config> server_config_;  ///< Из конфига, запускается вместе с мониторингом
     std::condition_variable monitor_cv_;
     
     // Callback для алертов
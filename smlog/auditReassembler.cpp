@@ -0,0 +1,381 @@
+/**
+ * @file auditReassembler.cpp
+ * @brief Реализация сборки событий auditd
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "auditReassembler.h"
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    /**
+     * @brief Типы вспомогательных записей, приходящих вместе с SYSCALL
+     */
+    bool is_syscall_aux(std::string_view type)
+    {
+        static constexpr std::array<std::string_view, 13> aux = {
+            "SYSCALL", "EXECVE", "CWD", "PATH", "PROCTITLE", "SOCKADDR", "SOCKETCALL",
+            "FD_PAIR", "MMAP", "BPRM_FCAPS", "CAPSET", "IPC", "OBJ_PID"
+        };
+        return std::find(aux.begin(), aux.end(), type) != aux.end();
+    }
+
+    /**
+     * @brief Поля, которые auditd записывает как "untrusted string" (в кавычках или hex)
+     */
+    bool is_encoded_field(std::string_view key)
+    {
+        static constexpr std::array<std::string_view, 10> keys = {
+            "name", "exe", "comm", "cwd", "proctitle", "acct", "path", "data", "key", "cmd"
+        };
+        if (std::find(keys.begin(), keys.end(), key) != keys.end())
+            return true;
+
+        // Аргументы EXECVE: a0, a1, ...
+        if (key.size() >= 2 && key[0] == 'a')
+            return std::all_of(key.begin() + 1, key.end(), [](char c) { return c >= '0' && c <= '9'; });
+        return false;
+    }
+
+    int hex_digit(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    bool parse_uint(std::string_view s, uint64_t& out)
+    {
+        if (s.empty())
+            return false;
+        out = 0;
+        for (char c : s)
+        {
+            if (c < '0' || c > '9')
+                return false;
+            out = out * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return true;
+    }
+
+    /**
+     * @brief Найти значение key= в теле записи
+     *
+     * Пользовательские записи содержат вложенные поля внутри msg='...',
+     * поэтому ключ может начинаться и после одинарной кавычки.
+     */
+    std::string_view find_field(std::string_view body, std::string_view key)
+    {
+        size_t pos = 0;
+        while ((pos = body.find(key, pos)) != std::string_view::npos)
+        {
+            size_t eq = pos + key.size();
+            bool at_start = pos == 0 || body[pos - 1] == ' ' || body[pos - 1] == '\'';
+            if (at_start && eq < body.size() && body[eq] == '=')
+            {
+                size_t start = eq + 1;
+                if (start < body.size() && body[start] == '"')
+                {
+                    size_t end = body.find('"', start + 1);
+                    return body.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start + 1);
+                }
+                size_t end = body.find_first_of(" '", start);
+                return body.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+            }
+            pos = eq;
+        }
+        return {};
+    }
+
+    /**
+     * @brief Снять кавычки или декодировать hex-значение поля
+     */
+    std::string decode_value(std::string_view key, std::string_view raw_value)
+    {
+        if (raw_value.empty())
+            return {};
+
+        if (raw_value.front() == '"')
+        {
+            raw_value.remove_prefix(1);
+            if (!raw_value.empty() && raw_value.back() == '"')
+                raw_value.remove_suffix(1);
+            return std::string(raw_value);
+        }
+
+        // Без кавычек "untrusted string" записывается в hex
+        if (is_encoded_field(key) && raw_value.size() % 2 == 0 && raw_value != "(null)")
+        {
+            std::string decoded;
+            decoded.reserve(raw_value.size() / 2);
+            for (size_t i = 0; i < raw_value.size(); i += 2)
+            {
+                int hi = hex_digit(raw_value[i]);
+                int lo = hex_digit(raw_value[i + 1]);
+                if (hi < 0 || lo < 0)
+                    return std::string(raw_value);
+                char c = static_cast<char>((hi << 4) | lo);
+                decoded.push_back(c == '\0' ? ' ' : c);  // proctitle разделяет аргументы нулями
+            }
+            return decoded;
+        }
+
+        return std::string(raw_value);
+    }
+}
+
+// =============== СОБЫТИЕ ===============
+
+const AuditRecord* AuditEvent::find(std::string_view type) const
+{
+    for (const auto& record : records)
+    {
+        if (record.type == type)
+            return &record;
+    }
+    return nullptr;
+}
+
+std::string_view AuditEvent::raw(std::string_view type, std::string_view key) const
+{
+    const AuditRecord* record = find(type);
+    if (!record)
+        return {};
+    return find_field(record->body, key);
+}
+
+std::string AuditEvent::value(std::string_view type, std::string_view key) const
+{
+    return decode_value(key, raw(type, key));
+}
+
+bool AuditEvent::failed() const
+{
+    if (records.empty())
+        return false;
+
+    const std::string& first = records.front().type;
+    return raw(first, "success") == "no" || raw(first, "res") == "failed" || raw(first, "res") == "0";
+}
+
+std::string AuditEvent::commandLine() const
+{
+    if (const AuditRecord* execve = find("EXECVE"))
+    {
+        uint64_t argc = 0;
+        parse_uint(find_field(execve->body, "argc"), argc);
+
+        std::string command;
+        for (uint64_t i = 0; i < argc; ++i)
+        {
+            std::string arg = value("EXECVE", "a" + std::to_string(i));
+            if (!command.empty())
+                command += ' ';
+            command += arg;
+        }
+        if (!command.empty())
+            return command;
+    }
+
+    if (find("PROCTITLE"))
+        return value("PROCTITLE", "proctitle");
+
+    // USER_CMD (sudo) хранит команду в поле cmd
+    return records.empty() ? std::string() : value(records.front().type, "cmd");
+}
+
+std::string AuditEvent::summary() const
+{
+    if (records.empty())
+        return {};
+
+    std::string first = type();
+    std::string result = first;
+
+    static constexpr std::array<std::string_view, 10> keys = {
+        "exe", "acct", "auid", "uid", "addr", "terminal", "syscall", "success", "res", "key"
+    };
+    for (auto key : keys)
+    {
+        std::string v = value(first, key);
+        if (!v.empty() && v != "?" && v != "(null)")
+            result += " " + std::string(key) + "=" + v;
+    }
+
+    std::string command = commandLine();
+    if (!command.empty())
+        result += " cmd='" + command + "'";
+
+    std::string cwd = find("CWD") ? value("CWD", "cwd") : value(first, "cwd");
+    if (!cwd.empty())
+        result += " cwd=" + cwd;
+
+    for (const auto& record : records)
+    {
+        if (record.type != "PATH")
+            continue;
+        std::string_view name = find_field(record.body, "name");
+        if (name.empty() || name == "(null)")
+            continue;
+
+        result += " path=" + decode_value("name", name);
+    }
+
+    return result;
+}
+
+// =============== СБОРЩИК ===============
+
+size_t AuditReassembler::EventKeyHash::operator()(const EventKey& key) const
+{
+    size_t hash = std::hash<uint64_t>()(key.serial * 0x9e3779b97f4a7c15ULL ^ key.timestamp_ms);
+    return key.node.empty() ? hash : hash ^ (std::hash<std::string>()(key.node) * 31);
+}
+
+AuditReassembler::AuditReassembler(EventCallback callback, uint64_t max_age_ms, size_t max_pending)
+    : callback_(std::move(callback)), max_age_ms_(max_age_ms), max_pending_(max_pending)
+{
+}
+
+bool AuditReassembler::feed(std::string_view line)
+{
+    size_t pos = 0;
+    std::string_view node;
+
+    if (line.substr(0, 5) == "node=")
+    {
+        size_t end = line.find(' ');
+        if (end == std::string_view::npos)
+        {
+            stats_.malformed++;
+            return false;
+        }
+        node = line.substr(5, end - 5);
+        pos = end + 1;
+    }
+
+    if (line.substr(pos, 5) != "type=")
+    {
+        stats_.malformed++;
+        return false;
+    }
+    pos += 5;
+
+    size_t type_end = line.find(' ', pos);
+    if (type_end == std::string_view::npos)
+    {
+        stats_.malformed++;
+        return false;
+    }
+    std::string_view type = line.substr(pos, type_end - pos);
+
+    pos = type_end + 1;
+    if (line.substr(pos, 10) != "msg=audit(")
+    {
+        stats_.malformed++;
+        return false;
+    }
+    pos += 10;
+
+    // audit(1700000000.123:42):
+    size_t dot = line.find('.', pos);
+    size_t colon = line.find(':', pos);
+    size_t close = line.find(')', pos);
+    uint64_t seconds = 0, millis = 0, serial = 0;
+    if (dot == std::string_view::npos || colon == std::string_view::npos || close == std::string_view::npos ||
+        dot > colon || colon > close ||
+        !parse_uint(line.substr(pos, dot - pos), seconds) ||
+        !parse_uint(line.substr(dot + 1, colon - dot - 1), millis) ||
+        !parse_uint(line.substr(colon + 1, close - colon - 1), serial))
+    {
+        stats_.malformed++;
+        return false;
+    }
+
+    std::string_view body;
+    if (close + 2 < line.size() && line[close + 1] == ':')
+        body = line.substr(close + 3);
+
+    uint64_t timestamp_ms = seconds * 1000 + millis;
+    newest_ms_ = std::max(newest_ms_, timestamp_ms);
+    stats_.records++;
+
+    // Сначала вытесняем устаревшие события, чтобы события выдавались в порядке времени
+    evict_expired();
+
+    EventKey key{timestamp_ms, serial, std::string(node)};
+    if (type == "EOE")
+    {
+        if (pending_.count(key))
+            complete(key, false);
+        return true;
+    }
+
+    auto [it, inserted] = pending_.try_emplace(key);
+    AuditEvent& event = it->second;
+    if (inserted)
+    {
+        event.serial = serial;
+        event.timestamp_ms = timestamp_ms;
+        event.node = key.node;
+        order_.push_back(std::move(key));
+    }
+    event.records.push_back({std::string(type), std::string(body)});
+
+    // Пользовательские события (логины, sudo, сервисы) состоят из одной записи и не имеют EOE
+    if (inserted && !is_syscall_aux(type))
+        complete(order_.back(), false);
+
+    return true;
+}
+
+void AuditReassembler::flush()
+{
+    while (!order_.empty())
+    {
+        EventKey key = std::move(order_.front());
+        order_.pop_front();
+        if (pending_.count(key))
+            complete(key, true);
+    }
+}
+
+void AuditReassembler::complete(const EventKey& key, bool evicted)
+{
+    auto it = pending_.find(key);
+    if (it == pending_.end())
+        return;
+
+    AuditEvent event = std::move(it->second);
+    pending_.erase(it);
+
+    stats_.events++;
+    if (evicted)
+        stats_.evicted++;
+
+    if (callback_)
+        callback_(event);
+}
+
+void AuditReassembler::evict_expired()
+{
+    while (!order_.empty())
+    {
+        bool expired = order_.front().timestamp_ms + max_age_ms_ < newest_ms_;
+        bool over_limit = pending_.size() > max_pending_;
+
+        if (!expired && !over_limit)
+            break;
+
+        EventKey key = std::move(order_.front());
+        order_.pop_front();
+
+        // Запись очереди могла устареть: событие уже завершено по EOE
+        if (pending_.count(key))
+            complete(key, true);
+    }
+}
@@ -0,0 +1,183 @@
+/**
+ * @file auditReassembler.h
+ * @brief Сборка многострочных событий auditd из отдельных записей
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#ifndef AUDITREASSEMBLER_H
+#define AUDITREASSEMBLER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+/**
+ * @brief Одна запись аудита (строка type=... msg=audit(...): ...)
+ */
+struct AuditRecord
+{
+    std::string type;  ///< Тип записи (SYSCALL, EXECVE, PATH, ...)
+    std::string body;  ///< Поля записи key=value после "): "
+};
+
+/**
+ * @brief Событие аудита - все записи с одним audit(ts:serial)
+ *
+ * Значения полей хранятся в исходном виде; hex-кодированные строки
+ * (так auditd записывает значения с пробелами и спецсимволами)
+ * декодируются только при обращении через value().
+ */
+struct AuditEvent
+{
+    uint64_t serial = 0;          ///< Серийный номер события
+    uint64_t timestamp_ms = 0;    ///< Время события в миллисекундах (epoch)
+    std::string node;             ///< Узел (node=) если указан
+    std::vector<AuditRecord> records;
+
+    /**
+     * @brief Первая запись заданного типа
+     * @param type Тип записи
+     * @return Указатель на запись или nullptr
+     */
+    const AuditRecord* find(std::string_view type) const;
+
+    /**
+     * @brief Значение поля в исходном виде (без снятия кавычек и декодирования)
+     * @param type Тип записи
+     * @param key Имя поля
+     * @return Значение или пустая строка
+     */
+    std::string_view raw(std::string_view type, std::string_view key) const;
+
+    /**
+     * @brief Декодированное значение поля
+     * @param type Тип записи
+     * @param key Имя поля
+     * @return Значение без кавычек, hex-строки декодированы
+     */
+    std::string value(std::string_view type, std::string_view key) const;
+
+    /**
+     * @brief Тип события - тип первой записи
+     */
+    std::string type() const
+    {
+        return records.empty() ? std::string() : records.front().type;
+    }
+
+    /**
+     * @brief Неуспешно ли событие (success=no или res=failed)
+     */
+    bool failed() const;
+
+    /**
+     * @brief Командная строка из EXECVE (или PROCTITLE)
+     * @return Аргументы, разделенные пробелами
+     */
+    std::string commandLine() const;
+
+    /**
+     * @brief Однострочное описание события для правил и отчетов
+     */
+    std::string summary() const;
+};
+
+/**
+ * @brief Сборщик событий аудита
+ *
+ * Записи одного события группируются в хэш-таблице по полному
+ * идентификатору audit(ts:serial) и узлу: в логах, собранных с нескольких
+ * узлов или склеенных после ротации, серийные номера повторяются.
+ * Событие завершается записью EOE, а однострочные пользовательские события
+ * (USER_LOGIN, USER_AUTH, ...) - сразу. События без EOE вытесняются по
+ * времени аудита: когда самое новое время ушло дальше, чем на max_age.
+ */
+class AuditReassembler
+{
+public:
+    using EventCallback = std::function<void(const AuditEvent&)>;
+
+    /**
+     * @brief Статистика сборки
+     */
+    struct Stats
+    {
+        uint64_t records = 0;    ///< Принято записей
+        uint64_t events = 0;     ///< Выдано событий
+        uint64_t evicted = 0;    ///< Событий, завершенных по времени/лимиту, а не по EOE
+        uint64_t malformed = 0;  ///< Строк, не являющихся записями аудита
+    };
+
+    /**
+     * @brief Конструктор
+     * @param callback Обработчик готовых событий
+     * @param max_age_ms Время ожидания недостающих записей события
+     * @param max_pending Максимум одновременно собираемых событий
+     */
+    explicit AuditReassembler(EventCallback callback, uint64_t max_age_ms = 2000, size_t max_pending = 65536);
+
+    /**
+     * @brief Передать строку лога аудита
+     * @param line Строка
+     * @return True если строка является записью аудита
+     */
+    bool feed(std::string_view line);
+
+    /**
+     * @brief Выдать все незавершенные события
+     */
+    void flush();
+
+    /**
+     * @brief Количество собираемых событий
+     */
+    size_t pending() const
+    {
+        return pending_.size();
+    }
+
+    /**
+     * @brief Получить статистику
+     */
+    const Stats& stats() const
+    {
+        return stats_;
+    }
+
+private:
+    /**
+     * @brief Идентификатор события: узел (node=) и audit(ts:serial)
+     */
+    struct EventKey
+    {
+        uint64_t timestamp_ms = 0;
+        uint64_t serial = 0;
+        std::string node;
+
+        bool operator==(const EventKey& other) const = default;
+    };
+
+    struct EventKeyHash
+    {
+        size_t operator()(const EventKey& key) const;
+    };
+
+    void complete(const EventKey& key, bool evicted);
+    void evict_expired();
+
+    EventCallback callback_;
+    uint64_t max_age_ms_;
+    size_t max_pending_;
+    uint64_t newest_ms_ = 0;
+
+    std::unordered_map<EventKey, AuditEvent, EventKeyHash> pending_;
+    std::deque<EventKey> order_;  ///< События в порядке появления
+    Stats stats_;
+};
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file loadShedder.cpp
+ * @brief Реализация адаптивного сброса нагрузки
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "loadShedder.h"
+#include <cmath>
+#include <algorithm>
+
+void LoadShedder::observe(const std::string& source, size_t lines, bool high_priority, Clock::time_point now)
+{
+    SourceState& state = sources_[source];
+    state.high_priority = high_priority;
+
+    // Первая пачка считается поступившей за одну секунду (интервал опроса монитора)
+    double seconds = 1.0;
+    if (state.seen)
+        seconds = std::max(std::chrono::duration<double>(now - state.last_observe).count(), 0.001);
+    state.seen = true;
+    state.last_observe = now;
+
+    // Быстрый рост, медленный спад: лавина обнаруживается в первой же пачке
+    double instant = static_cast<double>(lines) / seconds;
+    double alpha = 1.0 - std::exp(-seconds / limits_.decay_seconds);
+    double& rate = state.stats.rate;
+    rate = instant > rate ? instant : rate + alpha * (instant - rate);
+
+    double total = 0.0;
+    for (const auto& [name, other] : sources_)
+        total += other.stats.rate;
+
+    // Под общей нагрузкой прореживаются источники, превышающие справедливую долю
+    double fair_share = limits_.total_rate / static_cast<double>(sources_.size());
+    bool pressured = rate > limits_.source_rate || (total > limits_.total_rate && rate > fair_share);
+
+    state.stats.shedding = pressured && !high_priority;
+    if (state.stats.shedding)
+    {
+        double allowed = std::min(limits_.source_rate, fair_share);
+        state.stats.sample_every = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(rate / allowed)));
+    }
+    else
+        state.stats.sample_every = 1;
+}
+
+bool LoadShedder::isShedding(const std::string& source) const
+{
+    auto it = sources_.find(source);
+    return it != sources_.end() && it->second.stats.shedding;
+}
+
+LoadShedder::Verdict LoadShedder::admit(const std::string& source, std::string_view message, std::string& notice)
+{
+    SourceState& state = sources_[source];
+    state.stats.lines++;
+    notice.clear();
+
+    if (!state.stats.shedding)
+    {
+        // Без нагрузки серия повторов закрывается сразу, строки не сворачиваются
+        if (state.repeats > 0)
+            notice = flush(source);
+        state.stats.processed++;
+        return Verdict::Process;
+    }
+
+    if (message == state.last_message)
+    {
+        state.repeats++;
+        state.stats.collapsed++;
+        return Verdict::Collapsed;
+    }
+
+    if (state.repeats > 0)
+        notice = repeated_notice(state.repeats);
+    state.repeats = 0;
+    state.last_message.assign(message);
+
+    if (state.sample_counter++ % state.stats.sample_every != 0)
+    {
+        state.stats.sampled_out++;
+        return Verdict::Sampled;
+    }
+
+    state.stats.processed++;
+    return Verdict::Process;
+}
+
+void LoadShedder::pass(const std::string& source, size_t lines)
+{
+    SourceState& state = sources_[source];
+    state.stats.lines += lines;
+    state.stats.processed += lines;
+}
+
+std::string LoadShedder::flush(const std::string& source)
+{
+    auto it = sources_.find(source);
+    if (it == sources_.end() || it->second.repeats == 0)
+        return {};
+
+    std::string notice = repeated_notice(it->second.repeats);
+    it->second.repeats = 0;
+    return notice;
+}
+
+std::map<std::string, LoadShedder::SourceStats> LoadShedder::stats() const
+{
+    std::map<std::string, SourceStats> result;
+    for (const auto& [source, state] : sources_)
+        result[source] = state.stats;
+    return result;
+}
+
+std::string LoadShedder::repeated_notice(uint64_t repeats)
+{
+    return "last message repeated " + std::to_string(repeats) + " times";
+}
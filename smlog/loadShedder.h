@@ -0,0 +1,146 @@
+/**
+ * @file loadShedder.h
+ * @brief Защита конвейера мониторинга от лавины логов
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#ifndef LOADSHEDDER_H
+#define LOADSHEDDER_H
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Адаптивный сброс нагрузки для источников логов
+ *
+ * Для каждого источника измеряется скорость поступления строк (EWMA с быстрым
+ * ростом и медленным спадом). Пока скорость в пределах лимитов, все строки
+ * обрабатываются. Под нагрузкой источник низкого приоритета переходит в режим
+ * сжатия повторов ("last message repeated N times") и выборки 1 из N для
+ * остальных строк. Источники высокого приоритета никогда не прореживаются.
+ */
+class LoadShedder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Решение по строке
+     */
+    enum class Verdict
+    {
+        Process,    ///< Строку нужно обработать
+        Sampled,    ///< Строка отброшена выборкой
+        Collapsed   ///< Строка - повтор предыдущей, учтена в счетчике повторов
+    };
+
+    /**
+     * @brief Лимиты
+     */
+    struct Limits
+    {
+        double source_rate = 5000.0;   ///< Строк/с на источник до включения защиты
+        double total_rate = 20000.0;   ///< Строк/с суммарно по всем источникам
+        double decay_seconds = 5.0;    ///< Постоянная времени спада оценки скорости
+    };
+
+    /**
+     * @brief Статистика источника
+     */
+    struct SourceStats
+    {
+        double rate = 0.0;          ///< Оценка скорости, строк/с
+        bool shedding = false;      ///< Включена ли защита сейчас
+        uint64_t sample_every = 1;  ///< Обрабатывается 1 строка из N
+        uint64_t lines = 0;         ///< Всего строк
+        uint64_t processed = 0;     ///< Обработано
+        uint64_t sampled_out = 0;   ///< Отброшено выборкой
+        uint64_t collapsed = 0;     ///< Свернуто в "repeated N times"
+    };
+
+    LoadShedder() = default;
+    explicit LoadShedder(const Limits& limits) : limits_(limits) {}
+
+    /**
+     * @brief Учесть пачку новых строк источника и выбрать режим
+     * @param source Источник (путь к файлу)
+     * @param lines Количество строк в пачке
+     * @param high_priority Источник высокого приоритета (auth, audit, ...)
+     * @param now Текущее время
+     */
+    void observe(const std::string& source, size_t lines, bool high_priority, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Включена ли защита для источника (по последней пачке)
+     * @param source Источник
+     * @return True если строки источника прореживаются
+     */
+    bool isShedding(const std::string& source) const;
+
+    /**
+     * @brief Решить, обрабатывать ли строку
+     * @param source Источник
+     * @param message Текст сообщения без временной метки и PID (ключ для сжатия повторов)
+     * @param notice Заполняется "last message repeated N times", если серия повторов закончилась
+     * @return Решение
+     */
+    Verdict admit(const std::string& source, std::string_view message, std::string& notice);
+
+    /**
+     * @brief Учесть строки пачки, пропущенные без проверки
+     *
+     * Для источника не под защитой admit() только считает строки: после
+     * flush() серий повторов нет. Пачку можно учесть одним вызовом.
+     * @param source Источник
+     * @param lines Количество строк
+     */
+    void pass(const std::string& source, size_t lines);
+
+    /**
+     * @brief Завершить незакрытую серию повторов источника
+     * @param source Источник
+     * @return Сообщение о повторах или пустая строка
+     */
+    std::string flush(const std::string& source);
+
+    /**
+     * @brief Получить статистику по всем источникам
+     */
+    std::map<std::string, SourceStats> stats() const;
+
+    /**
+     * @brief Лимиты
+     */
+    const Limits& limits() const
+    {
+        return limits_;
+    }
+
+    void setLimits(const Limits& limits)
+    {
+        limits_ = limits;
+    }
+
+private:
+    struct SourceState
+    {
+        SourceStats stats;
+        bool high_priority = false;
+        bool seen = false;
+        Clock::time_point last_observe;
+        uint64_t sample_counter = 0;
+        std::string last_message;
+        uint64_t repeats = 0;
+    };
+
+    static std::string repeated_notice(uint64_t repeats);
+
+    Limits limits_;
+    std::map<std::string, SourceState> sources_;
+};
+
+#endif
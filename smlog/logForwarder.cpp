@@ -0,0 +1,659 @@
+/**
+ * @file logForwarder.cpp
+ * @brief Реализация пакетной пересылки логов
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "logForwarder.h"
+#include <sys/socket.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    std::string json_escape(const std::string& s)
+    {
+        std::string out;
+        out.reserve(s.size() + 8);
+        for (unsigned char c : s)
+        {
+            switch (c)
+            {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20)
+                    {
+                        char buf[8];
+                        snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        out += buf;
+                    }
+                    else
+                        out += static_cast<char>(c);
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief Экранировать значение параметра STRUCTURED-DATA (RFC5424 6.3.3)
+     */
+    std::string sd_escape(const std::string& s)
+    {
+        std::string out;
+        out.reserve(s.size());
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\' || c == ']')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    /**
+     * @brief Поле заголовка RFC5424: без пробелов, "-" если пусто
+     */
+    std::string header_field(const std::string& s, size_t max_len)
+    {
+        if (s.empty())
+            return "-";
+        std::string out = s.substr(0, max_len);
+        std::replace(out.begin(), out.end(), ' ', '_');
+        return out;
+    }
+
+    std::string local_hostname()
+    {
+        char name[256] = {0};
+        if (gethostname(name, sizeof(name) - 1) != 0)
+            return "-";
+        return name;
+    }
+
+    std::string rfc3339_now()
+    {
+        auto now = std::chrono::system_clock::now();
+        std::time_t t = std::chrono::system_clock::to_time_t(now);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+
+        std::tm tm{};
+        gmtime_r(&t, &tm);
+        char buf[80];
+        snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                 tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                 tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(ms));
+        return buf;
+    }
+
+    bool is_rfc3339(const std::string& ts)
+    {
+        return ts.size() >= 19 && isdigit(static_cast<unsigned char>(ts[0])) && ts[4] == '-' && ts[10] == 'T';
+    }
+
+    /**
+     * @brief Сжать данные в один gzip member
+     */
+    bool gzip_compress(const std::string& input, std::string& output)
+    {
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+
+        output.resize(deflateBound(&stream, input.size()) + 32);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = static_cast<uInt>(input.size());
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = static_cast<uInt>(output.size());
+
+        int rc = deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+        return rc == Z_STREAM_END;
+    }
+}
+
+// =============== КОНСТРУКТОР ===============
+
+LogForwarder::LogForwarder(const Config& config) : config_(config)
+{
+}
+
+LogForwarder::~LogForwarder()
+{
+    stop();
+}
+
+bool LogForwarder::start()
+{
+    if (running_)
+        return true;
+
+    try
+    {
+        fs::create_directories(config_.spool_dir);
+        load_spool();
+    }
+    catch (const std::exception& e)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_error_ = "Спул недоступен: " + std::string(e.what());
+        return false;
+    }
+
+    throughput_since_ = std::chrono::steady_clock::now();
+    next_connect_ = throughput_since_;
+    running_ = true;
+    thread_ = std::thread(&LogForwarder::sender_loop, this);
+    return true;
+}
+
+void LogForwarder::stop()
+{
+    if (!running_)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+
+    if (thread_.joinable())
+        thread_.join();
+
+    disconnect();
+}
+
+// =============== ОЧЕРЕДЬ ===============
+
+void LogForwarder::forward(const ForwardEvent& event)
+{
+    std::string record = serialize(event, config_.framing);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Обратное давление: даем потоку отправки (или спулу) разгрузить очередь
+    if (queue_.size() >= config_.queue_limit && running_)
+    {
+        cv_.notify_one();
+        idle_cv_.wait_for(lock, std::chrono::milliseconds(config_.flush_interval_ms),
+                          [this] { return queue_.size() < config_.queue_limit || !running_; });
+    }
+
+    if (queue_.size() >= config_.queue_limit)
+    {
+        queue_.pop_front();
+        counters_.dropped++;
+    }
+
+    queue_.push_back(std::move(record));
+    counters_.enqueued++;
+
+    if (queue_.size() >= config_.batch_size)
+        cv_.notify_one();
+}
+
+bool LogForwarder::flush(int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_)
+        return queue_.empty() && spool_.empty();
+
+    flush_requested_ = true;
+    cv_.notify_one();
+    idle_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                      [this] { return !flush_requested_ && !busy_; });
+    return queue_.empty() && spool_.empty();
+}
+
+LogForwarder::Counters LogForwarder::counters() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Counters result = counters_;
+
+    result.spool_files = spool_.size();
+    result.spool_bytes = 0;
+    result.lag = queue_.size();
+    for (const auto& file : spool_)
+    {
+        result.spool_bytes += file.bytes;
+        result.lag += file.events;
+    }
+    return result;
+}
+
+std::string LogForwarder::getLastError() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_error_;
+}
+
+// =============== ПОТОК ОТПРАВКИ ===============
+
+void LogForwarder::sender_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        cv_.wait_for(lock, std::chrono::milliseconds(config_.flush_interval_ms), [this] {
+            return !running_ || flush_requested_ || queue_.size() >= config_.batch_size;
+        });
+
+        bool stopping = !running_;
+        busy_ = true;
+
+        while (!queue_.empty())
+        {
+            size_t count = std::min(queue_.size(), config_.batch_size);
+            std::vector<std::string> records;
+            records.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                records.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            idle_cv_.notify_all();
+
+            lock.unlock();
+            std::string payload = build_payload(records);
+            // Спул отправляется первым, чтобы сохранить порядок событий
+            bool sent = drain_spool() && send_batch(payload);
+            if (sent)
+                update_throughput(count);
+            else
+                spool_batch(payload, count);
+            lock.lock();
+        }
+
+        if (!spool_.empty())
+        {
+            lock.unlock();
+            drain_spool();
+            lock.lock();
+        }
+
+        flush_requested_ = false;
+        busy_ = false;
+        idle_cv_.notify_all();
+
+        if (stopping)
+            break;
+    }
+}
+
+std::string LogForwarder::build_payload(std::vector<std::string>& records)
+{
+    std::string raw;
+    size_t total = 0;
+    for (const auto& record : records)
+        total += record.size();
+    raw.reserve(total);
+    for (const auto& record : records)
+        raw += record;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters_.bytes_raw += raw.size();
+    }
+
+    if (!config_.compress)
+        return raw;
+
+    std::string compressed;
+    if (!gzip_compress(raw, compressed))
+        return raw;
+    return compressed;
+}
+
+void LogForwarder::update_throughput(uint64_t events)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.sent += events;
+    counters_.batches_sent++;
+
+    throughput_events_ += events;
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - throughput_since_).count();
+    if (elapsed >= 1.0)
+    {
+        counters_.throughput = static_cast<double>(throughput_events_) / elapsed;
+        throughput_events_ = 0;
+        throughput_since_ = now;
+    }
+}
+
+// =============== СЕТЬ ===============
+
+bool LogForwarder::ensure_connected()
+{
+    if (socket_ >= 0)
+    {
+        // Коллектор мог закрыть соединение: проверяем без блокировки
+        pollfd pfd{socket_, POLLIN, 0};
+        if (poll(&pfd, 1, 0) > 0)
+        {
+            char byte;
+            ssize_t n = recv(socket_, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                disconnect();
+        }
+        if (socket_ >= 0)
+            return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_connect_)
+        return false;
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    std::string port = std::to_string(config_.port);
+
+    std::string error;
+    if (getaddrinfo(config_.host.c_str(), port.c_str(), &hints, &result) != 0)
+        error = "Не удалось разрешить адрес " + config_.host;
+
+    for (addrinfo* ai = result; ai && socket_ < 0; ai = ai->ai_next)
+    {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+
+        // Неблокирующий connect с таймаутом
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+        int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc < 0 && errno == EINPROGRESS)
+        {
+            pollfd pfd{fd, POLLOUT, 0};
+            if (poll(&pfd, 1, config_.connect_timeout_ms) == 1)
+            {
+                int so_error = 0;
+                socklen_t len = sizeof(so_error);
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+                rc = so_error == 0 ? 0 : -1;
+                errno = so_error;
+            }
+            else
+                errno = ETIMEDOUT;
+        }
+
+        if (rc == 0)
+        {
+            fcntl(fd, F_SETFL, flags);
+            timeval timeout{5, 0};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            socket_ = fd;
+        }
+        else
+        {
+            error = "Коллектор " + config_.host + ":" + port + " недоступен: " + strerror(errno);
+            close(fd);
+        }
+    }
+
+    if (result)
+        freeaddrinfo(result);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.connected = socket_ >= 0;
+    if (socket_ < 0)
+    {
+        // Экспоненциальная задержка переподключения до 30 секунд
+        last_error_ = error;
+        next_connect_ = now + std::chrono::milliseconds(backoff_ms_);
+        backoff_ms_ = std::min(backoff_ms_ * 2, 30000);
+        return false;
+    }
+
+    backoff_ms_ = 500;
+    return true;
+}
+
+void LogForwarder::disconnect()
+{
+    if (socket_ >= 0)
+    {
+        close(socket_);
+        socket_ = -1;
+    }
+}
+
+bool LogForwarder::send_batch(const std::string& payload)
+{
+    if (!ensure_connected())
+        return false;
+
+    size_t offset = 0;
+    while (offset < payload.size())
+    {
+        ssize_t n = send(socket_, payload.data() + offset, payload.size() - offset, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            last_error_ = "Ошибка отправки: " + std::string(strerror(errno));
+            counters_.send_errors++;
+            next_connect_ = std::chrono::steady_clock::now();
+            counters_.connected = false;
+            disconnect();
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.bytes_sent += payload.size();
+    return true;
+}
+
+// =============== СПУЛ ===============
+
+void LogForwarder::load_spool()
+{
+    std::vector<std::pair<uint64_t, SpoolFile>> files;
+
+    for (const auto& entry : fs::directory_iterator(config_.spool_dir))
+    {
+        if (!entry.is_regular_file() || entry.path().extension() != ".batch")
+            continue;
+
+        // Имя файла: <порядковый номер>-<количество событий>.batch
+        std::string stem = entry.path().stem().string();
+        size_t dash = stem.find('-');
+        if (dash == std::string::npos)
+            continue;
+
+        try
+        {
+            uint64_t seq = std::stoull(stem.substr(0, dash));
+            uint64_t events = std::stoull(stem.substr(dash + 1));
+            files.push_back({seq, {entry.path().string(), events, entry.file_size()}});
+        }
+        catch (...)
+        {
+            continue;
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    spool_.clear();
+    for (auto& [seq, file] : files)
+    {
+        spool_.push_back(std::move(file));
+        spool_seq_ = seq + 1;
+    }
+}
+
+void LogForwarder::spool_batch(const std::string& payload, uint64_t events)
+{
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        seq = spool_seq_++;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "%016llu-%llu.batch",
+             static_cast<unsigned long long>(seq), static_cast<unsigned long long>(events));
+    std::string path = (fs::path(config_.spool_dir) / name).string();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    file.close();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file)
+    {
+        last_error_ = "Не удалось записать спул: " + path;
+        counters_.dropped += events;
+        return;
+    }
+
+    spool_.push_back({path, events, payload.size()});
+    counters_.spooled += events;
+
+    // Ограничение размера спула: удаляем самые старые пачки
+    uint64_t total = 0;
+    for (const auto& spooled : spool_)
+        total += spooled.bytes;
+    while (total > config_.spool_limit_bytes && spool_.size() > 1)
+    {
+        const SpoolFile& oldest = spool_.front();
+        total -= oldest.bytes;
+        counters_.dropped += oldest.events;
+        std::error_code ec;
+        fs::remove(oldest.path, ec);
+        spool_.pop_front();
+    }
+}
+
+bool LogForwarder::drain_spool()
+{
+    while (true)
+    {
+        SpoolFile file;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (spool_.empty())
+                return true;
+            file = spool_.front();
+        }
+
+        std::ifstream in(file.path, std::ios::binary);
+        std::string payload((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        if (in.bad() || !send_batch(payload))
+            return false;
+
+        std::error_code ec;
+        fs::remove(file.path, ec);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!spool_.empty() && spool_.front().path == file.path)
+                spool_.pop_front();
+        }
+        update_throughput(file.events);
+    }
+}
+
+// =============== СЕРИАЛИЗАЦИЯ ===============
+
+bool LogForwarder::parseTarget(const std::string& target, Config& config)
+{
+    size_t colon = target.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 >= target.size())
+        return false;
+
+    std::string host = target.substr(0, colon);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+
+    try
+    {
+        int port = std::stoi(target.substr(colon + 1));
+        if (port <= 0 || port > 65535)
+            return false;
+        config.host = host;
+        config.port = port;
+        return true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+std::string LogForwarder::serialize(const ForwardEvent& event, Framing framing)
+{
+    bool alert = event.type == "alert";
+    int severity = event.severity >= 0 ? event.severity : (alert ? 4 : 6);
+
+    if (framing == Framing::JsonLines)
+    {
+        std::string json = "{\"type\":\"" + json_escape(event.type) + "\"";
+        auto add = [&json](const char* key, const std::string& value) {
+            if (!value.empty())
+                json += std::string(",\"") + key + "\":\"" + json_escape(value) + "\"";
+        };
+        add("timestamp", event.timestamp);
+        add("host", event.hostname.empty() ? local_hostname() : event.hostname);
+        add("service", event.service);
+        add("pid", event.pid);
+        add("level", event.level);
+        add("source", event.source);
+        add("rule", event.rule);
+        json += ",\"severity\":" + std::to_string(severity);
+        add("message", event.message);
+        json += "}\n";
+        return json;
+    }
+
+    // RFC5424: алерты идут в authpriv (10), остальные записи - в user (1)
+    int facility = alert ? 10 : 1;
+    std::string message = "<" + std::to_string(facility * 8 + severity) + ">1 ";
+    message += is_rfc3339(event.timestamp) ? event.timestamp : rfc3339_now();
+    message += " " + header_field(event.hostname.empty() ? local_hostname() : event.hostname, 255);
+    message += " " + header_field(event.service.empty() ? "smlog" : event.service, 48);
+    message += " " + header_field(event.pid, 128);
+    message += " " + header_field(event.type, 32);
+
+    std::string sd;
+    if (!event.source.empty())
+        sd += " source=\"" + sd_escape(event.source) + "\"";
+    if (!event.timestamp.empty() && !is_rfc3339(event.timestamp))
+        sd += " ts=\"" + sd_escape(event.timestamp) + "\"";
+    if (!event.rule.empty())
+        sd += " rule=\"" + sd_escape(event.rule) + "\"";
+    message += sd.empty() ? " -" : " [smlog@32473" + sd + "]";
+
+    if (!event.message.empty())
+        message += " " + event.message;
+
+    // RFC6587 octet counting
+    return std::to_string(message.size()) + " " + message;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file logForwarder.h
+ * @brief Пакетная пересылка записей и алертов на удаленный коллектор
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#ifndef LOGFORWARDER_H
+#define LOGFORWARDER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Событие для пересылки: разобранная запись лога или алерт правила
+ */
+struct ForwardEvent
+{
+    std::string type = "log";  ///< "log" или "alert"
+    std::string source;        ///< Файл или источник записи
+    std::string timestamp;     ///< Исходная временная метка
+    std::string hostname;
+    std::string service;
+    std::string pid;
+    std::string level;
+    std::string message;
+    std::string rule;          ///< Имя сработавшего правила (для алертов)
+    int severity = -1;         ///< Важность syslog 0-7
+};
+
+/**
+ * @brief Пересылка событий на коллектор по TCP
+ *
+ * События накапливаются в очереди и отправляются пачками в формате
+ * RFC6587 (octet counting, RFC5424 сообщения) или JSON-lines. Каждая
+ * пачка сжимается в отдельный gzip member, поэтому поток на стороне
+ * коллектора читается обычным gunzip. Пока коллектор недоступен, пачки
+ * пишутся в ограниченный по размеру спул на диске (при переполнении
+ * удаляются самые старые) и отправляются из него в исходном порядке
+ * после восстановления связи.
+ */
+class LogForwarder
+{
+public:
+    /**
+     * @brief Формат записей в пачке
+     */
+    enum class Framing
+    {
+        OctetCounted,  ///< RFC6587: "LEN SP <PRI>1 ..."
+        JsonLines      ///< Один JSON объект на строку
+    };
+
+    /**
+     * @brief Настройки пересылки
+     */
+    struct Config
+    {
+        std::string host = "127.0.0.1";
+        int port = 6514;
+        Framing framing = Framing::OctetCounted;
+        bool compress = true;
+        size_t batch_size = 500;                ///< Событий в пачке
+        int flush_interval_ms = 1000;           ///< Максимальная задержка неполной пачки
+        size_t queue_limit = 50000;             ///< Событий в памяти до сброса в спул
+        std::string spool_dir = "/var/spool/smlog";
+        uint64_t spool_limit_bytes = 64ull << 20;
+        int connect_timeout_ms = 2000;
+    };
+
+    /**
+     * @brief Счетчики пересылки
+     */
+    struct Counters
+    {
+        uint64_t enqueued = 0;        ///< Принято событий
+        uint64_t sent = 0;            ///< Отправлено событий
+        uint64_t batches_sent = 0;
+        uint64_t bytes_sent = 0;      ///< Байт отправлено (после сжатия)
+        uint64_t bytes_raw = 0;       ///< Байт до сжатия
+        uint64_t dropped = 0;         ///< Событий потеряно (переполнение спула)
+        uint64_t spooled = 0;         ///< Событий записано в спул
+        uint64_t spool_files = 0;     ///< Пачек в спуле сейчас
+        uint64_t spool_bytes = 0;     ///< Размер спула сейчас
+        uint64_t send_errors = 0;
+        uint64_t lag = 0;             ///< Событий ожидает отправки (очередь + спул)
+        double throughput = 0.0;      ///< Событий/с за последние отправки
+        bool connected = false;
+    };
+
+    explicit LogForwarder(const Config& config);
+    ~LogForwarder();
+
+    LogForwarder(const LogForwarder&) = delete;
+    LogForwarder& operator=(const LogForwarder&) = delete;
+
+    /**
+     * @brief Запустить поток отправки
+     * @return True если спул доступен и поток запущен
+     */
+    bool start();
+
+    /**
+     * @brief Остановить поток; неотправленные события сохраняются в спул
+     */
+    void stop();
+
+    /**
+     * @brief Поставить событие в очередь
+     * @param event Событие
+     */
+    void forward(const ForwardEvent& event);
+
+    /**
+     * @brief Отправить накопленное немедленно и дождаться попытки отправки
+     * @param timeout_ms Максимальное ожидание
+     * @return True если очередь и спул пусты
+     */
+    bool flush(int timeout_ms = 5000);
+
+    /**
+     * @brief Получить счетчики
+     */
+    Counters counters() const;
+
+    /**
+     * @brief Получить последнюю ошибку
+     */
+    std::string getLastError() const;
+
+    /**
+     * @brief Получить конфигурацию
+     */
+    const Config& config() const
+    {
+        return config_;
+    }
+
+    /**
+     * @brief Разобрать "host:port" в конфигурацию
+     * @param target Строка назначения
+     * @param config Конфигурация для заполнения
+     * @return True если строка корректна
+     */
+    static bool parseTarget(const std::string& target, Config& config);
+
+    /**
+     * @brief Сериализовать событие в запись пачки
+     * @param event Событие
+     * @param framing Формат
+     * @return Запись с разделителем/префиксом длины
+     */
+    static std::string serialize(const ForwardEvent& event, Framing framing);
+
+private:
+    struct SpoolFile
+    {
+        std::string path;
+        uint64_t events;
+        uint64_t bytes;
+    };
+
+    void sender_loop();
+    bool send_batch(const std::string& payload);
+    bool ensure_connected();
+    void disconnect();
+    std::string build_payload(std::vector<std::string>& records);
+    void spool_batch(const std::string& payload, uint64_t events);
+    bool drain_spool();
+    void load_spool();
+    void update_throughput(uint64_t events);
+
+    Config config_;
+    int socket_ = -1;
+    std::chrono::steady_clock::time_point next_connect_;
+    int backoff_ms_ = 500;
+
+    std::deque<std::string> queue_;
+    std::deque<SpoolFile> spool_;
+    uint64_t spool_seq_ = 0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idle_cv_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    bool flush_requested_ = false;
+    bool busy_ = false;
+
+    Counters counters_;
+    std::chrono::steady_clock::time_point throughput_since_;
+    uint64_t throughput_events_ = 0;
+    std::string last_error_;
+};
+
+#endif
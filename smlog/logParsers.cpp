@@ -0,0 +1,807 @@
+/**
+ * @file logParsers.cpp
+ * @brief Реализация парсеров форматов логов без регулярных выражений
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "logParsers.h"
+#include <fstream>
+#include <array>
+#include <cctype>
+
+namespace
+{
+    constexpr std::array<const char*, 8> kSeverityNames = {
+        "EMERGENCY", "ALERT", "CRITICAL", "ERROR", "WARNING", "NOTICE", "INFO", "DEBUG"
+    };
+
+    void set_severity(LogRecord& record, int severity)
+    {
+        if (severity < 0 || severity > 7)
+            return;
+        record.severity = severity;
+        record.level = kSeverityNames[severity];
+    }
+
+    bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    bool all_digits(std::string_view s)
+    {
+        if (s.empty())
+            return false;
+        for (char c : s)
+        {
+            if (!is_digit(c))
+                return false;
+        }
+        return true;
+    }
+
+    int to_int(std::string_view s)
+    {
+        int value = 0;
+        for (char c : s)
+            value = value * 10 + (c - '0');
+        return value;
+    }
+
+    bool iequals_prefix(std::string_view s, std::string_view prefix)
+    {
+        if (s.size() < prefix.size())
+            return false;
+        for (size_t i = 0; i < prefix.size(); ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(s[i])) != prefix[i])
+                return false;
+        }
+        return true;
+    }
+
+    size_t skip_spaces(std::string_view s, size_t pos)
+    {
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t'))
+            pos++;
+        return pos;
+    }
+
+    /**
+     * @brief Выделить токен до пробела начиная с pos, pos сдвигается за токен
+     */
+    std::string_view next_token(std::string_view s, size_t& pos)
+    {
+        size_t start = pos;
+        while (pos < s.size() && s[pos] != ' ')
+            pos++;
+        return s.substr(start, pos - start);
+    }
+
+    /**
+     * @brief Разобрать необязательный префикс <PRI>
+     * @return Важность (0-7) или -1; pos сдвигается за '>'
+     */
+    int parse_pri(std::string_view s, size_t& pos)
+    {
+        if (pos >= s.size() || s[pos] != '<')
+            return -1;
+
+        size_t end = s.find('>', pos + 1);
+        if (end == std::string_view::npos || end - pos > 4)
+            return -1;
+
+        std::string_view digits = s.substr(pos + 1, end - pos - 1);
+        if (!all_digits(digits))
+            return -1;
+
+        pos = end + 1;
+        return to_int(digits) & 7;
+    }
+
+    /**
+     * @brief Проверить временную метку вида "Jan  4 10:15:30"
+     */
+    bool is_bsd_timestamp(std::string_view s)
+    {
+        static constexpr std::array<std::string_view, 12> months = {
+            "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+        };
+
+        if (s.size() < 15)
+            return false;
+
+        bool month_ok = false;
+        for (const auto& month : months)
+        {
+            if (s.substr(0, 3) == month)
+            {
+                month_ok = true;
+                break;
+            }
+        }
+
+        return month_ok && s[3] == ' ' &&
+               (s[4] == ' ' || is_digit(s[4])) && is_digit(s[5]) && s[6] == ' ' &&
+               is_digit(s[7]) && is_digit(s[8]) && s[9] == ':' &&
+               is_digit(s[10]) && is_digit(s[11]) && s[12] == ':' &&
+               is_digit(s[13]) && is_digit(s[14]);
+    }
+
+    /**
+     * @brief Проверить временную метку RFC3339 "2026-01-04T10:15:30[.frac][zone]"
+     */
+    bool is_rfc3339_timestamp(std::string_view s)
+    {
+        if (s.size() < 19)
+            return false;
+
+        return is_digit(s[0]) && is_digit(s[1]) && is_digit(s[2]) && is_digit(s[3]) &&
+               s[4] == '-' && is_digit(s[5]) && is_digit(s[6]) && s[7] == '-' &&
+               is_digit(s[8]) && is_digit(s[9]) && s[10] == 'T' &&
+               is_digit(s[11]) && is_digit(s[12]) && s[13] == ':' &&
+               is_digit(s[14]) && is_digit(s[15]) && s[16] == ':' &&
+               is_digit(s[17]) && is_digit(s[18]);
+    }
+
+    /**
+     * @brief Нормализовать текстовый или числовой уровень в важность syslog
+     */
+    int severity_from_level(std::string_view level)
+    {
+        if (all_digits(level))
+        {
+            int value = to_int(level);
+            if (value <= 7)
+                return value;  // PRIORITY из journald
+            // Числовые уровни pino/bunyan
+            if (value >= 60) return 2;
+            if (value >= 50) return 3;
+            if (value >= 40) return 4;
+            if (value >= 30) return 6;
+            return 7;
+        }
+
+        if (iequals_prefix(level, "emerg") || iequals_prefix(level, "panic")) return 0;
+        if (iequals_prefix(level, "alert")) return 1;
+        if (iequals_prefix(level, "crit") || iequals_prefix(level, "fatal")) return 2;
+        if (iequals_prefix(level, "err")) return 3;
+        if (iequals_prefix(level, "warn")) return 4;
+        if (iequals_prefix(level, "notice")) return 5;
+        if (iequals_prefix(level, "info")) return 6;
+        if (iequals_prefix(level, "debug") || iequals_prefix(level, "trace")) return 7;
+        return -1;
+    }
+
+    /**
+     * @brief Разобрать тег "service[pid]: message" классического syslog
+     */
+    void parse_tag_and_message(std::string_view rest, LogRecord& record)
+    {
+        size_t i = rest.find_first_of(":[ ");
+        if (i == std::string_view::npos || rest[i] == ' ')
+        {
+            record.message = rest;
+            return;
+        }
+
+        size_t colon = i;
+        if (rest[i] == '[')
+        {
+            size_t close = rest.find(']', i);
+            if (close == std::string_view::npos || close + 1 >= rest.size() || rest[close + 1] != ':')
+            {
+                record.message = rest;
+                return;
+            }
+            record.pid = rest.substr(i + 1, close - i - 1);
+            colon = close + 1;
+        }
+
+        record.service = rest.substr(0, i);
+        record.message = rest.substr(skip_spaces(rest, colon + 1));
+    }
+
+    /**
+     * @brief Значение поля key=value в тексте записи аудита
+     */
+    std::string_view audit_field(std::string_view text, std::string_view key)
+    {
+        size_t pos = 0;
+        while ((pos = text.find(key, pos)) != std::string_view::npos)
+        {
+            bool at_start = pos == 0 || text[pos - 1] == ' ';
+            size_t eq = pos + key.size();
+            if (at_start && eq < text.size() && text[eq] == '=')
+            {
+                size_t start = eq + 1;
+                if (start < text.size() && text[start] == '"')
+                {
+                    size_t end = text.find('"', start + 1);
+                    if (end == std::string_view::npos)
+                        return {};
+                    return text.substr(start + 1, end - start - 1);
+                }
+                size_t end = text.find(' ', start);
+                if (end == std::string_view::npos)
+                    end = text.size();
+                return text.substr(start, end - start);
+            }
+            pos = eq;
+        }
+        return {};
+    }
+
+    // =============== ПАРСЕРЫ ===============
+
+    /**
+     * @brief Классический syslog: "Jan  4 10:15:30 host service[pid]: message"
+     *
+     * Также принимает временную метку RFC3339 (формат rsyslog по умолчанию в
+     * новых дистрибутивах) и необязательный префикс <PRI>.
+     */
+    class BsdSyslogParser : public LogParser
+    {
+    public:
+        LogFormat format() const override { return LogFormat::BsdSyslog; }
+
+        bool parse(std::string_view line, LogRecord& record) const override
+        {
+            size_t pos = 0;
+            int severity = parse_pri(line, pos);
+            std::string_view rest = line.substr(pos);
+
+            if (is_bsd_timestamp(rest))
+            {
+                record.timestamp = rest.substr(0, 15);
+                pos += 15;
+            }
+            else if (is_rfc3339_timestamp(rest))
+            {
+                record.timestamp = next_token(line, pos);
+            }
+            else
+                return false;
+
+            pos = skip_spaces(line, pos);
+            record.hostname = next_token(line, pos);
+            if (record.hostname.empty())
+                return false;
+
+            pos = skip_spaces(line, pos);
+            parse_tag_and_message(line.substr(pos), record);
+
+            record.format = LogFormat::BsdSyslog;
+            set_severity(record, severity);
+            return true;
+        }
+    };
+
+    /**
+     * @brief RFC5424: "<PRI>1 TIMESTAMP HOST APP PROCID MSGID [SD] MSG"
+     */
+    class Rfc5424Parser : public LogParser
+    {
+    public:
+        LogFormat format() const override { return LogFormat::Rfc5424; }
+
+        bool parse(std::string_view line, LogRecord& record) const override
+        {
+            size_t pos = 0;
+            int severity = parse_pri(line, pos);
+
+            // VERSION
+            size_t version_start = pos;
+            while (pos < line.size() && is_digit(line[pos]))
+                pos++;
+            if (pos == version_start || pos - version_start > 2 || pos >= line.size() || line[pos] != ' ')
+                return false;
+            pos++;
+
+            std::string_view timestamp = next_token(line, pos);
+            if (timestamp != "-" && !is_rfc3339_timestamp(timestamp))
+                return false;
+
+            std::string_view fields[4];  // HOSTNAME APP-NAME PROCID MSGID
+            for (auto& field : fields)
+            {
+                if (pos >= line.size() || line[pos] != ' ')
+                    return false;
+                pos++;
+                field = next_token(line, pos);
+                if (field.empty())
+                    return false;
+            }
+
+            // STRUCTURED-DATA: "-" или последовательность [id param="value" ...]
+            if (pos < line.size() && line[pos] == ' ')
+                pos++;
+            if (pos < line.size() && line[pos] == '-')
+                pos++;
+            else
+            {
+                while (pos < line.size() && line[pos] == '[')
+                {
+                    bool in_quotes = false;
+                    for (pos++; pos < line.size(); pos++)
+                    {
+                        char c = line[pos];
+                        if (in_quotes && c == '\\')
+                            pos++;
+                        else if (c == '"')
+                            in_quotes = !in_quotes;
+                        else if (!in_quotes && c == ']')
+                            break;
+                    }
+                    if (pos >= line.size())
+                        return false;
+                    pos++;
+                }
+            }
+
+            std::string_view message = pos < line.size() ? line.substr(skip_spaces(line, pos)) : std::string_view{};
+            if (message.size() >= 3 && message.substr(0, 3) == "\xEF\xBB\xBF")
+                message.remove_prefix(3);
+
+            auto nil = [](std::string_view v) { return v == "-" ? std::string_view{} : v; };
+            record.format = LogFormat::Rfc5424;
+            record.timestamp = nil(timestamp);
+            record.hostname = nil(fields[0]);
+            record.service = nil(fields[1]);
+            record.pid = nil(fields[2]);
+            record.message = message;
+            set_severity(record, severity);
+            return true;
+        }
+    };
+
+    /**
+     * @brief JSON-lines: один плоский JSON объект на строку
+     *
+     * Значения строк возвращаются в исходном (экранированном) виде.
+     */
+    class JsonLinesParser : public LogParser
+    {
+    public:
+        LogFormat format() const override { return LogFormat::JsonLines; }
+
+        bool parse(std::string_view line, LogRecord& record) const override
+        {
+            size_t pos = skip_spaces(line, 0);
+            if (pos >= line.size() || line[pos] != '{')
+                return false;
+            pos++;
+
+            std::string_view level;
+            LogRecord parsed;
+
+            while (true)
+            {
+                pos = skip_spaces(line, pos);
+                if (pos >= line.size())
+                    return false;
+                if (line[pos] == '}')
+                    break;
+
+                std::string_view key;
+                if (!read_string(line, pos, key))
+                    return false;
+
+                pos = skip_spaces(line, pos);
+                if (pos >= line.size() || line[pos] != ':')
+                    return false;
+                pos = skip_spaces(line, pos + 1);
+
+                std::string_view value;
+                if (!read_value(line, pos, value))
+                    return false;
+
+                assign(key, value, parsed, level);
+
+                pos = skip_spaces(line, pos);
+                if (pos < line.size() && line[pos] == ',')
+                {
+                    pos++;
+                    continue;
+                }
+                if (pos < line.size() && line[pos] == '}')
+                    break;
+                return false;
+            }
+
+            parsed.format = LogFormat::JsonLines;
+            if (!level.empty())
+                set_severity(parsed, severity_from_level(level));
+            record = parsed;
+            return true;
+        }
+
+    private:
+        static bool read_string(std::string_view s, size_t& pos, std::string_view& out)
+        {
+            if (pos >= s.size() || s[pos] != '"')
+                return false;
+            size_t start = ++pos;
+            while (pos < s.size() && s[pos] != '"')
+            {
+                if (s[pos] == '\\')
+                    pos++;
+                pos++;
+            }
+            if (pos >= s.size())
+                return false;
+            out = s.substr(start, pos - start);
+            pos++;
+            return true;
+        }
+
+        static bool read_value(std::string_view s, size_t& pos, std::string_view& out)
+        {
+            if (pos >= s.size())
+                return false;
+
+            if (s[pos] == '"')
+                return read_string(s, pos, out);
+
+            size_t start = pos;
+            if (s[pos] == '{' || s[pos] == '[')
+            {
+                int depth = 0;
+                bool in_string = false;
+                for (; pos < s.size(); pos++)
+                {
+                    char c = s[pos];
+                    if (in_string)
+                    {
+                        if (c == '\\')
+                            pos++;
+                        else if (c == '"')
+                            in_string = false;
+                    }
+                    else if (c == '"')
+                        in_string = true;
+                    else if (c == '{' || c == '[')
+                        depth++;
+                    else if ((c == '}' || c == ']') && --depth == 0)
+                    {
+                        pos++;
+                        out = s.substr(start, pos - start);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && s[pos] != ' ')
+                pos++;
+            out = s.substr(start, pos - start);
+            return !out.empty();
+        }
+
+        static void assign(std::string_view key, std::string_view value, LogRecord& record, std::string_view& level)
+        {
+            auto is = [&key](std::initializer_list<std::string_view> names) {
+                for (auto name : names)
+                {
+                    if (key == name)
+                        return true;
+                }
+                return false;
+            };
+
+            if (is({"timestamp", "time", "ts", "@timestamp", "date", "datetime", "__REALTIME_TIMESTAMP"}))
+                record.timestamp = value;
+            else if (is({"message", "msg", "MESSAGE", "log"}))
+                record.message = value;
+            else if (is({"level", "severity", "lvl", "loglevel", "log_level", "PRIORITY"}))
+                level = value;
+            else if (is({"host", "hostname", "_HOSTNAME"}))
+                record.hostname = value;
+            else if (is({"service", "app", "application", "logger", "name", "program", "SYSLOG_IDENTIFIER"}))
+                record.service = value;
+            else if (is({"pid", "_PID"}))
+                record.pid = value;
+            else if (is({"ip", "client_ip", "clientip", "remote_addr", "remote_ip", "src_ip", "source_ip"}))
+                record.client_ip = value;
+            else if (is({"user", "username", "remote_user"}))
+                record.user = value;
+        }
+    };
+
+    /**
+     * @brief nginx/apache combined: 'IP - user [time] "request" status bytes "ref" "ua"'
+     */
+    class CombinedAccessParser : public LogParser
+    {
+    public:
+        LogFormat format() const override { return LogFormat::CombinedAccess; }
+
+        bool parse(std::string_view line, LogRecord& record) const override
+        {
+            size_t pos = 0;
+            std::string_view ip = next_token(line, pos);
+            if (ip.empty() || !(std::isxdigit(static_cast<unsigned char>(ip[0])) || ip[0] == ':'))
+                return false;
+
+            pos = skip_spaces(line, pos);
+            next_token(line, pos);  // ident
+            pos = skip_spaces(line, pos);
+            std::string_view user = next_token(line, pos);
+            pos = skip_spaces(line, pos);
+
+            if (pos >= line.size() || line[pos] != '[')
+                return false;
+            size_t ts_end = line.find(']', pos);
+            if (ts_end == std::string_view::npos)
+                return false;
+            std::string_view timestamp = line.substr(pos + 1, ts_end - pos - 1);
+
+            pos = skip_spaces(line, ts_end + 1);
+            if (pos >= line.size() || line[pos] != '"')
+                return false;
+            size_t request_start = ++pos;
+            while (pos < line.size() && line[pos] != '"')
+            {
+                if (line[pos] == '\\')
+                    pos++;
+                pos++;
+            }
+            if (pos >= line.size())
+                return false;
+            std::string_view request = line.substr(request_start, pos - request_start);
+
+            pos = skip_spaces(line, pos + 1);
+            std::string_view status = next_token(line, pos);
+            if (status.size() != 3 || !all_digits(status))
+                return false;
+
+            int code = to_int(status);
+            record.format = LogFormat::CombinedAccess;
+            record.timestamp = timestamp;
+            record.service = "http";
+            record.client_ip = ip;
+            record.user = user == "-" ? std::string_view{} : user;
+            record.message = request;
+            set_severity(record, code >= 500 ? 3 : (code >= 400 ? 4 : 6));
+            return true;
+        }
+    };
+
+    /**
+     * @brief auditd: "[node=host ]type=TYPE msg=audit(1700000000.123:42): key=value ..."
+     */
+    class AuditdParser : public LogParser
+    {
+    public:
+        LogFormat format() const override { return LogFormat::Auditd; }
+
+        bool parse(std::string_view line, LogRecord& record) const override
+        {
+            size_t pos = 0;
+            std::string_view node;
+            if (line.substr(0, 5) == "node=")
+            {
+                pos = 5;
+                node = next_token(line, pos);
+                pos = skip_spaces(line, pos);
+            }
+
+            if (line.substr(pos, 5) != "type=")
+                return false;
+            pos += 5;
+            std::string_view type = next_token(line, pos);
+
+            pos = skip_spaces(line, pos);
+            if (line.substr(pos, 10) != "msg=audit(")
+                return false;
+            pos += 10;
+
+            size_t colon = line.find(':', pos);
+            size_t close = line.find(')', pos);
+            if (colon == std::string_view::npos || close == std::string_view::npos || colon > close)
+                return false;
+
+            std::string_view message;
+            if (close + 1 < line.size() && line[close + 1] == ':')
+                message = line.substr(skip_spaces(line, close + 2));
+
+            record.format = LogFormat::Auditd;
+            record.hostname = node;
+            record.service = type;
+            record.timestamp = line.substr(pos, colon - pos);
+            record.message = message;
+            record.pid = audit_field(message, "pid");
+            record.user = audit_field(message, "acct");
+            record.client_ip = audit_field(message, "addr");
+            if (record.client_ip == "?")
+                record.client_ip = {};
+
+            bool failed = audit_field(message, "success") == "no" || audit_field(message, "res") == "failed";
+            set_severity(record, failed ? 4 : 6);
+            return true;
+        }
+    };
+}
+
+// =============== ИМЕНА ФОРМАТОВ ===============
+
+const char* logFormatName(LogFormat format)
+{
+    switch (format)
+    {
+        case LogFormat::BsdSyslog: return "syslog";
+        case LogFormat::Rfc5424: return "rfc5424";
+        case LogFormat::JsonLines: return "json";
+        case LogFormat::CombinedAccess: return "access";
+        case LogFormat::Auditd: return "auditd";
+        default: return "unknown";
+    }
+}
+
+std::string jsonUnescape(std::string_view value)
+{
+    if (value.find('\\') == std::string_view::npos)
+        return std::string(value);
+
+    std::string out;
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        char c = value[i];
+        if (c != '\\' || i + 1 >= value.size())
+        {
+            out += c;
+            continue;
+        }
+
+        char e = value[++i];
+        switch (e)
+        {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u':
+            {
+                if (i + 4 >= value.size())
+                    return out;
+                unsigned code = 0;
+                for (size_t k = i + 1; k <= i + 4; ++k)
+                {
+                    char h = value[k];
+                    unsigned digit = is_digit(h) ? h - '0' : (std::tolower(static_cast<unsigned char>(h)) - 'a' + 10);
+                    if (digit > 15)
+                        return out;
+                    code = code * 16 + digit;
+                }
+                i += 4;
+                if (code < 0x80)
+                    out += static_cast<char>(code);
+                else if (code < 0x800)
+                {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += e; break;  // \" \\ \/
+        }
+    }
+    return out;
+}
+
+// =============== РЕЕСТР ===============
+
+LogParserRegistry::LogParserRegistry()
+{
+    // Порядок важен при равном количестве совпадений: более строгие форматы первыми
+    registerParser(std::make_unique<AuditdParser>());
+    registerParser(std::make_unique<JsonLinesParser>());
+    registerParser(std::make_unique<Rfc5424Parser>());
+    registerParser(std::make_unique<CombinedAccessParser>());
+    registerParser(std::make_unique<BsdSyslogParser>());
+}
+
+LogParserRegistry& LogParserRegistry::instance()
+{
+    static LogParserRegistry registry;
+    return registry;
+}
+
+void LogParserRegistry::registerParser(std::unique_ptr<LogParser> parser)
+{
+    for (auto& existing : parsers_)
+    {
+        if (existing->format() == parser->format())
+        {
+            existing = std::move(parser);
+            return;
+        }
+    }
+    parsers_.push_back(std::move(parser));
+}
+
+const LogParser* LogParserRegistry::find(LogFormat format) const
+{
+    for (const auto& parser : parsers_)
+    {
+        if (parser->format() == format)
+            return parser.get();
+    }
+    return nullptr;
+}
+
+LogFormat LogParserRegistry::detect(const std::vector<std::string_view>& sample) const
+{
+    LogFormat best = LogFormat::Unknown;
+    size_t best_score = 0;
+
+    for (const auto& parser : parsers_)
+    {
+        size_t score = 0;
+        LogRecord record;
+        for (const auto& line : sample)
+        {
+            if (parser->parse(line, record))
+                score++;
+        }
+
+        if (score > best_score)
+        {
+            best_score = score;
+            best = parser->format();
+        }
+    }
+
+    return best;
+}
+
+LogFormat LogParserRegistry::detectFile(const std::string& path, size_t sample_lines) const
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return LogFormat::Unknown;
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (lines.size() < sample_lines && std::getline(file, line))
+    {
+        if (!line.empty())
+            lines.push_back(line);
+    }
+
+    std::vector<std::string_view> sample(lines.begin(), lines.end());
+    return detect(sample);
+}
+
+bool LogParserRegistry::parse(std::string_view line, LogRecord& record, LogFormat hint) const
+{
+    // Парсер может частично заполнить запись до отказа, поэтому сбрасываем ее перед каждой попыткой
+    if (hint != LogFormat::Unknown)
+    {
+        const LogParser* parser = find(hint);
+        record = LogRecord{};
+        if (parser && parser->parse(line, record))
+            return true;
+    }
+
+    for (const auto& parser : parsers_)
+    {
+        if (parser->format() == hint)
+            continue;
+        record = LogRecord{};
+        if (parser->parse(line, record))
+            return true;
+    }
+
+    record = LogRecord{};
+    return false;
+}
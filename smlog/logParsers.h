@@ -0,0 +1,152 @@
+/**
+ * @file logParsers.h
+ * @brief Реестр парсеров форматов логов и автоопределение формата
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#ifndef LOGPARSERS_H
+#define LOGPARSERS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+/**
+ * @brief Поддерживаемые форматы лог файлов
+ */
+enum class LogFormat
+{
+    Unknown,         ///< Формат не определен
+    BsdSyslog,       ///< Классический syslog (RFC3164) и его вариант с RFC3339 временем
+    Rfc5424,         ///< Структурированный syslog (RFC5424)
+    JsonLines,       ///< Один JSON объект на строку
+    CombinedAccess,  ///< nginx/apache combined (и common) access log
+    Auditd           ///< Записи подсистемы аудита Linux
+};
+
+/**
+ * @brief Получить имя формата
+ * @param format Формат
+ * @return Короткое имя формата ("syslog", "rfc5424", ...)
+ */
+const char* logFormatName(LogFormat format);
+
+/**
+ * @brief Снять JSON-экранирование со значения строки
+ *
+ * Парсер JSON-lines возвращает строки в исходном виде; функция нужна,
+ * когда значение передается дальше как обычный текст.
+ * @param value Значение без окружающих кавычек
+ * @return Декодированная строка (\uXXXX кодируется в UTF-8)
+ */
+std::string jsonUnescape(std::string_view value);
+
+/**
+ * @brief Единая разобранная запись лога
+ *
+ * Все строковые поля указывают внутрь исходной строки (или на статические
+ * строки для нормализованного уровня), поэтому разбор не выделяет память.
+ * Запись действительна, пока жива исходная строка.
+ */
+struct LogRecord
+{
+    LogFormat format = LogFormat::Unknown;
+    std::string_view timestamp;  ///< Временная метка в исходном виде
+    std::string_view hostname;   ///< Имя хоста (если есть в формате)
+    std::string_view service;    ///< Программа / APP-NAME / тип записи аудита
+    std::string_view pid;        ///< PID процесса (если есть)
+    std::string_view level;      ///< Нормализованный уровень (ERROR, WARNING, INFO, ...) или пусто
+    std::string_view message;    ///< Текст сообщения
+    std::string_view client_ip;  ///< IP адрес клиента/источника (если формат его выделяет)
+    std::string_view user;       ///< Пользователь (если формат его выделяет)
+    int severity = -1;           ///< Важность syslog 0-7, -1 если неизвестна
+};
+
+/**
+ * @brief Базовый интерфейс парсера одного формата
+ *
+ * Парсеры не используют регулярные выражения и не копируют данные строки.
+ */
+class LogParser
+{
+public:
+    virtual ~LogParser() = default;
+
+    /**
+     * @brief Формат, который разбирает парсер
+     */
+    virtual LogFormat format() const = 0;
+
+    /**
+     * @brief Разобрать строку
+     * @param line Исходная строка
+     * @param record Запись для заполнения
+     * @return True если строка соответствует формату
+     */
+    virtual bool parse(std::string_view line, LogRecord& record) const = 0;
+};
+
+/**
+ * @brief Реестр парсеров с автоопределением формата
+ *
+ * По умолчанию содержит парсеры всех встроенных форматов. Определение формата
+ * выполняется по первым строкам файла: побеждает парсер, принявший больше строк.
+ */
+class LogParserRegistry
+{
+public:
+    /**
+     * @brief Конструктор - регистрирует встроенные парсеры
+     */
+    LogParserRegistry();
+
+    /**
+     * @brief Общий экземпляр реестра
+     * @return Ссылка на реестр
+     */
+    static LogParserRegistry& instance();
+
+    /**
+     * @brief Зарегистрировать парсер (заменяет парсер того же формата)
+     * @param parser Парсер
+     */
+    void registerParser(std::unique_ptr<LogParser> parser);
+
+    /**
+     * @brief Найти парсер формата
+     * @param format Формат
+     * @return Парсер или nullptr
+     */
+    const LogParser* find(LogFormat format) const;
+
+    /**
+     * @brief Определить формат по образцу строк
+     * @param sample Образец строк
+     * @return Наиболее подходящий формат или LogFormat::Unknown
+     */
+    LogFormat detect(const std::vector<std::string_view>& sample) const;
+
+    /**
+     * @brief Определить формат файла по его первым строкам
+     * @param path Путь к файлу
+     * @param sample_lines Количество непустых строк для анализа
+     * @return Формат или LogFormat::Unknown
+     */
+    LogFormat detectFile(const std::string& path, size_t sample_lines = 16) const;
+
+    /**
+     * @brief Разобрать строку известным форматом, при неудаче - любым подходящим
+     * @param line Строка
+     * @param record Запись для заполнения
+     * @param hint Ожидаемый формат (например, определенный для файла)
+     * @return True если строку принял хотя бы один парсер
+     */
+    bool parse(std::string_view line, LogRecord& record, LogFormat hint = LogFormat::Unknown) const;
+
+private:
+    std::vector<std::unique_ptr<LogParser>> parsers_;
+};
+
+#endif
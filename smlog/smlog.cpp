@@ -7,6 +7,8 @@
 
 #include "SystemLogger.h"
 #include "../logger/logger.h"
+#include "../geoip/geoip.h"
+#include "../iplist/iplist.h"
 #include <iostream>
 #include <cstring>
 #include <csignal>
@@ -14,6 +16,13 @@
 #include <chrono>
 #include <thread>
 #include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
 
 SystemLogger* g_logger = nullptr;  ///< Глобальный экземпляр логгера
 
@@ -32,6 +41,13 @@ void help()
     std::cout << "smlog top-users <path> [count] - показать ток ползователей (по умолчанию: 10)" << std::endl;
     std::cout << "smlog report [type] - сгенерировать отчет (security, daily, system, journal, full)" << std::endl;
     std::cout << "smlog monitor - начать мониторинг логов (Ctrl+C для выхода)" << std::endl;
+    std::cout << "smlog format <path> - определить формат лог файла (syslog, rfc5424, json, access, auditd)" << std::endl;
+    std::cout << "smlog audit <path> [count] - показать события auditd (по умолчанию: 20)" << std::endl;
+    std::cout << "smlog replay <path> [pattern] - прогнать файл через конвейер мониторинга (pattern - правило безопасности)" << std::endl;
+    std::cout << "smlog forward <host:port> <path> [syslog|json] [spool_dir] - переслать лог файл на коллектор" << std::endl;
+    std::cout << "smlog scan [--cache=normal|dontneed|direct] <path> [path...] - прочитать файлы через io_uring и показать скорость" << std::endl;
+    std::cout << "smlog server [[address:]port] [threads] - принимать syslog по UDP и TCP (по умолчанию: 0.0.0.0:514)" << std::endl;
+    std::cout << "smlog bench-receiver [seconds] [threads] [pipeline|raw] - замер скорости приема syslog на loopback" << std::endl;
 }
 
 /**
@@ -180,6 +196,468 @@ void cmd_journal(SystemLogger& logger, int argc, char* argv[])
     }
 }
 
+/**
+ * @brief Команда для определения формата файла лога
+ * @param logger Экземпляр логгера
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_format(SystemLogger& logger, int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        LogError("Ошибка: требуется путь к логу");
+        LogError("Использование: smlog format <path>");
+        return;
+    }
+
+    std::string path = argv[2];
+    LogFormat format = logger.detectLogFormat(path);
+    if (format == LogFormat::Unknown)
+    {
+        LogWarning("Формат лога не определен: " + path);
+        return;
+    }
+
+    LogInfo(path + ": " + logFormatName(format));
+}
+
+/**
+ * @brief Команда для просмотра событий аудита
+ * @param logger Экземпляр логгера
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_audit(SystemLogger& logger, int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        LogError("Ошибка: требуется путь к логу аудита");
+        LogError("Использование: smlog audit <path> [count]");
+        return;
+    }
+
+    std::string path = argv[2];
+    int count = 20;
+
+    if (argc >= 4)
+    {
+        try
+        {
+            count = std::stoi(argv[3]);
+        }
+        catch (...)
+        {
+            LogError("Ошибка: неверное количество");
+            return;
+        }
+    }
+
+    auto events = logger.readAuditEvents(path, count);
+    if (events.empty() && !logger.getLastError().empty())
+    {
+        LogError("Ошибка: " + logger.getLastError());
+        return;
+    }
+
+    auto stats = logger.getAuditStats(path);
+    std::stringstream ss;
+    ss << "События аудита: " << stats["events"] << " (записей: " << stats["records"]
+       << ", неуспешных: " << stats["failed"] << ")";
+    LogInfo(ss.str());
+
+    for (const auto& event : events)
+        LogInfo("  " + event);
+}
+
+/**
+ * @brief Команда для прогона файла через конвейер мониторинга
+ *
+ * Файл обрабатывается как одна пачка, поступившая за интервал опроса,
+ * что позволяет проверить защиту от перегрузки на записанной лавине логов.
+ * @param logger Экземпляр логгера
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_replay(SystemLogger& logger, int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        LogError("Ошибка: требуется путь к логу");
+        LogError("Использование: smlog replay <path> [pattern]");
+        return;
+    }
+
+    std::string path = argv[2];
+    auto lines = logger.readLog(path, 0);
+    if (lines.empty() && !logger.getLastError().empty())
+    {
+        LogError("Ошибка: " + logger.getLastError());
+        return;
+    }
+
+    if (argc >= 4)
+        logger.addWatchRule("replay", argv[3], "alert", false, true);
+
+    logger.processLogLines(path, lines);
+
+    for (const auto& [source, stats] : logger.getShedStats())
+    {
+        std::stringstream ss;
+        ss << source << ": строк " << stats.lines
+           << ", обработано " << stats.processed
+           << ", отброшено " << stats.sampled_out
+           << ", свернуто " << stats.collapsed
+           << (stats.shedding ? " (защита от перегрузки включена)" : "");
+        LogInfo(ss.str());
+    }
+}
+
+/**
+ * @brief Команда для пересылки файла лога на коллектор
+ * @param logger Экземпляр логгера
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_forward(SystemLogger& logger, int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        LogError("Ошибка: требуется адрес коллектора и путь к логу");
+        LogError("Использование: smlog forward <host:port> <path> [syslog|json] [spool_dir]");
+        return;
+    }
+
+    LogForwarder::Config config;
+    if (!LogForwarder::parseTarget(argv[2], config))
+    {
+        LogError("Ошибка: неверный адрес коллектора: " + std::string(argv[2]));
+        return;
+    }
+
+    if (argc >= 5)
+    {
+        if (strcmp(argv[4], "json") == 0)
+            config.framing = LogForwarder::Framing::JsonLines;
+        else if (strcmp(argv[4], "syslog") != 0)
+        {
+            LogError("Ошибка: неизвестный формат: " + std::string(argv[4]));
+            return;
+        }
+    }
+    if (argc >= 6)
+        config.spool_dir = argv[5];
+
+    std::string path = argv[3];
+    auto lines = logger.readLog(path, 0);
+    if (lines.empty() && !logger.getLastError().empty())
+    {
+        LogError("Ошибка: " + logger.getLastError());
+        return;
+    }
+
+    if (!logger.enableForwarding(config))
+    {
+        LogError("Ошибка: " + logger.getLastError());
+        return;
+    }
+
+    logger.processLogLines(path, lines);
+    bool delivered = logger.flushForwarding();
+    auto counters = logger.getForwardStats().value_or(LogForwarder::Counters{});
+    logger.disableForwarding();
+
+    std::stringstream ss;
+    ss << "Коллектор " << config.host << ":" << config.port << ": отправлено " << counters.sent
+       << " событий (" << counters.bytes_sent << " байт, до сжатия " << counters.bytes_raw << ")"
+       << ", в спуле " << counters.lag << " событий (" << counters.spool_files << " пачек)";
+    LogInfo(ss.str());
+
+    if (!delivered)
+        LogWarning("Коллектор недоступен, события сохранены в " + config.spool_dir);
+}
+
+/**
+ * @brief Команда для массового чтения файлов логов
+ *
+ * Показывает, каким путем читались файлы (io_uring или pread) и с какой
+ * скоростью, и позволяет проверить режимы работы с page cache.
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_scan(int argc, char* argv[])
+{
+    auto options = BulkReader::defaultOptions();
+    std::vector<std::string> paths;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--cache=", 8) == 0)
+        {
+            if (!BulkReader::parseCacheMode(argv[i] + 8, options.cache))
+            {
+                LogError("Ошибка: неизвестный режим кэша: " + std::string(argv[i] + 8));
+                return;
+            }
+        }
+        else if (strcmp(argv[i], "--no-uring") == 0)
+            options.use_uring = false;
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.empty())
+    {
+        LogError("Ошибка: требуется путь к логу");
+        LogError("Использование: smlog scan [--cache=normal|dontneed|direct] [--no-uring] <path> [path...]");
+        return;
+    }
+
+    std::vector<uint64_t> lines(paths.size(), 0);
+    BulkReader reader(options);
+    auto start = std::chrono::steady_clock::now();
+    bool ok = reader.readLines(paths, [&lines](size_t file, std::string_view) {
+        lines[file]++;
+        return true;
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (size_t i = 0; i < paths.size(); ++i)
+        LogInfo(paths[i] + ": " + std::to_string(lines[i]) + " строк");
+
+    const auto& stats = reader.stats();
+    std::stringstream ss;
+    ss << "Прочитано " << stats.bytes << " байт из " << stats.files << " файлов через "
+       << (stats.uring ? "io_uring" : "pread") << " (кэш: " << BulkReader::cacheModeName(options.cache)
+       << (stats.direct ? ", O_DIRECT" : "") << ", запросов " << stats.reads
+       << ", в полете до " << stats.max_in_flight << "), "
+       << std::fixed << std::setprecision(1) << (seconds > 0 ? stats.bytes / seconds / 1e6 : 0.0) << " МБ/с";
+    LogInfo(ss.str());
+
+    if (!ok)
+        LogWarning(reader.getLastError());
+}
+
+/**
+ * @brief Команда для запуска приема syslog по сети
+ * @param logger Экземпляр логгера
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_server(SystemLogger& logger, int argc, char* argv[])
+{
+    SyslogReceiver::Config config;
+    if (argc >= 3 && !SyslogReceiver::parseListen(argv[2], config))
+    {
+        LogError("Ошибка: неверный адрес: " + std::string(argv[2]));
+        LogError("Использование: smlog server [[address:]port] [threads]");
+        return;
+    }
+
+    if (argc >= 4)
+    {
+        try
+        {
+            config.threads = std::stoul(argv[3]);
+        }
+        catch (...)
+        {
+            LogError("Ошибка: неверное количество потоков");
+            return;
+        }
+    }
+
+    if (!logger.startSyslogServer(config))
+    {
+        LogError("Ошибка: " + logger.getLastError());
+        return;
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    g_logger = &logger;
+
+    std::stringstream ss;
+    ss << "Прием syslog на " << config.address << ":" << config.port << " (UDP и TCP, Ctrl+C для остановки)...";
+    LogInfo(ss.str());
+
+    logger.startMonitoring();
+    while (logger.isMonitoring())
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+}
+
+/**
+ * @brief Отправлять UDP сообщения пачками sendmmsg до остановки
+ */
+static void bench_send_udp(int port, int id, const std::atomic<bool>& stop, std::atomic<uint64_t>& sent)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        return;
+
+    constexpr int batch = 64;
+    std::vector<std::string> messages(batch);
+    std::vector<iovec> iovecs(batch);
+    std::vector<mmsghdr> headers(batch);
+    uint64_t seq = 0;
+
+    while (!stop)
+    {
+        for (int i = 0; i < batch; ++i)
+        {
+            messages[i] = "<30>Oct 18 12:00:00 rack-" + std::to_string(id) + " benchd[" + std::to_string(1000 + id) +
+                          "]: bench message " + std::to_string(seq++) + " status=ok";
+            iovecs[i] = {messages[i].data(), messages[i].size()};
+            headers[i] = mmsghdr{};
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = sendmmsg(fd, headers.data(), batch, 0);
+        if (n > 0)
+            sent += n;
+    }
+    close(fd);
+}
+
+/**
+ * @brief Отправлять кадры RFC6587 (octet counting) по TCP до остановки
+ */
+static void bench_send_tcp(int port, int id, const std::atomic<bool>& stop, std::atomic<uint64_t>& sent)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        return;
+
+    uint64_t seq = 0;
+    std::string chunk;
+    while (!stop)
+    {
+        chunk.clear();
+        for (int i = 0; i < 256; ++i)
+        {
+            std::string message = "<30>1 2026-10-18T12:00:00Z rack-" + std::to_string(id) + " benchd " +
+                                  std::to_string(1000 + id) + " - - bench message " + std::to_string(seq + i) + " status=ok";
+            chunk += std::to_string(message.size()) + " " + message;
+        }
+
+        size_t offset = 0;
+        while (offset < chunk.size())
+        {
+            ssize_t n = send(fd, chunk.data() + offset, chunk.size() - offset, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                close(fd);
+                return;
+            }
+            offset += n;
+        }
+        seq += 256;
+        sent += 256;
+    }
+    close(fd);
+}
+
+/**
+ * @brief Команда для замера пропускной способности приема syslog на loopback
+ *
+ * Отправители и сервер работают в одном процессе. В режиме pipeline
+ * сообщения проходят полный конвейер (разбор, правила, защита от
+ * перегрузки), в режиме raw - только прием и кадрирование.
+ * @param logger Экземпляр логгера
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_bench_receiver(SystemLogger& logger, int argc, char* argv[])
+{
+    int seconds = 3;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool raw = false;
+
+    try
+    {
+        if (argc >= 3)
+            seconds = std::max(1, std::stoi(argv[2]));
+        if (argc >= 4)
+            threads = std::max(1ul, std::stoul(argv[3]));
+    }
+    catch (...)
+    {
+        LogError("Ошибка: неверные параметры");
+        LogError("Использование: smlog bench-receiver [seconds] [threads] [pipeline|raw]");
+        return;
+    }
+    if (argc >= 5)
+        raw = strcmp(argv[4], "raw") == 0;
+
+    std::atomic<uint64_t> received{0};
+    SyslogReceiver::Config config;
+    config.address = "127.0.0.1";
+    config.port = 0;
+    config.threads = threads;
+
+    SyslogReceiver receiver(config, [&](const std::string& source, const std::vector<std::string>& messages) {
+        if (!raw)
+            logger.processLogLines(source, messages);
+        received += messages.size();
+    });
+    if (!receiver.start())
+    {
+        LogError("Ошибка: " + receiver.getLastError());
+        return;
+    }
+
+    for (bool tcp : {false, true})
+    {
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> sent{0};
+        received = 0;
+
+        std::vector<std::thread> senders;
+        for (unsigned i = 0; i < threads; ++i)
+            senders.emplace_back(tcp ? bench_send_tcp : bench_send_udp, receiver.port(), i, std::cref(stop), std::ref(sent));
+
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        stop = true;
+        for (auto& sender : senders)
+            sender.join();
+
+        // Досчитываем то, что уже в буферах сокетов
+        uint64_t last = 0;
+        do
+        {
+            last = received;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        } while (received != last || (tcp && received < sent && std::chrono::steady_clock::now() - start < std::chrono::seconds(seconds + 10)));
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - 0.2;
+        uint64_t lost = sent > received ? sent - received : 0;
+
+        std::stringstream ss;
+        ss << (tcp ? "TCP" : "UDP") << ": отправлено " << sent << ", получено " << received
+           << ", потеряно " << lost << ", " << static_cast<uint64_t>(received / elapsed) << " сообщений/с ("
+           << threads << " потоков, " << (raw ? "raw" : "pipeline") << ")";
+        LogInfo(ss.str());
+    }
+
+    auto counters = receiver.counters();
+    receiver.stop();
+
+    std::stringstream ss;
+    ss << "Пачек: " << counters.batches << ", ошибок кадрирования: " << counters.framing_errors
+       << ", обрезано: " << counters.truncated;
+    LogInfo(ss.str());
+}
+
 /**
  * @brief Команда для отображения топ IP адресов
  * @param logger Экземпляр логгера
@@ -220,10 +698,21 @@ void cmd_top_ips(SystemLogger& logger, int argc, char* argv[])
     std::stringstream ss;
     ss << "Топ " << count << " IP адресов:";
     LogInfo(ss.str());
+    // Страны одним пакетом: адреса из одной сети отвечают из кэша GeoIP
+    std::vector<std::string> ips;
+    for (const auto& entry : top_ips)
+        ips.push_back(entry.first);
+    auto countries = GeoIPService::instance().countries(ips);
+    // Адреса из блокирующих списков отмечаются, доверенные уже исключены из топа
+    auto lists = IpListService::instance().lists();
+
+    size_t index = 0;
     for (const auto& [ip, cnt] : top_ips)
     {
         ss.str("");
-        ss << "  " << ip << ": " << cnt << " событий";
+        ss << "  " << ip << ": " << cnt << " событий [" << countries[index++] << "]";
+        if (const PrefixMatcher::List* list = lists ? lists->match(ip) : nullptr)
+            ss << " (в списке " << list->name << ")";
         LogInfo(ss.str());
     }
 }
@@ -409,6 +898,48 @@ int main(int argc, char* argv[])
         return 0;
     }
     
+    if (argc >= 2 && strcmp(argv[1], "format") == 0)
+    {
+        cmd_format(logger, argc, argv);
+        return 0;
+    }
+    
+    if (argc >= 2 && strcmp(argv[1], "audit") == 0)
+    {
+        cmd_audit(logger, argc, argv);
+        return 0;
+    }
+    
+    if (argc >= 2 && strcmp(argv[1], "replay") == 0)
+    {
+        cmd_replay(logger, argc, argv);
+        return 0;
+    }
+    
+    if (argc >= 2 && strcmp(argv[1], "forward") == 0)
+    {
+        cmd_forward(logger, argc, argv);
+        return 0;
+    }
+    
+    if (argc >= 2 && strcmp(argv[1], "scan") == 0)
+    {
+        cmd_scan(argc, argv);
+        return 0;
+    }
+    
+    if (argc >= 2 && strcmp(argv[1], "server") == 0)
+    {
+        cmd_server(logger, argc, argv);
+        return 0;
+    }
+    
+    if (argc >= 2 && strcmp(argv[1], "bench-receiver") == 0)
+    {
+        cmd_bench_receiver(logger, argc, argv);
+        return 0;
+    }
+    
     std::stringstream ss;
     ss << "Ошибка: неизвестная команда: " << argv[1];
     LogError(ss.str());
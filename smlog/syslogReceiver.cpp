@@ -0,0 +1,600 @@
+/**
+ * @file syslogReceiver.cpp
+ * @brief Реализация сервера приема syslog
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "syslogReceiver.h"
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    constexpr size_t kMaxOctetFrame = 1 << 20;  ///< Больше - считаем поток испорченным
+    constexpr int kUdpBatchesPerWakeup = 16;    ///< Чтобы UDP не вытеснял TCP соединения
+
+    bool same_host(const sockaddr_storage& a, const sockaddr_storage& b)
+    {
+        if (a.ss_family != b.ss_family)
+            return false;
+        if (a.ss_family == AF_INET)
+            return reinterpret_cast<const sockaddr_in&>(a).sin_addr.s_addr ==
+                   reinterpret_cast<const sockaddr_in&>(b).sin_addr.s_addr;
+        if (a.ss_family == AF_INET6)
+            return memcmp(&reinterpret_cast<const sockaddr_in6&>(a).sin6_addr,
+                          &reinterpret_cast<const sockaddr_in6&>(b).sin6_addr, sizeof(in6_addr)) == 0;
+        return true;
+    }
+
+    std::string source_name(const sockaddr_storage& addr)
+    {
+        char host[INET6_ADDRSTRLEN] = "unknown";
+        if (addr.ss_family == AF_INET)
+            inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(addr).sin_addr, host, sizeof(host));
+        else if (addr.ss_family == AF_INET6)
+            inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(addr).sin6_addr, host, sizeof(host));
+
+        std::string name = host;
+        // IPv4 через двойной стек отображается как обычный адрес
+        if (name.compare(0, 7, "::ffff:") == 0 && name.find('.') != std::string::npos)
+            name.erase(0, 7);
+        return "syslog://" + name;
+    }
+
+    void trim_message(const char* data, size_t& length)
+    {
+        while (length > 0 && (data[length - 1] == '\n' || data[length - 1] == '\r' || data[length - 1] == '\0'))
+            length--;
+    }
+}
+
+struct SyslogReceiver::Connection
+{
+    std::string source;
+    std::string buffer;
+};
+
+struct SyslogReceiver::Worker
+{
+    int udp_fd = -1;
+    int tcp_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::thread thread;
+    std::unordered_map<int, Connection> connections;
+
+    // Буферы recvmmsg, выделяются один раз
+    std::vector<char> buffers;
+    std::vector<mmsghdr> headers;
+    std::vector<iovec> iovecs;
+    std::vector<sockaddr_storage> addresses;
+
+    struct Group
+    {
+        sockaddr_storage address;
+        std::vector<std::string> messages;
+    };
+    std::vector<Group> groups;
+    std::vector<std::string> frames;
+
+    std::atomic<uint64_t> udp_messages{0};
+    std::atomic<uint64_t> tcp_messages{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> truncated{0};
+    std::atomic<uint64_t> framing_errors{0};
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> active{0};
+    std::atomic<uint64_t> rejected{0};
+};
+
+SyslogReceiver::SyslogReceiver(const Config& config, Handler handler)
+    : config_(config), handler_(std::move(handler))
+{
+    if (config_.batch_size == 0)
+        config_.batch_size = 1;
+    if (config_.max_message < 480)
+        config_.max_message = 480;  // Минимум, который RFC5424 требует принимать
+}
+
+SyslogReceiver::~SyslogReceiver()
+{
+    stop();
+}
+
+bool SyslogReceiver::start()
+{
+    if (running_)
+        return true;
+
+    if (!config_.udp && !config_.tcp)
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        last_error_ = "Не выбран ни UDP, ни TCP";
+        return false;
+    }
+
+    unsigned count = config_.threads;
+    if (count == 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+
+    port_ = config_.port;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        auto worker = std::make_unique<Worker>();
+        if (!open_worker(*worker))
+        {
+            // Закрываем то, что успели открыть
+            workers_.push_back(std::move(worker));
+            stop();
+            workers_.clear();
+            return false;
+        }
+        workers_.push_back(std::move(worker));
+    }
+
+    running_ = true;
+    for (auto& worker : workers_)
+        worker->thread = std::thread(&SyslogReceiver::worker_loop, this, std::ref(*worker));
+    return true;
+}
+
+void SyslogReceiver::stop()
+{
+    running_ = false;
+
+    for (auto& worker : workers_)
+    {
+        if (worker->wake_fd >= 0)
+        {
+            uint64_t one = 1;
+            ssize_t written = write(worker->wake_fd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+
+    for (auto& worker : workers_)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+
+        for (auto& [fd, connection] : worker->connections)
+            close(fd);
+        worker->connections.clear();
+
+        for (int* fd : {&worker->udp_fd, &worker->tcp_fd, &worker->epoll_fd, &worker->wake_fd})
+        {
+            if (*fd >= 0)
+                close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+SyslogReceiver::Counters SyslogReceiver::counters() const
+{
+    Counters total;
+    for (const auto& worker : workers_)
+    {
+        total.udp_messages += worker->udp_messages.load(std::memory_order_relaxed);
+        total.tcp_messages += worker->tcp_messages.load(std::memory_order_relaxed);
+        total.bytes += worker->bytes.load(std::memory_order_relaxed);
+        total.batches += worker->batches.load(std::memory_order_relaxed);
+        total.truncated += worker->truncated.load(std::memory_order_relaxed);
+        total.framing_errors += worker->framing_errors.load(std::memory_order_relaxed);
+        total.connections += worker->accepted.load(std::memory_order_relaxed);
+        total.active_connections += worker->active.load(std::memory_order_relaxed);
+        total.rejected += worker->rejected.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::string SyslogReceiver::getLastError() const
+{
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return last_error_;
+}
+
+bool SyslogReceiver::parseListen(const std::string& listen, Config& config)
+{
+    std::string address = config.address;
+    std::string port = listen;
+
+    size_t colon = listen.rfind(':');
+    if (colon != std::string::npos)
+    {
+        address = listen.substr(0, colon);
+        port = listen.substr(colon + 1);
+        if (address.size() > 2 && address.front() == '[' && address.back() == ']')
+            address = address.substr(1, address.size() - 2);
+        if (address.empty())
+            return false;
+    }
+
+    try
+    {
+        size_t used = 0;
+        int value = std::stoi(port, &used);
+        if (used != port.size() || value < 0 || value > 65535)
+            return false;
+        config.address = address;
+        config.port = value;
+        return true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+size_t SyslogReceiver::extractFrames(std::string& buffer, size_t max_message, std::vector<std::string>& messages)
+{
+    size_t errors = 0;
+    size_t pos = 0;
+    const size_t size = buffer.size();
+
+    while (pos < size)
+    {
+        char c = buffer[pos];
+        if (c == '\n' || c == '\r' || c == '\0')
+        {
+            pos++;
+            continue;
+        }
+
+        // Octet counting: "LEN SP MSG"
+        if (c >= '1' && c <= '9')
+        {
+            size_t digits_end = pos;
+            while (digits_end < size && digits_end - pos < 8 && buffer[digits_end] >= '0' && buffer[digits_end] <= '9')
+                digits_end++;
+
+            if (digits_end == size)
+                break;  // Длина еще не дочитана
+
+            if (buffer[digits_end] == ' ')
+            {
+                size_t length = std::stoul(buffer.substr(pos, digits_end - pos));
+                if (length <= kMaxOctetFrame)
+                {
+                    size_t start = digits_end + 1;
+                    if (size - start < length)
+                        break;  // Кадр еще не дочитан
+
+                    size_t kept = std::min(length, max_message);
+                    trim_message(buffer.data() + start, kept);
+                    if (kept > 0)
+                        messages.emplace_back(buffer, start, kept);
+                    pos = start + length;
+                    continue;
+                }
+                errors++;
+            }
+            // Не похоже на длину: читаем как кадр с разделителем
+        }
+
+        // Non-transparent framing: сообщение до LF (или NUL)
+        size_t end = pos;
+        while (end < size && buffer[end] != '\n' && buffer[end] != '\0')
+            end++;
+
+        if (end == size)
+        {
+            if (size - pos > max_message)
+            {
+                // Разделителя нет слишком долго: отдаем накопленное, чтобы не расти без предела
+                messages.emplace_back(buffer, pos, max_message);
+                pos += max_message;
+                errors++;
+                continue;
+            }
+            break;
+        }
+
+        size_t length = std::min(end - pos, max_message);
+        trim_message(buffer.data() + pos, length);
+        if (length > 0)
+            messages.emplace_back(buffer, pos, length);
+        pos = end + 1;
+    }
+
+    buffer.erase(0, pos);
+    return errors;
+}
+
+bool SyslogReceiver::open_worker(Worker& worker)
+{
+    auto fail = [this](const std::string& what) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        last_error_ = what + " " + config_.address + ":" + std::to_string(port_) + ": " + strerror(errno);
+        return false;
+    };
+
+    auto open_socket = [&](int type) -> int {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = type;
+        hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+
+        addrinfo* result = nullptr;
+        if (getaddrinfo(config_.address.c_str(), std::to_string(port_).c_str(), &hints, &result) != 0 || !result)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+
+        int fd = socket(result->ai_family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            freeaddrinfo(result);
+            return -1;
+        }
+
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        // Каждый поток слушает свой сокет на том же порту, ядро распределяет нагрузку
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+        if (type == SOCK_DGRAM && config_.receive_buffer > 0)
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &config_.receive_buffer, sizeof(config_.receive_buffer));
+
+        int rc = bind(fd, result->ai_addr, result->ai_addrlen);
+        freeaddrinfo(result);
+        if (rc < 0 || (type == SOCK_STREAM && listen(fd, SOMAXCONN) < 0))
+        {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+
+        // Порт 0: остальные сокеты открываются на выбранном ядром порту
+        if (port_ == 0)
+        {
+            sockaddr_storage bound{};
+            socklen_t length = sizeof(bound);
+            if (getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length) == 0)
+                port_ = ntohs(bound.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6&>(bound).sin6_port
+                                                          : reinterpret_cast<sockaddr_in&>(bound).sin_port);
+        }
+        return fd;
+    };
+
+    worker.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    worker.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (worker.epoll_fd < 0 || worker.wake_fd < 0)
+        return fail("Не удалось создать epoll для");
+
+    if (config_.udp && (worker.udp_fd = open_socket(SOCK_DGRAM)) < 0)
+        return fail("Не удалось открыть UDP порт");
+    if (config_.tcp && (worker.tcp_fd = open_socket(SOCK_STREAM)) < 0)
+        return fail("Не удалось открыть TCP порт");
+
+    for (int fd : {worker.wake_fd, worker.udp_fd, worker.tcp_fd})
+    {
+        if (fd < 0)
+            continue;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+            return fail("Не удалось подписаться на события");
+    }
+
+    if (config_.udp)
+    {
+        size_t batch = config_.batch_size;
+        worker.buffers.resize(batch * config_.max_message);
+        worker.headers.resize(batch);
+        worker.iovecs.resize(batch);
+        worker.addresses.resize(batch);
+        for (size_t i = 0; i < batch; ++i)
+        {
+            worker.iovecs[i].iov_base = worker.buffers.data() + i * config_.max_message;
+            worker.iovecs[i].iov_len = config_.max_message;
+        }
+    }
+    return true;
+}
+
+void SyslogReceiver::worker_loop(Worker& worker)
+{
+    epoll_event events[64];
+
+    while (running_)
+    {
+        int ready = epoll_wait(worker.epoll_fd, events, 64, -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < ready && running_; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == worker.wake_fd)
+                continue;
+            if (fd == worker.udp_fd)
+                read_udp(worker);
+            else if (fd == worker.tcp_fd)
+                accept_tcp(worker);
+            else
+                read_tcp(worker, fd);
+        }
+    }
+}
+
+void SyslogReceiver::read_udp(Worker& worker)
+{
+    const size_t batch = worker.headers.size();
+
+    for (int round = 0; round < kUdpBatchesPerWakeup; ++round)
+    {
+        for (size_t i = 0; i < batch; ++i)
+        {
+            msghdr& header = worker.headers[i].msg_hdr;
+            header = msghdr{};
+            header.msg_name = &worker.addresses[i];
+            header.msg_namelen = sizeof(sockaddr_storage);
+            header.msg_iov = &worker.iovecs[i];
+            header.msg_iovlen = 1;
+        }
+
+        int received = recvmmsg(worker.udp_fd, worker.headers.data(), batch, MSG_DONTWAIT, nullptr);
+        if (received <= 0)
+            return;
+
+        // Группируем по отправителю: обычно в пачке несколько хостов
+        for (auto& group : worker.groups)
+            group.messages.clear();
+        size_t groups_used = 0;
+        uint64_t bytes = 0;
+
+        for (int i = 0; i < received; ++i)
+        {
+            const char* data = static_cast<const char*>(worker.iovecs[i].iov_base);
+            size_t length = worker.headers[i].msg_len;
+            bytes += length;
+            if (worker.headers[i].msg_hdr.msg_flags & MSG_TRUNC)
+                worker.truncated.fetch_add(1, std::memory_order_relaxed);
+
+            trim_message(data, length);
+            if (length == 0)
+                continue;
+
+            const sockaddr_storage& address = worker.addresses[i];
+            size_t g = 0;
+            while (g < groups_used && !same_host(worker.groups[g].address, address))
+                g++;
+            if (g == groups_used)
+            {
+                if (g == worker.groups.size())
+                    worker.groups.emplace_back();
+                worker.groups[g].address = address;
+                groups_used++;
+            }
+            worker.groups[g].messages.emplace_back(data, length);
+        }
+
+        worker.udp_messages.fetch_add(received, std::memory_order_relaxed);
+        worker.bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+        for (size_t g = 0; g < groups_used; ++g)
+        {
+            if (worker.groups[g].messages.empty())
+                continue;
+            worker.batches.fetch_add(1, std::memory_order_relaxed);
+            handler_(source_name(worker.groups[g].address), worker.groups[g].messages);
+        }
+
+        if (static_cast<size_t>(received) < batch)
+            return;  // Очередь сокета опустела
+    }
+}
+
+void SyslogReceiver::accept_tcp(Worker& worker)
+{
+    while (true)
+    {
+        sockaddr_storage address{};
+        socklen_t length = sizeof(address);
+        int fd = accept4(worker.tcp_fd, reinterpret_cast<sockaddr*>(&address), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        if (worker.connections.size() >= config_.max_connections)
+        {
+            worker.rejected.fetch_add(1, std::memory_order_relaxed);
+            close(fd);
+            continue;
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            close(fd);
+            continue;
+        }
+
+        worker.connections[fd].source = source_name(address);
+        worker.accepted.fetch_add(1, std::memory_order_relaxed);
+        worker.active.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SyslogReceiver::read_tcp(Worker& worker, int fd)
+{
+    auto it = worker.connections.find(fd);
+    if (it == worker.connections.end())
+        return;
+
+    Connection& connection = it->second;
+    char chunk[65536];
+    bool closed = false;
+    uint64_t bytes = 0;
+
+    // Читаем не больше нескольких блоков за раз, чтобы не задерживать другие соединения
+    for (int round = 0; round < 16; ++round)
+    {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n > 0)
+        {
+            connection.buffer.append(chunk, n);
+            bytes += n;
+            if (static_cast<size_t>(n) < sizeof(chunk))
+                break;
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            closed = true;
+        break;
+    }
+
+    worker.frames.clear();
+    size_t errors = extractFrames(connection.buffer, config_.max_message, worker.frames);
+
+    // Последнее сообщение без перевода строки при закрытии соединения
+    if (closed && !connection.buffer.empty())
+    {
+        size_t length = std::min(connection.buffer.size(), config_.max_message);
+        trim_message(connection.buffer.data(), length);
+        if (length > 0)
+            worker.frames.emplace_back(connection.buffer, 0, length);
+        connection.buffer.clear();
+    }
+
+    worker.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (errors > 0)
+        worker.framing_errors.fetch_add(errors, std::memory_order_relaxed);
+
+    if (!worker.frames.empty())
+    {
+        worker.tcp_messages.fetch_add(worker.frames.size(), std::memory_order_relaxed);
+        worker.batches.fetch_add(1, std::memory_order_relaxed);
+        handler_(connection.source, worker.frames);
+    }
+
+    if (closed)
+        close_connection(worker, fd);
+}
+
+void SyslogReceiver::close_connection(Worker& worker, int fd)
+{
+    epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    worker.connections.erase(fd);
+    worker.active.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,163 @@
+/**
+ * @file syslogReceiver.h
+ * @brief Прием syslog сообщений по сети (режим коллектора)
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#ifndef SYSLOGRECEIVER_H
+#define SYSLOGRECEIVER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+/**
+ * @brief Сервер syslog на UDP и TCP
+ *
+ * Каждый рабочий поток владеет собственными UDP и TCP сокетами на одном
+ * порту (SO_REUSEPORT), поэтому ядро само распределяет датаграммы и
+ * соединения между потоками без общей очереди. UDP читается пачками через
+ * recvmmsg. На TCP поддерживаются оба варианта кадрирования RFC6587:
+ * octet counting ("LEN SP MSG") и разделение переводом строки.
+ *
+ * Принятые сообщения передаются обработчику пачками, сгруппированными по
+ * адресу отправителя: источник имеет вид "syslog://<ip>".
+ */
+class SyslogReceiver
+{
+public:
+    /**
+     * @brief Обработчик пачки сообщений одного отправителя
+     */
+    using Handler = std::function<void(const std::string& source, const std::vector<std::string>& messages)>;
+
+    /**
+     * @brief Настройки сервера
+     */
+    struct Config
+    {
+        std::string address = "0.0.0.0";
+        int port = 514;                      ///< 0 - выбрать свободный порт
+        bool udp = true;
+        bool tcp = true;
+        unsigned threads = 0;                ///< 0 - по числу ядер
+        size_t batch_size = 64;              ///< Датаграмм за один recvmmsg
+        size_t max_message = 8192;           ///< Максимальная длина сообщения
+        size_t max_connections = 1024;       ///< TCP соединений на поток
+        int receive_buffer = 8 << 20;        ///< SO_RCVBUF для UDP
+    };
+
+    /**
+     * @brief Счетчики сервера (сумма по потокам)
+     */
+    struct Counters
+    {
+        uint64_t udp_messages = 0;
+        uint64_t tcp_messages = 0;
+        uint64_t bytes = 0;
+        uint64_t batches = 0;           ///< Вызовов обработчика
+        uint64_t truncated = 0;         ///< Сообщений длиннее max_message
+        uint64_t framing_errors = 0;    ///< Нарушений кадрирования TCP
+        uint64_t connections = 0;       ///< Принято TCP соединений
+        uint64_t active_connections = 0;
+        uint64_t rejected = 0;          ///< Отклонено соединений сверх лимита
+    };
+
+    SyslogReceiver(const Config& config, Handler handler);
+    ~SyslogReceiver();
+
+    SyslogReceiver(const SyslogReceiver&) = delete;
+    SyslogReceiver& operator=(const SyslogReceiver&) = delete;
+
+    /**
+     * @brief Открыть сокеты и запустить рабочие потоки
+     * @return True если сервер запущен
+     */
+    bool start();
+
+    /**
+     * @brief Остановить потоки и закрыть сокеты
+     */
+    void stop();
+
+    /**
+     * @brief Запущен ли сервер
+     */
+    bool isRunning() const
+    {
+        return running_;
+    }
+
+    /**
+     * @brief Фактический порт (полезно при port = 0)
+     */
+    int port() const
+    {
+        return port_;
+    }
+
+    /**
+     * @brief Количество рабочих потоков
+     */
+    size_t threads() const
+    {
+        return workers_.size();
+    }
+
+    /**
+     * @brief Получить счетчики
+     */
+    Counters counters() const;
+
+    /**
+     * @brief Получить последнюю ошибку
+     */
+    std::string getLastError() const;
+
+    /**
+     * @brief Разобрать "[address:]port" в конфигурацию
+     * @param listen Строка адреса
+     * @param config Конфигурация для заполнения
+     * @return True если строка корректна
+     */
+    static bool parseListen(const std::string& listen, Config& config);
+
+    /**
+     * @brief Выделить сообщения из потока TCP (RFC6587)
+     *
+     * Полные кадры удаляются из буфера, неполный хвост остается.
+     * @param buffer Накопленные данные соединения
+     * @param max_message Максимальная длина сообщения
+     * @param messages Вектор для найденных сообщений
+     * @return Количество нарушений кадрирования
+     */
+    static size_t extractFrames(std::string& buffer, size_t max_message, std::vector<std::string>& messages);
+
+private:
+    struct Worker;
+    struct Connection;
+
+    bool open_worker(Worker& worker);
+    void worker_loop(Worker& worker);
+    void read_udp(Worker& worker);
+    void accept_tcp(Worker& worker);
+    void read_tcp(Worker& worker, int fd);
+    void close_connection(Worker& worker, int fd);
+
+    Config config_;
+    Handler handler_;
+    int port_ = 0;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex error_mutex_;
+    std::string last_error_;
+};
+
+#endif
@@ -20,6 +20,7 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/types.h>
+#include "../ipaddress/ipaddress.h"
 
 /**
  * @brief Сканер портов и анализатор сетевых соединений
@@ -36,9 +37,9 @@ private:
     struct ConnectionInfo
     {
         std::string protocol;        /**< Network protocol (TCP/UDP) */
-        std::string local_address;   /**< Local IP address */
+        IpAddress local_address;     /**< Local IP address */
         int local_port;              /**< Local port number */
-        std::string remote_address;  /**< Remote IP address */
+        IpAddress remote_address;    /**< Remote IP address */
         int remote_port;             /**< Remote port number */
         std::string state;           /**< Connection state */
         pid_t pid;                   /**< Process ID owning the connection */
@@ -119,19 +120,25 @@ private:
         closedir(proc_dir);
     }
 
-    std::string hexToIp(const std::string& hex_ip)
+    /**
+     * @brief Parse an address from /proc/net/tcp (IPv4) or /proc/net/tcp6 (IPv6)
+     * @return Unspecified address if the field is malformed
+     */
+    IpAddress hexToIp(const std::string& hex_ip)
     {
-        if (hex_ip.length() != 8) return "0.0.0.0";
-        
-        unsigned int ip_int;
-        std::stringstream ss;
-        ss << std::hex << hex_ip;
-        ss >> ip_int;
-        
-        return std::to_string(ip_int & 0xFF) + "." +
-               std::to_string((ip_int >> 8) & 0xFF) + "." +
-               std::to_string((ip_int >> 16) & 0xFF) + "." +
-               std::to_string((ip_int >> 24) & 0xFF);
+        IpAddress address;
+        IpAddress::fromProcHex(hex_ip, address);
+        return address;
+    }
+
+    /**
+     * @brief Format an endpoint for output, IPv6 in brackets
+     */
+    static std::string formatEndpoint(const IpAddress& address, int port)
+    {
+        if (address.isV4())
+            return address.toString() + ":" + std::to_string(port);
+        return "[" + address.toString() + "]:" + std::to_string(port);
     }
 
     int hexToPort(const std::string& hex_port)
@@ -240,8 +247,8 @@ public:
             if (conn.state == "LISTEN" || conn.state == "ESTABLISHED")
             {
                 std::cout << std::setw(8) << conn.protocol
-                          << std::setw(20) << (conn.local_address + ":" + std::to_string(conn.local_port))
-                          << std::setw(20) << (conn.remote_address + ":" + std::to_string(conn.remote_port))
+                          << std::setw(20) << formatEndpoint(conn.local_address, conn.local_port)
+                          << std::setw(20) << formatEndpoint(conn.remote_address, conn.remote_port)
                           << std::setw(15) << conn.state
                           << std::setw(10) << (conn.pid == -1 ? "-" : std::to_string(conn.pid))
                           << std::setw(25) << (conn.process_name.length() > 24 ? 
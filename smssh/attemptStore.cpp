@@ -0,0 +1,241 @@
+/**
+ * @file attemptStore.cpp
+ * @brief Реализация компактного хранения попыток входа
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "attemptStore.h"
+#include <algorithm>
+#include <numeric>
+
+uint32_t InternRefs::allocate() {
+    if (!free_.empty()) {
+        uint32_t id = free_.back();
+        free_.pop_back();
+        refs_[id] = 1;
+        return id;
+    }
+    refs_.push_back(1);
+    return static_cast<uint32_t>(refs_.size() - 1);
+}
+
+bool InternRefs::drop(uint32_t id) {
+    if (--refs_[id] > 0) {
+        return false;
+    }
+    free_.push_back(id);
+    return true;
+}
+
+uint32_t SymbolTable::acquire(std::string_view text) {
+    auto it = index_.find(text);
+    if (it != index_.end()) {
+        retain(it->second);
+        return it->second;
+    }
+
+    uint32_t id = allocate();
+    if (id == names_.size()) {
+        names_.emplace_back(text);
+    } else {
+        names_[id].assign(text);
+    }
+    index_.emplace(names_[id], id);
+    return id;
+}
+
+void SymbolTable::release(uint32_t id) {
+    if (drop(id)) {
+        index_.erase(names_[id]);
+        names_[id].clear();
+    }
+}
+
+bool SymbolTable::find(std::string_view text, uint32_t& id) const {
+    auto it = index_.find(text);
+    if (it == index_.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+size_t SymbolTable::memoryUsage() const {
+    size_t bytes = names_.size() * sizeof(std::string) + refs_.capacity() * sizeof(uint32_t) +
+                   index_.size() * (sizeof(std::string_view) + sizeof(uint32_t) + 2 * sizeof(void*)) +
+                   index_.bucket_count() * sizeof(void*);
+    for (const auto& name : names_) {
+        if (name.capacity() > 15) {
+            bytes += name.capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+uint32_t AddressTable::acquire(std::string_view text) {
+    IpAddress key;
+    if (IpAddress::parse(text, key)) {
+        return acquire(key);
+    }
+
+    auto it = text_index_.find(text);
+    if (it != text_index_.end()) {
+        retain(it->second);
+        return it->second;
+    }
+    uint32_t id = allocateSlot(IpAddress(), true);
+    names_[id].assign(text);
+    text_index_.emplace(names_[id], id);
+    return id;
+}
+
+uint32_t AddressTable::acquire(const IpAddress& address) {
+    auto it = index_.find(address);
+    if (it != index_.end()) {
+        retain(it->second);
+        return it->second;
+    }
+    uint32_t id = allocateSlot(address, false);
+    names_[id] = address.toString();
+    index_.emplace(address, id);
+    return id;
+}
+
+uint32_t AddressTable::allocateSlot(const IpAddress& key, bool textual) {
+    uint32_t id = allocate();
+    if (id == names_.size()) {
+        names_.emplace_back();
+        keys_.emplace_back();
+        textual_.push_back(false);
+    }
+    keys_[id] = key;
+    textual_[id] = textual;
+    return id;
+}
+
+void AddressTable::release(uint32_t id) {
+    if (!drop(id)) {
+        return;
+    }
+    if (textual_[id]) {
+        text_index_.erase(names_[id]);
+    } else {
+        index_.erase(keys_[id]);
+    }
+    names_[id].clear();
+}
+
+size_t AddressTable::memoryUsage() const {
+    size_t bytes = names_.size() * sizeof(std::string) + refs_.capacity() * sizeof(uint32_t) +
+                   keys_.capacity() * sizeof(IpAddress) + textual_.capacity() / 8 +
+                   index_.size() * (sizeof(IpAddress) + sizeof(uint32_t) + 2 * sizeof(void*)) +
+                   index_.bucket_count() * sizeof(void*);
+    for (const auto& name : names_) {
+        if (name.capacity() > 15) {
+            bytes += name.capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+void AttemptStore::append(uint32_t ip, uint32_t user, std::chrono::system_clock::time_point time,
+                          uint16_t port, bool success, bool standard_port) {
+    int64_t seconds = std::chrono::floor<std::chrono::seconds>(time).time_since_epoch().count();
+    if (!has_base_) {
+        has_base_ = true;
+        base_ = seconds;
+    }
+
+    int32_t offset = static_cast<int32_t>(seconds - base_);
+    if (!times_.empty() && offset < times_.back()) {
+        sorted_ = false;
+    }
+
+    ips_.push_back(ip);
+    users_.push_back(user);
+    times_.push_back(offset);
+    ports_.push_back(port);
+    flags_.push_back((success ? Success : 0) | (standard_port ? StandardPort : 0));
+}
+
+std::chrono::system_clock::time_point AttemptStore::earliest() {
+    sort();
+    return std::chrono::system_clock::time_point(std::chrono::seconds(base_ + times_[head_]));
+}
+
+double AttemptStore::bytesPerAttempt() const {
+    if (size() == 0) {
+        return 0;
+    }
+    size_t bytes = ips_.capacity() * sizeof(uint32_t) + users_.capacity() * sizeof(uint32_t) +
+                   times_.capacity() * sizeof(int32_t) + ports_.capacity() * sizeof(uint16_t) +
+                   flags_.capacity() * sizeof(uint8_t);
+    return static_cast<double>(bytes) / size();
+}
+
+StoredAttempt AttemptStore::at(size_t index) const {
+    StoredAttempt attempt;
+    attempt.ip = ips_[index];
+    attempt.user = users_[index];
+    attempt.time = std::chrono::system_clock::time_point(std::chrono::seconds(base_ + times_[index]));
+    attempt.port = ports_[index];
+    attempt.success = flags_[index] & Success;
+    attempt.standard_port = flags_[index] & StandardPort;
+    return attempt;
+}
+
+void AttemptStore::sort() {
+    if (sorted_) {
+        return;
+    }
+
+    // Устойчивая сортировка перестановкой: попытки с одной меткой сохраняют порядок прихода
+    std::vector<uint32_t> order(times_.size() - head_);
+    std::iota(order.begin(), order.end(), static_cast<uint32_t>(head_));
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return times_[a] < times_[b];
+    });
+
+    auto permute = [&](auto& column) {
+        std::remove_reference_t<decltype(column)> sorted;
+        sorted.reserve(order.size());
+        for (uint32_t index : order) {
+            sorted.push_back(column[index]);
+        }
+        column = std::move(sorted);
+    };
+    permute(ips_);
+    permute(users_);
+    permute(times_);
+    permute(ports_);
+    permute(flags_);
+
+    head_ = 0;
+    sorted_ = true;
+}
+
+void AttemptStore::compact() {
+    // Выданное начало вырезается, когда занимает больше половины столбцов
+    if (head_ < 4096 || head_ * 2 < times_.size()) {
+        if (head_ == times_.size()) {
+            ips_.clear();
+            users_.clear();
+            times_.clear();
+            ports_.clear();
+            flags_.clear();
+            head_ = 0;
+        }
+        return;
+    }
+
+    auto cut = [this](auto& column) {
+        column.erase(column.begin(), column.begin() + head_);
+    };
+    cut(ips_);
+    cut(users_);
+    cut(times_);
+    cut(ports_);
+    cut(flags_);
+    head_ = 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file attemptStore.h
+ * @brief Компактное хранение попыток входа: интернированные адреса и имена, столбцы
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../ipaddress/ipaddress.h"
+
+/**
+ * @brief Счетчики ссылок и свободные номера для таблиц интернирования
+ */
+class InternRefs {
+public:
+    void retain(uint32_t id) { refs_[id]++; }
+    size_t size() const { return refs_.size() - free_.size(); }
+
+protected:
+    uint32_t allocate();
+    bool drop(uint32_t id);  // True если ссылок больше нет и номер освобожден
+
+    std::vector<uint32_t> refs_;
+    std::vector<uint32_t> free_;
+};
+
+/**
+ * @brief Таблица имен пользователей: строка <-> uint32
+ *
+ * Номер живет, пока на него есть ссылки (acquire/retain), потом
+ * освобождается и может быть выдан другому имени.
+ */
+class SymbolTable : public InternRefs {
+public:
+    uint32_t acquire(std::string_view text);
+    void release(uint32_t id);
+    bool find(std::string_view text, uint32_t& id) const;
+    const std::string& name(uint32_t id) const { return names_[id]; }
+    size_t memoryUsage() const;
+
+private:
+    std::deque<std::string> names_;  // deque не перемещает строки, ключи индекса остаются валидны
+    std::unordered_map<std::string_view, uint32_t> index_;
+};
+
+/**
+ * @brief Таблица адресов: двоичный ключ <-> uint32
+ *
+ * Разные записи одного IPv6 адреса получают один номер, имя - каноническая
+ * запись IpAddress. Строки, которые не являются адресом (имя хоста при
+ * UseDNS), интернируются как текст.
+ */
+class AddressTable : public InternRefs {
+public:
+    uint32_t acquire(std::string_view text);
+    uint32_t acquire(const IpAddress& address);
+    void release(uint32_t id);
+    const std::string& name(uint32_t id) const { return names_[id]; }
+
+    /**
+     * @brief Двоичный ключ номера (для isAddress()) без разбора name()
+     */
+    const IpAddress& address(uint32_t id) const { return keys_[id]; }
+    bool isAddress(uint32_t id) const { return !textual_[id]; }
+    size_t memoryUsage() const;
+
+private:
+    uint32_t allocateSlot(const IpAddress& key, bool textual);
+
+    std::deque<std::string> names_;
+    std::vector<IpAddress> keys_;
+    std::vector<bool> textual_;
+    std::unordered_map<IpAddress, uint32_t> index_;
+    std::unordered_map<std::string_view, uint32_t> text_index_;
+};
+
+/**
+ * @brief Попытка входа из AttemptStore
+ */
+struct StoredAttempt {
+    uint32_t ip;                                  /**< Номер в AddressTable */
+    uint32_t user;                                /**< Номер в SymbolTable */
+    std::chrono::system_clock::time_point time;   /**< Время события (с точностью до секунды) */
+    uint16_t port;                                /**< Порт sshd */
+    bool success;                                 /**< Успешный вход */
+    bool standard_port;                           /**< Порт из списка стандартных */
+};
+
+/**
+ * @brief Буфер попыток в виде столбцов (structure of arrays)
+ *
+ * На попытку уходит 15 байт: номера адреса и пользователя, время в секундах
+ * от базы, порт и битовое поле (успех, класс порта). Попытки добавляются в
+ * конец и забираются с начала по порядку времени; если лог пришел не по
+ * порядку, столбцы один раз сортируются перед выдачей.
+ */
+class AttemptStore {
+public:
+    void append(uint32_t ip, uint32_t user, std::chrono::system_clock::time_point time,
+                uint16_t port, bool success, bool standard_port);
+
+    /**
+     * @brief Выдать по порядку времени все попытки не позже time
+     * @param time Граница (включительно)
+     * @param callback Вызывается для каждой попытки
+     */
+    template <typename Callback>
+    void takeUntil(std::chrono::system_clock::time_point time, Callback&& callback) {
+        sort();
+        int64_t limit = std::chrono::floor<std::chrono::seconds>(time).time_since_epoch().count() - base_;
+        while (head_ < times_.size() && times_[head_] <= limit) {
+            callback(at(head_));
+            head_++;
+        }
+        compact();
+    }
+
+    /**
+     * @brief Перебрать невыданные попытки без изъятия (в порядке прихода)
+     */
+    template <typename Callback>
+    void forEach(Callback&& callback) const {
+        for (size_t i = head_; i < times_.size(); ++i) {
+            callback(at(i));
+        }
+    }
+
+    bool empty() const { return head_ == times_.size(); }
+    size_t size() const { return times_.size() - head_; }
+
+    /**
+     * @brief Самая ранняя попытка в буфере (буфер не пуст)
+     */
+    std::chrono::system_clock::time_point earliest();
+
+    /**
+     * @brief Байт на попытку в столбцах (по выделенной памяти)
+     */
+    double bytesPerAttempt() const;
+
+private:
+    StoredAttempt at(size_t index) const;
+    void sort();
+    void compact();
+
+    enum Flags : uint8_t {
+        Success = 1 << 0,
+        StandardPort = 1 << 1
+    };
+
+    std::vector<uint32_t> ips_;
+    std::vector<uint32_t> users_;
+    std::vector<int32_t> times_;   // Секунды от base_
+    std::vector<uint16_t> ports_;
+    std::vector<uint8_t> flags_;
+    int64_t base_ = 0;
+    bool has_base_ = false;
+    bool sorted_ = true;
+    size_t head_ = 0;              // Первая невыданная попытка
+};
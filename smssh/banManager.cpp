@@ -0,0 +1,531 @@
+/**
+ * @file banManager.cpp
+ * @brief Реализация менеджера блокировок и бэкендов
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "banManager.h"
+#include "detectorState.h"
+#include "../logger/logger.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    int severityRank(const std::string& severity) {
+        if (severity == "critical") return 3;
+        if (severity == "high") return 2;
+        if (severity == "medium") return 1;
+        return 0;
+    }
+
+    bool run_script(const std::string& command, const std::string& script) {
+        FILE* pipe = popen(command.c_str(), "w");
+        if (!pipe) {
+            LogWarning("Cannot run " + command);
+            return false;
+        }
+        bool written = fwrite(script.data(), 1, script.size(), pipe) == script.size();
+        int status = pclose(pipe);
+        if (!written || status != 0) {
+            LogWarning(command + " failed (status " + std::to_string(status) + ")");
+            return false;
+        }
+        return true;
+    }
+
+    // Сети одного семейства и одного действия одной строкой: { a, b, c }
+    std::string join_prefixes(const std::vector<BanChange>& changes, BanChange::Action action, bool ipv6) {
+        std::string list;
+        for (const auto& change : changes) {
+            if (change.action == action && change.ipv6 == ipv6) {
+                list += list.empty() ? "" : ", ";
+                list += change.prefix;
+            }
+        }
+        return list;
+    }
+}
+
+bool NftablesBackend::prepare() {
+    // add не трогает существующие таблицу и наборы; пересоздается только цепочка,
+    // чтобы правила не дублировались. Все одной транзакцией
+    std::string script =
+        "add table inet " + table_ + "\n"
+        "add set inet " + table_ + " banned4 { type ipv4_addr; flags interval; }\n"
+        "add set inet " + table_ + " banned6 { type ipv6_addr; flags interval; }\n"
+        "add chain inet " + table_ + " input { type filter hook input priority filter - 10; policy accept; }\n"
+        "flush chain inet " + table_ + " input\n"
+        "add rule inet " + table_ + " input ip saddr @banned4 drop\n"
+        "add rule inet " + table_ + " input ip6 saddr @banned6 drop\n";
+    return run_script("nft -f -", script);
+}
+
+std::string NftablesBackend::script(const std::vector<BanChange>& changes) const {
+    std::string script;
+    for (auto action : {BanChange::Action::Remove, BanChange::Action::Add}) {
+        for (bool ipv6 : {false, true}) {
+            std::string list = join_prefixes(changes, action, ipv6);
+            if (!list.empty()) {
+                script += action == BanChange::Action::Add ? "add" : "delete";
+                script += " element inet " + table_ + (ipv6 ? " banned6 { " : " banned4 { ") + list + " }\n";
+            }
+        }
+    }
+    return script;
+}
+
+bool NftablesBackend::apply(const std::vector<BanChange>& changes) {
+    return run_script("nft -f -", script(changes));
+}
+
+bool IpsetBackend::prepare() {
+    std::string script =
+        "create " + set_ + "4 hash:net family inet\n"
+        "create " + set_ + "6 hash:net family inet6\n";
+    return run_script("ipset -exist restore", script);
+}
+
+std::string IpsetBackend::script(const std::vector<BanChange>& changes) const {
+    std::string script;
+    for (const auto& change : changes) {
+        script += change.action == BanChange::Action::Add ? "add " : "del ";
+        script += set_ + (change.ipv6 ? "6 " : "4 ") + change.prefix + "\n";
+    }
+    return script;
+}
+
+bool IpsetBackend::apply(const std::vector<BanChange>& changes) {
+    return run_script("ipset -exist restore", script(changes));
+}
+
+bool FileBackend::prepare() {
+    std::ofstream file(path_, std::ios::app);
+    return file.is_open();
+}
+
+bool FileBackend::apply(const std::vector<BanChange>& changes) {
+    std::ofstream file(path_, std::ios::app);
+    if (!file.is_open()) {
+        return false;
+    }
+    for (const auto& change : changes) {
+        file << (change.action == BanChange::Action::Add ? "add " : "del ") << change.prefix << "\n";
+    }
+    file << "commit\n";
+    return file.good();
+}
+
+bool DryRunBackend::apply(const std::vector<BanChange>& changes) {
+    std::string summary;
+    for (const auto& change : changes) {
+        summary += summary.empty() ? "" : " ";
+        summary += (change.action == BanChange::Action::Add ? "+" : "-") + change.prefix;
+    }
+    LogInfo("Ban batch (dry-run): " + summary);
+    return true;
+}
+
+std::unique_ptr<BanBackend> makeBanBackend(const std::string& spec) {
+    if (spec == "nftables" || spec == "nft") {
+        return std::make_unique<NftablesBackend>();
+    }
+    if (spec == "ipset") {
+        return std::make_unique<IpsetBackend>();
+    }
+    if (spec == "dry-run") {
+        return std::make_unique<DryRunBackend>();
+    }
+    if (spec.rfind("file:", 0) == 0 && spec.size() > 5) {
+        return std::make_unique<FileBackend>(spec.substr(5));
+    }
+    return nullptr;
+}
+
+BanManager::BanManager(std::unique_ptr<BanBackend> backend, BanPolicy policy)
+    : backend_(std::move(backend)), policy_(std::move(policy)) {
+    nodes_.emplace_back();  // Корень
+    allow("127.0.0.0/8");
+    allow("::1");
+}
+
+uint32_t BanManager::insertNode(const IpAddress& network, uint8_t length) {
+    uint32_t node = 0;
+    for (int i = 0; i < length; ++i) {
+        int b = network.bit(i);
+        if (nodes_[node].child[b] == 0) {
+            uint32_t created;
+            if (!free_nodes_.empty()) {
+                created = free_nodes_.back();
+                free_nodes_.pop_back();
+                nodes_[created] = Node{};
+            } else {
+                created = static_cast<uint32_t>(nodes_.size());
+                nodes_.emplace_back();
+            }
+            nodes_[node].child[b] = created;
+        }
+        node = nodes_[node].child[b];
+    }
+    return node;
+}
+
+uint32_t BanManager::findNode(const IpAddress& network, uint8_t length) const {
+    uint32_t node = 0;
+    for (int i = 0; i < length; ++i) {
+        node = nodes_[node].child[network.bit(i)];
+        if (node == 0) {
+            return 0;
+        }
+    }
+    return node;
+}
+
+void BanManager::removeNode(const IpAddress& network, uint8_t length) {
+    std::vector<uint32_t> path;
+    path.reserve(length + 1);
+    uint32_t node = 0;
+    path.push_back(node);
+    for (int i = 0; i < length; ++i) {
+        node = nodes_[node].child[network.bit(i)];
+        if (node == 0) {
+            return;
+        }
+        path.push_back(node);
+    }
+
+    nodes_[node].ban = 0;
+    // Убрать ставшие пустыми узлы снизу вверх
+    for (int i = length; i > 0; --i) {
+        const Node& current = nodes_[path[i]];
+        if (current.ban != 0 || current.child[0] != 0 || current.child[1] != 0) {
+            break;
+        }
+        nodes_[path[i - 1]].child[network.bit(i - 1)] = 0;
+        free_nodes_.push_back(path[i]);
+    }
+}
+
+uint32_t BanManager::coveringBan(const IpAddress& network, uint8_t length) const {
+    uint32_t node = 0;
+    for (int i = 0;; ++i) {
+        if (nodes_[node].ban != 0) {
+            return nodes_[node].ban;
+        }
+        if (i == length) {
+            return 0;
+        }
+        node = nodes_[node].child[network.bit(i)];
+        if (node == 0) {
+            return 0;
+        }
+    }
+}
+
+void BanManager::collectBans(uint32_t node, std::vector<uint32_t>& bans) const {
+    std::vector<uint32_t> stack = {node};
+    while (!stack.empty()) {
+        const Node& current = nodes_[stack.back()];
+        stack.pop_back();
+        if (current.ban != 0) {
+            bans.push_back(current.ban - 1);
+        }
+        for (uint32_t child : current.child) {
+            if (child != 0) {
+                stack.push_back(child);
+            }
+        }
+    }
+}
+
+bool BanManager::isAllowed(const IpAddress& network, uint8_t length) const {
+    // Сети пересекаются, если совпадают по длине более короткой из них
+    for (const IpPrefix& allowed : allowed_) {
+        uint8_t common = std::min(length, allowed.length);
+        if (network.masked(common) == allowed.network.masked(common)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t BanManager::aggregateLength(const IpAddress& network) const {
+    return static_cast<uint8_t>(network.isV4() ? 96 + policy_.aggregate_prefix_v4 : policy_.aggregate_prefix_v6);
+}
+
+bool BanManager::allow(std::string_view cidr) {
+    IpPrefix prefix;
+    if (!IpPrefix::parse(cidr, prefix)) {
+        return false;
+    }
+    allowed_.push_back(prefix);
+    return true;
+}
+
+bool BanManager::onAlert(const AttackAlert& alert, std::chrono::system_clock::time_point now) {
+    if (alert.ip.empty() || alert.successful_logins > 0 || !policy_.types.count(alert.type) ||
+        severityRank(alert.severity) < severityRank(policy_.min_severity)) {
+        return false;
+    }
+    return ban(alert.ip, policy_.ban_time, alert.type, now);
+}
+
+bool BanManager::ban(std::string_view cidr, std::chrono::seconds duration, const std::string& reason,
+                     std::chrono::system_clock::time_point now) {
+    IpPrefix prefix;
+    // Слишком широкие сети (короче /8 и /16) - скорее опечатка, чем намерение
+    if (!IpPrefix::parse(cidr, prefix) || prefix.length < (prefix.network.isV4() ? 104 : 16) ||
+        isAllowed(prefix.network, prefix.length)) {
+        return false;
+    }
+    const IpAddress& network = prefix.network;
+    uint8_t length = prefix.length;
+
+    auto expires = now + duration;
+    if (uint32_t covering = coveringBan(network, length)) {
+        extendBan(covering - 1, expires);
+        return true;
+    }
+
+    // Более узкие блокировки внутри новой сети поглощаются ею
+    if (uint32_t node = findNode(network, length)) {
+        std::vector<uint32_t> inner;
+        collectBans(node, inner);
+        for (uint32_t index : inner) {
+            expires = std::max(expires, bans_[index].expires);
+            removeBan(index);
+        }
+    }
+
+    addBan(network, length, expires, reason);
+    stats_.banned++;
+    if (length == 128) {
+        maybeAggregate(network);
+    }
+    return true;
+}
+
+bool BanManager::unban(std::string_view cidr) {
+    IpPrefix prefix;
+    if (!IpPrefix::parse(cidr, prefix)) {
+        return false;
+    }
+    uint32_t node = findNode(prefix.network, prefix.length);
+    if (node == 0 || nodes_[node].ban == 0) {
+        return false;
+    }
+    removeBan(nodes_[node].ban - 1);
+    return true;
+}
+
+bool BanManager::isBanned(std::string_view ip) const {
+    IpAddress address;
+    return IpAddress::parse(ip, address) && coveringBan(address, 128) != 0;
+}
+
+uint32_t BanManager::addBan(const IpAddress& network, uint8_t length,
+                            std::chrono::system_clock::time_point expires, const std::string& reason) {
+    uint32_t index;
+    if (!free_bans_.empty()) {
+        index = free_bans_.back();
+        free_bans_.pop_back();
+    } else {
+        index = static_cast<uint32_t>(bans_.size());
+        bans_.emplace_back();
+    }
+
+    Ban& ban = bans_[index];
+    ban.network = network;
+    ban.length = length;
+    ban.active = true;
+    ban.expires = expires;
+    ban.reason = reason;
+    nodes_[insertNode(network, length)].ban = index + 1;
+    expiry_.emplace(expires, index);
+    stats_.active++;
+
+    if (length == 128) {
+        hosts_per_network_[network.masked(aggregateLength(network))]++;
+    }
+
+    Key key{network, length};
+    if (installed_.count(key)) {
+        pending_.erase(key);
+    } else {
+        pending_[key] = true;
+    }
+    return index;
+}
+
+void BanManager::removeBan(uint32_t index) {
+    Ban& ban = bans_[index];
+    removeNode(ban.network, ban.length);
+    ban.active = false;
+    free_bans_.push_back(index);
+    stats_.active--;
+
+    if (ban.length == 128) {
+        auto it = hosts_per_network_.find(ban.network.masked(aggregateLength(ban.network)));
+        if (it != hosts_per_network_.end() && --it->second == 0) {
+            hosts_per_network_.erase(it);
+        }
+    }
+
+    Key key{ban.network, ban.length};
+    if (installed_.count(key)) {
+        pending_[key] = false;
+    } else {
+        pending_.erase(key);
+    }
+}
+
+void BanManager::extendBan(uint32_t index, std::chrono::system_clock::time_point expires) {
+    Ban& ban = bans_[index];
+    if (expires > ban.expires) {
+        ban.expires = expires;
+        expiry_.emplace(expires, index);
+    }
+}
+
+void BanManager::maybeAggregate(const IpAddress& address) {
+    if (policy_.aggregate_threshold <= 0) {
+        return;
+    }
+    uint8_t length = aggregateLength(address);
+    IpAddress network = address.masked(length);
+    auto it = hosts_per_network_.find(network);
+    if (it == hosts_per_network_.end() || it->second < static_cast<uint32_t>(policy_.aggregate_threshold) ||
+        isAllowed(network, length)) {
+        return;
+    }
+
+    std::vector<uint32_t> inner;
+    collectBans(findNode(network, length), inner);
+    // Сеть блокируется до истечения самой поздней из поглощенных блокировок
+    std::chrono::system_clock::time_point expires;
+    for (uint32_t index : inner) {
+        expires = std::max(expires, bans_[index].expires);
+        removeBan(index);
+    }
+    addBan(network, length, expires, "aggregate: " + std::to_string(inner.size()) + " addresses");
+    stats_.aggregated++;
+}
+
+size_t BanManager::expire(std::chrono::system_clock::time_point now) {
+    size_t removed = 0;
+    while (!expiry_.empty() && expiry_.top().first <= now) {
+        uint32_t index = expiry_.top().second;
+        expiry_.pop();
+        // Устаревшая запись кучи: блокировку продлили или уже сняли
+        if (bans_[index].active && bans_[index].expires <= now) {
+            removeBan(index);
+            removed++;
+        }
+    }
+    stats_.expired += removed;
+    return removed;
+}
+
+bool BanManager::flush() {
+    if (!prepared_) {
+        if (!backend_->prepare()) {
+            stats_.failures++;
+            return false;
+        }
+        prepared_ = true;
+    }
+    if (pending_.empty()) {
+        return true;
+    }
+
+    std::vector<BanChange> changes;
+    changes.reserve(pending_.size());
+    for (bool add : {false, true}) {
+        for (const auto& [key, present] : pending_) {
+            if (present == add) {
+                BanChange change;
+                change.action = add ? BanChange::Action::Add : BanChange::Action::Remove;
+                change.prefix = key.toString();
+                change.ipv6 = !key.network.isV4();
+                changes.push_back(std::move(change));
+            }
+        }
+    }
+
+    if (!backend_->apply(changes)) {
+        stats_.failures++;
+        return false;
+    }
+
+    for (const auto& [key, present] : pending_) {
+        if (present) {
+            installed_.insert(key);
+        } else {
+            installed_.erase(key);
+        }
+    }
+    pending_.clear();
+    stats_.batches++;
+    stats_.changes += changes.size();
+    return true;
+}
+
+void BanManager::saveState(std::string& out) const {
+    StateWriter writer(out);
+    writer.put<uint64_t>(stats_.active);
+    for (const auto& ban : bans_) {
+        if (ban.active) {
+            writer.put(ban.network);
+            writer.put(ban.length);
+            writer.putTime(ban.expires);
+            writer.putString(ban.reason);
+        }
+    }
+}
+
+bool BanManager::loadState(std::string_view state, std::chrono::system_clock::time_point now) {
+    StateReader reader(state);
+    uint64_t count = 0;
+    reader.getCount(count, sizeof(IpAddress) + 1 + sizeof(int64_t) + sizeof(uint32_t));
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        IpAddress network;
+        uint8_t length = 0;
+        std::chrono::system_clock::time_point expires;
+        std::string reason;
+        reader.get(network);
+        reader.get(length);
+        reader.getTime(expires);
+        reader.getString(reason);
+        if (!reader.ok() || length > 128) {
+            return false;
+        }
+
+        network = network.masked(length);
+        Key key{network, length};
+        if (expires > now) {
+            if (coveringBan(network, length) == 0) {
+                addBan(network, length, expires, reason);
+            }
+        } else {
+            // Истекла, пока мониторинг не работал: в бэкенде она еще есть
+            installed_.insert(key);
+            pending_[key] = false;
+        }
+    }
+    return reader.ok() && reader.atEnd();
+}
+
+std::vector<BanEntry> BanManager::list() const {
+    std::vector<BanEntry> entries;
+    for (const auto& ban : bans_) {
+        if (ban.active) {
+            entries.push_back(BanEntry{IpPrefix{ban.network, ban.length}.toString(), ban.expires, ban.reason});
+        }
+    }
+    return entries;
+}
+
+BanStats BanManager::getStats() const {
+    return stats_;
+}
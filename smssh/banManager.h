@@ -0,0 +1,296 @@
+/**
+ * @file banManager.h
+ * @brief Активная блокировка атакующих адресов: набор CIDR со сроками и пакетное применение
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include "sshAttackDetector.h"
+#include "../ipaddress/ipaddress.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <queue>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Изменение набора блокировок для бэкенда
+ */
+struct BanChange {
+    enum class Action { Add, Remove };
+
+    Action action;
+    std::string prefix;  /**< Сеть в виде CIDR: 203.0.113.7/32, 2001:db8::/64 */
+    bool ipv6 = false;
+};
+
+/**
+ * @brief Куда применяются блокировки
+ *
+ * apply() получает все изменения одного flush() и должен применить их одной
+ * операцией (транзакция nft, один ipset restore), а не запуском процесса на
+ * каждый адрес.
+ */
+class BanBackend {
+public:
+    virtual ~BanBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief Создать таблицу или наборы, если их нет (вызывается один раз при запуске)
+     *
+     * Содержимое наборов не сбрасывается: блокировки прошлого запуска
+     * восстанавливаются из снимка и ставятся заново (BanManager::loadState).
+     */
+    virtual bool prepare() { return true; }
+
+    /**
+     * @brief Применить пачку изменений: сначала снятия, потом добавления
+     * @return False если пачка не применена (BanManager повторит ее)
+     */
+    virtual bool apply(const std::vector<BanChange>& changes) = 0;
+};
+
+/**
+ * @brief nftables: таблица inet smssh с интервальными наборами banned4/banned6
+ */
+class NftablesBackend : public BanBackend {
+public:
+    explicit NftablesBackend(std::string table = "smssh") : table_(std::move(table)) {}
+
+    const char* name() const override { return "nftables"; }
+    bool prepare() override;
+    bool apply(const std::vector<BanChange>& changes) override;
+
+    /**
+     * @brief Скрипт для nft -f с одной транзакцией
+     */
+    std::string script(const std::vector<BanChange>& changes) const;
+
+private:
+    std::string table_;
+};
+
+/**
+ * @brief ipset: наборы hash:net <name>4 и <name>6, правило iptables добавляет администратор
+ */
+class IpsetBackend : public BanBackend {
+public:
+    explicit IpsetBackend(std::string set = "smssh") : set_(std::move(set)) {}
+
+    const char* name() const override { return "ipset"; }
+    bool prepare() override;
+    bool apply(const std::vector<BanChange>& changes) override;
+
+    /**
+     * @brief Входные данные для ipset restore
+     */
+    std::string script(const std::vector<BanChange>& changes) const;
+
+private:
+    std::string set_;
+};
+
+/**
+ * @brief Запись изменений в файл: строки "add CIDR" / "del CIDR", после пачки "commit"
+ */
+class FileBackend : public BanBackend {
+public:
+    explicit FileBackend(std::string path) : path_(std::move(path)) {}
+
+    const char* name() const override { return "file"; }
+    bool prepare() override;
+    bool apply(const std::vector<BanChange>& changes) override;
+
+private:
+    std::string path_;
+};
+
+/**
+ * @brief Только журнал: что было бы заблокировано
+ */
+class DryRunBackend : public BanBackend {
+public:
+    const char* name() const override { return "dry-run"; }
+    bool apply(const std::vector<BanChange>& changes) override;
+};
+
+/**
+ * @brief Создать бэкенд по имени из конфигурации
+ * @param spec nftables, ipset, dry-run или file:<путь>
+ * @return nullptr для неизвестного имени
+ */
+std::unique_ptr<BanBackend> makeBanBackend(const std::string& spec);
+
+/**
+ * @brief Правила блокировки
+ */
+struct BanPolicy {
+    std::chrono::seconds ban_time{3600};   /**< Срок блокировки */
+    std::string min_severity = "high";     /**< Блокировать начиная с этой серьезности */
+    /** Типы оповещений, по которым блокировать: только вызванные неудачными входами
+     *  (geo_ip_anomaly, root_attack и другие срабатывают и на успешные входы) */
+    std::set<std::string> types = {"brute_force", "dictionary_attack", "nonexistent_user", "password_spray"};
+    int aggregate_threshold = 8;           /**< Адресов в одной сети для блокировки сети (0 - никогда) */
+    int aggregate_prefix_v4 = 24;          /**< Сеть для агрегации IPv4 */
+    int aggregate_prefix_v6 = 64;          /**< Сеть для агрегации IPv6 */
+};
+
+/**
+ * @brief Активная блокировка
+ */
+struct BanEntry {
+    std::string prefix;  /**< CIDR */
+    std::chrono::system_clock::time_point expires;
+    std::string reason;
+};
+
+/**
+ * @brief Счетчики менеджера блокировок
+ */
+struct BanStats {
+    uint64_t active = 0;      /**< Действующих блокировок */
+    uint64_t banned = 0;      /**< Поставлено блокировок */
+    uint64_t aggregated = 0;  /**< Блокировок сетей вместо отдельных адресов */
+    uint64_t expired = 0;     /**< Снято по сроку */
+    uint64_t batches = 0;     /**< Применено пачек */
+    uint64_t changes = 0;     /**< Изменений в примененных пачках */
+    uint64_t failures = 0;    /**< Пачек, которые бэкенд не принял */
+};
+
+/**
+ * @brief Набор блокировок по оповещениям детектора
+ *
+ * Блокировки хранятся в двоичном префиксном дереве по 128-битному адресу
+ * (IPv4 как ::ffff:a.b.c.d), так что проверка адреса - один проход от корня,
+ * а адрес внутри уже заблокированной сети новой записи не создает (срок сети
+ * продлевается). Когда в одной /24 (/64 для IPv6) набирается
+ * aggregate_threshold заблокированных адресов, они заменяются блокировкой
+ * всей сети. Сроки хранятся в куче; expire() снимает истекшие.
+ *
+ * Изменения копятся до flush() и уходят в бэкенд одной пачкой; добавление и
+ * снятие одной сети между двумя flush() взаимно сокращаются. Если бэкенд
+ * пачку не принял, она остается и уходит при следующем flush().
+ */
+class BanManager {
+public:
+    explicit BanManager(std::unique_ptr<BanBackend> backend, BanPolicy policy = {});
+
+    /**
+     * @brief Никогда не блокировать адреса из сети (по умолчанию 127.0.0.0/8 и ::1)
+     * @return False если CIDR не разобран
+     */
+    bool allow(std::string_view cidr);
+
+    /**
+     * @brief Заблокировать источник оповещения, если тип в BanPolicy::types и серьезность достаточна
+     *
+     * Адрес с успешными входами в окне не блокируется: это скорее
+     * пользователь, ошибавшийся в пароле, чем атакующий.
+     * @return True если блокировка поставлена или продлена
+     */
+    bool onAlert(const AttackAlert& alert, std::chrono::system_clock::time_point now);
+
+    /**
+     * @brief Заблокировать адрес или сеть
+     * @return True если блокировка поставлена или продлена
+     */
+    bool ban(std::string_view cidr, std::chrono::seconds duration, const std::string& reason,
+             std::chrono::system_clock::time_point now);
+
+    /**
+     * @brief Снять блокировку именно этой сети
+     */
+    bool unban(std::string_view cidr);
+
+    /**
+     * @brief Заблокирован ли адрес (сам или любой сетью)
+     */
+    bool isBanned(std::string_view ip) const;
+
+    /**
+     * @brief Снять истекшие блокировки
+     * @return Сколько снято
+     */
+    size_t expire(std::chrono::system_clock::time_point now);
+
+    /**
+     * @brief Отправить накопленные изменения в бэкенд одной пачкой
+     * @return False если бэкенд пачку не принял
+     */
+    bool flush();
+
+    /**
+     * @brief Записать действующие блокировки (сеть, срок, причина) для снимка мониторинга
+     */
+    void saveState(std::string& out) const;
+
+    /**
+     * @brief Восстановить блокировки из снимка (до первого flush())
+     *
+     * Действующие блокировки ставятся в бэкенд заново при следующем flush(),
+     * истекшие за время простоя - снимаются.
+     * @return False если данные повреждены
+     */
+    bool loadState(std::string_view state, std::chrono::system_clock::time_point now);
+
+    std::vector<BanEntry> list() const;
+    BanStats getStats() const;
+    const BanBackend& backend() const { return *backend_; }
+
+private:
+    using Key = IpPrefix;
+
+    struct Node {
+        uint32_t child[2] = {0, 0};
+        uint32_t ban = 0;  ///< Номер блокировки + 1, 0 - нет
+    };
+
+    struct Ban {
+        IpAddress network;
+        uint8_t length = 0;
+        bool active = false;
+        std::chrono::system_clock::time_point expires;
+        std::string reason;
+    };
+
+    using Expiry = std::pair<std::chrono::system_clock::time_point, uint32_t>;
+
+    uint32_t insertNode(const IpAddress& network, uint8_t length);
+    uint32_t findNode(const IpAddress& network, uint8_t length) const;
+    void removeNode(const IpAddress& network, uint8_t length);
+    uint32_t coveringBan(const IpAddress& network, uint8_t length) const;
+    void collectBans(uint32_t node, std::vector<uint32_t>& bans) const;
+    bool isAllowed(const IpAddress& network, uint8_t length) const;
+    uint8_t aggregateLength(const IpAddress& network) const;
+
+    uint32_t addBan(const IpAddress& network, uint8_t length,
+                    std::chrono::system_clock::time_point expires, const std::string& reason);
+    void removeBan(uint32_t index);
+    void extendBan(uint32_t index, std::chrono::system_clock::time_point expires);
+    void maybeAggregate(const IpAddress& address);
+
+    std::unique_ptr<BanBackend> backend_;
+    BanPolicy policy_;
+    bool prepared_ = false;
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> free_nodes_;
+    std::vector<Ban> bans_;
+    std::vector<uint32_t> free_bans_;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiry_;
+    // Заблокированных отдельных адресов в каждой сети агрегации
+    std::unordered_map<IpAddress, uint32_t> hosts_per_network_;
+    std::vector<Key> allowed_;
+
+    std::map<Key, bool> pending_;  ///< Сеть -> должна ли она быть в бэкенде
+    std::set<Key> installed_;      ///< Что уже применено в бэкенде
+    BanStats stats_;
+};
@@ -0,0 +1,277 @@
+/**
+ * @file cardinalitySketch.cpp
+ * @brief Реализация HyperLogLog и затухающих счетчиков
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "cardinalitySketch.h"
+#include "detectorState.h"
+#include "../ipaddress/ipaddress.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <functional>
+
+// Финализатор splitmix64
+static uint64_t mix64(uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+uint64_t sketchHash(std::string_view text) {
+    return mix64(std::hash<std::string_view>{}(text));
+}
+
+uint64_t sketchHash(const IpAddress& address) {
+    return mix64(address.high() * 0x9e3779b97f4a7c15ULL ^ mix64(address.low()));
+}
+
+void HyperLogLog::add(uint64_t hash) {
+    if (!registers_.empty()) {
+        addDense(hash);
+        return;
+    }
+    if (std::find(sparse_.begin(), sparse_.end(), hash) != sparse_.end()) {
+        return;
+    }
+    if (sparse_.size() < kSparseLimit) {
+        sparse_.push_back(hash);
+        return;
+    }
+    densify();
+    addDense(hash);
+}
+
+void HyperLogLog::addDense(uint64_t hash) {
+    addRegister(registers_.data(), hash);
+}
+
+void HyperLogLog::addRegister(uint8_t* registers, uint64_t hash) {
+    // Старшие биты - номер регистра, в регистре - ранг первой единицы остальных
+    size_t index = hash >> (64 - kPrecision);
+    uint64_t rest = hash << kPrecision;
+    uint8_t rank = rest == 0 ? 64 - kPrecision + 1 : static_cast<uint8_t>(std::countl_zero(rest) + 1);
+    registers[index] = std::max(registers[index], rank);
+}
+
+void HyperLogLog::densify() {
+    registers_.assign(kRegisters, 0);
+    for (uint64_t hash : sparse_) {
+        addDense(hash);
+    }
+    std::vector<uint64_t>().swap(sparse_);
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    if (other.registers_.empty()) {
+        for (uint64_t hash : other.sparse_) {
+            add(hash);
+        }
+        return;
+    }
+    if (registers_.empty()) {
+        densify();
+    }
+    for (size_t i = 0; i < kRegisters; ++i) {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+
+double HyperLogLog::estimate() const {
+    if (registers_.empty()) {
+        return static_cast<double>(sparse_.size());
+    }
+    return estimateRegisters(registers_.data());
+}
+
+double HyperLogLog::unionEstimate(const std::vector<const HyperLogLog*>& sketches) {
+    bool dense = std::any_of(sketches.begin(), sketches.end(), [](const HyperLogLog* sketch) {
+        return !sketch->registers_.empty();
+    });
+
+    if (!dense) {
+        // Буфер потока: оценка идет по тысячам ключей подряд
+        thread_local std::vector<uint64_t> hashes;
+        hashes.clear();
+        for (const HyperLogLog* sketch : sketches) {
+            hashes.insert(hashes.end(), sketch->sparse_.begin(), sketch->sparse_.end());
+        }
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        if (hashes.size() <= kSparseLimit) {
+            return static_cast<double>(hashes.size());
+        }
+    }
+
+    // Регистры, как у одного скетча со всеми хэшами: оценка не зависит от
+    // того, как элементы разложены по скетчам
+    std::array<uint8_t, kRegisters> registers{};
+    for (const HyperLogLog* sketch : sketches) {
+        if (sketch->registers_.empty()) {
+            for (uint64_t hash : sketch->sparse_) {
+                addRegister(registers.data(), hash);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < kRegisters; ++i) {
+            registers[i] = std::max(registers[i], sketch->registers_[i]);
+        }
+    }
+    return estimateRegisters(registers.data());
+}
+
+double HyperLogLog::estimateRegisters(const uint8_t* registers) {
+    // 2^-ранг таблицей: ldexp на каждый регистр заметен при оценке тысяч ключей
+    static const auto powers = []() {
+        std::array<double, 64 - kPrecision + 2> table{};
+        for (size_t rank = 0; rank < table.size(); ++rank) {
+            table[rank] = std::ldexp(1.0, -static_cast<int>(rank));
+        }
+        return table;
+    }();
+
+    double sum = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < kRegisters; ++i) {
+        sum += powers[registers[i]];
+        zeros += registers[i] == 0;
+    }
+    const double m = static_cast<double>(kRegisters);
+    double raw = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+    // Малые множества: по числу пустых регистров (linear counting) точнее
+    if (raw <= 2.5 * m && zeros > 0) {
+        return m * std::log(m / zeros);
+    }
+    return raw;
+}
+
+void HyperLogLog::save(StateWriter& writer) const {
+    writer.put<uint8_t>(!registers_.empty());
+    if (!registers_.empty()) {
+        std::array<uint8_t, kRegisters> registers;
+        std::copy(registers_.begin(), registers_.end(), registers.begin());
+        writer.put(registers);
+        return;
+    }
+    writer.put<uint64_t>(sparse_.size());
+    for (uint64_t hash : sparse_) {
+        writer.put(hash);
+    }
+}
+
+bool HyperLogLog::load(StateReader& reader) {
+    sparse_.clear();
+    registers_.clear();
+
+    uint8_t dense = 0;
+    reader.get(dense);
+    if (dense) {
+        std::array<uint8_t, kRegisters> registers;
+        if (reader.get(registers)) {
+            registers_.assign(registers.begin(), registers.end());
+        }
+        return reader.ok();
+    }
+
+    uint64_t count = 0;
+    reader.getCount(count, sizeof(uint64_t));
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        uint64_t hash = 0;
+        if (reader.get(hash)) {
+            add(hash);
+        }
+    }
+    return reader.ok();
+}
+
+void WindowedSketch::add(int64_t bucket, uint64_t hash) {
+    if (buckets_.empty() || buckets_.back().index < bucket) {
+        buckets_.push_back(Bucket{bucket, 0, HyperLogLog()});
+    }
+    buckets_.back().count++;
+    buckets_.back().sketch.add(hash);
+}
+
+void WindowedSketch::expire(int64_t cutoff) {
+    auto live = std::find_if(buckets_.begin(), buckets_.end(), [&](const Bucket& bucket) { return bucket.index > cutoff; });
+    buckets_.erase(buckets_.begin(), live);
+}
+
+HyperLogLog WindowedSketch::merged() const {
+    HyperLogLog sketch;
+    for (const auto& bucket : buckets_) {
+        sketch.merge(bucket.sketch);
+    }
+    return sketch;
+}
+
+double WindowedSketch::estimate() const {
+    if (buckets_.size() == 1) {
+        return buckets_.front().sketch.estimate();
+    }
+    std::vector<const HyperLogLog*> sketches;
+    for (const auto& bucket : buckets_) {
+        sketches.push_back(&bucket.sketch);
+    }
+    return HyperLogLog::unionEstimate(sketches);
+}
+
+uint64_t WindowedSketch::count() const {
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.count;
+    }
+    return total;
+}
+
+size_t WindowedSketch::memoryUsage() const {
+    size_t total = buckets_.capacity() * sizeof(Bucket);
+    for (const auto& bucket : buckets_) {
+        total += bucket.sketch.memoryUsage();
+    }
+    return total;
+}
+
+void WindowedSketch::save(StateWriter& writer) const {
+    writer.put<uint64_t>(buckets_.size());
+    for (const auto& bucket : buckets_) {
+        writer.put(bucket.index);
+        writer.put(bucket.count);
+        bucket.sketch.save(writer);
+    }
+}
+
+bool WindowedSketch::load(StateReader& reader) {
+    buckets_.clear();
+    uint64_t count = 0;
+    reader.getCount(count, sizeof(int64_t) + sizeof(uint64_t) + 1);
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        Bucket bucket;
+        reader.get(bucket.index);
+        reader.get(bucket.count);
+        if (bucket.sketch.load(reader)) {
+            buckets_.push_back(std::move(bucket));
+        }
+    }
+    return reader.ok();
+}
+
+void DecayedCounter::add(double amount, int64_t second, double half_life) {
+    value_ = valueAt(second, half_life) + amount;
+    second_ = std::max(second_, second);
+}
+
+double DecayedCounter::valueAt(int64_t second, double half_life) const {
+    if (second <= second_) {
+        return value_;
+    }
+    return value_ * std::exp2(-static_cast<double>(second - second_) / half_life);
+}
+
+double DecayedCounter::rateAt(int64_t second, double half_life) const {
+    return valueAt(second, half_life) * std::log(2.0) / half_life;
+}
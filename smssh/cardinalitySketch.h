@@ -0,0 +1,146 @@
+/**
+ * @file cardinalitySketch.h
+ * @brief Оценки с ограниченной памятью: число различных элементов и затухающие счетчики
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class IpAddress;
+class StateWriter;
+class StateReader;
+
+/**
+ * @brief 64-битный хэш строки для HyperLogLog
+ *
+ * std::hash строк в libstdc++ хорош, но его младшие и старшие биты не
+ * обязаны быть независимыми, а HyperLogLog берет номер регистра из старших
+ * бит и ранг из остальных, поэтому результат дополнительно перемешивается.
+ */
+uint64_t sketchHash(std::string_view text);
+
+/**
+ * @brief Хэш двоичного адреса: без перевода в текст
+ */
+uint64_t sketchHash(const IpAddress& address);
+
+/**
+ * @brief Оценка числа различных элементов (HyperLogLog)
+ *
+ * 256 однобайтовых регистров: стандартная ошибка 1.04 / sqrt(256) ~ 6.5%
+ * для множества любого размера. Пока различных хэшей не больше
+ * kSparseLimit, хранятся сами хэши и оценка точная: большинство ключей
+ * (имя, сеть) так и не набирает больше нескольких адресов. Объединение -
+ * поэлементный максимум регистров, поэтому скетчи шардов и корзин времени
+ * объединяются без потери точности.
+ */
+class HyperLogLog {
+public:
+    static constexpr int kPrecision = 8;
+    static constexpr size_t kRegisters = size_t(1) << kPrecision;
+    static constexpr size_t kSparseLimit = 32;  // 32 хэша - те же 256 байт, что и регистры
+
+    void add(uint64_t hash);
+    void merge(const HyperLogLog& other);
+    double estimate() const;
+
+    /**
+     * @brief Оценка объединения без копии скетча
+     *
+     * Результат тот же, что у estimate() одного скетча со всеми элементами:
+     * точно, пока различных хэшей не больше kSparseLimit, дальше - по
+     * регистрам. Поэтому оценка не зависит от раскладки по шардам и корзинам.
+     */
+    static double unionEstimate(const std::vector<const HyperLogLog*>& sketches);
+
+    bool empty() const { return sparse_.empty() && registers_.empty(); }
+    size_t memoryUsage() const { return sparse_.capacity() * sizeof(uint64_t) + registers_.capacity(); }
+
+    void save(StateWriter& writer) const;
+    bool load(StateReader& reader);
+
+private:
+    void densify();
+    void addDense(uint64_t hash);
+    static void addRegister(uint8_t* registers, uint64_t hash);
+    static double estimateRegisters(const uint8_t* registers);
+
+    std::vector<uint64_t> sparse_;    // Различные хэши, пока регистров нет
+    std::vector<uint8_t> registers_;  // kRegisters регистров после перехода
+};
+
+/**
+ * @brief HyperLogLog за скользящее окно: скетч и число добавлений на корзину времени
+ *
+ * Из HyperLogLog нельзя вычесть элемент, поэтому окно - это несколько
+ * корзин (например, по 4 часа), и устаревает корзина целиком. Добавление
+ * идет в порядке времени, как в SlidingWindow.
+ */
+class WindowedSketch {
+public:
+    /**
+     * @param bucket Номер корзины; не меньше последней (более ранний попадает в последнюю)
+     */
+    void add(int64_t bucket, uint64_t hash);
+
+    /**
+     * @brief Убрать корзины с номером не больше cutoff
+     */
+    void expire(int64_t cutoff);
+
+    /**
+     * @brief Объединение корзин окна
+     */
+    HyperLogLog merged() const;
+    double estimate() const;
+
+    /**
+     * @brief Добавлений за окно (с повторами)
+     */
+    uint64_t count() const;
+
+    bool empty() const { return buckets_.empty(); }
+    size_t memoryUsage() const;
+
+    void save(StateWriter& writer) const;
+    bool load(StateReader& reader);
+
+private:
+    struct Bucket {
+        int64_t index = 0;
+        uint64_t count = 0;
+        HyperLogLog sketch;
+    };
+
+    std::vector<Bucket> buckets_;  // Корзин несколько штук, вектор дешевле deque
+};
+
+/**
+ * @brief Счетчик с экспоненциальным затуханием
+ *
+ * Значение уменьшается вдвое за каждый период полураспада, поэтому одно
+ * число заменяет окно любой длины: valueAt() * ln 2 / период - средний темп
+ * за последние несколько периодов. Счетчики с одним периодом складываются.
+ * Период не хранится: его передает владелец, у которого он общий для всех
+ * счетчиков.
+ */
+class DecayedCounter {
+public:
+    void add(double amount, int64_t second, double half_life);
+    double valueAt(int64_t second, double half_life) const;
+
+    /**
+     * @brief Темп в единицах за секунду
+     */
+    double rateAt(int64_t second, double half_life) const;
+
+private:
+    double value_ = 0;
+    int64_t second_ = 0;  // Время, к которому приведено value_
+};
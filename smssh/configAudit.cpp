@@ -0,0 +1,267 @@
+/**
+ * @file configAudit.cpp
+ * @brief Реализация параллельной проверки sshd_config парка хостов
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "configAudit.h"
+#include "parallelFor.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <strings.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+    uint64_t content_hash(std::string_view data) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : data) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    bool read_file(const std::string& path, std::string& content, std::string& error) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        char buffer[16 * 1024];
+        while (true) {
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                error = std::strerror(errno);
+                close(fd);
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            content.append(buffer, n);
+        }
+        close(fd);
+        return true;
+    }
+
+    // Есть ли директива Include (результат зависит не только от текста файла)
+    bool has_include(std::string_view content) {
+        size_t start = 0;
+        while (start < content.size()) {
+            size_t end = std::min(content.find('\n', start), content.size());
+            std::string_view line = content.substr(start, end - start);
+            start = end + 1;
+            size_t first = line.find_first_not_of(" \t");
+            if (first != std::string_view::npos && line.size() - first > 7 &&
+                strncasecmp(line.data() + first, "include", 7) == 0 &&
+                (line[first + 7] == ' ' || line[first + 7] == '\t' || line[first + 7] == '=')) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string json_escape(const std::string& s) {
+        std::string out;
+        out.reserve(s.size() + 8);
+        for (unsigned char c : s) {
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += static_cast<char>(c);
+                }
+            }
+        }
+        return out;
+    }
+}
+
+ConfigAudit::ConfigAudit(unsigned threads)
+    : threads_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())) {
+}
+
+int ConfigAudit::severityWeight(const std::string& severity) {
+    if (severity == "critical") return 10;
+    if (severity == "high") return 5;
+    if (severity == "medium") return 2;
+    if (severity == "low") return 1;
+    return 0;
+}
+
+bool ConfigAudit::auditDirectory(const std::string& directory, ConfigAuditReport& report) {
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec)) {
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string>> hosts;
+    fs::recursive_directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        bool drop_in = name.size() > 2 && name.compare(name.size() - 2, 2, ".d") == 0 && it->is_directory(ec);
+        if ((!name.empty() && name[0] == '.') || drop_in) {
+            // Скрытые каталоги и каталоги Include (sshd_config.d) - не хосты
+            if (it->is_directory(ec)) {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (!it->is_regular_file(ec)) {
+            continue;
+        }
+        fs::path relative = it->path().lexically_relative(directory);
+        std::string host = name == "sshd_config" && relative.has_parent_path()
+                               ? relative.parent_path().string()
+                               : relative.string();
+        hosts.emplace_back(std::move(host), it->path().string());
+    }
+
+    report = auditFiles(hosts);
+    return true;
+}
+
+ConfigAuditReport ConfigAudit::auditFiles(const std::vector<std::pair<std::string, std::string>>& hosts) {
+    auto start = std::chrono::steady_clock::now();
+    ConfigAuditReport report;
+
+    std::vector<std::pair<std::string, std::string>> sorted = hosts;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Чтение и хеширование - параллельно, это основная часть ввода-вывода
+    std::vector<std::string> contents(sorted.size());
+    report.hosts.resize(sorted.size());
+    parallelFor(threads_, sorted.size(), [&](size_t i) {
+        HostAudit& host = report.hosts[i];
+        host.host = sorted[i].first;
+        host.path = sorted[i].second;
+        if (read_file(host.path, contents[i], host.error)) {
+            host.config_hash = content_hash(contents[i]);
+        }
+    });
+
+    // Одинаковые файлы получают один номер конфигурации; при совпадении хеша
+    // содержимое сравнивается, так что коллизия не склеит разные конфигурации
+    std::unordered_map<uint64_t, std::vector<size_t>> by_hash;
+    std::vector<size_t> representative;
+    for (size_t i = 0; i < report.hosts.size(); ++i) {
+        HostAudit& host = report.hosts[i];
+        if (!host.error.empty()) {
+            report.failed++;
+            continue;
+        }
+        if (has_include(contents[i])) {
+            // Включенные файлы свои у каждого хоста
+            host.config = representative.size();
+            representative.push_back(i);
+            continue;
+        }
+        auto& candidates = by_hash[host.config_hash];
+        auto same = std::find_if(candidates.begin(), candidates.end(),
+                                 [&](size_t config) { return contents[representative[config]] == contents[i]; });
+        if (same != candidates.end()) {
+            host.config = *same;
+            std::string().swap(contents[i]);
+            continue;
+        }
+        host.config = representative.size();
+        candidates.push_back(host.config);
+        representative.push_back(i);
+    }
+
+    // Разбор и анализ - один раз на уникальную конфигурацию
+    report.issues_by_config.resize(representative.size());
+    std::vector<int> config_score(representative.size());
+    parallelFor(threads_, representative.size(), [&](size_t config) {
+        size_t index = representative[config];
+        SSHConfig parsed(report.hosts[index].path, contents[index]);
+        report.issues_by_config[config] = parsed.analyzeSecurity();
+        for (const auto& issue : report.issues_by_config[config]) {
+            config_score[config] += severityWeight(issue.severity);
+        }
+    });
+
+    std::vector<size_t> config_hosts(representative.size());
+    for (HostAudit& host : report.hosts) {
+        if (host.error.empty()) {
+            host.score = config_score[host.config];
+            config_hosts[host.config]++;
+        }
+    }
+
+    std::map<std::string, AuditIssueCount> counts;
+    for (size_t config = 0; config < report.issues_by_config.size(); ++config) {
+        for (const auto& issue : report.issues_by_config[config]) {
+            AuditIssueCount& count = counts[issue.key];
+            count.key = issue.key;
+            count.severity = issue.severity;
+            count.description = issue.description;
+            count.hosts += config_hosts[config];
+        }
+    }
+    for (auto& [key, count] : counts) {
+        report.issues.push_back(std::move(count));
+    }
+    std::stable_sort(report.issues.begin(), report.issues.end(), [](const auto& a, const auto& b) {
+        if (a.hosts != b.hosts) {
+            return a.hosts > b.hosts;
+        }
+        return severityWeight(a.severity) > severityWeight(b.severity);
+    });
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+std::vector<const HostAudit*> ConfigAuditReport::worstHosts(size_t count) const {
+    std::vector<const HostAudit*> worst;
+    for (const HostAudit& host : hosts) {
+        if (host.error.empty() && host.score > 0) {
+            worst.push_back(&host);
+        }
+    }
+    // hosts уже упорядочены по имени, stable_sort сохраняет этот порядок при равном score
+    std::stable_sort(worst.begin(), worst.end(), [](const HostAudit* a, const HostAudit* b) { return a->score > b->score; });
+    if (worst.size() > count) {
+        worst.resize(count);
+    }
+    return worst;
+}
+
+void ConfigAuditReport::writeJsonLines(std::ostream& out) const {
+    char hash[17];
+    for (const HostAudit& host : hosts) {
+        out << "{\"host\":\"" << json_escape(host.host) << "\",\"path\":\"" << json_escape(host.path) << "\"";
+        if (!host.error.empty()) {
+            out << ",\"error\":\"" << json_escape(host.error) << "\"}\n";
+            continue;
+        }
+        snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(host.config_hash));
+        out << ",\"config_hash\":\"" << hash << "\",\"score\":" << host.score << ",\"issues\":[";
+        bool first = true;
+        for (const auto& issue : issues_by_config[host.config]) {
+            out << (first ? "" : ",") << "{\"key\":\"" << json_escape(issue.key)
+                << "\",\"severity\":\"" << issue.severity
+                << "\",\"current\":\"" << json_escape(issue.current_value)
+                << "\",\"recommended\":\"" << json_escape(issue.recommended_value) << "\"}";
+            first = false;
+        }
+        out << "]}\n";
+    }
+}
@@ -0,0 +1,99 @@
+/**
+ * @file configAudit.h
+ * @brief Параллельная проверка sshd_config с множества хостов
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include "sshConfig.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Результат проверки одного хоста
+ */
+struct HostAudit {
+    std::string host;        /**< Имя хоста (путь относительно каталога) */
+    std::string path;        /**< Файл конфигурации */
+    uint64_t config_hash = 0;/**< Хеш содержимого файла */
+    size_t config = 0;       /**< Номер уникальной конфигурации в ConfigAuditReport::issues_by_config */
+    int score = 0;           /**< Сумма весов проблем: critical 10, high 5, medium 2, low 1 */
+    std::string error;       /**< Файл не прочитан */
+};
+
+/**
+ * @brief Сколько хостов затронуто проблемой
+ */
+struct AuditIssueCount {
+    std::string key;         /**< Параметр sshd_config */
+    std::string severity;
+    std::string description;
+    size_t hosts = 0;
+};
+
+/**
+ * @brief Сводный отчет по каталогу конфигураций
+ */
+struct ConfigAuditReport {
+    std::vector<HostAudit> hosts;                                        /**< В порядке имен */
+    std::vector<std::vector<SSHSecurityRecommendation>> issues_by_config;/**< Проблемы уникальных конфигураций */
+    std::vector<AuditIssueCount> issues;                                 /**< По убыванию числа хостов */
+    size_t failed = 0;                                                   /**< Хостов с непрочитанным файлом */
+    double seconds = 0;
+
+    size_t uniqueConfigs() const { return issues_by_config.size(); }
+
+    /**
+     * @brief Хосты с наибольшим score (при равенстве - по имени)
+     */
+    std::vector<const HostAudit*> worstHosts(size_t count) const;
+
+    /**
+     * @brief По строке JSON на хост: host, path, config_hash, score, issues
+     */
+    void writeJsonLines(std::ostream& out) const;
+};
+
+/**
+ * @brief Проверка конфигураций sshd, собранных с парка хостов
+ *
+ * Каталог обходится рекурсивно; хост - это путь файла относительно каталога,
+ * а для файлов с именем sshd_config - путь их каталога (hosts/web1/sshd_config
+ * дает web1). Файлы читаются и хешируются параллельно, одинаковые по
+ * содержимому конфигурации разбираются и анализируются один раз (у парка их
+ * обычно единицы на тысячи хостов), затем результаты раздаются хостам и
+ * сводятся в отчет.
+ *
+ * Анализ идет по действующим глобальным настройкам, как у smssh effective:
+ * Include раскрывается от каталога файла (hosts/web1/sshd_config.d).
+ * Каталоги *.d не считаются хостами, а файл с Include не склеивается с
+ * другими: при том же тексте его включенные файлы могут отличаться.
+ */
+class ConfigAudit {
+public:
+    /**
+     * @param threads Число потоков (0 - по числу ядер)
+     */
+    explicit ConfigAudit(unsigned threads = 0);
+
+    /**
+     * @brief Проверить все файлы каталога
+     * @return False если каталог не открыт
+     */
+    bool auditDirectory(const std::string& directory, ConfigAuditReport& report);
+
+    /**
+     * @brief Проверить заданные файлы
+     * @param hosts Пары хост - путь к файлу
+     */
+    ConfigAuditReport auditFiles(const std::vector<std::pair<std::string, std::string>>& hosts);
+
+    static int severityWeight(const std::string& severity);
+
+private:
+    unsigned threads_;
+};
@@ -0,0 +1,119 @@
+/**
+ * @file detectorState.cpp
+ * @brief Сохранение и загрузка снимка мониторинга
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "detectorState.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    const char kMagic[8] = {'S', 'M', 'S', 'S', 'H', 'S', 'T', '1'};
+    // 2: добавлены блокировки; снимок версии 1 читается без них
+    const uint32_t kVersion = 2;
+
+    // FNV-1a: ловит обрезанный или испорченный файл
+    uint64_t checksum(std::string_view data) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : data) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    bool write_all(int fd, const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = write(fd, data.data() + written, data.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            written += n;
+        }
+        return true;
+    }
+}
+
+bool saveMonitorState(const std::string& path, const MonitorState& state) {
+    std::string payload;
+    StateWriter writer(payload);
+    writer.putString(state.cursor.path);
+    writer.put(state.cursor.inode);
+    writer.put(state.cursor.offset);
+    writer.putString(state.detector);
+    writer.putString(state.bans);
+
+    std::string data(kMagic, sizeof(kMagic));
+    StateWriter header(data);
+    header.put(kVersion);
+    header.put<uint64_t>(payload.size());
+    data += payload;
+    header.put(checksum(payload));
+
+    std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write_all(fd, data) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    // Сам rename тоже должен дойти до диска
+    std::string dir = path.find('/') == std::string::npos ? "." : path.substr(0, path.rfind('/'));
+    int dir_fd = open(dir.empty() ? "/" : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return true;
+}
+
+bool loadMonitorState(const std::string& path, MonitorState& state) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(kMagic) || data.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+
+    StateReader header(std::string_view(data).substr(sizeof(kMagic)));
+    uint32_t version = 0;
+    uint64_t size = 0;
+    if (!header.get(version) || version == 0 || version > kVersion || !header.get(size) ||
+        data.size() != sizeof(kMagic) + sizeof(version) + sizeof(size) + size + sizeof(uint64_t)) {
+        return false;
+    }
+
+    std::string_view payload = std::string_view(data).substr(sizeof(kMagic) + sizeof(version) + sizeof(size), size);
+    uint64_t stored_checksum = 0;
+    std::memcpy(&stored_checksum, data.data() + data.size() - sizeof(uint64_t), sizeof(uint64_t));
+    if (stored_checksum != checksum(payload)) {
+        return false;
+    }
+
+    StateReader reader(payload);
+    reader.getString(state.cursor.path);
+    reader.get(state.cursor.inode);
+    reader.get(state.cursor.offset);
+    reader.getString(state.detector);
+    state.bans.clear();
+    if (version >= 2) {
+        reader.getString(state.bans);
+    }
+    return reader.ok() && reader.atEnd();
+}
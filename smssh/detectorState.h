@@ -0,0 +1,138 @@
+/**
+ * @file detectorState.h
+ * @brief Снимок состояния мониторинга: двоичная запись, курсор лога, атомарное сохранение
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Последовательная двоичная запись (порядок байт машины)
+ *
+ * Снимок читает та же машина после перезапуска, поэтому числа пишутся как
+ * есть, без преобразований.
+ */
+class StateWriter {
+public:
+    explicit StateWriter(std::string& out) : out_(out) {}
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(std::string_view text) {
+        put<uint32_t>(static_cast<uint32_t>(text.size()));
+        out_.append(text);
+    }
+
+    void putTime(std::chrono::system_clock::time_point time) {
+        put<int64_t>(time.time_since_epoch().count());
+    }
+
+private:
+    std::string& out_;
+};
+
+/**
+ * @brief Чтение записи StateWriter с проверкой границ
+ *
+ * После первой ошибки все чтения возвращают false, поэтому проверить
+ * ok() достаточно в конце.
+ */
+class StateReader {
+public:
+    explicit StateReader(std::string_view in) : in_(in) {}
+
+    template <typename T>
+    bool get(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (!ok_ || in_.size() - pos_ < sizeof(T)) {
+            return ok_ = false;
+        }
+        std::memcpy(&value, in_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool getString(std::string& text) {
+        uint32_t size = 0;
+        if (!get(size) || in_.size() - pos_ < size) {
+            return ok_ = false;
+        }
+        text.assign(in_.data() + pos_, size);
+        pos_ += size;
+        return true;
+    }
+
+    bool getTime(std::chrono::system_clock::time_point& time) {
+        int64_t count = 0;
+        if (!get(count)) {
+            return false;
+        }
+        time = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(count));
+        return true;
+    }
+
+    /**
+     * @brief Число элементов, которое не может превышать остаток данных
+     */
+    bool getCount(uint64_t& count, size_t min_element_size = 1) {
+        if (!get(count)) {
+            return false;
+        }
+        if (count > (in_.size() - pos_) / min_element_size) {
+            return ok_ = false;
+        }
+        return true;
+    }
+
+    bool ok() const { return ok_; }
+    bool atEnd() const { return pos_ == in_.size(); }
+
+private:
+    std::string_view in_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+/**
+ * @brief Позиция чтения лога: файл определяется по inode, чтобы пережить ротацию
+ */
+struct LogCursor {
+    std::string path;     /**< Путь к логу */
+    uint64_t inode = 0;   /**< Inode файла, из которого читали */
+    uint64_t offset = 0;  /**< Смещение после последней целой строки */
+};
+
+/**
+ * @brief Снимок мониторинга: курсор лога, состояние детектора и действующие блокировки
+ */
+struct MonitorState {
+    LogCursor cursor;
+    std::string detector;  /**< SSHAttackDetector::saveState */
+    std::string bans;      /**< BanManager::saveState (пусто без активной блокировки) */
+};
+
+/**
+ * @brief Сохранить снимок: запись во временный файл, fsync и rename
+ *
+ * При падении посреди записи на диске остается прежний целый снимок.
+ * @return True если снимок записан
+ */
+bool saveMonitorState(const std::string& path, const MonitorState& state);
+
+/**
+ * @brief Загрузить снимок
+ * @return False если файла нет, он поврежден или от другой версии формата
+ */
+bool loadMonitorState(const std::string& path, MonitorState& state);
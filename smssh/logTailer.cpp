@@ -0,0 +1,96 @@
+/**
+ * @file logTailer.cpp
+ * @brief Реализация инкрементального чтения лога
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "logTailer.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <vector>
+
+LogTailer::LogTailer(std::string path) {
+    cursor_.path = std::move(path);
+}
+
+bool LogTailer::seekToEnd() {
+    struct stat st;
+    if (stat(cursor_.path.c_str(), &st) != 0) {
+        return false;
+    }
+    cursor_.inode = st.st_ino;
+    cursor_.offset = st.st_size;
+    return true;
+}
+
+size_t LogTailer::readFrom(const std::string& path, const std::function<void(std::string_view)>& on_line) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    // Блоками по 64 КБ; неполная строка в конце блока переносится в следующий
+    std::vector<char> buffer(64 * 1024);
+    std::string carry;
+    size_t lines = 0;
+    uint64_t position = cursor_.offset;
+    while (true) {
+        ssize_t n = pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(position));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        position += n;
+
+        std::string_view chunk(buffer.data(), n);
+        size_t start = 0;
+        size_t newline;
+        while ((newline = chunk.find('\n', start)) != std::string_view::npos) {
+            std::string_view line = chunk.substr(start, newline - start);
+            if (!carry.empty()) {
+                carry.append(line);
+                line = carry;
+            }
+            on_line(line);
+            cursor_.offset += line.size() + 1;
+            carry.clear();
+            lines++;
+            start = newline + 1;
+        }
+        carry.append(chunk.substr(start));
+    }
+
+    close(fd);
+    return lines;
+}
+
+size_t LogTailer::poll(const std::function<void(std::string_view)>& on_line) {
+    struct stat st;
+    if (stat(cursor_.path.c_str(), &st) != 0) {
+        return 0;  // Между переименованием и созданием нового файла
+    }
+
+    size_t lines = 0;
+    if (cursor_.inode != static_cast<uint64_t>(st.st_ino)) {
+        struct stat rotated;
+        std::string rotated_path = cursor_.path + ".1";
+        if (cursor_.inode != 0 && stat(rotated_path.c_str(), &rotated) == 0 &&
+            static_cast<uint64_t>(rotated.st_ino) == cursor_.inode) {
+            lines += readFrom(rotated_path, on_line);
+        }
+        cursor_.inode = st.st_ino;
+        cursor_.offset = 0;
+    } else if (static_cast<uint64_t>(st.st_size) < cursor_.offset) {
+        cursor_.offset = 0;
+    }
+
+    if (static_cast<uint64_t>(st.st_size) > cursor_.offset) {
+        lines += readFrom(cursor_.path, on_line);
+    }
+    return lines;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file logTailer.h
+ * @brief Инкрементальное чтение растущего лога с курсором, переживающим ротацию
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include "detectorState.h"
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Чтение только дописанных строк лога
+ *
+ * Курсор - inode файла и смещение после последней целой строки; его можно
+ * сохранить в снимок и продолжить с него после перезапуска. Если под путем
+ * появился другой файл (ротация), сначала дочитывается хвост прежнего
+ * (path.1 с тем же inode), потом новый файл с начала. Обрезанный файл
+ * (copytruncate) читается с начала. Недописанная последняя строка остается
+ * за курсором до следующего вызова poll().
+ */
+class LogTailer {
+public:
+    explicit LogTailer(std::string path);
+
+    /**
+     * @brief Начать с текущего конца файла
+     * @return False если файла нет
+     */
+    bool seekToEnd();
+
+    void setCursor(const LogCursor& cursor) { cursor_ = cursor; }
+    const LogCursor& cursor() const { return cursor_; }
+    const std::string& path() const { return cursor_.path; }
+
+    /**
+     * @brief Прочитать новые целые строки
+     * @param on_line Вызывается для каждой строки (без перевода строки)
+     * @return Число прочитанных строк
+     */
+    size_t poll(const std::function<void(std::string_view)>& on_line);
+
+private:
+    size_t readFrom(const std::string& path, const std::function<void(std::string_view)>& on_line);
+
+    LogCursor cursor_;
+};
@@ -0,0 +1,151 @@
+/**
+ * @file parallelFor.h
+ * @brief Раздача независимых заданий по потокам
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Выполнить task(i) для i от 0 до count - 1 в threads потоках
+ *
+ * Задания раздаются по одному через общий счетчик: файлы, конфигурации и
+ * ключи сильно различаются по времени обработки, статическое деление дало бы
+ * перекос. Вызывающий поток работает наравне с остальными.
+ * @param threads Число потоков (0 - по числу ядер)
+ */
+template <typename Task>
+void parallelFor(unsigned threads, size_t count, Task&& task) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            task(i);
+        }
+    };
+
+    size_t workers_count = std::min<size_t>(threads, count);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < workers_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Постоянные потоки для заданий, которые повторяются много раз в секунду
+ *
+ * parallelFor создает потоки на каждый вызов, что незаметно для аудита
+ * парка, но не для детектора, который проходит по шардам при каждом
+ * закрытии окна. Здесь потоки создаются один раз и ждут следующего run();
+ * вызывающий поток работает наравне с ними.
+ */
+class WorkerPool {
+public:
+    /**
+     * @param threads Потоков кроме вызывающего
+     */
+    explicit WorkerPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this]() { work(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * @brief Выполнить task(i) для i от 0 до count - 1 и дождаться всех
+     */
+    void run(size_t count, const std::function<void(size_t)>& task) {
+        if (threads_.empty() || count <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                task(i);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> run_lock(run_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            count_ = count;
+            next_.store(0, std::memory_order_relaxed);
+            busy_ = threads_.size();
+            generation_++;
+        }
+        start_cv_.notify_all();
+
+        drain();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return busy_ == 0; });
+        task_ = nullptr;
+    }
+
+private:
+    void drain() {
+        for (size_t i; (i = next_.fetch_add(1, std::memory_order_relaxed)) < count_;) {
+            (*task_)(i);
+        }
+    }
+
+    void work() {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_cv_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+                if (stop_) {
+                    return;
+                }
+                seen = generation_;
+            }
+            drain();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                busy_--;
+            }
+            done_cv_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex run_mutex_;  // Один run() за раз
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    size_t busy_ = 0;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
@@ -0,0 +1,59 @@
+/**
+ * @file slidingWindow.h
+ * @brief Скользящее окно счетчиков с поминутными корзинами
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+/**
+ * @brief Скользящее окно из поминутных корзин с накопленной суммой
+ *
+ * Counters - структура счетчиков с operator+= и operator-=. Добавление
+ * идет в порядке времени (в последнюю корзину или новую в конце), поэтому
+ * и добавление, и устаревание - O(1) на корзину. Сумма по окну всегда
+ * готова в totals(), перебирать корзины нужно только детекторам, которым
+ * важно распределение внутри окна.
+ */
+template <typename Counters>
+class SlidingWindow {
+public:
+    using Bucket = std::pair<int64_t, Counters>;
+
+    /**
+     * @brief Добавить счетчики в корзину минуты
+     * @param minute Номер минуты (время события / 60 с); не меньше последней корзины
+     * @param delta Прибавляемые счетчики
+     */
+    void add(int64_t minute, const Counters& delta) {
+        if (buckets_.empty() || buckets_.back().first < minute) {
+            buckets_.emplace_back(minute, Counters{});
+        }
+        buckets_.back().second += delta;
+        totals_ += delta;
+    }
+
+    /**
+     * @brief Убрать корзины с минутой не позже cutoff
+     * @param cutoff Последняя устаревшая минута
+     */
+    void expire(int64_t cutoff) {
+        while (!buckets_.empty() && buckets_.front().first <= cutoff) {
+            totals_ -= buckets_.front().second;
+            buckets_.pop_front();
+        }
+    }
+
+    const Counters& totals() const { return totals_; }
+    const std::deque<Bucket>& buckets() const { return buckets_; }
+    bool empty() const { return buckets_.empty(); }
+
+private:
+    std::deque<Bucket> buckets_;
+    Counters totals_{};
+};
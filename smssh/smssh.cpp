@@ -8,14 +8,34 @@
 #include "sshConfig.h"
 #include "sshAttackDetector.h"
 #include "../logger/logger.h"
+#include "../bulkreader/bulkreader.h"
+#include "../userdir/userdir.h"
+#include "../iplist/iplist.h"
+#include "detectorState.h"
+#include "logTailer.h"
+#include "banManager.h"
+#include "configAudit.h"
+#include "sshConfigResolver.h"
+#include "sshKeyGen.h"
+#include "sshTrafficGenerator.h"
+#include "smssh_config.h"
 #include <iostream>
 #include <cstring>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <regex>
+#include <random>
+#include <malloc.h>
 #include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <unistd.h>
+#include <sys/resource.h>
 
 /**
  * @brief Display help information
@@ -29,9 +49,20 @@ void help()
     std::cout << "smssh check [путь_конфига] - проверить текущую SSH конфигурацию" << std::endl;
     std::cout << "smssh apply [путь_конфига] - применить рекомендации по безопасности (создает резервную копию)" << std::endl;
     std::cout << "smssh show [путь_конфига] - показать текущую SSH конфигурацию" << std::endl;
-    std::cout << "smssh monitor - запустить мониторинг SSH атак" << std::endl;
-    std::cout << "smssh parse-log <путь_лога> - разобрать SSH лог и обнаружить атаки" << std::endl;
-    std::cout << "smssh gen-key [имя_ключа] - сгенерировать SSH ключи хоста для аутентификации сервера" << std::endl;
+    std::cout << "smssh monitor [путь_конфига] [--once] - запустить мониторинг SSH атак (--once: обработать новые строки, сохранить снимок и выйти)" << std::endl;
+    std::cout << "smssh parse-log <путь_лога> [--threads N] [--shards N] - разобрать SSH лог и обнаружить атаки (обычный файл делится на части и разбирается во всех ядрах)" << std::endl;
+    std::cout << "smssh bench-parse <путь_лога> [проходы] - сравнить скорость разбора лога с прежним разбором на регулярных выражениях" << std::endl;
+    std::cout << "smssh bench-detector [попыток] [адресов] [потоков] - замерить прием попыток и время анализа детектора на часе событий" << std::endl;
+    std::cout << "smssh gen-traffic <каталог> [--hours H] [--scale N] [--seed S] - синтетический auth.log (фон, перебор, словарь, spray, ночные входы, сканы имен) с разметкой атак" << std::endl;
+    std::cout << "smssh bench-traffic [каталог] [--hours H] [--scale N] [--seed S] - прием, задержка analyze(), память и точность/полнота детектора на синтетическом трафике" << std::endl;
+    std::cout << "smssh user <имя> [каталог] - показать, как детектор видит учетную запись (passwd, group, shadow; по умолчанию /etc)" << std::endl;
+    std::cout << "smssh iplist build <файл> <block|allow>:<имя>:<фид>... - собрать списки сетей (DROP, FireHOL, свои) в файл для ip_lists_file" << std::endl;
+    std::cout << "smssh iplist check <файл> <ip>... - в каком списке адрес" << std::endl;
+    std::cout << "smssh audit-dir <каталог> [--json <файл>|-] [--threads N] [--top N] - проверить sshd_config всех хостов каталога (одинаковые файлы анализируются один раз)" << std::endl;
+    std::cout << "smssh effective <путь_конфига> [--user U] [--group G]... [--host H] [--addr A] [--laddr A] [--lport P] - действующие настройки для подключения с учетом Match и Include" << std::endl;
+    std::cout << "smssh overrides <путь_конфига> [--users каталог] [--addr CIDR]... [--lport P] - найти блоки Match, ослабляющие защиту для локальных пользователей (по умолчанию /etc и все адреса)" << std::endl;
+    std::cout << "smssh gen-key [имя_ключа] [--type ed25519|ecdsa|rsa] [--bits N] [--dir каталог] - сгенерировать SSH ключи хоста для аутентификации сервера (по умолчанию ed25519 в ~/.ssh)" << std::endl;
+    std::cout << "smssh gen-keys <каталог> <список|-> [--type T] [--bits N] [--threads N] - сгенерировать ключи по списку (строка: имя [тип [бит]]) параллельно" << std::endl;
     std::cout << "smssh post-config - показать шаги пост-конфигурации SSH сервера" << std::endl;
 }
 
@@ -252,33 +283,70 @@ void cmd_show(int argc, char* argv[])
     cmd_check(argc, argv);
 }
 
+/**
+ * @brief Разобрать общие опции генерации ключей (--type, --bits)
+ * @return False если опция не распознана или значение неверно
+ */
+bool parse_key_option(const std::string& option, const std::string& value, SSHKeySpec& spec)
+{
+    if (option == "--type") {
+        if (!SSHKeyGenerator::parseType(value, spec.type)) {
+            LogError("Unknown key type " + value + ", expected ed25519, ecdsa or rsa");
+            return false;
+        }
+        return true;
+    }
+    if (option == "--bits") {
+        spec.bits = atoi(value.c_str());
+        return true;
+    }
+    LogError("Unknown option " + option);
+    return false;
+}
+
 /**
  * @brief Команда генерации SSH ключей
- * @param key_name Имя ключа
+ * @param argc Количество аргументов
+ * @param argv [имя_ключа] [--type T] [--bits N] [--dir каталог]
  */
-void cmd_gen_key(const std::string& key_name)
+void cmd_gen_key(int argc, char* argv[])
 {
+    SSHKeySpec spec;
+    int first_option = 2;
+    if (argc >= 3 && strncmp(argv[2], "--", 2) != 0) {
+        spec.name = argv[2];
+        first_option = 3;
+    }
+    const char* home = std::getenv("HOME");
+    std::string ssh_dir = std::string(home ? home : ".") + "/.ssh";
+    for (int i = first_option; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--dir") == 0) {
+            ssh_dir = argv[i + 1];
+        } else if (!parse_key_option(argv[i], argv[i + 1], spec)) {
+            return;
+        }
+    }
+    if (spec.name.empty()) {
+        spec.name = "id_" + SSHKeyGenerator::typeName(spec.type);
+    }
+    std::string key_name = spec.name;
+
     std::cout << "Генерация пары SSH ключей хоста для сервера: " << key_name << std::endl;
     std::cout << "Это создаст SSH ключи сервера:" << std::endl;
     std::cout << "  - " << key_name << " (приватный ключ хоста)" << std::endl;
     std::cout << "  - " << key_name << ".pub (public host key)" << std::endl;
     std::cout << std::endl;
 
-    // Создать директорию .ssh если она не существует
-    std::string home_dir = std::getenv("HOME");
-    std::string ssh_dir = home_dir + "/.ssh";
-
-    // Использовать системный вызов для генерации SSH ключа
-    std::string cmd = "ssh-keygen -t rsa -b 4096 -f " + ssh_dir + "/" + key_name + " -N \"\"";
-    std::cout << "Executing: " << cmd << std::endl;
+    // Ключ создается в процессе через OpenSSL, каталог - с правами 0700 если его нет
+    auto results = SSHKeyGenerator::generateBatch(ssh_dir, {spec}, 1);
+    const SSHKeyResult& result = results.front();
 
-    int result = system(cmd.c_str());
-
-    if (result == 0) {
+    if (result.error.empty()) {
         std::cout << std::endl;
         std::cout << "SSH host key pair generated successfully!" << std::endl;
         std::cout << "Private host key: " << ssh_dir << "/" << key_name << std::endl;
         std::cout << "Public host key:  " << ssh_dir << "/" << key_name << ".pub" << std::endl;
+        std::cout << "Fingerprint:      " << result.fingerprint << std::endl;
         std::cout << std::endl;
         std::cout << "Следующие шаги для настройки SSH сервера:" << std::endl;
         std::cout << "1. Скопируйте ключи на ваш SSH сервер:" << std::endl;
@@ -293,10 +361,73 @@ void cmd_gen_key(const std::string& key_name)
         std::cout << std::endl;
         std::cout << "5. Протестируйте соединение с SSH сервером с другой машины" << std::endl;
     } else {
-        std::cout << "Не удалось сгенерировать пару SSH ключей хоста!" << std::endl;
+        std::cout << "Не удалось сгенерировать пару SSH ключей хоста: " << result.error << std::endl;
     }
 }
 
+/**
+ * @brief Пакетная генерация ключей для служебных учетных записей
+ * @param argc Количество аргументов
+ * @param argv <каталог> <список|-> [--type T] [--bits N] [--threads N]; в списке строки "имя [тип [бит]]"
+ */
+void cmd_gen_keys(int argc, char* argv[])
+{
+    SSHKeySpec defaults;
+    unsigned threads = 0;
+    for (int i = 4; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--threads") == 0) {
+            threads = static_cast<unsigned>(std::max(0, atoi(argv[i + 1])));
+        } else if (!parse_key_option(argv[i], argv[i + 1], defaults)) {
+            return;
+        }
+    }
+
+    std::ifstream file;
+    bool from_stdin = strcmp(argv[3], "-") == 0;
+    if (!from_stdin) {
+        file.open(argv[3]);
+        if (!file.is_open()) {
+            LogError(std::string("Cannot read ") + argv[3]);
+            return;
+        }
+    }
+    std::istream& in = from_stdin ? std::cin : file;
+
+    std::vector<SSHKeySpec> specs;
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number) {
+        std::stringstream ss(line.substr(0, line.find('#')));
+        SSHKeySpec spec = defaults;
+        std::string type;
+        if (!(ss >> spec.name)) {
+            continue;
+        }
+        if (ss >> type && !SSHKeyGenerator::parseType(type, spec.type)) {
+            LogError(std::string(argv[3]) + ":" + std::to_string(line_number) + ": unknown key type " + type);
+            return;
+        }
+        ss >> spec.bits;
+        specs.push_back(std::move(spec));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = SSHKeyGenerator::generateBatch(argv[2], specs, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    for (const auto& result : results) {
+        if (result.error.empty()) {
+            std::cout << result.path << " " << result.fingerprint << std::endl;
+        } else {
+            LogError(result.name + ": " + result.error);
+            failed++;
+        }
+    }
+    std::cout << std::fixed << std::setprecision(2) << "Создано ключей: " << results.size() - failed
+              << ", ошибок: " << failed << " за " << seconds << " с" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+}
+
 /**
  * @brief Команда отображения пост-конфигурационных шагов
  */
@@ -307,7 +438,7 @@ void cmd_post_config()
     std::cout << "After applying security recommendations to SSH server configuration:" << std::endl;
     std::cout << std::endl;
     std::cout << "1. GENERATE SSH HOST KEYS" << std::endl;
-    std::cout << "   smssh gen-key ssh_host_rsa_key" << std::endl;
+    std::cout << "   smssh gen-key ssh_host_ed25519_key --dir /etc/ssh" << std::endl;
     std::cout << "   or manually for server host keys:" << std::endl;
     std::cout << "   sudo ssh-keygen -t rsa -b 4096 -f /etc/ssh/ssh_host_rsa_key -N \"\"" << std::endl;
     std::cout << std::endl;
@@ -353,101 +484,420 @@ void cmd_post_config()
     std::cout << std::endl;
 }
 
-void parse_ssh_log_line(const std::string& line, SSHAttackDetector& detector);
+void parse_ssh_log_line(std::string_view line, SSHAttackDetector& detector);
+void parse_live_ssh_log_line(std::string_view line, SSHAttackDetector& detector);
+
+static volatile sig_atomic_t g_monitor_stop = 0;
 
 /**
- * @brief Команда мониторинга SSH атак
+ * @brief Обработчик SIGINT/SIGTERM: мониторинг сохраняет снимок и завершается
+ */
+static void monitor_signal_handler(int)
+{
+    g_monitor_stop = 1;
+}
+
+/**
+ * @brief Менеджер блокировок по ключам ban_* конфигурации
+ * @return nullptr если блокировка выключена (ban_backend = off)
  */
-void cmd_monitor()
+std::unique_ptr<BanManager> make_ban_manager(const SSHConfigManager& config)
 {
-    std::cout << "Starting SSH attack monitoring..." << std::endl;
-    std::cout << "Press Ctrl+C to stop" << std::endl;
+    std::string spec = config.get("ban_backend");
+    if (spec.empty() || spec == "off") {
+        return nullptr;
+    }
+    auto backend = makeBanBackend(spec);
+    if (!backend) {
+        LogWarning("Unknown ban_backend: " + spec + ", active response disabled");
+        return nullptr;
+    }
+
+    BanPolicy policy;
+    policy.ban_time = std::chrono::seconds(config.getInt("ban_seconds", 3600));
+    policy.min_severity = config.get("ban_min_severity").empty() ? policy.min_severity : config.get("ban_min_severity");
+    policy.aggregate_threshold = config.getInt("ban_aggregate_threshold", policy.aggregate_threshold);
+    if (!config.get("ban_types").empty()) {
+        policy.types.clear();
+        std::stringstream types(config.get("ban_types"));
+        std::string type;
+        while (std::getline(types, type, ',')) {
+            type.erase(0, type.find_first_not_of(" \t"));
+            type.erase(type.find_last_not_of(" \t") + 1);
+            if (!type.empty()) {
+                policy.types.insert(type);
+            }
+        }
+    }
 
-    SSHAttackDetector detector;
+    auto bans = std::make_unique<BanManager>(std::move(backend), policy);
+    std::stringstream allowed(config.get("ban_allow"));
+    std::string cidr;
+    while (std::getline(allowed, cidr, ',')) {
+        cidr.erase(0, cidr.find_first_not_of(" \t"));
+        cidr.erase(cidr.find_last_not_of(" \t") + 1);
+        if (!cidr.empty() && !bans->allow(cidr)) {
+            LogWarning("Invalid ban_allow entry: " + cidr);
+        }
+    }
+    return bans;
+}
 
-    // Мониторить /var/log/auth.log на новые записи
+/**
+ * @brief Команда мониторинга SSH атак
+ * @param config_path Путь к конфигурации (ssh_log_path, state_file (off - без снимков), state_interval_seconds)
+ * @param once Прочитать новые строки, сохранить снимок и выйти
+ */
+void cmd_monitor(const std::string& config_path, bool once)
+{
     std::string log_path = "/var/log/auth.log";
-    std::ifstream log_file(log_path);
+    std::string state_path = "/var/lib/smssh/monitor.state";
+    int state_interval = 30;
+    std::unique_ptr<BanManager> bans;
+    if (!config_path.empty() && access(config_path.c_str(), R_OK) == 0) {
+        SSHConfigManager config(config_path);
+        log_path = config.get("ssh_log_path").empty() ? log_path : config.get("ssh_log_path");
+        state_path = config.get("state_file").empty() ? state_path : config.get("state_file");
+        state_interval = config.getInt("state_interval_seconds", state_interval);
+        bans = make_ban_manager(config);
+    }
+    if (state_path == "off") {
+        state_path.clear();
+    } else {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(state_path).parent_path(), ec);
+    }
+
+    if (!once) {
+        std::cout << "Starting SSH attack monitoring..." << std::endl;
+        std::cout << "Press Ctrl+C to stop" << std::endl;
+    }
+
+    // Снимок: окна детектора, подавление повторов и позиция в логе на момент записи
+    MonitorState saved;
+    std::unique_ptr<SSHAttackDetector> detector;
+    bool have_snapshot = !state_path.empty() && loadMonitorState(state_path, saved);
+    if (have_snapshot && saved.cursor.path == log_path) {
+        detector = SSHAttackDetector::fromState(saved.detector);
+        if (!detector) {
+            LogWarning("Snapshot " + state_path + " is not usable, starting from the end of the log");
+        }
+    }
+    bool restored = detector != nullptr;
+    if (!restored) {
+        detector = std::make_unique<SSHAttackDetector>();
+    }
+    if (!config_path.empty() && !detector->loadConfig(config_path)) {
+        LogWarning("Cannot read config file: " + config_path + ", using defaults");
+    }
+    if (!once) {
+        detector->watchUserDirectory();
+    }
 
-    if (!log_file.is_open()) {
+    // Подавление повторов восстановлено из снимка, поэтому те же атакующие
+    // новых оповещений не дадут: их блокировки восстанавливаются вместе с ним
+    if (bans && have_snapshot && !saved.bans.empty() &&
+        !bans->loadState(saved.bans, std::chrono::system_clock::now())) {
+        LogWarning("Bans in snapshot " + state_path + " are damaged, some were not restored");
+    }
+
+    // Без снимка мониторинг начинается с текущего конца лога
+    LogTailer tailer(log_path);
+    if (restored) {
+        tailer.setCursor(saved.cursor);
+        LogInfo("Restored detector state from " + state_path + ", resuming " + log_path +
+                " at offset " + std::to_string(saved.cursor.offset));
+    } else if (!tailer.seekToEnd()) {
         LogError("Cannot open log file: " + log_path);
         return;
     }
 
-    // Перейти в конец файла для начала мониторинга с текущей позиции
-    log_file.seekg(0, std::ios::end);
-    std::streampos last_pos = log_file.tellg();
+    signal(SIGINT, monitor_signal_handler);
+    signal(SIGTERM, monitor_signal_handler);
 
+    auto last_save = std::chrono::steady_clock::now();
     while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(5));
-
-        log_file.clear();
-        log_file.seekg(last_pos);
+        tailer.poll([&](std::string_view line) { parse_live_ssh_log_line(line, *detector); });
 
-        std::string line;
-        while (std::getline(log_file, line)) {
-            // Разбирать строки SSH лога на попытки аутентификации
-            parse_ssh_log_line(line, detector);
+        // Без новых строк время событий стоит; двигать watermark по часам,
+        // чтобы окна закрывались и в тишине (с тем же допуском на опоздание)
+        if (!once) {
+            detector->advanceWatermark(std::chrono::system_clock::now() - std::chrono::seconds(60));
         }
 
-        last_pos = log_file.tellg();
-
-        // Анализировать обнаруженные атаки и генерировать оповещения
-        auto alerts = detector.analyze();
+        // Анализировать закрытые окна; повторы одной и той же атаки подавляются,
+        // пока она не усилится или не пройдет интервал напоминания
+        auto alerts = detector->pollAlerts();
         if (!alerts.empty()) {
             LogWarning("SSH Security Alerts Detected:");
             for (const auto& alert : alerts) {
                 std::stringstream ss;
-                ss << "[" << alert.severity << "] " << alert.type << " from " << alert.ip;
+                ss << "[" << alert.severity << "] " << alert.type;
+                if (!alert.ip.empty()) {
+                    ss << " from " << alert.ip;
+                }
                 if (!alert.username.empty()) {
                     ss << " (user: " << alert.username << ")";
                 }
-                ss << ": " << alert.description;
+                auto notification = alert.details.find("notification");
+                if (notification != alert.details.end() && notification->second != "new") {
+                    ss << " [" << notification->second << "]";
+                }
+                ss << " at " << alert.timestamp << ": " << alert.description;
                 LogWarning(ss.str());
             }
         }
 
-        detector.clearOldAttempts(60); // Очистить старые попытки соединения старше 60 минут
+        // Блокировки за один проход цикла уходят в бэкенд одной пачкой
+        if (bans) {
+            auto now = std::chrono::system_clock::now();
+            for (const auto& alert : alerts) {
+                bans->onAlert(alert, now);
+            }
+            bans->expire(now);
+            if (!bans->flush()) {
+                LogWarning(std::string("Cannot apply bans via ") + bans->backend().name() + ", will retry");
+            }
+        }
+
+        // Состояние и курсор сохраняются вместе, после обработки прочитанных строк
+        bool stopping = once || g_monitor_stop;
+        auto now = std::chrono::steady_clock::now();
+        if (!state_path.empty() && (stopping || now - last_save >= std::chrono::seconds(state_interval))) {
+            MonitorState state;
+            state.cursor = tailer.cursor();
+            detector->saveState(state.detector);
+            if (bans) {
+                bans->saveState(state.bans);
+            }
+            if (!saveMonitorState(state_path, state)) {
+                LogWarning("Cannot write snapshot " + state_path);
+            }
+            last_save = now;
+        }
+        if (stopping) {
+            break;
+        }
+
+        for (int i = 0; i < 50 && !g_monitor_stop; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+/**
+ * @brief Строка лога, разобранная потоком разбора
+ */
+struct ParsedLogLine {
+    SshLogEvent event;  // string_view указывают в отображение файла
+    std::chrono::system_clock::time_point time;
+    bool has_time = false;
+    uint64_t line = 0;  // Номер строки в части, с 1
+};
+
+/**
+ * @brief Часть лога: события по порядку строк
+ */
+struct ParsedLogChunk {
+    std::vector<ParsedLogLine> events;
+    uint64_t lines = 0;
+    bool ready = false;
+};
+
+/**
+ * @brief Вывести прогресс за каждые пройденные 100000 строк
+ */
+static void report_parse_progress(uint64_t& reported, uint64_t line_count)
+{
+    while (reported + 100000 <= line_count) {
+        reported += 100000;
+        std::cout << "Processed " << reported << " log lines..." << std::endl;
+    }
+}
+
+/**
+ * @brief Параллельный разбор отображенного в память лога
+ *
+ * Текст делится на части по границам строк, потоки разбора превращают части
+ * в списки событий с уже разобранными метками, а вызывающий поток передает
+ * события детектору строго в порядке файла и опрашивает окна на тех же
+ * границах в 1000 строк, что и последовательный разбор. Детектор (сессии по
+ * PID, буфер упорядочивания, watermark) получает ту же последовательность
+ * вызовов, поэтому и оповещения те же.
+ * @param threads Всего потоков вместе с вызывающим (не меньше 2)
+ * @return Число строк
+ */
+static uint64_t parse_log_parallel(std::string_view data, unsigned threads, SSHAttackDetector& detector,
+                                   std::vector<AttackAlert>& alerts)
+{
+    // Части по ~4 МБ; разбор уходит вперед не больше чем на 4 части на поток,
+    // чтобы память под события не росла с размером лога
+    size_t parsers = threads - 1;
+    auto texts = MappedFile::splitLines(data, std::max<size_t>(parsers, data.size() / (4 << 20)));
+    std::vector<ParsedLogChunk> chunks(texts.size());
+    size_t ahead = parsers * 4;
+
+    std::mutex mutex;
+    std::condition_variable parsed_cv;
+    std::condition_variable merged_cv;
+    size_t merged = 0;
+    std::atomic<size_t> next{0};
+
+    auto parser = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < chunks.size();) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                merged_cv.wait(lock, [&]() { return i < merged + ahead; });
+            }
+
+            ParsedLogChunk& chunk = chunks[i];
+            std::string_view text = texts[i];
+            ParsedLogLine parsed;
+            size_t start = 0;
+            while (start < text.size()) {
+                size_t end = std::min(text.find('\n', start), text.size());
+                chunk.lines++;
+                if (parseSshLogLine(text.substr(start, end - start), parsed.event)) {
+                    parsed.has_time = parseSshTimestamp(parsed.event.timestamp, parsed.time);
+                    parsed.line = chunk.lines;
+                    chunk.events.push_back(parsed);
+                }
+                start = end + 1;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunk.ready = true;
+            }
+            parsed_cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(parsers, chunks.size()); ++i) {
+        workers.emplace_back(parser);
+    }
+
+    uint64_t line_count = 0;
+    uint64_t polled = 0;
+    uint64_t reported = 0;
+    auto catch_up = [&](uint64_t processed) {
+        // Опрос после каждой тысячной строки; опросы подряд без новых событий
+        // равносильны одному
+        if (processed / 1000 > polled / 1000) {
+            polled = processed;
+            auto closed = detector.pollAlerts();
+            alerts.insert(alerts.end(), closed.begin(), closed.end());
+        }
+        report_parse_progress(reported, processed);
+    };
+
+    for (auto& chunk : chunks) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            parsed_cv.wait(lock, [&]() { return chunk.ready; });
+        }
+
+        for (const auto& parsed : chunk.events) {
+            catch_up(line_count + parsed.line - 1);
+            if (parsed.has_time) {
+                detector.addLogEvent(parsed.event, parsed.time);
+            } else {
+                detector.addLogEvent(parsed.event);
+            }
+        }
+        line_count += chunk.lines;
+        catch_up(line_count);
+        std::vector<ParsedLogLine>().swap(chunk.events);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            merged++;
+        }
+        merged_cv.notify_all();
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
     }
+    return line_count;
 }
 
 /**
  * @brief Команда разбора SSH лога
  * @param log_path Путь к файлу лога
+ * @param threads Число потоков (0 - по числу ядер, 1 - последовательный разбор)
+ * @param shards Число шардов детектора (0 - по числу ядер)
  */
-void cmd_parse_log(const std::string& log_path)
+void cmd_parse_log(const std::string& log_path, unsigned threads, unsigned shards)
 {
     std::cout << "Parsing SSH log file: " << log_path << std::endl;
 
-    SSHAttackDetector detector;
+    SSHAttackDetector detector(shards);
 
-    std::ifstream log_file(log_path);
-    if (!log_file.is_open()) {
-        LogError("Cannot open log file: " + log_path);
-        return;
+    uint64_t line_count = 0;
+    uint64_t bytes = 0;
+    std::vector<AttackAlert> alerts;
+    auto started = std::chrono::steady_clock::now();
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
 
-    std::string line;
-    int line_count = 0;
+    // Окна считаются по времени событий по мере продвижения watermark, поэтому
+    // история любой длины разбирается с правильными окнами и временем атак.
+    // Обычный файл разбирается частями во всех ядрах, с одним потоком -
+    // последовательно, блоками через io_uring
+    MappedFile mapped;
+    if (threads > 1 && mapped.open(log_path)) {
+        bytes = mapped.data().size();
+        line_count = parse_log_parallel(mapped.data(), threads, detector, alerts);
+    } else {
+        threads = 1;
+        uint64_t reported = 0;
+        bool readable = BulkReader::forEachLine(log_path, [&](std::string_view line) {
+            parse_ssh_log_line(line, detector);
+            line_count++;
+            bytes += line.size() + 1;
 
-    while (std::getline(log_file, line)) {
-        parse_ssh_log_line(line, detector);
-        line_count++;
+            if (line_count % 1000 == 0) {
+                auto closed = detector.pollAlerts();
+                alerts.insert(alerts.end(), closed.begin(), closed.end());
+            }
+            report_parse_progress(reported, line_count);
+            return true;
+        });
 
-        if (line_count % 1000 == 0) {
-            std::cout << "Processed " << line_count << " log lines..." << std::endl;
+        if (!readable) {
+            LogError("Cannot open log file: " + log_path);
+            return;
         }
     }
 
-    log_file.close();
+    auto closed = detector.flushAlerts();
+    alerts.insert(alerts.end(), closed.begin(), closed.end());
 
     std::cout << "Log parsing completed. Analyzing attacks..." << std::endl;
 
-    // Отладка: показать разобранные попытки
-    auto recent_attempts = detector.getRecentAttempts(60);
-    std::cout << "Parsed " << recent_attempts.size() << " connection attempts" << std::endl;
+    double seconds = std::max(1e-6, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+    double megabytes = bytes / 1048576.0;
+    std::ostringstream throughput;
+    throughput << std::fixed << std::setprecision(1) << "Read " << line_count << " lines (" << megabytes << " MB) in "
+               << std::setprecision(2) << seconds << " s: " << std::setprecision(1) << megabytes / seconds << " MB/s, "
+               << std::setprecision(0) << line_count / seconds << " lines/s, " << threads << " threads";
+    std::cout << throughput.str() << std::endl;
 
-    auto alerts = detector.analyze();
+    auto stats = detector.getStats();
+    std::cout << "Parsed " << stats.attempts << " connection attempts" << std::endl;
+    if (stats.late_attempts > 0) {
+        std::cout << "Dropped " << stats.late_attempts << " out-of-order attempts (older than the watermark)" << std::endl;
+    }
+    if (stats.untimed_events > 0) {
+        std::cout << "Lines with unparsable timestamps: " << stats.untimed_events << " (timed as the previous line)" << std::endl;
+    }
+    if (stats.allowlisted > 0) {
+        std::cout << "Skipped " << stats.allowlisted << " alerts for allowlisted networks" << std::endl;
+    }
 
     if (alerts.empty()) {
         std::cout << "No SSH attacks detected!" << std::endl;
@@ -469,11 +919,14 @@ void cmd_parse_log(const std::string& log_path)
     std::cout << std::endl;
     std::cout << "Detailed Alerts:" << std::endl;
     for (const auto& alert : alerts) {
-        std::cout << "[" << alert.severity << "] " << alert.type << " from " << alert.ip;
+        std::cout << "[" << alert.severity << "] " << alert.type;
+        if (!alert.ip.empty()) {
+            std::cout << " from " << alert.ip;
+        }
         if (!alert.username.empty()) {
             std::cout << " (user: " << alert.username << ")";
         }
-        std::cout << std::endl;
+        std::cout << " at " << alert.timestamp << std::endl;
         std::cout << "  " << alert.description << std::endl;
 
         for (const auto& [key, value] : alert.details) {
@@ -488,42 +941,827 @@ void cmd_parse_log(const std::string& log_path)
  * @param line Строка лога для разбора
  * @param detector Детектор SSH атак
  */
-void parse_ssh_log_line(const std::string& line, SSHAttackDetector& detector)
+void parse_ssh_log_line(std::string_view line, SSHAttackDetector& detector)
+{
+    SshLogEvent event;
+    if (parseSshLogLine(line, event)) {
+        detector.addLogEvent(event);
+    }
+}
+
+/**
+ * @brief Разобрать только что дописанную строку: без разборной метки берется время чтения
+ * @param line Строка лога
+ * @param detector Детектор атак
+ */
+void parse_live_ssh_log_line(std::string_view line, SSHAttackDetector& detector)
+{
+    SshLogEvent event;
+    if (parseSshLogLine(line, event)) {
+        std::chrono::system_clock::time_point time;
+        if (!parseSshTimestamp(event.timestamp, time)) {
+            time = std::chrono::system_clock::now();
+        }
+        detector.addLogEvent(event, time);
+    }
+}
+
+/**
+ * @brief Прежний разбор цепочкой регулярных выражений, оставлен только как эталон для bench-parse
+ * @param line Строка лога
+ * @return True если строка распознана
+ */
+static bool legacy_regex_match(const std::string& line)
 {
-    // Регулярные выражения для разбора строк SSH лога с временными метками
     static std::regex failed_password_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Failed password for (invalid user )?(\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+) ssh2)");
     static std::regex accepted_password_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Accepted password for (\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+) ssh2)");
     static std::regex accepted_pubkey_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Accepted publickey for (\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+) ssh2)");
     static std::regex invalid_user_regex(R"(\w+\s+\d+\s+\d+:\d+:\d+\s+\w+\s+sshd\[(\d+)\]:\s+Invalid user (\w+) from (\d+\.\d+\.\d+\.\d+) port (\d+))");
 
     std::smatch match;
-    std::string ip, username;
-    int port = 22;
-    bool success = false;
+    return std::regex_search(line, match, failed_password_regex) ||
+           std::regex_search(line, match, accepted_password_regex) ||
+           std::regex_search(line, match, accepted_pubkey_regex) ||
+           std::regex_search(line, match, invalid_user_regex);
+}
+
+/**
+ * @brief Команда сравнения скорости разбора: токенизатор против цепочки регулярных выражений
+ * @param log_path Путь к файлу лога
+ * @param iterations Сколько раз прогнать файл
+ */
+void cmd_bench_parse(const std::string& log_path, int iterations)
+{
+    std::vector<std::string> lines;
+    bool readable = BulkReader::forEachLine(log_path, [&](std::string_view line) {
+        lines.emplace_back(line);
+        return true;
+    });
+
+    if (!readable || lines.empty()) {
+        LogError("Cannot read log file: " + log_path);
+        return;
+    }
+
+    // Файл маленький, поэтому прогоняется по кругу до ~20k строк на путь
+    if (iterations <= 0) {
+        iterations = static_cast<int>(20000 / lines.size()) + 1;
+    }
+    size_t total = lines.size() * static_cast<size_t>(iterations);
+
+    auto run = [&](const char* name, auto&& parse) {
+        size_t recognized = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            for (const auto& line : lines) {
+                if (parse(line)) {
+                    recognized++;
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = seconds > 0 ? total / seconds : 0;
+
+        std::cout << std::left << std::setw(10) << name << std::right
+                  << std::setw(12) << static_cast<uint64_t>(rate) << " строк/с, распознано "
+                  << recognized / iterations << " из " << lines.size() << std::endl;
+        return rate;
+    };
+
+    std::cout << "Файл: " << log_path << ", строк: " << lines.size() << ", проходов: " << iterations << std::endl;
+
+    double regex_rate = run("regex", [](const std::string& line) {
+        return legacy_regex_match(line);
+    });
+    double token_rate = run("tokenizer", [](const std::string& line) {
+        SshLogEvent event;
+        return parseSshLogLine(line, event);
+    });
+
+    if (regex_rate > 0) {
+        std::cout << "Ускорение: " << std::fixed << std::setprecision(1) << token_rate / regex_rate << "x" << std::endl;
+    }
+}
+
+/**
+ * @brief Занятая куча, включая большие блоки, выделенные через mmap
+ */
+static size_t heap_in_use()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+/**
+ * @brief Команда замера детектора: прием попыток и время анализа на часе событий
+ * @param attempts Сколько попыток сгенерировать (0 - сравнить 100 тыс. и 1 млн)
+ * @param ips Сколько разных адресов
+ * @param threads Потоков приема и шардов детектора (0 - по числу ядер)
+ */
+void cmd_bench_detector(int attempts, int ips, int threads)
+{
+    std::vector<int> sizes;
+    if (attempts > 0) {
+        sizes.push_back(attempts);
+    } else {
+        sizes = {100000, 1000000};
+    }
+    if (ips <= 0) {
+        ips = 1000;
+    }
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    const char* usernames[] = {"root", "admin", "test", "deploy", "oracle", "ubuntu", "git", "backup"};
+    const auto base = std::chrono::system_clock::time_point(std::chrono::seconds(1767225600));
+
+    struct Attempt {
+        const IpAddress* ip;
+        const char* user;
+        bool success;
+        int port;
+        std::chrono::system_clock::time_point time;
+    };
+
+    // Адреса уже разобраны, как SshLogEvent::address после разбора строки
+    std::vector<IpAddress> addresses;
+    for (int i = 0; i < ips; ++i) {
+        addresses.push_back(IpAddress::fromV4(0x0a000000u | (i & 0xffffff)));
+    }
+
+    for (int count : sizes) {
+        SSHAttackDetector detector(threads);
+
+        // Попытки равномерно заполняют час времени событий
+        std::mt19937 rng(42);
+        std::vector<Attempt> generated(count);
+        for (int i = 0; i < count; ++i) {
+            generated[i].time = base + std::chrono::microseconds(3600000000LL * i / count);
+            generated[i].ip = &addresses[rng() % addresses.size()];
+            generated[i].user = usernames[rng() % 8];
+            generated[i].success = rng() % 10 == 0;
+            generated[i].port = rng() % 20 == 0 ? 2222 : 22;
+        }
+
+        // Каждый поток принимает свою полосу попыток, как читатели разных логов
+        size_t heap_before = heap_in_use();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&, t]() {
+                for (int i = t; i < count; i += threads) {
+                    const Attempt& attempt = generated[i];
+                    detector.addConnectionAttempt(*attempt.ip, attempt.user, attempt.success, attempt.port, attempt.time);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        double ingest = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double bytes_per_attempt = static_cast<double>(heap_in_use() - heap_before) / count;
+
+        start = std::chrono::steady_clock::now();
+        size_t polled = detector.pollAlerts().size();
+        double poll = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const int rounds = 10;
+        size_t analyzed = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) {
+            analyzed = detector.analyze().size();
+        }
+        double analyze = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+        std::cout << std::left << std::setw(8) << count << std::right
+                  << " попыток, " << ips << " адресов, " << threads << " шардов: прием "
+                  << static_cast<uint64_t>(ingest > 0 ? count / ingest : 0) << " попыток/с ("
+                  << std::fixed << std::setprecision(1) << bytes_per_attempt << " байт/попытку в буфере), pollAlerts "
+                  << std::fixed << std::setprecision(1) << poll * 1000 << " мс (" << polled << " оповещений), analyze "
+                  << analyze * 1000 << " мс (" << analyzed << " оповещений)" << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+/**
+ * @brief Разобрать параметры gen-traffic и bench-traffic
+ * @param first Номер первого параметра
+ * @param directory Каталог (первый аргумент без "--", может отсутствовать)
+ * @return False при неизвестном параметре
+ */
+static bool parse_traffic_options(int argc, char* argv[], int first, SSHTrafficMix& mix, std::string& directory)
+{
+    int scale = 1;
+    for (int i = first; i < argc; ++i) {
+        if (strncmp(argv[i], "--", 2) != 0 && directory.empty()) {
+            directory = argv[i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--hours") == 0) {
+            mix.hours = std::max(1, atoi(argv[++i]));
+        } else if (i + 1 < argc && strcmp(argv[i], "--scale") == 0) {
+            scale = std::max(1, atoi(argv[++i]));
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            mix.seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else {
+            LogError(std::string("Unknown option ") + argv[i]);
+            return false;
+        }
+    }
+    mix.scale(scale);
+    return true;
+}
+
+/**
+ * @brief Команда генерации синтетического трафика sshd с разметкой
+ * @param argc Количество аргументов
+ * @param argv <каталог> [--hours H] [--scale N] [--seed S]
+ */
+void cmd_gen_traffic(int argc, char* argv[])
+{
+    SSHTrafficMix mix;
+    std::string directory;
+    if (!parse_traffic_options(argc, argv, 2, mix, directory)) {
+        return;
+    }
+    if (directory.empty()) {
+        LogError("Usage: smssh gen-traffic <directory> [--hours H] [--scale N] [--seed S]");
+        return;
+    }
+
+    SSHTrafficGenerator generator(mix);
+    std::string error;
+    if (!generator.write(directory, error)) {
+        LogError(error);
+        return;
+    }
+
+    std::map<std::string, int> scenarios;
+    for (const auto& label : generator.labels()) {
+        scenarios[label.scenario]++;
+    }
+    std::cout << "Записано " << generator.lines().size() << " строк в " << directory << "/auth.log, учетных записей: "
+              << generator.accounts().size() << std::endl;
+    for (const auto& [scenario, count] : scenarios) {
+        std::cout << "  " << scenario << ": " << count << " адресов" << std::endl;
+    }
+    std::cout << "Разметка: " << directory << "/labels.tsv, passwd и group для smssh user и bench-traffic" << std::endl;
+}
+
+/**
+ * @brief Команда замера детектора на синтетическом трафике
+ *
+ * Первый проход - как parse-log: прием строк с опросом окон каждые 1000 строк;
+ * по нему считаются скорость приема, память и точность и полнота по типам
+ * оповещений. Второй проход вызывает analyze() каждые 5 минут времени
+ * событий и дает распределение задержки снимка (в первом проходе analyze()
+ * менял бы окна, которые закрывает pollAlerts).
+ * @param argc Количество аргументов
+ * @param argv [каталог gen-traffic] [--hours H] [--scale N] [--seed S]
+ */
+void cmd_bench_traffic(int argc, char* argv[])
+{
+    SSHTrafficMix mix;
+    std::string directory;
+    if (!parse_traffic_options(argc, argv, 2, mix, directory)) {
+        return;
+    }
+
+    std::vector<std::string> lines;
+    std::vector<SSHTrafficLabel> labels;
+    std::unique_ptr<UserDirectory> users;
+    if (!directory.empty()) {
+        bool readable = BulkReader::forEachLine(directory + "/auth.log", [&](std::string_view line) {
+            lines.emplace_back(line);
+            return true;
+        });
+        if (!readable || !SSHTrafficGenerator::readLabels(directory + "/labels.tsv", labels)) {
+            LogError("Cannot read " + directory + "/auth.log and labels.tsv (smssh gen-traffic)");
+            return;
+        }
+        users = std::make_unique<UserDirectory>(directory);
+    } else {
+        SSHTrafficGenerator generator(mix);
+        lines = generator.lines();
+        labels = generator.labels();
+
+        // Детектору нужны учетные записи трафика, а не системные
+        char temporary[] = "/tmp/smssh-traffic-XXXXXX";
+        if (!mkdtemp(temporary) || !SSHTrafficGenerator::writeAccounts(temporary, generator.accounts())) {
+            LogError("Cannot create temporary directory for passwd");
+            return;
+        }
+        users = std::make_unique<UserDirectory>(temporary);
+        std::error_code ec;
+        std::filesystem::remove_all(temporary, ec);
+    }
+
+    // Проход 1: прием и оповещения
+    std::vector<AttackAlert> alerts;
+    double ingest = 0;
+    double poll = 0;
+    size_t heap_state = 0;
+    DetectorStats stats;
+    {
+        SSHAttackDetector detector;
+        detector.setUserDirectory(users.get());
+
+        for (size_t i = 0; i < lines.size();) {
+            size_t batch = std::min(lines.size(), i + 1000);
+            auto start = std::chrono::steady_clock::now();
+            for (; i < batch; ++i) {
+                parse_ssh_log_line(lines[i], detector);
+            }
+            ingest += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            auto closed = detector.pollAlerts();
+            poll += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            alerts.insert(alerts.end(), closed.begin(), closed.end());
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto closed = detector.flushAlerts();
+        poll += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        alerts.insert(alerts.end(), closed.begin(), closed.end());
+
+        heap_state = heap_in_use();
+        stats = detector.getStats();
+    }
+    // Оповещения остаются, поэтому состояние - это то, что освободил детектор
+    heap_state -= std::min(heap_state, heap_in_use());
+
+    // Проход 2: снимок analyze() каждые 5 минут времени событий; заодно
+    // собираются адреса с неудачами по именам для оценки оповещений по многим адресам
+    std::vector<double> latencies;
+    std::map<std::string, std::set<std::string>> failed_by_user;
+    std::set<std::string> failed_ips;
+    {
+        SSHAttackDetector detector;
+        detector.setUserDirectory(users.get());
+
+        std::chrono::system_clock::time_point next_snapshot{};
+        for (const auto& line : lines) {
+            SshLogEvent event;
+            std::chrono::system_clock::time_point time;
+            if (!parseSshLogLine(line, event) || !parseSshTimestamp(event.timestamp, time)) {
+                continue;
+            }
+            detector.addLogEvent(event, time);
+            if ((event.type == SshEventType::Failed || event.type == SshEventType::InvalidUser) && !event.ip.empty()) {
+                failed_by_user[std::string(event.user)].emplace(event.ip);
+                failed_ips.emplace(event.ip);
+            }
+
+            if (next_snapshot == std::chrono::system_clock::time_point{}) {
+                next_snapshot = time + std::chrono::minutes(5);
+            } else if (time >= next_snapshot) {
+                auto start = std::chrono::steady_clock::now();
+                detector.analyze();
+                latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                next_snapshot += std::chrono::minutes(5) * ((time - next_snapshot) / std::chrono::minutes(5) + 1);
+            }
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double q) {
+        return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>(q * latencies.size()))];
+    };
+
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Строк: " << lines.size() << ", попыток: " << stats.attempts << ", адресов атак: " << labels.size()
+              << ", оповещений: " << alerts.size() << std::endl;
+    std::cout << "Прием: " << static_cast<uint64_t>(ingest > 0 ? lines.size() / ingest : 0) << " строк/с (разбор и addLogEvent), pollAlerts "
+              << poll * 1000 << " мс всего" << std::endl;
+    std::cout << "analyze(): p50 " << percentile(0.5) << " мс, p95 " << percentile(0.95) << " мс, p99 "
+              << percentile(0.99) << " мс, max " << (latencies.empty() ? 0.0 : latencies.back()) << " мс ("
+              << latencies.size() << " снимков)" << std::endl;
+    std::cout << "Память: состояние детектора в конце " << heap_state / 1048576.0 << " МБ, пик RSS "
+              << usage.ru_maxrss / 1024.0 << " МБ" << std::endl;
+
+    // Качество по типам оповещений: точность - доля адресов, которые
+    // действительно атаковали (любым сценарием), полнота - доля адресов своего
+    // сценария, на которые детектор ответил. Оповещение без адреса (password_spray)
+    // засчитывается адресам с неудачами по его имени, оповещение по сети
+    // (distributed_dictionary) - адресам сети с неудачами; failure_spike
+    // адресов не называет и только считается
+    std::map<std::string, std::string> scenario_of;
+    std::map<std::string, std::set<std::string>> expected;
+    for (const auto& label : labels) {
+        if (label.attempts > 0) {
+            scenario_of[label.ip] = label.scenario;
+            expected[SSHTrafficGenerator::expectedAlert(label.scenario)].insert(label.ip);
+        }
+    }
+    std::map<std::string, std::set<std::string>> flagged;
+    std::map<std::string, size_t> alert_counts;
+    for (const auto& alert : alerts) {
+        auto& ips = flagged[alert.type];
+        alert_counts[alert.type]++;
+
+        IpPrefix network;
+        if (alert.ip.empty()) {
+            auto failed = failed_by_user.find(alert.username);
+            if (!alert.username.empty() && failed != failed_by_user.end()) {
+                ips.insert(failed->second.begin(), failed->second.end());
+            }
+        } else if (alert.ip.find('/') != std::string::npos && IpPrefix::parse(alert.ip, network)) {
+            for (const auto& ip : failed_ips) {
+                IpAddress address;
+                if (IpAddress::parse(ip, address) && network.contains(address)) {
+                    ips.insert(ip);
+                }
+            }
+        } else {
+            ips.insert(alert.ip);
+        }
+    }
+    for (const auto& [type, ips] : expected) {
+        flagged[type];
+    }
+
+    // setw считает байты, а заголовки по-русски: выравнивание по числу символов
+    auto column = [](const std::string& text, size_t width, bool left) {
+        size_t chars = std::count_if(text.begin(), text.end(), [](char c) { return (c & 0xC0) != 0x80; });
+        std::string padding(chars < width ? width - chars : 0, ' ');
+        return left ? text + padding : padding + text;
+    };
+    std::cout << std::endl << column("детектор", 20, true) << column("оповещений", 12, false) << column("адресов", 10, false)
+              << column("точность", 11, false) << column("полнота", 10, false) << "  ложные" << std::endl;
+    for (const auto& [type, ips] : flagged) {
+        size_t attackers = 0;
+        size_t found = 0;
+        std::vector<std::string> false_positives;
+        for (const auto& ip : ips) {
+            if (scenario_of.count(ip)) {
+                attackers++;
+            } else if (false_positives.size() < 3) {
+                false_positives.push_back(ip);
+            }
+        }
+        auto target = expected.find(type);
+        if (target != expected.end()) {
+            for (const auto& ip : target->second) {
+                found += ips.count(ip);
+            }
+        }
+
+        std::ostringstream precision;
+        std::ostringstream recall;
+        precision << std::fixed << std::setprecision(1);
+        recall << std::fixed << std::setprecision(1);
+        if (ips.empty()) {
+            precision << "-";
+        } else {
+            precision << 100.0 * attackers / ips.size() << "%";
+        }
+        if (target == expected.end()) {
+            recall << "-";
+        } else {
+            recall << 100.0 * found / target->second.size() << "%";
+        }
+
+        std::cout << std::left << std::setw(20) << type << std::right << std::setw(12) << alert_counts[type]
+                  << std::setw(10) << ips.size() << std::setw(11) << precision.str() << std::setw(10) << recall.str();
+        for (size_t i = 0; i < false_positives.size(); ++i) {
+            std::cout << (i ? ", " : "  ") << false_positives[i];
+        }
+        std::cout << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+/**
+ * @brief Show how the detector sees a local account
+ * @param name Username
+ * @param directory Directory with passwd, group and shadow
+ */
+void cmd_user(const std::string& name, const std::string& directory)
+{
+    UserDirectory users(directory);
+    auto snapshot = users.snapshot();
+    const UserAccount* account = snapshot->find(name);
+    if (!account) {
+        std::cout << name << ": не существует (попытки входа считаются атакой на несуществующего пользователя)" << std::endl;
+        return;
+    }
+
+    std::cout << name << ": uid " << account->uid << ", gid " << account->gid
+              << (snapshot->isSuperuser(name) ? ", суперпользователь" : "")
+              << (account->admin ? ", администратор" : "")
+              << (account->locked ? ", заблокирован" : "") << std::endl;
+}
+
+/**
+ * @brief Build or query a compiled IP list file
+ * @param argc Argument count
+ * @param argv build <out> <block|allow>:<name>:<feed>... | check <file> <ip>...
+ */
+void cmd_iplist(int argc, char* argv[])
+{
+    if (argc >= 5 && strcmp(argv[2], "build") == 0) {
+        PrefixMatcher matcher;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 4; i < argc; ++i) {
+            std::string spec = argv[i];
+            size_t first = spec.find(':');
+            size_t second = first == std::string::npos ? std::string::npos : spec.find(':', first + 1);
+            std::string kind = spec.substr(0, first);
+            if (second == std::string::npos || (kind != "block" && kind != "allow")) {
+                LogError("Invalid list " + spec + ", expected block:<name>:<feed> or allow:<name>:<feed>");
+                return;
+            }
+            std::string name = spec.substr(first + 1, second - first - 1);
+            std::string feed = spec.substr(second + 1);
+            uint16_t list = matcher.addList(name, kind == "allow" ? PrefixMatcher::Kind::Allow : PrefixMatcher::Kind::Block);
+            size_t skipped = 0;
+            long added = matcher.loadFeed(list, feed, &skipped);
+            if (added < 0) {
+                LogError("Cannot read feed " + feed);
+                return;
+            }
+            std::cout << name << ": " << added << " префиксов из " << feed;
+            if (skipped > 0) {
+                std::cout << " (" << skipped << " строк не разобрано)";
+            }
+            std::cout << std::endl;
+        }
+        matcher.build();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!matcher.save(argv[3])) {
+            LogError(std::string("Cannot write ") + argv[3]);
+            return;
+        }
+        std::cout << std::fixed << std::setprecision(2) << "Собрано за " << seconds << " с: "
+                  << matcher.nodeCount() << " узлов, " << matcher.leafCount() << " листьев, "
+                  << matcher.memoryUsage() / 1024 << " КБ" << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        return;
+    }
+
+    if (argc >= 5 && strcmp(argv[2], "check") == 0) {
+        PrefixMatcher matcher;
+        if (!matcher.open(argv[3])) {
+            LogError(std::string("Cannot open IP lists ") + argv[3]);
+            return;
+        }
+        for (int i = 4; i < argc; ++i) {
+            const PrefixMatcher::List* list = matcher.match(std::string_view(argv[i]));
+            std::cout << argv[i] << ": ";
+            if (!list) {
+                std::cout << "нет в списках" << std::endl;
+            } else {
+                std::cout << list->name << (list->kind == PrefixMatcher::Kind::Allow ? " (доверенная сеть)" : " (атакующая сеть)") << std::endl;
+            }
+        }
+        return;
+    }
+
+    LogError("Usage: smssh iplist build <out> <block|allow>:<name>:<feed>... | smssh iplist check <file> <ip>...");
+}
+
+/**
+ * @brief Проверка каталога sshd_config, собранных с парка хостов
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_audit_dir(int argc, char* argv[])
+{
+    std::string json_path;
+    unsigned threads = 0;
+    size_t top = 10;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threads = static_cast<unsigned>(std::max(0, atoi(argv[i + 1])));
+        } else if (strcmp(argv[i], "--top") == 0) {
+            top = static_cast<size_t>(std::max(0, atoi(argv[i + 1])));
+        } else {
+            LogError(std::string("Unknown option ") + argv[i]);
+            return;
+        }
+    }
+
+    ConfigAudit audit(threads);
+    ConfigAuditReport report;
+    if (!audit.auditDirectory(argv[2], report)) {
+        LogError(std::string("Cannot open directory ") + argv[2]);
+        return;
+    }
+
+    // "--json -": только JSON строки в stdout, для конвейеров
+    if (json_path == "-") {
+        report.writeJsonLines(std::cout);
+        return;
+    }
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        if (!out.is_open()) {
+            LogError("Cannot write " + json_path);
+            return;
+        }
+        report.writeJsonLines(out);
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Проверено хостов: " << report.hosts.size() << " (уникальных конфигураций: " << report.uniqueConfigs()
+              << ", не прочитано: " << report.failed << ") за " << report.seconds << " с" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+
+    if (!report.issues.empty()) {
+        std::cout << "Проблемы по числу хостов:" << std::endl;
+        for (const auto& issue : report.issues) {
+            std::cout << "  [" << issue.severity << "] " << issue.key << ": " << issue.hosts << " хостов - "
+                      << issue.description << std::endl;
+        }
+    }
+
+    auto worst = report.worstHosts(top);
+    if (!worst.empty()) {
+        std::cout << "Худшие хосты:" << std::endl;
+        for (const HostAudit* host : worst) {
+            std::cout << "  " << host->host << ": " << host->score << " (";
+            const auto& issues = report.issues_by_config[host->config];
+            for (size_t i = 0; i < issues.size(); ++i) {
+                std::cout << (i ? ", " : "") << issues[i].key;
+            }
+            std::cout << ")" << std::endl;
+        }
+    }
+
+    for (const HostAudit& host : report.hosts) {
+        if (!host.error.empty()) {
+            LogWarning("Cannot read " + host.path + ": " + host.error);
+        }
+    }
+}
+
+/**
+ * @brief Пользователи из passwd со всеми группами из каталога пользователей
+ * @param directory Каталог с passwd и group
+ */
+std::vector<SSHMatchContext> load_local_users(const std::string& directory)
+{
+    UserDirectory directory_users(directory);
+    auto snapshot = directory_users.snapshot();
+
+    std::vector<SSHMatchContext> users;
+    users.reserve(snapshot->size());
+    for (size_t i = 0; i < snapshot->size(); ++i) {
+        SSHMatchContext user;
+        user.user = std::string(snapshot->name(i));
+        for (std::string_view group : snapshot->groups(user.user)) {
+            user.groups.emplace_back(group);
+        }
+        users.push_back(std::move(user));
+    }
+    return users;
+}
+
+/**
+ * @brief Показать действующие настройки sshd для одного подключения
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_effective(int argc, char* argv[])
+{
+    SSHMatchContext connection;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        bool parsed = true;
+        if (option == "--user") {
+            connection.user = argv[i + 1];
+        } else if (option == "--group") {
+            connection.groups.push_back(argv[i + 1]);
+        } else if (option == "--host") {
+            connection.host = argv[i + 1];
+        } else if (option == "--addr") {
+            parsed = IpAddress::parse(argv[i + 1], connection.address);
+        } else if (option == "--laddr") {
+            parsed = IpAddress::parse(argv[i + 1], connection.local_address);
+        } else if (option == "--lport") {
+            connection.local_port = atoi(argv[i + 1]);
+        } else {
+            LogError("Unknown option " + option);
+            return;
+        }
+        if (!parsed) {
+            LogError(std::string("Invalid address ") + argv[i + 1]);
+            return;
+        }
+    }
+
+    SSHConfigResolver resolver;
+    if (!resolver.load(argv[2])) {
+        LogError(std::string("Cannot read ") + argv[2]);
+        return;
+    }
+    for (const auto& error : resolver.errors()) {
+        LogWarning(error);
+    }
+
+    SSHEffectiveConfig config = resolver.resolve(connection);
+    std::cout << "Файлов: " << resolver.files().size() << ", блоков Match: " << resolver.blockCount()
+              << ", подошли: " << config.blocks.size() << std::endl;
+    for (int block : config.blocks) {
+        std::cout << "  " << resolver.blockText(block) << std::endl;
+    }
+    for (const auto& [key, value] : config.settings) {
+        const SSHDirective* source = config.sources[key];
+        std::cout << key << " " << value << "  (" << source->file << ":" << source->line << ")" << std::endl;
+    }
+}
+
+/**
+ * @brief Проверить все сочетания локальных пользователей и сетей на ослабления в блоках Match
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ */
+void cmd_overrides(int argc, char* argv[])
+{
+    std::string users_directory = "/etc";
+    std::vector<IpPrefix> networks;
+    int local_port = 22;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--users") {
+            users_directory = argv[i + 1];
+        } else if (option == "--addr") {
+            IpPrefix network;
+            if (!IpPrefix::parse(argv[i + 1], network)) {
+                LogError(std::string("Invalid network ") + argv[i + 1]);
+                return;
+            }
+            networks.push_back(network);
+        } else if (option == "--lport") {
+            local_port = atoi(argv[i + 1]);
+        } else {
+            LogError("Unknown option " + option);
+            return;
+        }
+    }
+    if (networks.empty()) {
+        networks.resize(2);
+        IpPrefix::parse("0.0.0.0/0", networks[0]);
+        IpPrefix::parse("::/0", networks[1]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SSHConfigResolver resolver;
+    if (!resolver.load(argv[2])) {
+        LogError(std::string("Cannot read ") + argv[2]);
+        return;
+    }
+    for (const auto& error : resolver.errors()) {
+        LogWarning(error);
+    }
+
+    std::vector<SSHMatchContext> users = load_local_users(users_directory);
+    if (users.empty()) {
+        LogError("No users in " + users_directory + "/passwd");
+        return;
+    }
 
-    if (std::regex_search(line, match, failed_password_regex)) {
-        // Неудачная попытка пароля
-        username = match[3].str();
-        ip = match[4].str();
-        port = std::stoi(match[5].str());
-        success = false;
-    } else if (std::regex_search(line, match, accepted_password_regex) ||
-               std::regex_search(line, match, accepted_pubkey_regex)) {
-        // Успешная аутентификация
-        username = match[2].str();
-        ip = match[3].str();
-        port = std::stoi(match[4].str());
-        success = true;
-    } else if (std::regex_search(line, match, invalid_user_regex)) {
-        // Попытка с недействительным пользователем
-        username = match[2].str();
-        ip = match[3].str();
-        port = std::stoi(match[4].str());
-        success = false;
+    // Внутри сети условия Match Address меняются только на границах сетей из
+    // условий, поэтому хватает по адресу на каждый такой участок
+    std::vector<IpAddress> addresses;
+    for (const IpPrefix& network : networks) {
+        for (const IpAddress& address : resolver.representativeAddresses(network)) {
+            addresses.push_back(address);
+        }
     }
+    for (SSHMatchContext& user : users) {
+        user.local_port = local_port;
+    }
+
+    auto overrides = resolver.findWeakenedOverrides(users, addresses);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::fixed << std::setprecision(3)
+              << "Блоков Match: " << resolver.blockCount() << ", проверено подключений: " << users.size() * addresses.size()
+              << " (" << users.size() << " пользователей) за " << seconds << " с" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
 
-    if (!username.empty() && !ip.empty()) {
-        detector.addConnectionAttempt(ip, username, success, port);
+    if (overrides.empty()) {
+        std::cout << "Блоки Match не ослабляют защиту" << std::endl;
+        return;
+    }
+    std::cout << "Ослабления в блоках Match:" << std::endl;
+    for (const auto& weakened : overrides) {
+        const SSHDirective* directive = weakened.directive;
+        std::cout << "  [" << weakened.issue.severity << "] " << weakened.issue.key << " " << weakened.issue.current_value
+                  << " (глобально " << weakened.global_value << ") - " << directive->file << ":" << directive->line
+                  << " " << resolver.blockText(directive->block) << std::endl;
+        std::cout << "    пользователи:";
+        for (size_t i = 0; i < weakened.users.size(); ++i) {
+            std::cout << (i ? ", " : " ") << weakened.users[i];
+        }
+        std::cout << "; адреса:";
+        for (size_t i = 0; i < weakened.addresses.size(); ++i) {
+            std::cout << (i ? ", " : " ") << weakened.addresses[i];
+        }
+        std::cout << std::endl;
     }
 }
 
@@ -571,18 +1809,82 @@ int main(int argc, char* argv[])
     }
 
     if (argc >= 2 && strcmp(argv[1], "monitor") == 0) {
-        cmd_monitor();
+        bool once = argc >= 3 && strcmp(argv[argc - 1], "--once") == 0;
+        int args = argc - (once ? 1 : 0);
+        cmd_monitor(args >= 3 ? argv[2] : "", once);
         return 0;
     }
 
     if (argc >= 3 && strcmp(argv[1], "parse-log") == 0) {
-        cmd_parse_log(argv[2]);
+        unsigned threads = 0;
+        unsigned shards = 0;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--threads") == 0) {
+                threads = static_cast<unsigned>(std::max(0, atoi(argv[i + 1])));
+            } else if (strcmp(argv[i], "--shards") == 0) {
+                shards = static_cast<unsigned>(std::max(0, atoi(argv[i + 1])));
+            }
+        }
+        cmd_parse_log(argv[2], threads, shards);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "bench-parse") == 0) {
+        int iterations = (argc >= 4) ? atoi(argv[3]) : 0;
+        cmd_bench_parse(argv[2], iterations);
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "bench-detector") == 0) {
+        int attempts = (argc >= 3) ? atoi(argv[2]) : 0;
+        int ips = (argc >= 4) ? atoi(argv[3]) : 0;
+        int threads = (argc >= 5) ? atoi(argv[4]) : 0;
+        cmd_bench_detector(attempts, ips, threads);
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "gen-traffic") == 0) {
+        cmd_gen_traffic(argc, argv);
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "bench-traffic") == 0) {
+        cmd_bench_traffic(argc, argv);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "user") == 0) {
+        cmd_user(argv[2], argc >= 4 ? argv[3] : "/etc");
+        return 0;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "iplist") == 0) {
+        cmd_iplist(argc, argv);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "audit-dir") == 0) {
+        cmd_audit_dir(argc, argv);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "effective") == 0) {
+        cmd_effective(argc, argv);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "overrides") == 0) {
+        cmd_overrides(argc, argv);
         return 0;
     }
 
     if (argc >= 2 && strcmp(argv[1], "gen-key") == 0) {
-        std::string key_name = (argc >= 3) ? argv[2] : "id_rsa";
-        cmd_gen_key(key_name);
+        cmd_gen_key(argc, argv);
+        return 0;
+    }
+
+    if (argc >= 4 && strcmp(argv[1], "gen-keys") == 0) {
+        cmd_gen_keys(argc, argv);
         return 0;
     }
 
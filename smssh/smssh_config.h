@@ -42,6 +42,22 @@ private:
         config_["telegram_chat_id"] = "";
         config_["enable_system_notify"] = "true";
         config_["monitor_port"] = "22";
+        config_["alert_quiet_minutes"] = "30";
+        config_["alert_renotify_minutes"] = "60";
+        config_["state_file"] = "/var/lib/smssh/monitor.state";
+        config_["state_interval_seconds"] = "30";
+        config_["ban_backend"] = "off";
+        config_["ban_seconds"] = "3600";
+        config_["ban_min_severity"] = "high";
+        config_["ban_types"] = "brute_force,dictionary_attack,nonexistent_user,password_spray";
+        config_["ban_aggregate_threshold"] = "8";
+        config_["ban_allow"] = "";
+        config_["ip_lists_file"] = "";
+        config_["spray_window_hours"] = "24";
+        config_["spray_min_sources"] = "10";
+        config_["spray_network_min_usernames"] = "20";
+        config_["failure_spike_factor"] = "5";
+        config_["failure_spike_min_per_minute"] = "30";
     }
     
 public:
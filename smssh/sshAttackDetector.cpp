@@ -6,8 +6,15 @@
  */
 
 #include "sshAttackDetector.h"
+#include "smssh_config.h"
 #include "../logger/logger.h"
+#include "../geoip/geoip.h"
+#include "../userdir/userdir.h"
+#include "../iplist/iplist.h"
+#include "detectorState.h"
+#include "parallelFor.h"
 #include <algorithm>
+#include <tuple>
 #include <regex>
 #include <fstream>
 #include <sstream>
@@ -18,15 +25,22 @@
 #include <chrono>
 #include <thread>
 #include <mutex>
-#include <maxminddb.h> // Для базы данных MaxMind GeoIP
 #include <unistd.h> // Для access()
 
-SSHAttackDetector::SSHAttackDetector() {
+SSHAttackDetector::SSHAttackDetector(size_t shards) : users_(&UserDirectory::instance()) {
+    if (shards == 0) {
+        shards = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+    workers_ = std::make_unique<WorkerPool>(shards - 1);
+
     brute_force_threshold_ = 5;
     brute_force_window_minutes_ = 10;
     standard_ports_ = {22};
+    setSprayWindow(spray_window_hours_);
 
-    loadExistingUsers();
     normal_countries_ = {"US", "GB", "DE", "FR", "CA", "AU", "JP", "NL"}; // список стран, считающихся нормальными для соединений
     common_usernames_ = {
         "admin", "administrator", "root", "user", "guest", "test",
@@ -36,1142 +50,2138 @@ SSHAttackDetector::SSHAttackDetector() {
     };
 }
 
-SSHAttackDetector::~SSHAttackDetector() {
-    // Очистить ресурсы базы данных GeoIP
-    cleanupGeoIP();
-}
+SSHAttackDetector::~SSHAttackDetector() = default;
 
-// Статическая функция для очистки ресурсов GeoIP
-void SSHAttackDetector::cleanupGeoIP() {
-    static MMDB_s* mmdb = nullptr;
-    static bool initialized = false;
+void SSHAttackDetector::setUserDirectory(UserDirectory* users) {
+    users_ = users;
+}
 
-    if (initialized && mmdb) {
-        MMDB_close(mmdb);
-        free(mmdb);
-        mmdb = nullptr;
-        initialized = false;
-    }
+void SSHAttackDetector::watchUserDirectory() {
+    // Пользователи, созданные после запуска, появляются в каталоге без перезапуска
+    users_->watch();
 }
 
 bool SSHAttackDetector::loadConfig(const std::string& config_path) {
-    // Загрузить конфигурацию из файла
+    // Загрузить конфигурацию из файла (SSHConfigManager создает недостающий
+    // файл, поэтому без существующего файла остаются значения по умолчанию)
+    if (config_path.empty() || access(config_path.c_str(), R_OK) != 0) {
+        return false;
+    }
+
+    SSHConfigManager config(config_path);
+    setBruteForceThreshold(config.getInt("brute_force_threshold", brute_force_threshold_),
+                           config.getInt("brute_force_window_minutes", brute_force_window_minutes_));
+
+    // Подавление повторов: общее и для отдельных типов (alert_renotify_minutes.brute_force = 15)
+    auto minutes = [&](const std::string& key, std::chrono::seconds fallback) {
+        int value = config.getInt(key, -1);
+        return value >= 0 ? std::chrono::seconds(value * 60) : fallback;
+    };
+    default_alert_policy_.quiet = minutes("alert_quiet_minutes", default_alert_policy_.quiet);
+    default_alert_policy_.renotify = minutes("alert_renotify_minutes", default_alert_policy_.renotify);
+
+    // Распределенные атаки
+    setSprayWindow(std::max(1, config.getInt("spray_window_hours", spray_window_hours_)));
+    spray_min_sources_ = config.getInt("spray_min_sources", spray_min_sources_);
+    spray_network_min_usernames_ = config.getInt("spray_network_min_usernames", spray_network_min_usernames_);
+    failure_spike_factor_ = config.getInt("failure_spike_factor", failure_spike_factor_);
+    failure_spike_min_per_minute_ = config.getInt("failure_spike_min_per_minute", failure_spike_min_per_minute_);
+
+    std::string ip_lists = config.get("ip_lists_file");
+    if (!ip_lists.empty() && ip_lists != "off") {
+        IpListService::instance().open(ip_lists);
+    }
+
+    for (const char* type : {"brute_force", "dictionary_attack", "geo_ip_anomaly", "time_anomaly",
+                             "nonexistent_user", "root_attack", "non_standard_port", "post_login_anomaly",
+                             "password_spray", "distributed_dictionary", "failure_spike"}) {
+        std::string quiet_key = std::string("alert_quiet_minutes.") + type;
+        std::string renotify_key = std::string("alert_renotify_minutes.") + type;
+        if (config.get(quiet_key).empty() && config.get(renotify_key).empty()) {
+            continue;
+        }
+        // Незаданное значение - собственное по типу (у распределенных атак - окно) или общее
+        auto own = alert_policies_.find(type);
+        AlertPolicy fallback = own != alert_policies_.end() ? own->second : default_alert_policy_;
+        AlertPolicy& policy = alert_policies_[type];
+        policy.quiet = minutes(quiet_key, fallback.quiet);
+        policy.renotify = minutes(renotify_key, fallback.renotify);
+    }
     return true;
 }
 
+void SSHAttackDetector::setSprayWindow(int hours) {
+    // Имя или сеть задеваются реже, чем раз в полчаса, поэтому тишина и
+    // напоминание для распределенных атак - окно, а не общие 30 и 60 минут
+    spray_window_hours_ = hours;
+    for (const char* type : {"password_spray", "distributed_dictionary"}) {
+        alert_policies_[type] = AlertPolicy{std::chrono::hours(hours), std::chrono::hours(hours)};
+    }
+}
+
 void SSHAttackDetector::setBruteForceThreshold(int attempts, int window_minutes) {
     brute_force_threshold_ = attempts;
     brute_force_window_minutes_ = window_minutes;
 }
 
+SSHAttackDetector::IpCounters& SSHAttackDetector::IpCounters::operator+=(const IpCounters& other) {
+    attempts += other.attempts;
+    failed += other.failed;
+    success += other.success;
+    off_hours += other.off_hours;
+    off_hours_failed += other.off_hours_failed;
+    off_hours_success += other.off_hours_success;
+    root_failed += other.root_failed;
+    root_success += other.root_success;
+    root_off_hours += other.root_off_hours;
+    root_rapid += other.root_rapid;
+    common_attempts += other.common_attempts;
+    common_failed += other.common_failed;
+    common_sequential += other.common_sequential;
+    nonstandard_port += other.nonstandard_port;
+    short_sessions += other.short_sessions;
+    return *this;
+}
+
+SSHAttackDetector::IpCounters& SSHAttackDetector::IpCounters::operator-=(const IpCounters& other) {
+    attempts -= other.attempts;
+    failed -= other.failed;
+    success -= other.success;
+    off_hours -= other.off_hours;
+    off_hours_failed -= other.off_hours_failed;
+    off_hours_success -= other.off_hours_success;
+    root_failed -= other.root_failed;
+    root_success -= other.root_success;
+    root_off_hours -= other.root_off_hours;
+    root_rapid -= other.root_rapid;
+    common_attempts -= other.common_attempts;
+    common_failed -= other.common_failed;
+    common_sequential -= other.common_sequential;
+    nonstandard_port -= other.nonstandard_port;
+    short_sessions -= other.short_sessions;
+    return *this;
+}
+
+SSHAttackDetector::PairCounters& SSHAttackDetector::PairCounters::operator+=(const PairCounters& other) {
+    attempts += other.attempts;
+    failed += other.failed;
+    success += other.success;
+    return *this;
+}
+
+SSHAttackDetector::PairCounters& SSHAttackDetector::PairCounters::operator-=(const PairCounters& other) {
+    attempts -= other.attempts;
+    failed -= other.failed;
+    success -= other.success;
+    return *this;
+}
+
+static int64_t minute_of(std::chrono::system_clock::time_point time) {
+    return std::chrono::floor<std::chrono::minutes>(time.time_since_epoch()).count();
+}
+
+static int64_t second_of(std::chrono::system_clock::time_point time) {
+    return std::chrono::floor<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+// Распределенные атаки: корзин в окне, попыток адреса по имени за час, после
+// которых это перебор, а не распыление, и периоды полураспада темпа неудач
+static constexpr int64_t kSprayBuckets = 6;
+static constexpr int kSprayPairLimit = 3;
+static constexpr double kSpikeShortHalfLife = 5 * 60;
+static constexpr double kSpikeLongHalfLife = 6 * 60 * 60;
+
 void SSHAttackDetector::addConnectionAttempt(const std::string& ip, const std::string& username,
                                            bool success, int port) {
-    std::lock_guard<std::mutex> lock(attempts_mutex_);
-
-    ConnectionAttempt attempt;
-    attempt.ip = ip;
-    attempt.username = username;
-    attempt.success = success;
-    attempt.port = port;
-    attempt.timestamp = std::chrono::system_clock::now();
+    addConnectionAttempt(ip, username, success, port, std::chrono::system_clock::now());
+}
 
-    recent_attempts_.push_back(attempt);
+void SSHAttackDetector::addConnectionAttempt(const std::string& ip, const std::string& username,
+                                           bool success, int port,
+                                           std::chrono::system_clock::time_point event_time) {
+    IpAddress address;
+    if (IpAddress::parse(ip, address)) {
+        addConnectionAttempt(address, username, success, port, event_time);
+        return;
+    }
 
-    // Ограничить размер списка недавних попыток
-    if (recent_attempts_.size() > 10000) {
-        recent_attempts_.erase(recent_attempts_.begin(),
-                             recent_attempts_.begin() + 1000);
+    // Не адрес (имя хоста при UseDNS) - шард и номер по тексту
+    Shard& shard = shardFor(ip);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (event_time <= shard.closed_until) {
+        shard.late_attempts++;
+        return;
     }
+    appendAttempt(shard, shard.addresses.acquire(ip), username, success, port, event_time);
 }
 
-std::vector<AttackAlert> SSHAttackDetector::analyze() {
-    std::lock_guard<std::mutex> lock(attempts_mutex_);
+void SSHAttackDetector::addConnectionAttempt(const IpAddress& ip, std::string_view username,
+                                           bool success, int port,
+                                           std::chrono::system_clock::time_point event_time) {
+    // Шард выбирается по двоичному адресу: разные записи одного адреса
+    // (регистр, ::ffff:) попадают в один шард
+    Shard& shard = shardFor(ip);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // Окно с этой меткой уже посчитано - событие опоздало сильнее допустимого
+    if (event_time <= shard.closed_until) {
+        shard.late_attempts++;
+        return;
+    }
+    appendAttempt(shard, shard.addresses.acquire(ip), username, success, port, event_time);
+}
 
-    std::vector<AttackAlert> alerts;
+void SSHAttackDetector::appendAttempt(Shard& shard, uint32_t ip_id, std::string_view username, bool success,
+                                      int port, std::chrono::system_clock::time_point event_time) {
+    // До закрытия окна попытка ждет в буфере: в счетчики они попадают строго по времени.
+    // Адрес и имя хранятся в шарде один раз, в буфере только их номера
+    uint32_t user_id = shard.usernames.acquire(username);
+    bool standard_port = standard_ports_.find(port) != standard_ports_.end();
+    shard.pending.append(ip_id, user_id, event_time, static_cast<uint16_t>(port), success, standard_port);
+    shard.attempts++;
+    shard.max_event_time = std::max(shard.max_event_time, event_time);
+}
 
-    // Получить недавние попытки за последний час
-    auto now = std::chrono::system_clock::now();
-    auto one_hour_ago = now - std::chrono::hours(1);
+void SSHAttackDetector::addLogEvent(const SshLogEvent& event) {
+    // Часы машины сдвинули бы watermark при разборе истории в сегодня, и все
+    // дальнейшие строки оказались бы опоздавшими
+    std::chrono::system_clock::time_point event_time;
+    if (!parseSshTimestamp(event.timestamp, event_time)) {
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            untimed_events_++;
+            event_time = last_event_time_;
+        }
+        if (event_time == std::chrono::system_clock::time_point{}) {
+            return;
+        }
+    }
+    addLogEvent(event, event_time);
+}
 
-    std::vector<ConnectionAttempt> recent;
-    for (const auto& attempt : recent_attempts_) {
-        if (attempt.timestamp > one_hour_ago) {
-            recent.push_back(attempt);
+void SSHAttackDetector::addLogEvent(const SshLogEvent& event, std::chrono::system_clock::time_point event_time) {
+    std::string pid(event.pid);
+    bool already_failed = false;
+    bool announced = false;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        last_event_time_ = event_time;
+        already_failed = !pid.empty() && failed_sessions_.count(pid) > 0;
+
+        // Сообщения о неудаче и о закрытии одной сессии не должны считаться дважды
+        switch (event.type) {
+        case SshEventType::Failed:
+        case SshEventType::InvalidUser:
+            if (!pid.empty()) {
+                if (failed_sessions_.size() > 10000) {
+                    failed_sessions_.clear();
+                    invalid_sessions_.clear();
+                }
+                failed_sessions_.insert(pid);
+                // "Invalid user X" и следующий за ним "Failed password for invalid user X" -
+                // одна попытка; последующие пароли той же сессии считаются
+                if (event.type == SshEventType::InvalidUser) {
+                    invalid_sessions_.insert(pid);
+                } else {
+                    announced = invalid_sessions_.erase(pid) > 0;
+                }
+            }
+            break;
+        case SshEventType::Accepted:
+        case SshEventType::ConnectionClosed:
+        case SshEventType::Disconnected:
+            failed_sessions_.erase(pid);
+            invalid_sessions_.erase(pid);
+            break;
+        default:
+            break;
         }
     }
 
-    if (recent.empty()) {
-        return alerts;
+    bool record = false;
+    switch (event.type) {
+    case SshEventType::Accepted:
+    case SshEventType::InvalidUser:
+        record = true;
+        break;
+    case SshEventType::Failed:
+        record = !announced;
+        break;
+    case SshEventType::MaxAuthExceeded:
+        record = !already_failed;
+        break;
+    case SshEventType::ConnectionClosed:
+    case SshEventType::Disconnected:
+        // Оборванная аутентификация известного пользователя (перебор ключей и т.п.)
+        record = event.preauth && !event.user.empty() && !already_failed;
+        break;
+    default:
+        // PAM дублирует "Failed password", а у сканеров нет имени пользователя
+        break;
     }
 
-    // Проверить на различные типы атак
-    auto brute_force_alerts = detectBruteForce(recent);
-    alerts.insert(alerts.end(), brute_force_alerts.begin(), brute_force_alerts.end());
+    if (!record) {
+        return;
+    }
 
-    auto dict_alerts = detectDictionaryAttack(recent);
-    alerts.insert(alerts.end(), dict_alerts.begin(), dict_alerts.end());
+    int port = event.port > 0 ? event.port : 22;
+    for (int i = 0; i < event.repeats; ++i) {
+        if (event.has_address) {
+            addConnectionAttempt(event.address, event.user, event.success(), port, event_time);
+        } else {
+            addConnectionAttempt(std::string(event.ip), std::string(event.user), event.success(), port, event_time);
+        }
+    }
+}
 
-    auto geo_alerts = detectGeoIPAnomalies(recent);
-    alerts.insert(alerts.end(), geo_alerts.begin(), geo_alerts.end());
+// Порядок оповещений не должен зависеть от числа шардов (по умолчанию - ядер):
+// время окна (последней попытки), адрес, тип, пользователь. Оповещения одного
+// адреса с равным ключом (по порту) строит один шард, их порядок сохраняется
+static void sort_alerts(std::vector<AttackAlert>& alerts) {
+    std::stable_sort(alerts.begin(), alerts.end(), [](const AttackAlert& a, const AttackAlert& b) {
+        return std::tie(a.timestamp, a.ip, a.type, a.username) < std::tie(b.timestamp, b.ip, b.type, b.username);
+    });
+}
 
-    auto time_alerts = detectTimeAnomalies(recent);
-    alerts.insert(alerts.end(), time_alerts.begin(), time_alerts.end());
+std::vector<AttackAlert> SSHAttackDetector::analyze() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    refreshWatermark();
+
+    // Снимок на watermark без подавления повторов: все адреса с попытками в окне
+    auto now = currentTime();
+    std::vector<std::vector<AttackAlert>> shard_alerts(shards_.size());
+    forEachShard([&](Shard& shard, size_t index) {
+        std::lock_guard<std::mutex> shard_lock(shard.mutex);
+        ingestUntil(shard, now);
+        expireUntil(shard, now);
+        evaluateShard(shard, false, shard_alerts[index]);
+    });
 
-    auto user_alerts = detectNonExistentUsers(recent);
-    alerts.insert(alerts.end(), user_alerts.begin(), user_alerts.end());
+    std::vector<AttackAlert> alerts;
+    for (auto& part : shard_alerts) {
+        std::move(part.begin(), part.end(), std::back_inserter(alerts));
+    }
+    mergeShardSummaries(alerts);
+    detectDistributedAttacks(now, false, true, alerts);
+    sort_alerts(alerts);
+    return alerts;
+}
 
-    auto root_alerts = detectRootAttempts(recent);
-    alerts.insert(alerts.end(), root_alerts.begin(), root_alerts.end());
+std::chrono::system_clock::time_point SSHAttackDetector::currentTime() const {
+    if (!has_events_) {
+        return std::chrono::system_clock::now();
+    }
+    return watermark_;
+}
 
-    auto port_alerts = detectNonStandardPorts(recent);
-    alerts.insert(alerts.end(), port_alerts.begin(), port_alerts.end());
+SSHAttackDetector::Shard& SSHAttackDetector::shardFor(const IpAddress& ip) {
+    return *shards_[ip.hash() % shards_.size()];
+}
 
-    auto post_login_alerts = detectPostLoginAnomalies(recent);
-    alerts.insert(alerts.end(), post_login_alerts.begin(), post_login_alerts.end());
+SSHAttackDetector::Shard& SSHAttackDetector::shardFor(std::string_view ip) {
+    // Не адрес (имя хоста при UseDNS) - по хэшу текста
+    IpAddress address;
+    if (IpAddress::parse(ip, address)) {
+        return shardFor(address);
+    }
+    return *shards_[std::hash<std::string_view>{}(ip) % shards_.size()];
+}
 
-    return alerts;
+template <typename Function>
+void SSHAttackDetector::forEachShard(Function&& function) {
+    // Проход идет при каждом закрытии окна, поэтому потоки постоянные
+    workers_->run(shards_.size(), [&](size_t i) { function(*shards_[i], i); });
 }
 
-void SSHAttackDetector::clearOldAttempts(int minutes) {
-    std::lock_guard<std::mutex> lock(attempts_mutex_);
+void SSHAttackDetector::refreshWatermark() {
+    // Самая поздняя метка по всем шардам; первая попытка задает сетку окон
+    auto max_event_time = std::chrono::system_clock::time_point::min();
+    auto first_pending = std::chrono::system_clock::time_point::max();
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (shard->attempts > 0) {
+            max_event_time = std::max(max_event_time, shard->max_event_time);
+        }
+        if (!shard->pending.empty()) {
+            first_pending = std::min(first_pending, shard->pending.earliest());
+        }
+    }
 
-    auto cutoff = std::chrono::system_clock::now() - std::chrono::minutes(minutes);
+    if (max_event_time == std::chrono::system_clock::time_point::min()) {
+        return;
+    }
+
+    if (!has_events_ && first_pending != std::chrono::system_clock::time_point::max()) {
+        has_events_ = true;
+
+        // Окна выровнены по границам шага: (E - шаг, E]
+        auto step = evaluationStep();
+        auto since_epoch = first_pending.time_since_epoch();
+        next_evaluation_ = std::chrono::system_clock::time_point{} +
+                           step * ((since_epoch + step - std::chrono::system_clock::duration(1)) / step);
+    }
+
+    max_event_time_ = max_event_time;
+    watermark_ = std::max(watermark_, max_event_time - allowed_lateness_);
+}
+
+static std::string format_time(std::chrono::system_clock::time_point time) {
+    auto tt = std::chrono::system_clock::to_time_t(time);
+    std::tm tm{};
+    localtime_r(&tt, &tm);
 
-    recent_attempts_.erase(
-        std::remove_if(recent_attempts_.begin(), recent_attempts_.end(),
-            [cutoff](const ConnectionAttempt& attempt) {
-                return attempt.timestamp < cutoff;
-            }),
-        recent_attempts_.end()
-    );
+    std::stringstream ss;
+    ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+    return ss.str();
 }
 
-std::vector<SSHAttackDetector::ConnectionAttempt> SSHAttackDetector::getRecentAttempts(int minutes) {
-    std::lock_guard<std::mutex> lock(attempts_mutex_);
+void SSHAttackDetector::ingest(Shard& shard, const StoredAttempt& attempt, const UserSnapshot& users) {
+    int64_t minute = minute_of(attempt.time);
+    bool success = attempt.success;
+    const std::string& username = shard.usernames.name(attempt.user);
 
-    auto cutoff = std::chrono::system_clock::now() - std::chrono::minutes(minutes);
-    std::vector<ConnectionAttempt> recent;
+    auto [it, inserted] = shard.ips.try_emplace(attempt.ip);
+    IpState& state = it->second;
+    if (inserted) {
+        shard.addresses.retain(attempt.ip);
+    }
+
+    bool business = isBusinessHours(shard, attempt.time);
+    bool first_seen = state.last_seen == std::chrono::system_clock::time_point{};
+
+    IpCounters counters;
+    counters.attempts = 1;
+    counters.failed = !success;
+    counters.success = success;
+    if (!business) {
+        counters.off_hours = 1;
+        counters.off_hours_failed = !success;
+        counters.off_hours_success = success;
+    }
 
-    for (const auto& attempt : recent_attempts_) {
-        if (attempt.timestamp > cutoff) {
-            recent.push_back(attempt);
+    // Root и другие учетные записи с UID 0
+    if (users.isSuperuser(username)) {
+        counters.root_failed = !success;
+        counters.root_success = success;
+        counters.root_off_hours = !business;
+        if (state.last_root != std::chrono::system_clock::time_point{} &&
+            attempt.time - state.last_root < std::chrono::seconds(30)) {
+            counters.root_rapid = 1;
         }
+        state.last_root = attempt.time;
     }
 
-    return recent;
-}
+    bool common = common_usernames_.count(username) > 0;
+    if (common) {
+        counters.common_attempts = 1;
+        counters.common_failed = !success;
+    }
+    if (!first_seen && state.last_failed_common &&
+        attempt.time - state.last_seen < std::chrono::minutes(5)) {
+        counters.common_sequential = 1;
+    }
+    state.last_failed_common = common && !success;
 
-void SSHAttackDetector::loadExistingUsers() {
-    // Загрузить существующих пользователей из /etc/passwd
-    std::ifstream passwd_file("/etc/passwd");
-    if (passwd_file.is_open()) {
-        std::string line;
-        while (std::getline(passwd_file, line)) {
-            std::stringstream ss(line);
-            std::string username;
-            std::getline(ss, username, ':');
-            if (!username.empty()) {
-                existing_users_.insert(username);
-            }
+    if (!attempt.standard_port) {
+        counters.nonstandard_port = 1;
+    }
+
+    if (success) {
+        if (state.last_success != std::chrono::system_clock::time_point{} &&
+            attempt.time - state.last_success < std::chrono::minutes(5)) {
+            counters.short_sessions = 1;
         }
-        passwd_file.close();
+        state.last_success = attempt.time;
+        state.last_success_user = username;
     }
-}
 
-bool SSHAttackDetector::userExists(const std::string& username) {
-    return existing_users_.count(username) > 0;
-}
+    state.window.add(minute, counters);
 
-std::string SSHAttackDetector::getCountryFromIP(const std::string& ip) {
-    // Проверить на локальные адреса
-    static std::map<std::string, std::string> local_prefixes = {
-        {"192.168.", "LOCAL"},
-        {"10.", "LOCAL"},
-        {"172.", "LOCAL"},
-        {"127.", "LOCAL"},
-        {"169.254.", "LOCAL"}  // Link-local
-    };
+    PairCounters pair;
+    pair.attempts = 1;
+    pair.failed = !success;
+    pair.success = success;
 
-    for (const auto& [prefix, country] : local_prefixes) {
-        if (ip.find(prefix) == 0) {
-            return country;
+    auto [user_it, new_user] = state.users.try_emplace(attempt.user);
+    user_it->second.add(minute, pair);
+    if (!success) {
+        ingestSpray(shard, attempt, username, user_it->second.totals().failed);
+    }
+    state.ports[attempt.port].add(minute, pair);
+
+    UserState& user = shard.users[attempt.user];
+    user.window.expire(minute - 60);
+    user.window.add(minute, pair);
+    if (new_user) {
+        user.ips++;
+        shard.usernames.retain(attempt.user);
+    }
+
+    state.last_seen = attempt.time;
+    if (!state.dirty) {
+        state.dirty = true;
+        shard.dirty_ips.push_back(attempt.ip);
+    }
+
+    // Колесо устаревания: адрес записывается один раз на каждую минуту с попытками
+    if (inserted || state.last_minute != minute) {
+        state.last_minute = minute;
+        if (shard.minute_wheel.empty() || shard.minute_wheel.back().first < minute) {
+            shard.minute_wheel.emplace_back(minute, std::vector<uint32_t>());
         }
+        shard.minute_wheel.back().second.push_back(attempt.ip);
     }
 
-    // Проверить на зарезервированные адреса
-    if (ip.find("0.") == 0 || ip.find("255.255.255.255") == 0) {
-        return "RESERVED";
+    // Ссылки буфера: дальше адрес и имя держат только счетчики окна
+    shard.addresses.release(attempt.ip);
+    shard.usernames.release(attempt.user);
+}
+
+void SSHAttackDetector::ingestUntil(Shard& shard, std::chrono::system_clock::time_point time) {
+    auto users = users_->snapshot();
+    shard.pending.takeUntil(time, [&](const StoredAttempt& attempt) {
+        ingest(shard, attempt, *users);
+    });
+}
+
+void SSHAttackDetector::eraseIp(Shard& shard, std::unordered_map<uint32_t, IpState>::iterator it) {
+    for (const auto& [user_id, window] : it->second.users) {
+        auto user = shard.users.find(user_id);
+        if (user != shard.users.end() && --user->second.ips <= 0) {
+            shard.users.erase(user);
+        }
+        shard.usernames.release(user_id);
     }
+    shard.addresses.release(it->first);
+    shard.ips.erase(it);
+}
 
-    // Real GeoIP lookup using MaxMind GeoLite2
-    static MMDB_s* mmdb = nullptr;
-    static bool initialized = false;
+void SSHAttackDetector::expireUntil(Shard& shard, std::chrono::system_clock::time_point time) {
+    // Окно (time - 1ч, time]: минуты целиком до его начала больше не нужны
+    int64_t cutoff = minute_of(time - std::chrono::hours(1)) - 1;
 
-    if (!initialized) {
-        // Пути к базе данных GeoLite2 (проверить несколько возможных мест)
-        std::vector<std::string> db_paths = {
-            "/usr/share/GeoIP/GeoLite2-Country.mmdb",
-            "/var/lib/GeoIP/GeoLite2-Country.mmdb",
-            "/usr/local/share/GeoIP/GeoLite2-Country.mmdb",
-            "./GeoLite2-Country.mmdb"
-        };
+    while (!shard.minute_wheel.empty() && shard.minute_wheel.front().first <= cutoff) {
+        int64_t minute = shard.minute_wheel.front().first;
 
-        for (const auto& path : db_paths) {
-            if (access(path.c_str(), F_OK) == 0) {
-                mmdb = static_cast<MMDB_s*>(malloc(sizeof(MMDB_s)));
-                if (!mmdb) {
-                    LogError("Failed to allocate memory for GeoIP database");
-                    return "UNKNOWN";
-                }
+        for (const auto& ip : shard.minute_wheel.front().second) {
+            auto it = shard.ips.find(ip);
+            if (it == shard.ips.end()) {
+                continue;
+            }
 
-                int status = MMDB_open(path.c_str(), MMDB_MODE_MMAP, mmdb);
-                if (status == MMDB_SUCCESS) {
-                    LogInfo("Loaded GeoIP database from: " + path);
-                    initialized = true;
-                    break;
-                } else {
-                    LogWarning("Failed to open GeoIP database at " + path + ": " +
-                              MMDB_strerror(status));
-                    free(mmdb);
-                    mmdb = nullptr;
+            IpState& state = it->second;
+            if (state.last_minute <= minute) {
+                // Более поздних попыток с адреса не было - устарел целиком
+                eraseIp(shard, it);
+                continue;
+            }
+
+            state.window.expire(cutoff);
+            for (auto user = state.users.begin(); user != state.users.end();) {
+                user->second.expire(cutoff);
+                if (!user->second.empty()) {
+                    ++user;
+                    continue;
+                }
+                auto global = shard.users.find(user->first);
+                if (global != shard.users.end() && --global->second.ips <= 0) {
+                    shard.users.erase(global);
                 }
+                shard.usernames.release(user->first);
+                user = state.users.erase(user);
+            }
+            for (auto port = state.ports.begin(); port != state.ports.end();) {
+                port->second.expire(cutoff);
+                port = port->second.empty() ? state.ports.erase(port) : std::next(port);
             }
         }
 
-        if (!initialized) {
-            LogWarning("GeoIP database not found. Install GeoLite2-Country.mmdb or run: "
-                      "wget https://git.io/GeoLite2-Country.mmdb -O /usr/share/GeoIP/GeoLite2-Country.mmdb");
-            return "UNKNOWN";
-        }
+        shard.minute_wheel.pop_front();
     }
 
-    if (!mmdb) {
-        return "UNKNOWN";
-    }
+    expireSpray(shard, time);
+}
 
-    int gai_error, mmdb_error;
-    MMDB_lookup_result_s result = MMDB_lookup_string(mmdb, ip.c_str(), &gai_error, &mmdb_error);
+int64_t SSHAttackDetector::sprayBucket(std::chrono::system_clock::time_point time) const {
+    int64_t minutes = std::max<int64_t>(1, spray_window_hours_ * 60 / kSprayBuckets);
+    return minute_of(time) / minutes;
+}
 
-    if (gai_error != 0) {
-        LogWarning("GeoIP lookup failed for IP " + ip + ": " + gai_strerror(gai_error));
-        return "UNKNOWN";
+void SSHAttackDetector::ingestSpray(Shard& shard, const StoredAttempt& attempt, const std::string& username,
+                                    int pair_failed) {
+    int64_t second = second_of(attempt.time);
+    shard.failures_short.add(1, second, kSpikeShortHalfLife);
+    shard.failures_long.add(1, second, kSpikeLongHalfLife);
+    if (shard.first_failure == std::chrono::system_clock::time_point{}) {
+        shard.first_failure = attempt.time;
     }
 
-    if (mmdb_error != MMDB_SUCCESS) {
-        LogWarning("GeoIP lookup error for IP " + ip + ": " + MMDB_strerror(mmdb_error));
-        return "UNKNOWN";
-    }
+    // Новые ключи берутся, пока не кончился предел шарда; дальше ботнет
+    // со случайными именами не увеличивает память, а только счетчик
+    size_t limit = spray_max_keys_ / shards_.size() + 1;
+    auto has_room = [&]() {
+        if (shard.spray_users.size() + shard.spray_networks.size() < limit) {
+            return true;
+        }
+        shard.spray_untracked++;
+        return false;
+    };
 
-    if (!result.found_entry) {
-        LogDebug("GeoIP entry not found for IP: " + ip);
-        return "UNKNOWN";
-    }
+    // Номер адреса уже хранит двоичный ключ: текст не разбирается заново
+    bool is_address = shard.addresses.isAddress(attempt.ip);
+    const IpAddress& address = shard.addresses.address(attempt.ip);
+    uint64_t ip_hash = is_address ? sketchHash(address) : sketchHash(shard.addresses.name(attempt.ip));
+    int64_t bucket = sprayBucket(attempt.time);
 
-    MMDB_entry_data_s entry_data;
-    int status = MMDB_get_value(&result.entry, &entry_data, "country", "iso_code", NULL);
+    auto user = shard.spray_users.find(username);
+    if (user != shard.spray_users.end() || has_room()) {
+        if (user == shard.spray_users.end()) {
+            user = shard.spray_users.try_emplace(username).first;
+        }
+        SprayUser& target = user->second;
+        target.sources.add(bucket, ip_hash);
+        if (pair_failed > kSprayPairLimit) {
+            target.heavy.add(bucket, ip_hash);
+        }
+        if (!target.dirty) {
+            target.dirty = true;
+            shard.dirty_spray_users.push_back(username);
+        }
+    }
 
-    if (status == MMDB_SUCCESS && entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-        std::string country_code(reinterpret_cast<const char*>(entry_data.utf8_string),
-                                entry_data.data_size);
-        return country_code;
+    if (!is_address) {
+        return;
     }
+    IpAddress network_key = address.masked(address.isV4() ? 96 + 16 : 48);
+    auto network = shard.spray_networks.find(network_key);
+    if (network != shard.spray_networks.end() || has_room()) {
+        if (network == shard.spray_networks.end()) {
+            network = shard.spray_networks.try_emplace(network_key).first;
+        }
+        SprayNetwork& source = network->second;
+        source.usernames.add(bucket, sketchHash(username));
+        source.sources.add(bucket, ip_hash);
+        if (!source.dirty) {
+            source.dirty = true;
+            shard.dirty_spray_networks.push_back(network_key);
+        }
+    }
+}
 
-    // Попытка получить registered_country если country не найден
-    status = MMDB_get_value(&result.entry, &entry_data, "registered_country", "iso_code", NULL);
-    if (status == MMDB_SUCCESS && entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-        std::string country_code(reinterpret_cast<const char*>(entry_data.utf8_string),
-                                entry_data.data_size);
-        return country_code;
+void SSHAttackDetector::expireSpray(Shard& shard, std::chrono::system_clock::time_point time) {
+    // Корзина устаревает целиком, поэтому ключи перебираются раз на корзину, а не на окно
+    int64_t cutoff = sprayBucket(time) - kSprayBuckets;
+    if (cutoff <= shard.spray_expired_bucket) {
+        return;
     }
+    shard.spray_expired_bucket = cutoff;
 
-    LogDebug("Could not extract country code for IP: " + ip);
-    return "UNKNOWN";
+    for (auto it = shard.spray_users.begin(); it != shard.spray_users.end();) {
+        it->second.sources.expire(cutoff);
+        it->second.heavy.expire(cutoff);
+        it = it->second.sources.empty() ? shard.spray_users.erase(it) : std::next(it);
+    }
+    for (auto it = shard.spray_networks.begin(); it != shard.spray_networks.end();) {
+        it->second.usernames.expire(cutoff);
+        it->second.sources.expire(cutoff);
+        it = it->second.sources.empty() ? shard.spray_networks.erase(it) : std::next(it);
+    }
 }
 
-bool SSHAttackDetector::isBusinessHours(const std::chrono::system_clock::time_point& time) {
-    auto tt = std::chrono::system_clock::to_time_t(time);
-    auto tm = *std::localtime(&tt);
+void SSHAttackDetector::evaluateShard(Shard& shard, bool dirty_only, std::vector<AttackAlert>& alerts) {
+    auto visit = [&](const std::string& ip, IpState& state) {
+        state.dirty = false;
+        if (state.window.empty()) {
+            return;
+        }
 
-    // Рабочие часы: 9:00 - 18:00 в будни
-    int hour = tm.tm_hour;
-    int day = tm.tm_wday; // 0 = Воскресенье, 6 = Суббота
+        size_t first = alerts.size();
+        detectBruteForce(shard, ip, state, alerts);
+        detectDictionaryAttack(shard, ip, state, alerts);
+        detectGeoIPAnomalies(shard, ip, state, alerts);
+        detectTimeAnomalies(shard, ip, state, alerts);
+        detectNonExistentUsers(shard, ip, state, alerts);
+        detectRootAttempts(shard, ip, state, alerts);
+        detectNonStandardPorts(shard, ip, state, alerts);
+        detectPostLoginAnomalies(shard, ip, state, alerts);
+
+        // Время оповещения - время последней попытки с этого адреса, а не время анализа
+        for (size_t i = first; i < alerts.size(); ++i) {
+            AttackAlert& alert = alerts[i];
+            alert.timestamp = format_time(state.last_seen);
+            alert.successful_logins = state.window.totals().success;
+
+            if (alert.username.empty()) {
+                alert.failed_attempts = state.window.totals().failed;
+            } else {
+                uint32_t user_id;
+                auto user = shard.usernames.find(alert.username, user_id) ? state.users.find(user_id) : state.users.end();
+                alert.failed_attempts = user == state.users.end() ? 0 : user->second.totals().failed;
+            }
+        }
+    };
 
-    return (day >= 1 && day <= 5) && (hour >= 9 && hour <= 17);
+    // В потоковом режиме смотрим только адреса с новыми попытками: у остальных
+    // счетчики могли только уменьшиться, новых оповещений они не дадут
+    if (dirty_only) {
+        for (uint32_t ip : shard.dirty_ips) {
+            auto it = shard.ips.find(ip);
+            if (it != shard.ips.end()) {
+                visit(shard.addresses.name(ip), it->second);
+            }
+        }
+    } else {
+        for (auto& [ip, state] : shard.ips) {
+            visit(shard.addresses.name(ip), state);
+        }
+    }
+    shard.dirty_ips.clear();
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectBruteForce(const std::vector<ConnectionAttempt>& attempts) {
-    std::vector<AttackAlert> alerts;
-
-    // Группируем по IP и временному окну
-    std::map<std::string, std::vector<ConnectionAttempt>> ip_attempts;
+void SSHAttackDetector::mergeShardSummaries(std::vector<AttackAlert>& alerts) {
+    // Сколько адресов пробовали пользователя: сумма сводок всех шардов
+    // (адрес живет ровно в одном шарде, поэтому адреса не пересчитываются дважды)
+    std::map<std::string, int> source_ips;
+    for (const auto& alert : alerts) {
+        if (alert.type == "nonexistent_user") {
+            source_ips.emplace(alert.username, 0);
+        }
+    }
+    if (source_ips.empty()) {
+        return;
+    }
 
-    auto window_start = std::chrono::system_clock::now() -
-                       std::chrono::minutes(brute_force_window_minutes_);
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& [username, count] : source_ips) {
+            uint32_t user_id;
+            if (!shard->usernames.find(username, user_id)) {
+                continue;
+            }
+            auto user = shard->users.find(user_id);
+            if (user != shard->users.end()) {
+                count += user->second.ips;
+            }
+        }
+    }
 
-    for (const auto& attempt : attempts) {
-        if (attempt.timestamp > window_start) {
-            ip_attempts[attempt.ip].push_back(attempt);
+    for (auto& alert : alerts) {
+        if (alert.type == "nonexistent_user") {
+            alert.details["source_ips"] = std::to_string(source_ips[alert.username]);
         }
     }
+}
 
-    for (const auto& [ip, attempts_list] : ip_attempts) {
-        size_t failed_count = 0;
-        size_t total_attempts = attempts_list.size();
+void SSHAttackDetector::detectDistributedAttacks(std::chrono::system_clock::time_point now, bool dirty_only,
+                                                 bool evaluate_keys, std::vector<AttackAlert>& alerts) {
+    // Ключи с новыми неудачами (для снимка - все) и темп неудач по шардам.
+    // Пока ключи не оцениваются, имена и сети копятся в списках шардов
+    std::vector<std::string> user_keys;
+    std::vector<IpAddress> network_keys;
+    int64_t second = second_of(now);
+    double short_rate = 0;
+    double long_rate = 0;
+    auto first_failure = std::chrono::system_clock::time_point::max();
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        short_rate += shard->failures_short.rateAt(second, kSpikeShortHalfLife);
+        long_rate += shard->failures_long.rateAt(second, kSpikeLongHalfLife);
+        if (shard->first_failure != std::chrono::system_clock::time_point{}) {
+            first_failure = std::min(first_failure, shard->first_failure);
+        }
+        if (!evaluate_keys) {
+            continue;
+        }
 
-        // Подсчитываем неудачные попытки
-        for (const auto& attempt : attempts_list) {
-            if (!attempt.success) {
-                failed_count++;
+        for (const auto& username : shard->dirty_spray_users) {
+            auto it = shard->spray_users.find(username);
+            if (it != shard->spray_users.end()) {
+                it->second.dirty = false;
+                user_keys.push_back(username);
+            }
+        }
+        for (const auto& network : shard->dirty_spray_networks) {
+            auto it = shard->spray_networks.find(network);
+            if (it != shard->spray_networks.end()) {
+                it->second.dirty = false;
+                network_keys.push_back(network);
             }
         }
+        shard->dirty_spray_users.clear();
+        shard->dirty_spray_networks.clear();
 
-        // Расчет метрик brute force атаки
-        double failure_rate = total_attempts > 0 ? static_cast<double>(failed_count) / total_attempts : 0.0;
+        if (!dirty_only) {
+            for (const auto& [username, user] : shard->spray_users) {
+                user_keys.push_back(username);
+            }
+            for (const auto& [network, source] : shard->spray_networks) {
+                network_keys.push_back(network);
+            }
+        }
+    }
 
-        // Детекция на основе порогов
-        bool is_brute_force = false;
-        std::string reason;
+    std::string window = std::to_string(spray_window_hours_) + " ч";
+    std::string timestamp = format_time(now);
+
+    // Всплеск неудач по всему серверу: темп за минуты против обычного за часы
+    // (первые часы обычного темпа еще нет)
+    double per_minute = short_rate * 60;
+    double usual_per_minute = long_rate * 60;
+    if (first_failure != std::chrono::system_clock::time_point::max() &&
+        now - first_failure >= std::chrono::seconds(static_cast<int64_t>(kSpikeLongHalfLife)) &&
+        per_minute >= failure_spike_min_per_minute_ && per_minute >= failure_spike_factor_ * usual_per_minute) {
+        std::ostringstream rates;
+        rates << std::fixed << std::setprecision(1) << per_minute << " в минуту при обычных " << usual_per_minute;
+
+        AttackAlert alert;
+        alert.type = "failure_spike";
+        alert.severity = per_minute >= 2 * failure_spike_factor_ * usual_per_minute ? "high" : "medium";
+        alert.description = "Всплеск неудачных входов: " + rates.str();
+        alert.timestamp = timestamp;
+        alert.details["failures_per_minute"] = std::to_string(static_cast<int>(per_minute + 0.5));
+        alert.details["usual_per_minute"] = std::to_string(static_cast<int>(usual_per_minute + 0.5));
+        alerts.push_back(std::move(alert));
+    }
 
-        if (failed_count >= static_cast<size_t>(brute_force_threshold_)) {
-            is_brute_force = true;
-            reason = "High number of failed attempts";
-        } else if (failure_rate > 0.8 && total_attempts >= 5) {
-            is_brute_force = true;
-            reason = "High failure rate with multiple attempts";
-        } else if (total_attempts >= 10 && failed_count >= 8) {
-            is_brute_force = true;
-            reason = "Persistent failed attempts";
-
-            // Проверяем распределение по времени (быстрые последовательные попытки)
-            if (attempts_list.size() >= 3) {
-                auto time_span = std::chrono::duration_cast<std::chrono::seconds>(
-                    attempts_list.back().timestamp - attempts_list.front().timestamp).count();
-
-                if (time_span < 60 && failed_count >= attempts_list.size() - 1) { // почти все неудачи
-                    reason += " (rapid sequential attempts)";
-                }
+    if (user_keys.empty() && network_keys.empty()) {
+        return;
+    }
+
+    // Имя или сеть могут быть в нескольких шардах; порядок ключей задает порядок оповещений
+    std::sort(user_keys.begin(), user_keys.end());
+    user_keys.erase(std::unique(user_keys.begin(), user_keys.end()), user_keys.end());
+    std::sort(network_keys.begin(), network_keys.end());
+    network_keys.erase(std::unique(network_keys.begin(), network_keys.end()), network_keys.end());
+
+    // Различных адресов и имен не больше, чем неудач: сначала дешевые суммы
+    // неудач, оцениваются только ключи, которые могут дойти до порога
+    std::vector<std::pair<std::string, uint64_t>> users;
+    std::vector<std::pair<IpAddress, uint64_t>> networks;
+    for (const auto& username : user_keys) {
+        users.emplace_back(username, 0);
+    }
+    for (const auto& network : network_keys) {
+        networks.emplace_back(network, 0);
+    }
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& [username, failures] : users) {
+            auto it = shard->spray_users.find(username);
+            failures += it != shard->spray_users.end() ? it->second.sources.count() : 0;
+        }
+        for (auto& [network, failures] : networks) {
+            auto it = shard->spray_networks.find(network);
+            failures += it != shard->spray_networks.end() ? it->second.sources.count() : 0;
+        }
+    }
+    std::erase_if(users, [&](const auto& user) { return user.second < static_cast<uint64_t>(spray_min_sources_); });
+    std::erase_if(networks, [&](const auto& network) {
+        return network.second < static_cast<uint64_t>(std::max(3, spray_network_min_usernames_));
+    });
+    if (users.empty() && networks.empty()) {
+        return;
+    }
+
+    // Скетчи ключей по шардам параллельно, затем одна оценка объединения:
+    // сумма оценок шардов копила бы ошибку каждого и зависела от их числа
+    struct UserSketches {
+        HyperLogLog sources;
+        HyperLogLog heavy;
+    };
+    struct NetworkSketches {
+        HyperLogLog usernames;
+        HyperLogLog sources;
+    };
+    std::vector<std::vector<UserSketches>> user_parts(shards_.size());
+    std::vector<std::vector<NetworkSketches>> network_parts(shards_.size());
+
+    forEachShard([&](Shard& shard, size_t index) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto& user_part = user_parts[index];
+        user_part.resize(users.size());
+        for (size_t i = 0; i < users.size(); ++i) {
+            auto it = shard.spray_users.find(users[i].first);
+            if (it != shard.spray_users.end()) {
+                user_part[i].sources = it->second.sources.merged();
+                user_part[i].heavy = it->second.heavy.merged();
             }
         }
 
-        if (is_brute_force) {
-            AttackAlert alert;
-            alert.type = "brute_force";
-            alert.severity = "high";
-            alert.ip = ip;
-            alert.description = "Brute force attack detected: " + reason +
-                              ". Failed: " + std::to_string(failed_count) +
-                              "/" + std::to_string(total_attempts) +
-                              " attempts in " + std::to_string(brute_force_window_minutes_) + " minutes";
-            alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            alert.details["failed_attempts"] = std::to_string(failed_count);
-            alert.details["total_attempts"] = std::to_string(total_attempts);
-            alert.details["failure_rate"] = std::to_string(failure_rate * 100) + "%";
-            alert.details["time_window_minutes"] = std::to_string(brute_force_window_minutes_);
-            alert.details["reason"] = reason;
+        auto& network_part = network_parts[index];
+        network_part.resize(networks.size());
+        for (size_t i = 0; i < networks.size(); ++i) {
+            auto it = shard.spray_networks.find(networks[i].first);
+            if (it != shard.spray_networks.end()) {
+                network_part[i].usernames = it->second.usernames.merged();
+                network_part[i].sources = it->second.sources.merged();
+            }
+        }
+    });
 
-            alerts.push_back(alert);
+    auto union_of = [](const auto& parts, size_t i, auto member) {
+        std::vector<const HyperLogLog*> sketches;
+        for (const auto& part : parts) {
+            sketches.push_back(&(part[i].*member));
         }
+        return HyperLogLog::unionEstimate(sketches);
+    };
+
+    // Много адресов по одному имени, каждый редко: распыление пароля.
+    // Адреса, перебиравшие имя, уже видны детекторам по адресу и не считаются
+    for (size_t i = 0; i < users.size(); ++i) {
+        double light = union_of(user_parts, i, &UserSketches::sources) - union_of(user_parts, i, &UserSketches::heavy);
+        int sources = static_cast<int>(std::max(0.0, light) + 0.5);
+        if (sources < spray_min_sources_) {
+            continue;
+        }
+
+        AttackAlert alert;
+        alert.type = "password_spray";
+        const auto& [username, failures] = users[i];
+        alert.severity = userExists(username) ? "high" : "medium";
+        alert.description = "Распределенный подбор пароля: " + std::to_string(sources) + " адресов за " + window +
+                            ", каждый не чаще " + std::to_string(kSprayPairLimit) + " раз в час";
+        alert.username = username;
+        alert.timestamp = timestamp;
+        alert.failed_attempts = static_cast<int>(failures);
+        alert.details["source_ips"] = std::to_string(sources);
+        alert.details["window"] = window;
+        alerts.push_back(std::move(alert));
     }
 
-    return alerts;
+    // Много имен из одной сети с нескольких адресов: перебор имен, разнесенный
+    // по адресам (с одного адреса его ловит detectDictionaryAttack)
+    for (size_t i = 0; i < networks.size(); ++i) {
+        int usernames = static_cast<int>(union_of(network_parts, i, &NetworkSketches::usernames) + 0.5);
+        int sources = static_cast<int>(union_of(network_parts, i, &NetworkSketches::sources) + 0.5);
+        if (usernames < spray_network_min_usernames_ || sources < 3) {
+            continue;
+        }
+
+        IpPrefix prefix;
+        const auto& [network, failures] = networks[i];
+        prefix.network = network;
+        prefix.length = network.isV4() ? 96 + 16 : 48;
+
+        AttackAlert alert;
+        alert.type = "distributed_dictionary";
+        alert.severity = "medium";
+        alert.description = "Перебор имен из сети " + prefix.toString() + ": " + std::to_string(usernames) +
+                            " имен с " + std::to_string(sources) + " адресов за " + window;
+        alert.ip = prefix.toString();
+        alert.timestamp = timestamp;
+        alert.failed_attempts = static_cast<int>(failures);
+        alert.details["usernames"] = std::to_string(usernames);
+        alert.details["source_ips"] = std::to_string(sources);
+        alert.details["window"] = window;
+        alerts.push_back(std::move(alert));
+    }
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectDictionaryAttack(const std::vector<ConnectionAttempt>& attempts) {
+std::vector<AttackAlert> SSHAttackDetector::evaluateClosedWindows(bool flush) {
     std::vector<AttackAlert> alerts;
+    refreshWatermark();
+    if (!has_events_) {
+        return alerts;
+    }
 
-    // Группируем по IP
-    std::map<std::string, std::vector<ConnectionAttempt>> ip_attempts;
+    auto step = evaluationStep();
+    std::vector<std::vector<AttackAlert>> shard_alerts(shards_.size());
+    std::vector<char> evaluated(shards_.size());
+    std::vector<std::chrono::system_clock::time_point> next_pending(shards_.size());
 
-    for (const auto& attempt : attempts) {
-        ip_attempts[attempt.ip].push_back(attempt);
-    }
+    while (next_evaluation_ <= watermark_) {
+        auto window_end = next_evaluation_;
 
-    for (const auto& [ip, attempts_list] : ip_attempts) {
-        std::set<std::string> common_user_attempts;
-        std::set<std::string> all_usernames;
-        int failed_common_attempts = 0;
-        int total_common_attempts = 0;
+        // Шарды независимы: каждый раскладывает свои попытки и считает свои адреса
+        forEachShard([&](Shard& shard, size_t index) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            ingestUntil(shard, window_end);
+            expireUntil(shard, window_end);
+            shard.closed_until = window_end;
 
-        // Анализируем попытки с распространенными логинами
-        for (const auto& attempt : attempts_list) {
-            all_usernames.insert(attempt.username);
+            evaluated[index] = !shard.dirty_ips.empty();
+            if (evaluated[index]) {
+                evaluateShard(shard, true, shard_alerts[index]);
+            }
+            next_pending[index] = shard.pending.empty() ? std::chrono::system_clock::time_point::max()
+                                                        : shard.pending.earliest();
+        });
+
+        bool any_evaluated = std::find(evaluated.begin(), evaluated.end(), 1) != evaluated.end();
+        if (any_evaluated) {
+            stats_.windows++;
+
+            std::vector<AttackAlert> window_alerts;
+            for (auto& part : shard_alerts) {
+                std::move(part.begin(), part.end(), std::back_inserter(window_alerts));
+                part.clear();
+            }
+            mergeShardSummaries(window_alerts);
+
+            // Имена и сети за сутки незачем пересчитывать каждые 10 минут: раз
+            // в двадцать четвертую часть окна и на последнем окне ввода
+            bool evaluate_keys = window_end >= next_spray_evaluation_ || (flush && window_end + step > watermark_);
+            if (evaluate_keys) {
+                next_spray_evaluation_ = window_end + std::chrono::minutes(std::max(10, spray_window_hours_ * 60 / 24));
+            }
+            detectDistributedAttacks(window_end, true, evaluate_keys, window_alerts);
+            sort_alerts(window_alerts);
 
-            if (common_usernames_.count(attempt.username)) {
-                total_common_attempts++;
-                if (!attempt.success) {
-                    failed_common_attempts++;
+            for (auto& alert : window_alerts) {
+                if (admitAlert(alert, window_end)) {
+                    alerts.push_back(std::move(alert));
                 }
-                common_user_attempts.insert(attempt.username);
             }
+            next_evaluation_ = window_end + step;
+        } else {
+            // Окно без новых попыток ничего нового не даст; перейти к ближайшей
+            // границе не раньше следующей попытки (или за watermark, если попыток нет)
+            auto target = std::min(*std::min_element(next_pending.begin(), next_pending.end()), watermark_);
+            auto steps = (target - window_end + step - std::chrono::system_clock::duration(1)) / step;
+            next_evaluation_ = window_end + step * std::max<decltype(steps)>(steps, 1);
         }
+    }
 
-        // Детекция dictionary атаки
-        bool is_dictionary_attack = false;
-        std::string reason;
+    // Условие давно не выполнялось: следующее срабатывание все равно будет новым
+    auto now = next_evaluation_ - step;
+    for (auto it = alert_states_.begin(); it != alert_states_.end();) {
+        const AlertPolicy& policy = alertPolicy(it->first.substr(0, it->first.find('|')));
+        it = now - it->second.active >= policy.quiet ? alert_states_.erase(it) : std::next(it);
+    }
 
-        // Критерий 1: много попыток с распространенными логинами
-        if (total_common_attempts >= 5) {
-            is_dictionary_attack = true;
-            reason = "Multiple attempts with common usernames";
-        }
-        // Критерий 2: много разных распространенных логинов от одного IP
-        else if (common_user_attempts.size() >= 3 && total_common_attempts >= 3) {
-            is_dictionary_attack = true;
-            reason = "Multiple different common usernames tried";
-        }
-        // Критерий 3: последовательные неудачные попытки с разными логинами
-        else if (failed_common_attempts >= 3 && common_user_attempts.size() >= 2) {
-            // Проверяем временную последовательность
-            std::vector<ConnectionAttempt> sorted_attempts = attempts_list;
-            std::sort(sorted_attempts.begin(), sorted_attempts.end(),
-                     [](const ConnectionAttempt& a, const ConnectionAttempt& b) {
-                         return a.timestamp < b.timestamp;
-                     });
-
-            int sequential_failures = 0;
-            for (size_t i = 0; i < sorted_attempts.size() - 1; ++i) {
-                if (!sorted_attempts[i].success &&
-                    common_usernames_.count(sorted_attempts[i].username) &&
-                    std::chrono::duration_cast<std::chrono::minutes>(
-                        sorted_attempts[i+1].timestamp - sorted_attempts[i].timestamp).count() < 5) {
-                    sequential_failures++;
-                }
-            }
+    return alerts;
+}
 
-            if (sequential_failures >= 2) {
-                is_dictionary_attack = true;
-                reason = "Sequential failed attempts with different common usernames";
-            }
-        }
+static int severity_rank(const std::string& severity) {
+    if (severity == "critical") return 4;
+    if (severity == "high") return 3;
+    if (severity == "medium") return 2;
+    return 1;
+}
 
-        if (is_dictionary_attack) {
-            AttackAlert alert;
-            alert.type = "dictionary_attack";
-            alert.severity = "medium";
-            alert.ip = ip;
-            alert.description = "Dictionary attack detected: " + reason +
-                              ". Common usernames tried: " + std::to_string(common_user_attempts.size()) +
-                              ", Total attempts: " + std::to_string(total_common_attempts);
-            alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            alert.details["common_usernames_tried"] = std::to_string(common_user_attempts.size());
-            alert.details["total_common_attempts"] = std::to_string(total_common_attempts);
-            alert.details["failed_common_attempts"] = std::to_string(failed_common_attempts);
-            alert.details["reason"] = reason;
+static std::string raise_severity(const std::string& severity) {
+    if (severity == "low") return "medium";
+    if (severity == "medium") return "high";
+    return "critical";
+}
 
-            std::string usernames_list;
-            for (const auto& username : common_user_attempts) {
-                if (!usernames_list.empty()) usernames_list += ", ";
-                usernames_list += username;
-            }
-            alert.details["usernames"] = usernames_list;
+const SSHAttackDetector::AlertPolicy& SSHAttackDetector::alertPolicy(const std::string& type) const {
+    auto it = alert_policies_.find(type);
+    return it != alert_policies_.end() ? it->second : default_alert_policy_;
+}
 
-            alerts.push_back(alert);
+bool SSHAttackDetector::admitAlert(AttackAlert& alert, std::chrono::system_clock::time_point now) {
+    // Списки сетей: доверенные сети не оповещают, известные атакующие - на уровень серьезнее
+    if (auto lists = IpListService::instance().lists()) {
+        if (const PrefixMatcher::List* list = lists->match(alert.ip)) {
+            if (list->kind == PrefixMatcher::Kind::Allow) {
+                stats_.allowlisted++;
+                return false;
+            }
+            alert.severity = raise_severity(alert.severity);
+            alert.details["blocklist"] = list->name;
         }
     }
 
-    return alerts;
+    // Оповещение по фронту: детекторы выдают условие на каждом окне, пока
+    // оно выполняется, а наружу уходят только переходы
+    const AlertPolicy& policy = alertPolicy(alert.type);
+    int severity = severity_rank(alert.severity);
+    auto [it, inserted] = alert_states_.try_emplace(alert.type + "|" + alert.ip + "|" + alert.username);
+    AlertState& state = it->second;
+
+    const char* notification = nullptr;
+    if (inserted || now - state.active >= policy.quiet) {
+        notification = "new";
+        state.severity = 0;
+    } else if (severity > state.severity) {
+        notification = "escalated";
+        stats_.escalated++;
+    } else if (policy.renotify.count() > 0 && now - state.notified >= policy.renotify) {
+        notification = "repeat";
+        stats_.renotified++;
+    }
+
+    state.active = now;
+    if (!notification) {
+        stats_.suppressed++;
+        return false;
+    }
+
+    state.severity = std::max(state.severity, severity);
+    state.notified = now;
+    alert.details["notification"] = notification;
+    return true;
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectGeoIPAnomalies(const std::vector<ConnectionAttempt>& attempts) {
-    std::vector<AttackAlert> alerts;
+std::vector<AttackAlert> SSHAttackDetector::pollAlerts() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    return evaluateClosedWindows();
+}
 
-    // Группируем по IP
-    std::map<std::string, std::vector<ConnectionAttempt>> ip_attempts;
+std::vector<AttackAlert> SSHAttackDetector::flushAlerts() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
 
-    for (const auto& attempt : attempts) {
-        ip_attempts[attempt.ip].push_back(attempt);
+    // Конец ввода: опоздавших событий больше не будет, закрыть окно с последней попыткой
+    refreshWatermark();
+    if (has_events_) {
+        watermark_ = std::max(watermark_, max_event_time_ + std::chrono::minutes(brute_force_window_minutes_));
     }
+    return evaluateClosedWindows(true);
+}
 
-    // Анализируем паттерны подключений
-    for (const auto& [ip, attempts_list] : ip_attempts) {
-        std::string country = getCountryFromIP(ip);
+void SSHAttackDetector::advanceWatermark(std::chrono::system_clock::time_point time) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    watermark_ = std::max(watermark_, time);
+}
 
-        // Пропускаем локальные адреса
-        if (country == "LOCAL") {
-            continue;
-        }
+std::chrono::system_clock::duration SSHAttackDetector::evaluationStep() const {
+    if (evaluation_interval_.count() > 0) {
+        return evaluation_interval_;
+    }
+    return std::chrono::minutes(brute_force_window_minutes_);
+}
+
+void SSHAttackDetector::setEvaluationInterval(std::chrono::seconds interval) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    evaluation_interval_ = interval;
+}
 
-        int successful_connections = 0;
-        int failed_connections = 0;
-        std::set<int> ports_used;
-        std::set<std::string> usernames_tried;
+void SSHAttackDetector::setAllowedLateness(std::chrono::seconds lateness) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    allowed_lateness_ = lateness;
+}
 
-        for (const auto& attempt : attempts_list) {
-            if (attempt.success) {
-                successful_connections++;
-            } else {
-                failed_connections++;
-            }
-            ports_used.insert(attempt.port);
-            usernames_tried.insert(attempt.username);
-        }
+void SSHAttackDetector::setAlertSuppression(std::chrono::seconds quiet, std::chrono::seconds renotify,
+                                            const std::string& type) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    AlertPolicy& policy = type.empty() ? default_alert_policy_ : alert_policies_[type];
+    policy.quiet = quiet;
+    policy.renotify = renotify;
+}
 
-        // Детекция гео-аномалий
-        bool is_geo_anomaly = false;
-        std::string reason;
-        std::string severity = "low";
+std::chrono::system_clock::time_point SSHAttackDetector::getWatermark() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    refreshWatermark();
+    return watermark_;
+}
 
-        // Критерий 1: много подключений из необычной страны
-        if (normal_countries_.find(country) == normal_countries_.end()) {
-            if (attempts_list.size() >= 3) {
-                is_geo_anomaly = true;
-                reason = "Multiple connections from unusual geographic location";
-                severity = "medium";
-            }
+DetectorStats SSHAttackDetector::getStats() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    DetectorStats stats = stats_;
+    stats.shards = shards_.size();
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> shard_lock(shard->mutex);
+        stats.attempts += shard->attempts;
+        stats.late_attempts += shard->late_attempts;
+        stats.active_ips += shard->ips.size();
+        stats.spray_keys += shard->spray_users.size() + shard->spray_networks.size();
+        stats.spray_untracked += shard->spray_untracked;
+    }
+    std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+    stats.untimed_events = untimed_events_;
+    return stats;
+}
+
+namespace {
+    // Формат состояния детектора; меняется вместе с составом счетчиков и
+    // раскладкой адресов по шардам
+    const uint32_t kStateFormat = 3;
+
+    template <typename Counters>
+    void put_window(StateWriter& writer, const SlidingWindow<Counters>& window) {
+        writer.put<uint64_t>(window.buckets().size());
+        for (const auto& [minute, counters] : window.buckets()) {
+            writer.put(minute);
+            writer.put(counters);
         }
+    }
 
-        // Критерий 2: подозрительная активность из необычной страны
-        if (normal_countries_.find(country) == normal_countries_.end()) {
-            // Много неудачных попыток
-            if (failed_connections >= 5 && successful_connections == 0) {
-                is_geo_anomaly = true;
-                reason = "Failed connection attempts from unusual geographic location";
-                severity = "medium";
+    template <typename Counters>
+    bool get_window(StateReader& reader, SlidingWindow<Counters>& window) {
+        uint64_t count = 0;
+        reader.getCount(count, sizeof(int64_t) + sizeof(Counters));
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            int64_t minute = 0;
+            Counters counters;
+            if (reader.get(minute) && reader.get(counters)) {
+                window.add(minute, counters);
             }
+        }
+        return reader.ok();
+    }
+}
 
-            // Попытки на нестандартные порты
-            bool has_non_standard_ports = false;
-            for (int port : ports_used) {
-                if (standard_ports_.find(port) == standard_ports_.end()) {
-                    has_non_standard_ports = true;
-                    break;
-                }
-            }
+void SSHAttackDetector::saveState(std::string& out) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    StateWriter writer(out);
+    writer.put(kStateFormat);
+    writer.put<uint32_t>(sizeof(IpCounters));
+    writer.put<uint32_t>(sizeof(PairCounters));
+    writer.put<uint64_t>(shards_.size());
+
+    writer.putTime(max_event_time_);
+    writer.putTime(watermark_);
+    writer.putTime(next_evaluation_);
+    writer.putTime(next_spray_evaluation_);
+    writer.put<uint8_t>(has_events_);
+    writer.put(stats_.windows);
+    writer.put(stats_.suppressed);
+    writer.put(stats_.escalated);
+    writer.put(stats_.renotified);
+
+    writer.put<uint64_t>(alert_states_.size());
+    for (const auto& [key, state] : alert_states_) {
+        writer.putString(key);
+        writer.put(state.severity);
+        writer.putTime(state.notified);
+        writer.putTime(state.active);
+    }
 
-            if (has_non_standard_ports && attempts_list.size() >= 2) {
-                is_geo_anomaly = true;
-                reason = "Connection attempts to non-standard ports from unusual geographic location";
-                severity = "high";
-            }
+    {
+        std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+        writer.put<uint64_t>(failed_sessions_.size());
+        for (const auto& pid : failed_sessions_) {
+            writer.putString(pid);
+        }
+    }
 
-            // Много разных пользователей
-            if (usernames_tried.size() >= 3 && failed_connections >= 3) {
-                is_geo_anomaly = true;
-                reason = "Multiple usernames tried from unusual geographic location";
-                severity = "high";
+    // Шарды пишутся по номерам: при том же числе шардов адрес попадает в тот же шард
+    for (auto& shard_ptr : shards_) {
+        Shard& shard = *shard_ptr;
+        std::lock_guard<std::mutex> shard_lock(shard.mutex);
+
+        writer.putTime(shard.max_event_time);
+        writer.putTime(shard.closed_until);
+        writer.put(shard.attempts);
+        writer.put(shard.late_attempts);
+
+        writer.put<uint64_t>(shard.pending.size());
+        shard.pending.forEach([&](const StoredAttempt& attempt) {
+            writer.putString(shard.addresses.name(attempt.ip));
+            writer.putString(shard.usernames.name(attempt.user));
+            writer.putTime(attempt.time);
+            writer.put(attempt.port);
+            writer.put<uint8_t>(attempt.success | (attempt.standard_port << 1));
+        });
+
+        writer.put<uint64_t>(shard.ips.size());
+        for (const auto& [ip_id, state] : shard.ips) {
+            writer.putString(shard.addresses.name(ip_id));
+            writer.putTime(state.last_seen);
+            writer.putTime(state.last_root);
+            writer.putTime(state.last_success);
+            writer.putString(state.last_success_user);
+            writer.put<uint8_t>(state.last_failed_common);
+            writer.put(state.last_minute);
+            writer.put<uint8_t>(state.dirty);
+            writer.putString(state.country);
+            put_window(writer, state.window);
+
+            writer.put<uint64_t>(state.users.size());
+            for (const auto& [user_id, window] : state.users) {
+                writer.putString(shard.usernames.name(user_id));
+                put_window(writer, window);
+            }
+            writer.put<uint64_t>(state.ports.size());
+            for (const auto& [port, window] : state.ports) {
+                writer.put<int32_t>(port);
+                put_window(writer, window);
             }
         }
 
-        // Критерий 3: необычное время подключения из необычной страны
-        if (normal_countries_.find(country) == normal_countries_.end() && attempts_list.size() >= 2) {
-            bool unusual_time = false;
-            for (const auto& attempt : attempts_list) {
-                if (!isBusinessHours(attempt.timestamp)) {
-                    unusual_time = true;
-                    break;
-                }
-            }
+        writer.put<uint64_t>(shard.users.size());
+        for (const auto& [user_id, user] : shard.users) {
+            writer.putString(shard.usernames.name(user_id));
+            writer.put<int32_t>(user.ips);
+            put_window(writer, user.window);
+        }
 
-            if (unusual_time && successful_connections > 0) {
-                is_geo_anomaly = true;
-                reason = "Successful connections outside business hours from unusual geographic location";
-                severity = "high";
+        // Колесо и список грязных адресов ссылаются только на живые адреса
+        writer.put<uint64_t>(shard.minute_wheel.size());
+        for (const auto& [minute, ips] : shard.minute_wheel) {
+            writer.put(minute);
+            uint64_t live = std::count_if(ips.begin(), ips.end(), [&](uint32_t id) { return shard.ips.count(id) > 0; });
+            writer.put(live);
+            for (uint32_t id : ips) {
+                if (shard.ips.count(id)) {
+                    writer.putString(shard.addresses.name(id));
+                }
             }
         }
 
-        if (is_geo_anomaly) {
-            AttackAlert alert;
-            alert.type = "geo_ip_anomaly";
-            alert.severity = severity;
-            alert.ip = ip;
-            alert.description = "GeoIP anomaly detected: " + reason +
-                              " (Country: " + country + ", Connections: " +
-                              std::to_string(attempts_list.size()) + ")";
-            alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            alert.details["country"] = country;
-            alert.details["total_connections"] = std::to_string(attempts_list.size());
-            alert.details["successful_connections"] = std::to_string(successful_connections);
-            alert.details["failed_connections"] = std::to_string(failed_connections);
-            alert.details["usernames_tried"] = std::to_string(usernames_tried.size());
-            alert.details["ports_used"] = std::to_string(ports_used.size());
-            alert.details["reason"] = reason;
+        writer.put<uint64_t>(shard.last_successful_login.size());
+        for (const auto& [ip, time] : shard.last_successful_login) {
+            writer.putString(ip);
+            writer.putTime(time);
+        }
 
-            alerts.push_back(alert);
+        writer.putTime(shard.first_failure);
+        writer.put(shard.failures_short);
+        writer.put(shard.failures_long);
+        writer.put(shard.spray_expired_bucket);
+        writer.put(shard.spray_untracked);
+        writer.put<uint64_t>(shard.spray_users.size());
+        for (const auto& [username, user] : shard.spray_users) {
+            writer.putString(username);
+            writer.put<uint8_t>(user.dirty);
+            user.sources.save(writer);
+            user.heavy.save(writer);
+        }
+        writer.put<uint64_t>(shard.spray_networks.size());
+        for (const auto& [network, source] : shard.spray_networks) {
+            writer.put(network);
+            writer.put<uint8_t>(source.dirty);
+            source.usernames.save(writer);
+            source.sources.save(writer);
         }
     }
+}
 
-    return alerts;
+size_t SSHAttackDetector::stateShards(std::string_view state) {
+    StateReader reader(state);
+    uint32_t format = 0, ip_counters = 0, pair_counters = 0;
+    uint64_t shards = 0;
+    reader.get(format);
+    reader.get(ip_counters);
+    reader.get(pair_counters);
+    reader.get(shards);
+    if (!reader.ok() || format != kStateFormat || ip_counters != sizeof(IpCounters) ||
+        pair_counters != sizeof(PairCounters) || shards == 0 || shards > 4096) {
+        return 0;
+    }
+    return shards;
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectTimeAnomalies(const std::vector<ConnectionAttempt>& attempts) {
-    std::vector<AttackAlert> alerts;
+std::unique_ptr<SSHAttackDetector> SSHAttackDetector::fromState(std::string_view state) {
+    size_t shards = stateShards(state);
+    if (shards == 0) {
+        return nullptr;
+    }
+    auto detector = std::make_unique<SSHAttackDetector>(shards);
+    if (!detector->loadState(state)) {
+        return nullptr;
+    }
+    return detector;
+}
 
-    // Группируем по IP для анализа паттернов
-    std::map<std::string, std::vector<ConnectionAttempt>> ip_attempts;
+bool SSHAttackDetector::loadState(std::string_view state) {
+    // Только в новый детектор с тем же числом шардов (см. stateShards)
+    if (stateShards(state) != shards_.size()) {
+        return false;
+    }
 
-    for (const auto& attempt : attempts) {
-        ip_attempts[attempt.ip].push_back(attempt);
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    StateReader reader(state);
+    uint32_t skip32 = 0;
+    uint64_t skip64 = 0;
+    reader.get(skip32);
+    reader.get(skip32);
+    reader.get(skip32);
+    reader.get(skip64);
+
+    uint8_t flag = 0;
+    reader.getTime(max_event_time_);
+    reader.getTime(watermark_);
+    reader.getTime(next_evaluation_);
+    reader.getTime(next_spray_evaluation_);
+    reader.get(flag);
+    has_events_ = flag != 0;
+    reader.get(stats_.windows);
+    reader.get(stats_.suppressed);
+    reader.get(stats_.escalated);
+    reader.get(stats_.renotified);
+
+    uint64_t count = 0;
+    reader.getCount(count);
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        std::string key;
+        AlertState alert_state;
+        reader.getString(key);
+        reader.get(alert_state.severity);
+        reader.getTime(alert_state.notified);
+        reader.getTime(alert_state.active);
+        alert_states_[key] = alert_state;
     }
 
-    for (const auto& [ip, attempts_list] : ip_attempts) {
-        std::vector<ConnectionAttempt> successful_attempts;
-        std::vector<ConnectionAttempt> failed_attempts;
+    {
+        std::lock_guard<std::mutex> sessions_lock(sessions_mutex_);
+        reader.getCount(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            std::string pid;
+            reader.getString(pid);
+            failed_sessions_.insert(pid);
+        }
+    }
 
-        for (const auto& attempt : attempts_list) {
-            if (attempt.success) {
-                successful_attempts.push_back(attempt);
-            } else {
-                failed_attempts.push_back(attempt);
+    for (size_t index = 0; index < shards_.size() && reader.ok(); ++index) {
+        Shard& shard = *shards_[index];
+        std::lock_guard<std::mutex> shard_lock(shard.mutex);
+
+        reader.getTime(shard.max_event_time);
+        reader.getTime(shard.closed_until);
+        reader.get(shard.attempts);
+        reader.get(shard.late_attempts);
+
+        reader.getCount(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            std::string ip, user;
+            std::chrono::system_clock::time_point time;
+            uint16_t port = 0;
+            uint8_t flags = 0;
+            reader.getString(ip);
+            reader.getString(user);
+            reader.getTime(time);
+            reader.get(port);
+            reader.get(flags);
+            if (reader.ok()) {
+                shard.pending.append(shard.addresses.acquire(ip), shard.usernames.acquire(user), time, port,
+                                     flags & 1, flags & 2);
             }
         }
 
-        // Детекция временных аномалий
-        bool is_time_anomaly = false;
-        std::string reason;
-        std::string severity = "low";
-
-        // Критерий 1: успешные подключения в нерабочее время
-        int off_hours_success = 0;
-        for (const auto& attempt : successful_attempts) {
-            if (!isBusinessHours(attempt.timestamp)) {
-                off_hours_success++;
+        // Номера адресов и имен выдаются заново; ссылки держат записи ips так же, как после ingest
+        std::unordered_map<std::string, uint32_t> ip_ids;
+        reader.getCount(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            std::string ip;
+            reader.getString(ip);
+            if (!reader.ok() || &shardFor(ip) != &shard) {
+                return false;  // Другая функция хэша: раскладка по шардам не совпадает
+            }
+            uint32_t ip_id = shard.addresses.acquire(ip);
+            ip_ids[ip] = ip_id;
+            IpState& ip_state = shard.ips[ip_id];
+
+            reader.getTime(ip_state.last_seen);
+            reader.getTime(ip_state.last_root);
+            reader.getTime(ip_state.last_success);
+            reader.getString(ip_state.last_success_user);
+            reader.get(flag);
+            ip_state.last_failed_common = flag != 0;
+            reader.get(ip_state.last_minute);
+            reader.get(flag);
+            ip_state.dirty = flag != 0;
+            if (ip_state.dirty) {
+                shard.dirty_ips.push_back(ip_id);
+            }
+            reader.getString(ip_state.country);
+            get_window(reader, ip_state.window);
+
+            uint64_t users = 0;
+            reader.getCount(users);
+            for (uint64_t u = 0; u < users && reader.ok(); ++u) {
+                std::string user;
+                reader.getString(user);
+                get_window(reader, ip_state.users[shard.usernames.acquire(user)]);
+            }
+            uint64_t ports = 0;
+            reader.getCount(ports);
+            for (uint64_t p = 0; p < ports && reader.ok(); ++p) {
+                int32_t port = 0;
+                reader.get(port);
+                get_window(reader, ip_state.ports[port]);
             }
         }
 
-        if (off_hours_success > 0) {
-            // Проверяем, является ли это новым паттерном
-            auto last_success = last_successful_login_.find(ip);
-            bool is_new_pattern = (last_success == last_successful_login_.end() ||
-                                 std::chrono::duration_cast<std::chrono::hours>(
-                                     attempts_list.back().timestamp - last_success->second).count() > 24);
-
-            if (is_new_pattern) {
-                is_time_anomaly = true;
-                reason = "Successful login outside business hours";
-                severity = off_hours_success >= 2 ? "medium" : "low";
-                last_successful_login_[ip] = attempts_list.back().timestamp;
-            }
+        reader.getCount(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            std::string user;
+            int32_t ips = 0;
+            reader.getString(user);
+            reader.get(ips);
+            uint32_t user_id = 0;
+            UserState discarded;
+            UserState& user_state = shard.usernames.find(user, user_id) ? shard.users[user_id] : discarded;
+            user_state.ips = ips;
+            get_window(reader, user_state.window);
         }
 
-        // Критерий 2: подозрительная активность ночью (много неудачных попыток)
-        int night_attempts = 0;
-        int night_failures = 0;
-        for (const auto& attempt : attempts_list) {
-            if (!isBusinessHours(attempt.timestamp)) {
-                night_attempts++;
-                if (!attempt.success) {
-                    night_failures++;
+        reader.getCount(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            int64_t minute = 0;
+            uint64_t ips = 0;
+            reader.get(minute);
+            reader.getCount(ips);
+            auto& bucket = shard.minute_wheel.emplace_back(minute, std::vector<uint32_t>()).second;
+            for (uint64_t j = 0; j < ips && reader.ok(); ++j) {
+                std::string ip;
+                reader.getString(ip);
+                auto it = ip_ids.find(ip);
+                if (it != ip_ids.end()) {
+                    bucket.push_back(it->second);
                 }
             }
         }
 
-        if (night_failures >= 3 && night_attempts >= night_failures) {
-            is_time_anomaly = true;
-            reason = "Multiple failed attempts during off-hours";
-            severity = "medium";
+        reader.getCount(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            std::string ip;
+            std::chrono::system_clock::time_point time;
+            reader.getString(ip);
+            reader.getTime(time);
+            shard.last_successful_login[ip] = time;
         }
 
-        // Критерий 3: необычное время для первого подключения с этого IP
-        if (successful_attempts.size() == 1 && !isBusinessHours(successful_attempts[0].timestamp)) {
-            // Проверяем, что это первый успешный вход с этого IP
-            auto last_success = last_successful_login_.find(ip);
-            if (last_success == last_successful_login_.end()) {
-                is_time_anomaly = true;
-                reason = "First successful connection from this IP occurred outside business hours";
-                severity = "low";
-                last_successful_login_[ip] = successful_attempts[0].timestamp;
+        reader.getTime(shard.first_failure);
+        reader.get(shard.failures_short);
+        reader.get(shard.failures_long);
+        reader.get(shard.spray_expired_bucket);
+        reader.get(shard.spray_untracked);
+        reader.getCount(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            std::string username;
+            reader.getString(username);
+            SprayUser& user = shard.spray_users[username];
+            reader.get(flag);
+            user.dirty = flag != 0;
+            if (user.dirty) {
+                shard.dirty_spray_users.push_back(username);
             }
+            user.sources.load(reader);
+            user.heavy.load(reader);
         }
-
-        // Критерий 4: регулярные неудачные попытки в нерабочее время
-        if (failed_attempts.size() >= 5) {
-            std::map<int, int> hour_attempts; // час -> количество попыток
-            for (const auto& attempt : failed_attempts) {
-                auto tt = std::chrono::system_clock::to_time_t(attempt.timestamp);
-                auto tm = *std::localtime(&tt);
-                hour_attempts[tm.tm_hour]++;
-            }
-
-            // Ищем часы с аномально высокой активностью
-            for (const auto& [hour, count] : hour_attempts) {
-                if (count >= 3 && (hour < 6 || hour > 22)) { // ночные часы
-                    is_time_anomaly = true;
-                    reason = "High activity during unusual hours (hour " + std::to_string(hour) + ")";
-                    severity = "medium";
-                    break;
-                }
+        reader.getCount(count, sizeof(IpAddress));
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            IpAddress network;
+            reader.get(network);
+            SprayNetwork& source = shard.spray_networks[network];
+            reader.get(flag);
+            source.dirty = flag != 0;
+            if (source.dirty) {
+                shard.dirty_spray_networks.push_back(network);
             }
+            source.usernames.load(reader);
+            source.sources.load(reader);
         }
+    }
 
-        if (is_time_anomaly) {
-            AttackAlert alert;
-            alert.type = "time_anomaly";
-            alert.severity = severity;
-            alert.ip = ip;
-            alert.description = "Time anomaly detected: " + reason;
-            alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            alert.details["successful_connections"] = std::to_string(successful_attempts.size());
-            alert.details["failed_connections"] = std::to_string(failed_attempts.size());
-            alert.details["off_hours_success"] = std::to_string(off_hours_success);
-            alert.details["reason"] = reason;
+    return reader.ok() && reader.atEnd();
+}
 
-            if (!successful_attempts.empty()) {
-                alert.username = successful_attempts.back().username;
-                alert.details["last_username"] = alert.username;
-            }
+bool SSHAttackDetector::userExists(const std::string& username) {
+    return users_->exists(username);
+}
 
-            alerts.push_back(alert);
-        }
-    }
+std::string SSHAttackDetector::getCountryFromIP(const std::string& ip) {
+    // База, частные диапазоны и кэш по сетям - в общей службе GeoIP
+    return GeoIPService::instance().country(ip);
+}
 
-    return alerts;
+bool SSHAttackDetector::isBusinessHours(Shard& shard, const std::chrono::system_clock::time_point& time) {
+    // localtime заметен при разборе больших логов; смещения часовых поясов
+    // кратны 15 минутам, поэтому результат кэшируется по четверти часа
+    int64_t quarter = std::chrono::floor<std::chrono::minutes>(time.time_since_epoch()).count() / 15;
+    if (quarter != shard.business_cache_quarter) {
+        auto tt = static_cast<time_t>(quarter * 15 * 60);
+        std::tm tm{};
+        localtime_r(&tt, &tm);
+
+        // Рабочие часы: 9:00 - 18:00 в будни
+        int hour = tm.tm_hour;
+        int day = tm.tm_wday; // 0 = Воскресенье, 6 = Суббота
+
+        shard.business_cache_quarter = quarter;
+        shard.business_cache_local_hour = hour;
+        shard.business_cache_value = (day >= 1 && day <= 5) && (hour >= 9 && hour <= 17);
+    }
+    return shard.business_cache_value;
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectNonExistentUsers(const std::vector<ConnectionAttempt>& attempts) {
-    std::vector<AttackAlert> alerts;
+int SSHAttackDetector::localHour(Shard& shard, int64_t minute) {
+    isBusinessHours(shard, std::chrono::system_clock::time_point(std::chrono::minutes(minute)));
+    return shard.business_cache_local_hour;
+}
 
-    // Группируем по IP и имени пользователя
-    std::map<std::string, std::map<std::string, std::vector<ConnectionAttempt>>> ip_user_attempts;
+const std::string& SSHAttackDetector::countryOf(const std::string& ip, IpState& state) {
+    if (state.country.empty()) {
+        state.country = getCountryFromIP(ip);
+    }
+    return state.country;
+}
 
-    for (const auto& attempt : attempts) {
-        ip_user_attempts[attempt.ip][attempt.username].push_back(attempt);
+void SSHAttackDetector::detectBruteForce(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    const IpCounters& totals = state.window.totals();
+    if (totals.failed < brute_force_threshold_ && totals.attempts < 5) {
+        return;
     }
 
-    for (const auto& [ip, user_attempts] : ip_user_attempts) {
-        for (const auto& [username, attempts_list] : user_attempts) {
-            if (!userExists(username)) {
-                // Пользователь не существует
-                int failed_attempts = 0;
-                int total_attempts = attempts_list.size();
+    // Скользящее окно по времени событий: берем M минут с наибольшим числом
+    // неудач, чтобы серия на границе окон анализа не терялась
+    const auto& buckets = state.window.buckets();
+    size_t begin = 0;
+    int failed_in_window = 0;
+    int attempts_in_window = 0;
+    int failed_count = -1;
+    int total_attempts = 0;
+    int64_t span_minutes = 0;
+
+    for (size_t end = 0; end < buckets.size(); ++end) {
+        failed_in_window += buckets[end].second.failed;
+        attempts_in_window += buckets[end].second.attempts;
+        while (buckets[end].first - buckets[begin].first >= brute_force_window_minutes_) {
+            failed_in_window -= buckets[begin].second.failed;
+            attempts_in_window -= buckets[begin].second.attempts;
+            begin++;
+        }
+        if (failed_in_window > failed_count ||
+            (failed_in_window == failed_count && attempts_in_window > total_attempts)) {
+            failed_count = failed_in_window;
+            total_attempts = attempts_in_window;
+            span_minutes = buckets[end].first - buckets[begin].first;
+        }
+    }
 
-                for (const auto& attempt : attempts_list) {
-                    if (!attempt.success) {
-                        failed_attempts++;
-                    }
-                }
+    // Расчет метрик brute force атаки
+    double failure_rate = total_attempts > 0 ? static_cast<double>(failed_count) / total_attempts : 0.0;
+
+    // Детекция на основе порогов
+    bool is_brute_force = false;
+    std::string reason;
+
+    if (failed_count >= brute_force_threshold_) {
+        is_brute_force = true;
+        reason = "High number of failed attempts";
+    } else if (failure_rate > 0.8 && total_attempts >= 5) {
+        is_brute_force = true;
+        reason = "High failure rate with multiple attempts";
+    } else if (total_attempts >= 10 && failed_count >= 8) {
+        is_brute_force = true;
+        reason = "Persistent failed attempts";
+
+        // Проверяем распределение по времени (быстрые последовательные попытки)
+        if (span_minutes == 0 && failed_count >= total_attempts - 1) { // почти все неудачи за минуту
+            reason += " (rapid sequential attempts)";
+        }
+    }
 
-                // Детекция подозрительной активности с несуществующими пользователями
-                bool is_suspicious = false;
-                std::string reason;
-                std::string severity = "low";
-
-                if (total_attempts >= 3) {
-                    is_suspicious = true;
-                    reason = "Multiple attempts with non-existent username";
-                    severity = "medium";
-                } else if (failed_attempts >= 2 && total_attempts >= 2) {
-                    is_suspicious = true;
-                    reason = "Failed attempts with non-existent username";
-                    severity = "low";
-                }
+    if (is_brute_force) {
+        AttackAlert alert;
+        alert.type = "brute_force";
+        alert.severity = "high";
+        alert.ip = ip;
+        alert.description = "Brute force attack detected: " + reason +
+                          ". Failed: " + std::to_string(failed_count) +
+                          "/" + std::to_string(total_attempts) +
+                          " attempts in " + std::to_string(brute_force_window_minutes_) + " minutes";
+        alert.details["failed_attempts"] = std::to_string(failed_count);
+        alert.details["total_attempts"] = std::to_string(total_attempts);
+        alert.details["failure_rate"] = std::to_string(failure_rate * 100) + "%";
+        alert.details["time_window_minutes"] = std::to_string(brute_force_window_minutes_);
+        alert.details["reason"] = reason;
+
+        alerts.push_back(alert);
+    }
+}
 
-                // Проверяем, не является ли это опечаткой в распространенном имени
-                if (!is_suspicious && total_attempts >= 2) {
-                    for (const auto& common_user : common_usernames_) {
-                        // Простая проверка на опечатку (разница в 1-2 символа)
-                        size_t common_len = common_user.length();
-                        size_t username_len = username.length();
-                        size_t min_len = std::min(common_len, username_len);
-                        size_t max_len = std::max(common_len, username_len);
-
-                        if (max_len - min_len <= 2) {
-                            // Подсчитываем различия
-                            int differences = 0;
-                            for (size_t i = 0; i < min_len; ++i) {
-                                if (common_user[i] != username[i]) {
-                                    differences++;
-                                }
-                            }
-                            differences += (max_len - min_len);
-
-                            if (differences <= 2) {
-                                is_suspicious = true;
-                                reason = "Possible typo in common username '" + common_user + "'";
-                                severity = "low";
-                                break;
-                            }
-                        }
-                    }
-                }
+void SSHAttackDetector::detectDictionaryAttack(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    const IpCounters& totals = state.window.totals();
+    if (totals.common_attempts == 0) {
+        return;
+    }
 
-                if (is_suspicious) {
-                    AttackAlert alert;
-                    alert.type = "nonexistent_user";
-                    alert.severity = severity;
-                    alert.ip = ip;
-                    alert.username = username;
-                    alert.description = "Suspicious activity with non-existent user '" + username +
-                                      "': " + reason + " (" + std::to_string(total_attempts) + " attempts)";
-                    alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                    alert.details["total_attempts"] = std::to_string(total_attempts);
-                    alert.details["failed_attempts"] = std::to_string(failed_attempts);
-                    alert.details["reason"] = reason;
-
-                    alerts.push_back(alert);
-                }
-            }
+    // Распространенные логины, которые пробовал адрес в окне
+    std::set<std::string> common_user_attempts;
+    for (const auto& [user_id, window] : state.users) {
+        const std::string& username = shard.usernames.name(user_id);
+        if (common_usernames_.count(username)) {
+            common_user_attempts.insert(username);
         }
     }
 
-    return alerts;
+    int total_common_attempts = totals.common_attempts;
+    int failed_common_attempts = totals.common_failed;
+
+    // Детекция dictionary атаки
+    bool is_dictionary_attack = false;
+    std::string reason;
+
+    // Критерий 1: много попыток с распространенными логинами
+    if (total_common_attempts >= 5) {
+        is_dictionary_attack = true;
+        reason = "Multiple attempts with common usernames";
+    }
+    // Критерий 2: много разных распространенных логинов от одного IP
+    else if (common_user_attempts.size() >= 3 && total_common_attempts >= 3) {
+        is_dictionary_attack = true;
+        reason = "Multiple different common usernames tried";
+    }
+    // Критерий 3: последовательные неудачные попытки с разными логинами
+    else if (failed_common_attempts >= 3 && common_user_attempts.size() >= 2 &&
+             totals.common_sequential >= 2) {
+        is_dictionary_attack = true;
+        reason = "Sequential failed attempts with different common usernames";
+    }
+
+    if (is_dictionary_attack) {
+        AttackAlert alert;
+        alert.type = "dictionary_attack";
+        alert.severity = "medium";
+        alert.ip = ip;
+        alert.description = "Dictionary attack detected: " + reason +
+                          ". Common usernames tried: " + std::to_string(common_user_attempts.size()) +
+                          ", Total attempts: " + std::to_string(total_common_attempts);
+        alert.details["common_usernames_tried"] = std::to_string(common_user_attempts.size());
+        alert.details["total_common_attempts"] = std::to_string(total_common_attempts);
+        alert.details["failed_common_attempts"] = std::to_string(failed_common_attempts);
+        alert.details["reason"] = reason;
+
+        std::string usernames_list;
+        for (const auto& username : common_user_attempts) {
+            if (!usernames_list.empty()) usernames_list += ", ";
+            usernames_list += username;
+        }
+        alert.details["usernames"] = usernames_list;
+
+        alerts.push_back(alert);
+    }
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectRootAttempts(const std::vector<ConnectionAttempt>& attempts) {
-    std::vector<AttackAlert> alerts;
+void SSHAttackDetector::detectGeoIPAnomalies(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    const std::string& country = countryOf(ip, state);
 
-    // Группируем по IP для комплексного анализа
-    std::map<std::string, std::vector<ConnectionAttempt>> ip_attempts;
+    // Пропускаем локальные адреса
+    if (country == "LOCAL") {
+        return;
+    }
 
-    for (const auto& attempt : attempts) {
-        ip_attempts[attempt.ip].push_back(attempt);
+    const IpCounters& totals = state.window.totals();
+    int successful_connections = totals.success;
+    int failed_connections = totals.failed;
+    bool unusual_country = normal_countries_.find(country) == normal_countries_.end();
+
+    // Детекция гео-аномалий
+    bool is_geo_anomaly = false;
+    std::string reason;
+    std::string severity = "low";
+
+    // Критерий 1: много подключений из необычной страны
+    if (unusual_country && totals.attempts >= 3) {
+        is_geo_anomaly = true;
+        reason = "Multiple connections from unusual geographic location";
+        severity = "medium";
     }
 
-    for (const auto& [ip, attempts_list] : ip_attempts) {
-        std::vector<ConnectionAttempt> root_attempts;
-        std::set<std::string> other_usernames;
+    // Критерий 2: подозрительная активность из необычной страны
+    if (unusual_country) {
+        // Много неудачных попыток
+        if (failed_connections >= 5 && successful_connections == 0) {
+            is_geo_anomaly = true;
+            reason = "Failed connection attempts from unusual geographic location";
+            severity = "medium";
+        }
 
-        for (const auto& attempt : attempts_list) {
-            if (attempt.username == "root") {
-                root_attempts.push_back(attempt);
-            } else {
-                other_usernames.insert(attempt.username);
-            }
+        // Попытки на нестандартные порты
+        if (totals.nonstandard_port > 0 && totals.attempts >= 2) {
+            is_geo_anomaly = true;
+            reason = "Connection attempts to non-standard ports from unusual geographic location";
+            severity = "high";
         }
 
-        if (root_attempts.empty()) {
-            continue;
+        // Много разных пользователей
+        if (state.users.size() >= 3 && failed_connections >= 3) {
+            is_geo_anomaly = true;
+            reason = "Multiple usernames tried from unusual geographic location";
+            severity = "high";
         }
+    }
 
-        int failed_root_attempts = 0;
-        int successful_root_attempts = 0;
+    // Критерий 3: необычное время подключения из необычной страны
+    if (unusual_country && totals.attempts >= 2 && totals.off_hours > 0 && successful_connections > 0) {
+        is_geo_anomaly = true;
+        reason = "Successful connections outside business hours from unusual geographic location";
+        severity = "high";
+    }
 
-        for (const auto& attempt : root_attempts) {
-            if (attempt.success) {
-                successful_root_attempts++;
-            } else {
-                failed_root_attempts++;
-            }
-        }
+    if (is_geo_anomaly) {
+        AttackAlert alert;
+        alert.type = "geo_ip_anomaly";
+        alert.severity = severity;
+        alert.ip = ip;
+        alert.description = "GeoIP anomaly detected: " + reason +
+                          " (Country: " + country + ", Connections: " +
+                          std::to_string(totals.attempts) + ")";
+        alert.details["country"] = country;
+        alert.details["total_connections"] = std::to_string(totals.attempts);
+        alert.details["successful_connections"] = std::to_string(successful_connections);
+        alert.details["failed_connections"] = std::to_string(failed_connections);
+        alert.details["usernames_tried"] = std::to_string(state.users.size());
+        alert.details["ports_used"] = std::to_string(state.ports.size());
+        alert.details["reason"] = reason;
+
+        alerts.push_back(alert);
+    }
+}
 
-        // Детекция атак на root
-        bool is_root_attack = false;
-        std::string reason;
-        std::string severity = "medium";
+void SSHAttackDetector::detectTimeAnomalies(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    const IpCounters& totals = state.window.totals();
 
-        // Критерий 1: много неудачных попыток входа под root
-        if (failed_root_attempts >= 3) {
-            is_root_attack = true;
-            reason = "Multiple failed root login attempts";
-            severity = failed_root_attempts >= 5 ? "high" : "medium";
+    // Детекция временных аномалий
+    bool is_time_anomaly = false;
+    std::string reason;
+    std::string severity = "low";
+
+    // Критерий 1: успешные подключения в нерабочее время
+    int off_hours_success = totals.off_hours_success;
+    if (off_hours_success > 0) {
+        // Проверяем, является ли это новым паттерном
+        auto last_success = shard.last_successful_login.find(ip);
+        bool is_new_pattern = (last_success == shard.last_successful_login.end() ||
+                             std::chrono::duration_cast<std::chrono::hours>(
+                                 state.last_seen - last_success->second).count() > 24);
+
+        if (is_new_pattern) {
+            is_time_anomaly = true;
+            reason = "Successful login outside business hours";
+            severity = off_hours_success >= 2 ? "medium" : "low";
+            shard.last_successful_login[ip] = state.last_seen;
         }
+    }
 
-        // Критерий 2: успешный вход под root из подозрительного источника
-        if (successful_root_attempts > 0) {
-            std::string country = getCountryFromIP(ip);
-            if (normal_countries_.find(country) == normal_countries_.end() && country != "LOCAL") {
-                is_root_attack = true;
-                reason = "Successful root login from unusual geographic location";
-                severity = "high";
-            }
+    // Критерий 2: подозрительная активность ночью (много неудачных попыток)
+    if (totals.off_hours_failed >= 3 && totals.off_hours >= totals.off_hours_failed) {
+        is_time_anomaly = true;
+        reason = "Multiple failed attempts during off-hours";
+        severity = "medium";
+    }
+
+    // Критерий 3: необычное время для первого подключения с этого IP
+    if (totals.success == 1 && totals.off_hours_success == 1) {
+        // Проверяем, что это первый успешный вход с этого IP
+        auto last_success = shard.last_successful_login.find(ip);
+        if (last_success == shard.last_successful_login.end()) {
+            is_time_anomaly = true;
+            reason = "First successful connection from this IP occurred outside business hours";
+            severity = "low";
+            shard.last_successful_login[ip] = state.last_success;
         }
+    }
 
-        // Критерий 3: root + другие пользователи (dictionary attack на root)
-        if (!other_usernames.empty() && failed_root_attempts >= 2) {
-            is_root_attack = true;
-            reason = "Root login attempts combined with other username attempts";
-            severity = "high";
+    // Критерий 4: регулярные неудачные попытки в нерабочее время
+    if (totals.failed >= 5) {
+        std::map<int, int> hour_attempts; // час -> количество попыток
+        for (const auto& [minute, counters] : state.window.buckets()) {
+            if (counters.failed > 0) {
+                hour_attempts[localHour(shard, minute)] += counters.failed;
+            }
         }
 
-        // Критерий 4: root попытки в нерабочее время
-        bool off_hours_root = false;
-        for (const auto& attempt : root_attempts) {
-            if (!isBusinessHours(attempt.timestamp)) {
-                off_hours_root = true;
+        // Ищем часы с аномально высокой активностью
+        for (const auto& [hour, count] : hour_attempts) {
+            if (count >= 3 && (hour < 6 || hour > 22)) { // ночные часы
+                is_time_anomaly = true;
+                reason = "High activity during unusual hours (hour " + std::to_string(hour) + ")";
+                severity = "medium";
                 break;
             }
         }
+    }
 
-        if (off_hours_root && failed_root_attempts >= 2) {
-            is_root_attack = true;
-            reason = "Root login attempts outside business hours";
+    if (is_time_anomaly) {
+        AttackAlert alert;
+        alert.type = "time_anomaly";
+        alert.severity = severity;
+        alert.ip = ip;
+        alert.description = "Time anomaly detected: " + reason;
+        alert.details["successful_connections"] = std::to_string(totals.success);
+        alert.details["failed_connections"] = std::to_string(totals.failed);
+        alert.details["off_hours_success"] = std::to_string(off_hours_success);
+        alert.details["reason"] = reason;
+
+        if (totals.success > 0) {
+            alert.username = state.last_success_user;
+            alert.details["last_username"] = alert.username;
+        }
+
+        alerts.push_back(alert);
+    }
+}
+
+void SSHAttackDetector::detectNonExistentUsers(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    auto users = users_->snapshot();
+    for (const auto& [user_id, window] : state.users) {
+        const std::string& username = shard.usernames.name(user_id);
+        if (users->exists(username)) {
+            continue;
+        }
+
+        // Пользователь не существует
+        int failed_attempts = window.totals().failed;
+        int total_attempts = window.totals().attempts;
+
+        // Детекция подозрительной активности с несуществующими пользователями
+        bool is_suspicious = false;
+        std::string reason;
+        std::string severity = "low";
+
+        if (total_attempts >= 3) {
+            is_suspicious = true;
+            reason = "Multiple attempts with non-existent username";
             severity = "medium";
+        } else if (failed_attempts >= 2 && total_attempts >= 2) {
+            is_suspicious = true;
+            reason = "Failed attempts with non-existent username";
+            severity = "low";
         }
 
-        // Критерий 5: быстрые последовательные попытки root
-        if (root_attempts.size() >= 3) {
-            std::vector<ConnectionAttempt> sorted_root = root_attempts;
-            std::sort(sorted_root.begin(), sorted_root.end(),
-                     [](const ConnectionAttempt& a, const ConnectionAttempt& b) {
-                         return a.timestamp < b.timestamp;
-                     });
-
-            int rapid_attempts = 0;
-            for (size_t i = 1; i < sorted_root.size(); ++i) {
-                auto time_diff = std::chrono::duration_cast<std::chrono::seconds>(
-                    sorted_root[i].timestamp - sorted_root[i-1].timestamp).count();
-                if (time_diff < 30) { // менее 30 секунд между попытками
-                    rapid_attempts++;
-                }
-            }
+        // Проверяем, не является ли это опечаткой в распространенном имени
+        if (!is_suspicious && total_attempts >= 2) {
+            for (const auto& common_user : common_usernames_) {
+                // Простая проверка на опечатку (разница в 1-2 символа)
+                size_t common_len = common_user.length();
+                size_t username_len = username.length();
+                size_t min_len = std::min(common_len, username_len);
+                size_t max_len = std::max(common_len, username_len);
+
+                if (max_len - min_len <= 2) {
+                    // Подсчитываем различия
+                    int differences = 0;
+                    for (size_t i = 0; i < min_len; ++i) {
+                        if (common_user[i] != username[i]) {
+                            differences++;
+                        }
+                    }
+                    differences += (max_len - min_len);
 
-            if (rapid_attempts >= 2) {
-                is_root_attack = true;
-                reason = "Rapid sequential root login attempts";
-                severity = "high";
+                    if (differences <= 2) {
+                        is_suspicious = true;
+                        reason = "Possible typo in common username '" + common_user + "'";
+                        severity = "low";
+                        break;
+                    }
+                }
             }
         }
 
-        if (is_root_attack) {
+        if (is_suspicious) {
             AttackAlert alert;
-            alert.type = "root_attack";
+            alert.type = "nonexistent_user";
             alert.severity = severity;
             alert.ip = ip;
-            alert.username = "root";
-            alert.description = "Root account attack detected: " + reason +
-                              " (Failed: " + std::to_string(failed_root_attempts) +
-                              ", Successful: " + std::to_string(successful_root_attempts) + ")";
-            alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            alert.details["failed_root_attempts"] = std::to_string(failed_root_attempts);
-            alert.details["successful_root_attempts"] = std::to_string(successful_root_attempts);
-            alert.details["total_root_attempts"] = std::to_string(root_attempts.size());
-            alert.details["other_usernames_tried"] = std::to_string(other_usernames.size());
+            alert.username = username;
+            alert.description = "Suspicious activity with non-existent user '" + username +
+                              "': " + reason + " (" + std::to_string(total_attempts) + " attempts)";
+            alert.details["total_attempts"] = std::to_string(total_attempts);
+            alert.details["failed_attempts"] = std::to_string(failed_attempts);
             alert.details["reason"] = reason;
 
             alerts.push_back(alert);
         }
     }
-
-    return alerts;
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectNonStandardPorts(const std::vector<ConnectionAttempt>& attempts) {
-    std::vector<AttackAlert> alerts;
-
-    // Группируем по IP и порту
-    std::map<std::string, std::map<int, std::vector<ConnectionAttempt>>> ip_port_attempts;
+void SSHAttackDetector::detectRootAttempts(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    const IpCounters& totals = state.window.totals();
 
-    for (const auto& attempt : attempts) {
-        ip_port_attempts[attempt.ip][attempt.port].push_back(attempt);
+    int failed_root_attempts = totals.root_failed;
+    int successful_root_attempts = totals.root_success;
+    int root_attempts = failed_root_attempts + successful_root_attempts;
+    if (root_attempts == 0) {
+        return;
     }
 
-    for (const auto& [ip, port_attempts] : ip_port_attempts) {
-        for (const auto& [port, attempts_list] : port_attempts) {
-            if (standard_ports_.find(port) == standard_ports_.end()) {
-                // Не стандартный порт
-                int successful_connections = 0;
-                int failed_connections = 0;
-                std::set<std::string> usernames_tried;
+    size_t other_usernames = state.users.size() - 1; // root есть в окне, раз есть попытки root
 
-                for (const auto& attempt : attempts_list) {
-                    if (attempt.success) {
-                        successful_connections++;
-                    } else {
-                        failed_connections++;
-                    }
-                    usernames_tried.insert(attempt.username);
-                }
-
-                // Детекция подозрительной активности на нестандартных портах
-                bool is_port_scan = false;
-                std::string reason;
-                std::string severity = "low";
-
-                // Критерий 1: много попыток на нестандартный порт
-                if (attempts_list.size() >= 3) {
-                    is_port_scan = true;
-                    reason = "Multiple connection attempts to non-standard port";
-                    severity = "medium";
-                }
+    // Детекция атак на root
+    bool is_root_attack = false;
+    std::string reason;
+    std::string severity = "medium";
 
-                // Критерий 2: сканирование разных портов одним IP
-                if (port_attempts.size() >= 3) { // этот IP пробовал 3+ разных порта
-                    int non_standard_ports = 0;
-                    for (const auto& [p, _] : port_attempts) {
-                        if (standard_ports_.find(p) == standard_ports_.end()) {
-                            non_standard_ports++;
-                        }
-                    }
+    // Критерий 1: много неудачных попыток входа под root
+    if (failed_root_attempts >= 3) {
+        is_root_attack = true;
+        reason = "Multiple failed root login attempts";
+        severity = failed_root_attempts >= 5 ? "high" : "medium";
+    }
 
-                    if (non_standard_ports >= 2) {
-                        is_port_scan = true;
-                        reason = "Port scanning activity detected";
-                        severity = "high";
-                    }
-                }
+    // Критерий 2: успешный вход под root из подозрительного источника
+    if (successful_root_attempts > 0) {
+        const std::string& country = countryOf(ip, state);
+        if (normal_countries_.find(country) == normal_countries_.end() && country != "LOCAL") {
+            is_root_attack = true;
+            reason = "Successful root login from unusual geographic location";
+            severity = "high";
+        }
+    }
 
-                // Критерий 3: успешное подключение к подозрительному порту
-                if (successful_connections > 0) {
-                    // Успешное подключение к нестандартному порту может быть легитимным
-                    // но все равно подозрительно
-                    is_port_scan = true;
-                    reason = "Successful connection to non-standard port";
-                    severity = "medium";
-                }
+    // Критерий 3: root + другие пользователи (dictionary attack на root)
+    if (other_usernames > 0 && failed_root_attempts >= 2) {
+        is_root_attack = true;
+        reason = "Root login attempts combined with other username attempts";
+        severity = "high";
+    }
 
-                // Критерий 4: комбинация с другими подозрительными активностями
-                std::string country = getCountryFromIP(ip);
-                if (normal_countries_.find(country) == normal_countries_.end() && country != "LOCAL") {
-                    if (attempts_list.size() >= 2) {
-                        is_port_scan = true;
-                        reason = "Non-standard port attempts from unusual geographic location";
-                        severity = "high";
-                    }
-                }
+    // Критерий 4: root попытки в нерабочее время
+    if (totals.root_off_hours > 0 && failed_root_attempts >= 2) {
+        is_root_attack = true;
+        reason = "Root login attempts outside business hours";
+        severity = "medium";
+    }
 
-                if (is_port_scan) {
-                    AttackAlert alert;
-                    alert.type = "non_standard_port";
-                    alert.severity = severity;
-                    alert.ip = ip;
-                    alert.description = "Port scanning detected: " + reason +
-                                      " (Port: " + std::to_string(port) +
-                                      ", Attempts: " + std::to_string(attempts_list.size()) + ")";
-                    alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                    alert.details["port"] = std::to_string(port);
-                    alert.details["attempts_on_port"] = std::to_string(attempts_list.size());
-                    alert.details["successful_connections"] = std::to_string(successful_connections);
-                    alert.details["failed_connections"] = std::to_string(failed_connections);
-                    alert.details["usernames_tried"] = std::to_string(usernames_tried.size());
-                    alert.details["total_ports_scanned"] = std::to_string(port_attempts.size());
-                    alert.details["reason"] = reason;
-
-                    alerts.push_back(alert);
-                }
-            }
-        }
+    // Критерий 5: быстрые последовательные попытки root (менее 30 секунд между попытками)
+    if (root_attempts >= 3 && totals.root_rapid >= 2) {
+        is_root_attack = true;
+        reason = "Rapid sequential root login attempts";
+        severity = "high";
     }
 
-    return alerts;
+    if (is_root_attack) {
+        AttackAlert alert;
+        alert.type = "root_attack";
+        alert.severity = severity;
+        alert.ip = ip;
+        alert.username = "root";
+        alert.description = "Root account attack detected: " + reason +
+                          " (Failed: " + std::to_string(failed_root_attempts) +
+                          ", Successful: " + std::to_string(successful_root_attempts) + ")";
+        alert.details["failed_root_attempts"] = std::to_string(failed_root_attempts);
+        alert.details["successful_root_attempts"] = std::to_string(successful_root_attempts);
+        alert.details["total_root_attempts"] = std::to_string(root_attempts);
+        alert.details["other_usernames_tried"] = std::to_string(other_usernames);
+        alert.details["reason"] = reason;
+
+        alerts.push_back(alert);
+    }
 }
 
-std::vector<AttackAlert> SSHAttackDetector::detectPostLoginAnomalies(const std::vector<ConnectionAttempt>& attempts) {
-    std::vector<AttackAlert> alerts;
-
-    // Группируем по IP для анализа поведения после входа
-    std::map<std::string, std::vector<ConnectionAttempt>> ip_attempts;
+void SSHAttackDetector::detectNonStandardPorts(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    if (state.window.totals().nonstandard_port == 0) {
+        return;
+    }
 
-    for (const auto& attempt : attempts) {
-        if (attempt.success) { // только успешные входы
-            ip_attempts[attempt.ip].push_back(attempt);
+    int non_standard_ports = 0;
+    for (const auto& [port, window] : state.ports) {
+        if (standard_ports_.find(port) == standard_ports_.end()) {
+            non_standard_ports++;
         }
     }
 
-    for (const auto& [ip, attempts_list] : ip_attempts) {
-        if (attempts_list.size() < 2) {
-            continue; // недостаточно данных для анализа
+    for (const auto& [port, window] : state.ports) {
+        if (standard_ports_.find(port) != standard_ports_.end()) {
+            continue;
         }
 
-        // Сортируем по времени
-        std::vector<ConnectionAttempt> sorted_attempts = attempts_list;
-        std::sort(sorted_attempts.begin(), sorted_attempts.end(),
-                 [](const ConnectionAttempt& a, const ConnectionAttempt& b) {
-                     return a.timestamp < b.timestamp;
-                 });
+        // Не стандартный порт
+        int attempts_on_port = window.totals().attempts;
+        int successful_connections = window.totals().success;
+        int failed_connections = window.totals().failed;
 
-        // Анализируем паттерны поведения после входа
-        bool is_post_login_anomaly = false;
+        // Детекция подозрительной активности на нестандартных портах
+        bool is_port_scan = false;
         std::string reason;
         std::string severity = "low";
 
-        // Критерий 1: частые переподключения (возможное использование сессии)
-        if (sorted_attempts.size() >= 3) {
-            int short_sessions = 0;
-            for (size_t i = 1; i < sorted_attempts.size(); ++i) {
-                auto session_duration = std::chrono::duration_cast<std::chrono::minutes>(
-                    sorted_attempts[i].timestamp - sorted_attempts[i-1].timestamp).count();
-
-                if (session_duration < 5) { // сессия короче 5 минут
-                    short_sessions++;
-                }
-            }
-
-            if (short_sessions >= 2) {
-                is_post_login_anomaly = true;
-                reason = "Frequent short sessions detected";
-                severity = "medium";
-            }
-        }
-
-        // Критерий 2: подключения в необычное время после первого входа
-        auto first_login = sorted_attempts.front().timestamp;
-        bool has_unusual_timing = false;
-
-        for (size_t i = 1; i < sorted_attempts.size(); ++i) {
-            auto time_diff = std::chrono::duration_cast<std::chrono::hours>(
-                sorted_attempts[i].timestamp - first_login).count();
-
-            if (time_diff > 24) { // спустя сутки и более
-                if (!isBusinessHours(sorted_attempts[i].timestamp)) {
-                    has_unusual_timing = true;
-                    break;
-                }
-            }
-        }
-
-        if (has_unusual_timing) {
-            is_post_login_anomaly = true;
-            reason = "Unusual timing pattern after initial login";
-            severity = "low";
-        }
-
-        // Критерий 3: смена пользователей с одного IP (возможное использование сессии)
-        std::set<std::string> usernames;
-        for (const auto& attempt : attempts_list) {
-            usernames.insert(attempt.username);
+        // Критерий 1: много попыток на нестандартный порт
+        if (attempts_on_port >= 3) {
+            is_port_scan = true;
+            reason = "Multiple connection attempts to non-standard port";
+            severity = "medium";
         }
 
-        if (usernames.size() >= 3 && attempts_list.size() >= 5) {
-            is_post_login_anomaly = true;
-            reason = "Multiple different users from same IP after successful logins";
+        // Критерий 2: сканирование разных портов одним IP
+        if (state.ports.size() >= 3 && non_standard_ports >= 2) { // этот IP пробовал 3+ разных порта
+            is_port_scan = true;
+            reason = "Port scanning activity detected";
             severity = "high";
         }
 
-        // Критерий 4: подозрительная геолокация с повторяющимися входами
-        std::string country = getCountryFromIP(ip);
-        if (normal_countries_.find(country) == normal_countries_.end() && country != "LOCAL") {
-            if (attempts_list.size() >= 3) {
-                is_post_login_anomaly = true;
-                reason = "Multiple successful logins from unusual geographic location";
-                severity = "medium";
-            }
+        // Критерий 3: успешное подключение к подозрительному порту
+        if (successful_connections > 0) {
+            // Успешное подключение к нестандартному порту может быть легитимным
+            // но все равно подозрительно
+            is_port_scan = true;
+            reason = "Successful connection to non-standard port";
+            severity = "medium";
         }
 
-        // Критерий 5: аномальная частота входов
-        if (sorted_attempts.size() >= 5) {
-            auto total_duration = std::chrono::duration_cast<std::chrono::hours>(
-                sorted_attempts.back().timestamp - sorted_attempts.front().timestamp).count();
-
-            if (total_duration > 0) {
-                double avg_logins_per_hour = static_cast<double>(sorted_attempts.size()) / total_duration;
-
-                if (avg_logins_per_hour > 2.0) { // более 2 входов в час
-                    is_post_login_anomaly = true;
-                    reason = "High frequency of logins from same IP";
-                    severity = "medium";
-                }
+        // Критерий 4: комбинация с другими подозрительными активностями
+        const std::string& country = countryOf(ip, state);
+        if (normal_countries_.find(country) == normal_countries_.end() && country != "LOCAL") {
+            if (attempts_on_port >= 2) {
+                is_port_scan = true;
+                reason = "Non-standard port attempts from unusual geographic location";
+                severity = "high";
             }
         }
 
-        if (is_post_login_anomaly) {
+        if (is_port_scan) {
             AttackAlert alert;
-            alert.type = "post_login_anomaly";
+            alert.type = "non_standard_port";
             alert.severity = severity;
             alert.ip = ip;
-            alert.username = sorted_attempts.back().username; // последний пользователь
-            alert.description = "Post-login anomaly detected: " + reason +
-                              " (" + std::to_string(attempts_list.size()) + " successful logins)";
-            alert.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-            alert.details["successful_logins"] = std::to_string(attempts_list.size());
-            alert.details["unique_users"] = std::to_string(usernames.size());
-            alert.details["country"] = getCountryFromIP(ip);
+            alert.description = "Port scanning detected: " + reason +
+                              " (Port: " + std::to_string(port) +
+                              ", Attempts: " + std::to_string(attempts_on_port) + ")";
+            alert.details["port"] = std::to_string(port);
+            alert.details["attempts_on_port"] = std::to_string(attempts_on_port);
+            alert.details["successful_connections"] = std::to_string(successful_connections);
+            alert.details["failed_connections"] = std::to_string(failed_connections);
+            alert.details["total_ports_scanned"] = std::to_string(state.ports.size());
             alert.details["reason"] = reason;
 
-            // Добавляем временные метрики
-            if (!sorted_attempts.empty()) {
-                auto first = sorted_attempts.front().timestamp;
-                auto last = sorted_attempts.back().timestamp;
-                auto duration_hours = std::chrono::duration_cast<std::chrono::hours>(last - first).count();
-                alert.details["observation_period_hours"] = std::to_string(duration_hours);
+            alerts.push_back(alert);
+        }
+    }
+}
 
-                if (duration_hours > 0) {
-                    double avg_per_hour = static_cast<double>(attempts_list.size()) / duration_hours;
-                    alert.details["avg_logins_per_hour"] = std::to_string(avg_per_hour);
-                }
-            }
+void SSHAttackDetector::detectPostLoginAnomalies(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts) {
+    const IpCounters& totals = state.window.totals();
+    int successful_logins = totals.success;
+    if (successful_logins < 2) {
+        return; // недостаточно данных для анализа
+    }
 
-            alerts.push_back(alert);
+    // Анализируем паттерны поведения после входа. Проверки, которым нужен
+    // интервал больше часа между входами, в часовом окне сработать не могут
+    bool is_post_login_anomaly = false;
+    std::string reason;
+    std::string severity = "low";
+
+    // Критерий 1: частые переподключения (сессии короче 5 минут)
+    if (successful_logins >= 3 && totals.short_sessions >= 2) {
+        is_post_login_anomaly = true;
+        reason = "Frequent short sessions detected";
+        severity = "medium";
+    }
+
+    // Критерий 2: смена пользователей с одного IP (возможное использование сессии)
+    size_t usernames = 0;
+    for (const auto& [user_id, window] : state.users) {
+        if (window.totals().success > 0) {
+            usernames++;
         }
     }
 
-    return alerts;
-}
\ No newline at end of file
+    if (usernames >= 3 && successful_logins >= 5) {
+        is_post_login_anomaly = true;
+        reason = "Multiple different users from same IP after successful logins";
+        severity = "high";
+    }
+
+    // Критерий 3: подозрительная геолокация с повторяющимися входами
+    const std::string& country = countryOf(ip, state);
+    if (normal_countries_.find(country) == normal_countries_.end() && country != "LOCAL") {
+        if (successful_logins >= 3) {
+            is_post_login_anomaly = true;
+            reason = "Multiple successful logins from unusual geographic location";
+            severity = "medium";
+        }
+    }
+
+    if (is_post_login_anomaly) {
+        AttackAlert alert;
+        alert.type = "post_login_anomaly";
+        alert.severity = severity;
+        alert.ip = ip;
+        alert.username = state.last_success_user; // последний пользователь
+        alert.description = "Post-login anomaly detected: " + reason +
+                          " (" + std::to_string(successful_logins) + " successful logins)";
+        alert.details["successful_logins"] = std::to_string(successful_logins);
+        alert.details["unique_users"] = std::to_string(usernames);
+        alert.details["country"] = country;
+        alert.details["reason"] = reason;
+
+        alerts.push_back(alert);
+    }
+}
@@ -8,13 +8,25 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <chrono>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
 #include "sshConfig.h"
+#include "sshLogParser.h"
+#include "slidingWindow.h"
+#include "attemptStore.h"
+#include "cardinalitySketch.h"
+
+class UserDirectory;
+class UserSnapshot;
+class WorkerPool;
 
 /**
  * @brief Структура, представляющая попытку SSH соединения
@@ -35,69 +47,333 @@ struct AttackAlert {
     std::string type;       /**< Type of attack detected */
     std::string severity;   /**< Severity level: "critical", "high", "medium", "low" */
     std::string description;/**< Description of the attack */
-    std::string ip;         /**< Attacker IP address */
+    std::string ip;         /**< Attacker IP address (сеть или пусто у оповещений по многим адресам) */
     std::string username;   /**< Target username */
     std::string timestamp;  /**< Time of detection */
+    int failed_attempts = 0;/**< Неудачных попыток с адреса (и пользователя, если указан) в окне */
+    int successful_logins = 0; /**< Успешных входов с адреса в окне (0 у оповещений по многим адресам) */
     std::map<std::string, std::string> details; /**< Additional attack details */
 };
 
+/**
+ * @brief Счетчики детектора
+ */
+struct DetectorStats {
+    uint64_t attempts = 0;       /**< Принято попыток */
+    uint64_t late_attempts = 0;  /**< Отброшено: окно уже посчитано */
+    uint64_t untimed_events = 0; /**< Строк с неразборной меткой времени (время предыдущей строки, до первой - пропущены) */
+    uint64_t windows = 0;        /**< Посчитано окон анализа */
+    uint64_t suppressed = 0;     /**< Повторных оповещений подавлено */
+    uint64_t escalated = 0;      /**< Оповещений о росте серьезности */
+    uint64_t renotified = 0;     /**< Напоминаний о продолжающейся атаке */
+    uint64_t allowlisted = 0;    /**< Оповещений о доверенных сетях (не выдано) */
+    uint64_t active_ips = 0;     /**< Адресов с попытками в окне */
+    uint64_t spray_keys = 0;     /**< Имен и сетей под наблюдением распределенных детекторов */
+    uint64_t spray_untracked = 0;/**< Неудач по новым именам и сетям сверх предела ключей */
+    uint64_t shards = 0;         /**< Число шардов состояния */
+};
+
 /**
  * @brief SSH attack detection and monitoring class
+ *
+ * Попытки несут время события (метку из лога). Детектор держит watermark -
+ * самую позднюю метку минус допустимое опоздание - и считает окна анализа
+ * (шаг равен окну brute force, глубина - час) только когда watermark прошел
+ * их конец. Поэтому разбор исторического лога и живой мониторинг дают одни
+ * и те же оповещения с временем атаки, а не временем разбора.
+ *
+ * Попытки не хранятся: по мере закрытия окон они по порядку времени
+ * раскладываются в поминутные счетчики по IP, IP x пользователь, IP x порт
+ * и пользователю, а устаревшие минуты вычитаются. Детекторы читают готовые
+ * суммы и смотрят только адреса, по которым были новые попытки, поэтому
+ * время анализа не растет с числом попыток в окне.
+ *
+ * Состояние разбито на шарды по хэшу IP, у каждого свой мьютекс: прием
+ * попыток с разных потоков блокирует только свой шард, а окно считается
+ * по шардам параллельно. Признаки, которым нужны данные нескольких адресов
+ * (сколько адресов пробовали пользователя), собираются из сводок шардов
+ * после параллельного прохода.
+ *
+ * Медленные распределенные атаки (ботнет пробует каждое имя раз в час с
+ * тысяч адресов) по одному адресу не видны, поэтому неудачи еще раз
+ * складываются по имени и по сети /16 (/48 для IPv6) за сутки: HyperLogLog
+ * различных адресов и имен по корзинам в 4 часа и затухающие счетчики
+ * темпа неудач. Память на ключ ограничена размером скетча, число ключей -
+ * пределом, поэтому размер ботнета на нее не влияет.
  */
 class SSHAttackDetector {
 private:
-    struct ConnectionAttempt {
-        std::string ip;
-        std::string username;
-        std::chrono::system_clock::time_point timestamp;
-        bool success;
-        int port;
+    // Счетчики одной минуты по адресу
+    struct IpCounters {
+        int attempts = 0;
+        int failed = 0;
+        int success = 0;
+        int off_hours = 0;           // Вне рабочего времени
+        int off_hours_failed = 0;
+        int off_hours_success = 0;
+        int root_failed = 0;
+        int root_success = 0;
+        int root_off_hours = 0;
+        int root_rapid = 0;          // Попытка root через < 30 с после предыдущей
+        int common_attempts = 0;     // Распространенные логины (admin, test, ...)
+        int common_failed = 0;
+        int common_sequential = 0;   // Неудача с распространенным логином, следующая попытка через < 5 мин
+        int nonstandard_port = 0;
+        int short_sessions = 0;      // Успешный вход через < 5 мин после предыдущего
+
+        IpCounters& operator+=(const IpCounters& other);
+        IpCounters& operator-=(const IpCounters& other);
     };
-    
-    std::vector<ConnectionAttempt> recent_attempts_;
-    std::mutex attempts_mutex_;
+
+    // Счетчики одной минуты для пары (IP x пользователь, IP x порт) и пользователя
+    struct PairCounters {
+        int attempts = 0;
+        int failed = 0;
+        int success = 0;
+
+        PairCounters& operator+=(const PairCounters& other);
+        PairCounters& operator-=(const PairCounters& other);
+    };
+
+    struct IpState {
+        SlidingWindow<IpCounters> window;
+        std::unordered_map<uint32_t, SlidingWindow<PairCounters>> users;  // По номеру имени в шарде
+        std::map<int, SlidingWindow<PairCounters>> ports;
+        std::chrono::system_clock::time_point last_seen{};
+        std::chrono::system_clock::time_point last_root{};
+        std::chrono::system_clock::time_point last_success{};
+        std::string last_success_user;
+        bool last_failed_common = false;
+        int64_t last_minute = 0;     // Последняя минута в колесе устаревания
+        bool dirty = false;          // Были попытки после последнего анализа
+        std::string country;         // GeoIP, определяется один раз
+    };
+
+    // Состояние оповещения по ключу тип|ip|пользователь
+    struct AlertState {
+        int severity = 0;                                 // Наибольшая сообщенная серьезность
+        std::chrono::system_clock::time_point notified{}; // Когда сообщали последний раз
+        std::chrono::system_clock::time_point active{};   // Когда условие выполнялось последний раз
+    };
+
+    struct AlertPolicy {
+        std::chrono::seconds quiet{30 * 60};     // Сколько условие должно не выполняться, чтобы новое срабатывание было новым инцидентом
+        std::chrono::seconds renotify{60 * 60};  // Напоминание о продолжающейся атаке (0 - не напоминать)
+    };
+
+    struct UserState {
+        SlidingWindow<PairCounters> window;
+        int ips = 0;                 // Адресов, пробовавших этого пользователя в окне
+    };
+
+    // Неудачи по имени за окно распределенных атак
+    struct SprayUser {
+        WindowedSketch sources;      // Адреса с неудачами
+        WindowedSketch heavy;        // Из них перебиравшие имя чаще 3 раз в час
+        bool dirty = false;
+    };
+
+    // Неудачи из сети /16 (/48) за окно распределенных атак
+    struct SprayNetwork {
+        WindowedSketch usernames;    // Различные имена
+        WindowedSketch sources;      // Адреса сети с неудачами
+        bool dirty = false;
+    };
+
+    // Шард: адреса с одинаковым hash(IP) % N и все, что о них известно
+    struct Shard {
+        std::mutex mutex;
+
+        // Адреса и имена хранятся один раз, дальше везде номера
+        AddressTable addresses;
+        SymbolTable usernames;
+
+        // Окно: попытки ждут в буфере упорядочивания, пока их окно не закроется
+        AttemptStore pending;
+        std::unordered_map<uint32_t, IpState> ips;
+        std::unordered_map<uint32_t, UserState> users;  // Сводка по пользователям адресов шарда
+        std::deque<std::pair<int64_t, std::vector<uint32_t>>> minute_wheel;  // Адреса по минутам
+        std::vector<uint32_t> dirty_ips;
+        std::map<std::string, std::chrono::system_clock::time_point> last_successful_login;
+
+        // Распределенные атаки: адрес живет в одном шарде, поэтому множества
+        // адресов шардов не пересекаются, а имена и сети объединяются при оценке
+        std::unordered_map<std::string, SprayUser> spray_users;
+        std::unordered_map<IpAddress, SprayNetwork> spray_networks;
+        std::vector<std::string> dirty_spray_users;
+        std::vector<IpAddress> dirty_spray_networks;
+        int64_t spray_expired_bucket = 0;   // Корзины до этой включительно устарели
+        DecayedCounter failures_short;      // Темп неудач за минуты
+        DecayedCounter failures_long;       // Обычный темп неудач за часы
+        std::chrono::system_clock::time_point first_failure{};
+        uint64_t spray_untracked = 0;
+
+        std::chrono::system_clock::time_point max_event_time{};  // Самая поздняя метка в шарде
+        std::chrono::system_clock::time_point closed_until{std::chrono::system_clock::time_point::min()};  // Окна до этой метки посчитаны
+        uint64_t attempts = 0;
+        uint64_t late_attempts = 0;
+
+        // localtime заметен при разборе больших логов, кэш по четверти часа
+        int64_t business_cache_quarter = -1;
+        int business_cache_local_hour = 0;
+        bool business_cache_value = false;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::unique_ptr<WorkerPool> workers_;  // Потоки для проходов по шардам, создаются один раз
+    std::mutex control_mutex_;   // Watermark, курсор окон, подавление повторов
+    std::mutex sessions_mutex_;  // failed_sessions_, invalid_sessions_, last_event_time_, untimed_events_
+
+    // Время событий: все окна считаются по меткам из лога, а не по часам машины
+    std::chrono::system_clock::time_point max_event_time_{};  // Самая поздняя метка по всем шардам
+    std::chrono::system_clock::time_point watermark_{};       // События до этой метки уже не придут
+    std::chrono::system_clock::time_point next_evaluation_{}; // Конец следующего окна анализа
+    std::chrono::system_clock::time_point next_spray_evaluation_{}; // Следующая оценка имен и сетей за сутки
+    std::chrono::seconds allowed_lateness_{60};
+    std::chrono::seconds evaluation_interval_{0};              // Шаг окон анализа (0 - окно brute force)
+    bool has_events_ = false;
+    std::unordered_map<std::string, AlertState> alert_states_;  // Подавление повторов по тип|ip|пользователь
+    AlertPolicy default_alert_policy_;
+    std::map<std::string, AlertPolicy> alert_policies_;         // Переопределения по типу атаки
+    DetectorStats stats_;
+
     
     // Конфигурация
     int brute_force_threshold_;  // N попыток
     int brute_force_window_minutes_;  // M минут
     std::set<std::string> common_usernames_;
-    std::set<std::string> existing_users_;
+    UserDirectory* users_;  // Локальные учетные записи, общий каталог процесса
     std::set<std::string> normal_countries_;
     std::set<int> standard_ports_ = {22};
-    std::map<std::string, std::chrono::system_clock::time_point> last_successful_login_;
+    std::set<std::string> failed_sessions_;  // PID сессий sshd, по которым уже учтена неудача
+    std::set<std::string> invalid_sessions_; // "Invalid user" учтен, первый "Failed password" сессии - та же попытка
+    std::chrono::system_clock::time_point last_event_time_{};  // Метка последней строки с разобранным временем
+    uint64_t untimed_events_ = 0;
+
+    // Распределенные атаки
+    int spray_window_hours_ = 24;             // Окно: шесть корзин по spray_window_hours_ / 6
+    int spray_min_sources_ = 10;              // Адресов на одно имя для password_spray
+    int spray_network_min_usernames_ = 20;    // Имен из одной сети для distributed_dictionary
+    int failure_spike_factor_ = 5;            // Во сколько раз темп неудач выше обычного
+    int failure_spike_min_per_minute_ = 30;
+    size_t spray_max_keys_ = 200000;          // Имен и сетей на все шарды
     
     // GeoIP
     std::string getCountryFromIP(const std::string& ip);
-    static void cleanupGeoIP();
+    const std::string& countryOf(const std::string& ip, IpState& state);
     
+    // Шарды
+    Shard& shardFor(const IpAddress& ip);
+    Shard& shardFor(std::string_view ip);
+    void appendAttempt(Shard& shard, uint32_t ip_id, std::string_view username, bool success, int port,
+                       std::chrono::system_clock::time_point event_time);
+    template <typename Function>
+    void forEachShard(Function&& function);
+    void refreshWatermark();
+
     // Анализ времени
-    bool isBusinessHours(const std::chrono::system_clock::time_point& time);
+    std::chrono::system_clock::time_point currentTime() const;
+    void ingest(Shard& shard, const StoredAttempt& attempt, const UserSnapshot& users);
+    void ingestUntil(Shard& shard, std::chrono::system_clock::time_point time);
+    void expireUntil(Shard& shard, std::chrono::system_clock::time_point time);
+    void eraseIp(Shard& shard, std::unordered_map<uint32_t, IpState>::iterator it);
+    void ingestSpray(Shard& shard, const StoredAttempt& attempt, const std::string& username, int pair_failed);
+    void expireSpray(Shard& shard, std::chrono::system_clock::time_point time);
+    int64_t sprayBucket(std::chrono::system_clock::time_point time) const;
+    void evaluateShard(Shard& shard, bool dirty_only, std::vector<AttackAlert>& alerts);
+    void mergeShardSummaries(std::vector<AttackAlert>& alerts);
+    std::vector<AttackAlert> evaluateClosedWindows(bool flush = false);
+    std::chrono::system_clock::duration evaluationStep() const;
+    const AlertPolicy& alertPolicy(const std::string& type) const;
+    bool admitAlert(AttackAlert& alert, std::chrono::system_clock::time_point now);
+    bool isBusinessHours(Shard& shard, const std::chrono::system_clock::time_point& time);
+    int localHour(Shard& shard, int64_t minute);
     
     // Управление пользователями
-    void loadExistingUsers();
     bool userExists(const std::string& username);
     
-    // Методы обнаружения
-    std::vector<AttackAlert> detectBruteForce(const std::vector<ConnectionAttempt>& attempts);
-    std::vector<AttackAlert> detectDictionaryAttack(const std::vector<ConnectionAttempt>& attempts);
-    std::vector<AttackAlert> detectGeoIPAnomalies(const std::vector<ConnectionAttempt>& attempts);
-    std::vector<AttackAlert> detectTimeAnomalies(const std::vector<ConnectionAttempt>& attempts);
-    std::vector<AttackAlert> detectNonExistentUsers(const std::vector<ConnectionAttempt>& attempts);
-    std::vector<AttackAlert> detectRootAttempts(const std::vector<ConnectionAttempt>& attempts);
-    std::vector<AttackAlert> detectNonStandardPorts(const std::vector<ConnectionAttempt>& attempts);
-    std::vector<AttackAlert> detectPostLoginAnomalies(const std::vector<ConnectionAttempt>& attempts);
+    // Методы обнаружения (по одному адресу, по готовым счетчикам окна)
+    void detectBruteForce(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+    void detectDictionaryAttack(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+    void detectGeoIPAnomalies(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+    void detectTimeAnomalies(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+    void detectNonExistentUsers(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+    void detectRootAttempts(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+    void detectNonStandardPorts(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+    void detectPostLoginAnomalies(Shard& shard, const std::string& ip, IpState& state, std::vector<AttackAlert>& alerts);
+
+    // Методы обнаружения по многим адресам (после прохода по шардам)
+    void detectDistributedAttacks(std::chrono::system_clock::time_point now, bool dirty_only, bool evaluate_keys,
+                                  std::vector<AttackAlert>& alerts);
     
 public:
-    SSHAttackDetector();
+    /**
+     * @param shards Число шардов состояния (0 - по числу ядер)
+     */
+    explicit SSHAttackDetector(size_t shards = 0);
     ~SSHAttackDetector();
     
     bool loadConfig(const std::string& config_path = "");
+    // Каталог учетных записей вместо системного (до первой попытки), например
+    // passwd синтетического трафика в bench-traffic
+    void setUserDirectory(UserDirectory* users);
+    // Следить за изменениями каталога учетных записей (inotify и фоновый поток);
+    // нужно только долгоживущему мониторингу, разовый разбор лога обходится снимком
+    void watchUserDirectory();
     void setBruteForceThreshold(int attempts, int window_minutes);
+    // Окно распределенных атак (password_spray, distributed_dictionary, по умолчанию сутки)
+    void setSprayWindow(int hours);
     
     void addConnectionAttempt(const std::string& ip, const std::string& username, 
                              bool success, int port = 22);
+    void addConnectionAttempt(const std::string& ip, const std::string& username,
+                             bool success, int port, std::chrono::system_clock::time_point event_time);
+    // Адрес уже разобран (SshLogEvent::address): ни разбора, ни хэша, ни копии текста
+    void addConnectionAttempt(const IpAddress& ip, std::string_view username,
+                             bool success, int port, std::chrono::system_clock::time_point event_time);
+    // Строка без разборной метки получает время предыдущей (разбор истории);
+    // живой мониторинг передает время чтения сам через вторую перегрузку
+    void addLogEvent(const SshLogEvent& event);
+    // Метка уже разобрана (parseSshTimestamp), например потоком разбора лога
+    void addLogEvent(const SshLogEvent& event, std::chrono::system_clock::time_point event_time);
     std::vector<AttackAlert> analyze();
-    
-    void clearOldAttempts(int minutes = 60);
-    std::vector<ConnectionAttempt> getRecentAttempts(int minutes = 60);
+
+    // Потоковый режим: окна, закрытые watermark. Оповещение выдается при
+    // новом срабатывании, росте серьезности или раз в интервал напоминания
+    std::vector<AttackAlert> pollAlerts();
+    std::vector<AttackAlert> flushAlerts();
+    void advanceWatermark(std::chrono::system_clock::time_point time);
+    void setAllowedLateness(std::chrono::seconds lateness);
+    // Шаг закрытия окон (по умолчанию равен окну brute force). Окна скользящие,
+    // поэтому короткий шаг только ускоряет оповещения: повторы подавляются
+    void setEvaluationInterval(std::chrono::seconds interval);
+    void setAlertSuppression(std::chrono::seconds quiet, std::chrono::seconds renotify,
+                             const std::string& type = "");
+    std::chrono::system_clock::time_point getWatermark();
+    DetectorStats getStats();
+
+    /**
+     * @brief Записать состояние (окна, буфер упорядочивания, подавление повторов)
+     * @param out Двоичная запись дописывается в конец строки
+     */
+    void saveState(std::string& out);
+
+    /**
+     * @brief Восстановить состояние в только что созданный детектор
+     *
+     * Детектор должен быть создан с числом шардов stateShards(state).
+     * @return False если запись повреждена или от другой версии
+     */
+    bool loadState(std::string_view state);
+
+    /**
+     * @brief Число шардов в записи состояния (0 - запись не подходит)
+     */
+    static size_t stateShards(std::string_view state);
+
+    /**
+     * @brief Создать детектор из записи состояния
+     * @return nullptr если запись не подходит
+     */
+    static std::unique_ptr<SSHAttackDetector> fromState(std::string_view state);
 };
@@ -6,7 +6,9 @@
  */
 
 #include "sshConfig.h"
+#include "sshConfigResolver.h"
 #include <regex>
+#include <strings.h>
 
 SSHConfig::SSHConfig() : config_path_("/etc/ssh/sshd_config") {
     loadConfig();
@@ -16,8 +18,13 @@ SSHConfig::SSHConfig(const std::string& configPath) : config_path_(configPath) {
     loadConfig();
 }
 
+SSHConfig::SSHConfig(const std::string& configPath, const std::string& content) : config_path_(configPath) {
+    loadFromString(content);
+}
+
 bool SSHConfig::loadConfig() {
     settings_.clear();
+    resolved_settings_.clear();
     original_lines_.clear();
     last_error_.clear();
     
@@ -31,17 +38,55 @@ bool SSHConfig::loadConfig() {
     return true;
 }
 
+void SSHConfig::loadFromString(const std::string& content) {
+    settings_.clear();
+    resolved_settings_.clear();
+    original_lines_.clear();
+    last_error_.clear();
+
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == std::string::npos) {
+            end = content.size();
+        }
+        original_lines_.emplace_back(content, start, end - start);
+        start = end + 1;
+    }
+    parseConfig();
+}
+
 void SSHConfig::parseConfig() {
+    // Строки самого файла для правки: как у sshd, действует первое значение,
+    // а строки после Match относятся к блокам и не меняют глобальные настройки
     for (const auto& line : original_lines_) {
         if (isComment(line)) {
             continue;
         }
         
         auto [key, value] = parseLine(line);
+        if (isMatchLine(key)) {
+            break;
+        }
         if (!key.empty()) {
-            settings_[key] = value;
+            settings_.emplace(key, value);
         }
     }
+
+    // Анализ идет по тому же разбору, что и smssh effective: с файлами из
+    // Include (значение из включенного файла может оказаться первым)
+    std::string content;
+    for (const auto& line : original_lines_) {
+        content += line;
+        content += '\n';
+    }
+    SSHConfigResolver resolver;
+    resolver.loadFromString(config_path_, content, true);
+    resolved_settings_ = resolver.globalSettings();
+}
+
+bool SSHConfig::isMatchLine(const std::string& key) {
+    return key.size() == 5 && strncasecmp(key.c_str(), "match", 5) == 0;
 }
 
 std::pair<std::string, std::string> SSHConfig::parseLine(const std::string& line) {
@@ -112,7 +157,9 @@ bool SSHConfig::saveConfig(const std::string& outputPath) {
     std::string path = outputPath.empty() ? config_path_ : outputPath;
     std::vector<std::string> lines;
     
-    // Копировать комментарии и пустые строки, обновить настройки
+    // Копировать комментарии и пустые строки, обновить настройки; блоки Match
+    // переносятся как есть
+    bool in_match = false;
     for (const auto& original_line : original_lines_) {
         if (isComment(original_line) || trim(original_line).empty()) {
             lines.push_back(original_line);
@@ -120,7 +167,8 @@ bool SSHConfig::saveConfig(const std::string& outputPath) {
         }
         
         auto [key, _] = parseLine(original_line);
-        if (key.empty()) {
+        in_match = in_match || isMatchLine(key);
+        if (key.empty() || in_match) {
             lines.push_back(original_line);
             continue;
         }
@@ -132,26 +180,39 @@ bool SSHConfig::saveConfig(const std::string& outputPath) {
         }
     }
     
-    // Добавить новые настройки, которых не было в оригинальном файле
+    // Добавить новые настройки, которых не было в оригинальном файле; они
+    // должны стоять до первого Match, иначе попадут в блок
+    size_t global_end = lines.size();
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (isMatchLine(parseLine(lines[i]).first)) {
+            global_end = i;
+            break;
+        }
+    }
+    std::vector<std::string> added;
     for (const auto& [key, value] : settings_) {
         bool found = false;
         for (const auto& line : original_lines_) {
             auto [line_key, _] = parseLine(line);
+            if (isMatchLine(line_key)) {
+                break;
+            }
             if (line_key == key) {
                 found = true;
                 break;
             }
         }
         if (!found) {
-            lines.push_back(key + " " + value);
+            added.push_back(key + " " + value);
         }
     }
+    lines.insert(lines.begin() + global_end, added.begin(), added.end());
     
     return writeLines(path, lines);
 }
 
 std::map<std::string, std::string> SSHConfig::getCurrentSettings() const {
-    return settings_;
+    return resolved_settings_;
 }
 
 std::string SSHConfig::getSetting(const std::string& key) const {
@@ -165,11 +226,13 @@ bool SSHConfig::hasSetting(const std::string& key) const {
 
 bool SSHConfig::setSetting(const std::string& key, const std::string& value) {
     settings_[key] = value;
+    resolved_settings_[SSHConfigResolver::canonicalKey(key)] = value;
     return true;
 }
 
 void SSHConfig::removeSetting(const std::string& key) {
     settings_.erase(key);
+    resolved_settings_.erase(SSHConfigResolver::canonicalKey(key));
 }
 
 std::map<std::string, std::string> SSHConfig::getSecureDefaults() const {
@@ -195,8 +258,15 @@ std::map<std::string, std::string> SSHConfig::getSecureDefaults() const {
 }
 
 std::vector<SSHSecurityRecommendation> SSHConfig::getRecommendations() const {
+    return analyzeSettings(resolved_settings_);
+}
+
+std::vector<SSHSecurityRecommendation> SSHConfig::analyzeSettings(const std::map<std::string, std::string>& settings) {
     std::vector<SSHSecurityRecommendation> recommendations;
-    auto secure_defaults = getSecureDefaults();
+    auto getSetting = [&settings](const std::string& key) {
+        auto it = settings.find(key);
+        return it != settings.end() ? it->second : std::string();
+    };
     
     // Проверить Protocol
     std::string protocol = getSetting("Protocol");
@@ -48,12 +48,24 @@ public:
      */
     SSHConfig(const std::string& configPath);
 
+    /**
+     * @brief Constructor from already read file contents (nothing is read from disk)
+     * @param configPath Path the contents came from
+     * @param content Configuration text
+     */
+    SSHConfig(const std::string& configPath, const std::string& content);
+
     /**
      * @brief Load SSH configuration from file
      * @return True if loading successful
      */
     bool loadConfig();
 
+    /**
+     * @brief Load SSH configuration from text instead of config_path
+     */
+    void loadFromString(const std::string& content);
+
     /**
      * @brief Save SSH configuration to file
      * @param outputPath Output file path (optional)
@@ -63,6 +75,9 @@ public:
 
     /**
      * @brief Get current SSH configuration settings
+     *
+     * Global settings as sshd sees them: Include files are expanded and the
+     * first value wins, Match blocks are left out (see SSHConfigResolver).
      * @return Map of setting key-value pairs
      */
     std::map<std::string, std::string> getCurrentSettings() const;
@@ -73,6 +88,13 @@ public:
      */
     std::vector<SSHSecurityRecommendation> analyzeSecurity();
 
+    /**
+     * @brief Analyze arbitrary settings (e.g. effective settings for one connection)
+     * @param settings Map of setting key-value pairs with canonical key names
+     * @return Vector of security recommendations
+     */
+    static std::vector<SSHSecurityRecommendation> analyzeSettings(const std::map<std::string, std::string>& settings);
+
     /**
      * @brief Generate secure SSH configuration
      * @return String containing secure SSH config
@@ -91,7 +113,8 @@ public:
 private:
     std::string config_path_;
     std::string last_error_;
-    std::map<std::string, std::string> settings_;
+    std::map<std::string, std::string> settings_;           // Строки основного файла (для правки и сохранения)
+    std::map<std::string, std::string> resolved_settings_;  // С Include, как у SSHConfigResolver (для анализа)
     std::vector<std::string> original_lines_;
     
     void parseConfig();
@@ -106,4 +129,5 @@ private:
     std::string trim(const std::string& str);
     bool isComment(const std::string& line);
     std::pair<std::string, std::string> parseLine(const std::string& line);
+    static bool isMatchLine(const std::string& key);
 };
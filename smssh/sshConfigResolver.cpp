@@ -0,0 +1,609 @@
+/**
+ * @file sshConfigResolver.cpp
+ * @brief Реализация вычисления действующих настроек sshd
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "sshConfigResolver.h"
+#include <glob.h>
+#include <set>
+#include <unordered_map>
+
+namespace {
+    const int kMaxIncludeDepth = 16;  // Как SERVCONF_MAX_DEPTH у sshd
+
+    std::string lowercase(std::string_view text) {
+        std::string out(text);
+        for (char& c : out) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        return out;
+    }
+
+    std::string_view trim(std::string_view text) {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) {
+            return {};
+        }
+        size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+
+    /**
+     * @brief Слова строки; кавычки снимаются, '#' вне кавычек начинает комментарий
+     */
+    std::vector<std::string> split_words(std::string_view text) {
+        std::vector<std::string> words;
+        size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) {
+                ++i;
+            }
+            if (i == text.size() || text[i] == '#') {
+                break;
+            }
+            std::string word;
+            bool quoted = false;
+            for (; i < text.size() && (quoted || (text[i] != ' ' && text[i] != '\t')); ++i) {
+                if (text[i] == '"') {
+                    quoted = !quoted;
+                } else {
+                    word += text[i];
+                }
+            }
+            words.push_back(std::move(word));
+        }
+        return words;
+    }
+
+    /**
+     * @brief Шаблон sshd: '*' - любая строка, '?' - один символ
+     */
+    bool wildcard_match(std::string_view pattern, std::string_view text) {
+        size_t p = 0, t = 0;
+        size_t star = std::string_view::npos, resume = 0;
+        while (t < text.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+                ++p;
+                ++t;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                resume = t;
+            } else if (star != std::string_view::npos) {
+                p = star + 1;
+                t = ++resume;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    /**
+     * @brief Первый адрес после сети или false, если сеть в конце пространства
+     */
+    bool address_after(const IpPrefix& prefix, IpAddress& next) {
+        IpAddress last = prefix.network;
+        for (int bit = prefix.length; bit < 128; ++bit) {
+            last[bit >> 3] |= static_cast<uint8_t>(0x80 >> (bit & 7));
+        }
+        next = last;
+        for (int i = 15; i >= 0; --i) {
+            if (++next[i] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool is_list_key(const std::string& key) {
+        static const std::set<std::string> keys = {
+            "AcceptEnv", "AllowGroups", "AllowUsers", "DenyGroups", "DenyUsers",
+            "HostCertificate", "HostKey", "ListenAddress", "Port"
+        };
+        return keys.count(key) > 0;
+    }
+
+    int severity_rank(const std::string& severity) {
+        if (severity == "critical") return 3;
+        if (severity == "high") return 2;
+        if (severity == "medium") return 1;
+        return 0;
+    }
+}
+
+std::string SSHConfigResolver::canonicalKey(std::string_view key) {
+    static const char* const known[] = {
+        "AcceptEnv", "AddressFamily", "AllowAgentForwarding", "AllowGroups", "AllowStreamLocalForwarding",
+        "AllowTcpForwarding", "AllowUsers", "AuthenticationMethods", "AuthorizedKeysCommand",
+        "AuthorizedKeysCommandUser", "AuthorizedKeysFile", "AuthorizedPrincipalsFile", "Banner",
+        "ChallengeResponseAuthentication", "ChrootDirectory", "Ciphers", "ClientAliveCountMax",
+        "ClientAliveInterval", "Compression", "DenyGroups", "DenyUsers", "DisableForwarding",
+        "ForceCommand", "GatewayPorts", "GSSAPIAuthentication", "HostbasedAuthentication", "HostCertificate",
+        "HostKey", "HostKeyAlgorithms", "IgnoreRhosts", "KbdInteractiveAuthentication",
+        "KerberosAuthentication", "KexAlgorithms", "ListenAddress", "LoginGraceTime", "LogLevel", "MACs",
+        "MaxAuthTries", "MaxSessions", "MaxStartups", "PasswordAuthentication", "PermitEmptyPasswords",
+        "PermitListen", "PermitOpen", "PermitRootLogin", "PermitTTY", "PermitTunnel", "PermitUserEnvironment",
+        "PermitUserRC", "PidFile", "Port", "PrintLastLog", "PrintMotd", "Protocol", "PubkeyAcceptedAlgorithms",
+        "PubkeyAuthentication", "RekeyLimit", "SetEnv", "StrictModes", "Subsystem", "SyslogFacility",
+        "TCPKeepAlive", "UseDNS", "UsePAM", "X11DisplayOffset", "X11Forwarding", "X11UseLocalhost"
+    };
+    static const std::unordered_map<std::string, std::string> names = [] {
+        std::unordered_map<std::string, std::string> map;
+        for (const char* name : known) {
+            map.emplace(lowercase(name), name);
+        }
+        return map;
+    }();
+
+    auto it = names.find(lowercase(key));
+    return it != names.end() ? it->second : std::string(key);
+}
+
+void SSHConfigResolver::reset() {
+    files_.clear();
+    errors_.clear();
+    directives_.clear();
+    globals_.clear();
+    blocks_.clear();
+}
+
+bool SSHConfigResolver::load(const std::string& path) {
+    reset();
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        errors_.push_back("Cannot read " + path);
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+
+    fs::path parent = fs::path(path).parent_path();
+    base_directory_ = parent.empty() ? "." : parent.string();
+    expand_includes_ = true;
+    parseText(path, content.str(), -1, 0);
+    return true;
+}
+
+void SSHConfigResolver::loadFromString(const std::string& path, const std::string& content, bool expandIncludes) {
+    reset();
+    fs::path parent = fs::path(path).parent_path();
+    base_directory_ = parent.empty() ? "." : parent.string();
+    expand_includes_ = expandIncludes;
+    parseText(path, content, -1, 0);
+}
+
+void SSHConfigResolver::parseText(const std::string& path, const std::string& content, int block, int depth) {
+    files_.push_back(path);
+
+    int line_number = 0;
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == std::string::npos) {
+            end = content.size();
+        }
+        std::string_view line = trim(std::string_view(content).substr(start, end - start));
+        start = end + 1;
+        ++line_number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        // "Key value", "Key=value" и "Key = value"
+        size_t key_end = line.find_first_of(" \t=");
+        std::string key = lowercase(line.substr(0, key_end));
+        std::string_view rest = key_end == std::string_view::npos ? std::string_view() : trim(line.substr(key_end));
+        if (!rest.empty() && rest[0] == '=') {
+            rest = trim(rest.substr(1));
+        }
+
+        if (key == "match") {
+            Block match;
+            match.text = std::string(line);
+            match.file = path;
+            match.line = line_number;
+            if (!parseMatch(std::string(rest), match)) {
+                errors_.push_back(path + ":" + std::to_string(line_number) + ": unsupported " + match.text);
+            }
+            blocks_.push_back(std::move(match));
+            block = static_cast<int>(blocks_.size()) - 1;
+            continue;
+        }
+        if (key == "include") {
+            parseInclude(path, line_number, std::string(rest), block, depth);
+            continue;
+        }
+
+        std::vector<std::string> words = split_words(rest);
+        std::string value;
+        for (const auto& word : words) {
+            value += (value.empty() ? "" : " ") + word;
+        }
+
+        SSHDirective directive;
+        directive.key = canonicalKey(key);
+        directive.value = std::move(value);
+        directive.file = path;
+        directive.line = line_number;
+        directive.block = block;
+        directives_.push_back(std::move(directive));
+        int index = static_cast<int>(directives_.size()) - 1;
+        if (block < 0) {
+            globals_.push_back(index);
+        } else {
+            blocks_[block].directives.push_back(index);
+        }
+    }
+}
+
+void SSHConfigResolver::parseInclude(const std::string& from, int line, const std::string& patterns, int block, int depth) {
+    if (!expand_includes_) {
+        return;
+    }
+    if (depth >= kMaxIncludeDepth) {
+        errors_.push_back(from + ":" + std::to_string(line) + ": Include nested too deeply");
+        return;
+    }
+
+    for (std::string pattern : split_words(patterns)) {
+        if (pattern.empty() || pattern[0] != '/') {
+            pattern = base_directory_ + "/" + pattern;
+        }
+        glob_t found{};
+        int result = glob(pattern.c_str(), 0, nullptr, &found);
+        if (result != 0 && result != GLOB_NOMATCH) {
+            errors_.push_back(from + ":" + std::to_string(line) + ": cannot expand " + pattern);
+        }
+        // glob возвращает пути по алфавиту - в том же порядке их читает sshd
+        for (size_t i = 0; result == 0 && i < found.gl_pathc; ++i) {
+            std::string path = found.gl_pathv[i];
+            std::ifstream file(path);
+            if (!file.is_open()) {
+                errors_.push_back(from + ":" + std::to_string(line) + ": cannot read " + path);
+                continue;
+            }
+            std::stringstream content;
+            content << file.rdbuf();
+            // Блок Match из включенного файла заканчивается вместе с файлом
+            parseText(path, content.str(), block, depth + 1);
+        }
+        globfree(&found);
+    }
+}
+
+bool SSHConfigResolver::parseMatch(const std::string& arguments, Block& block) {
+    std::vector<std::string> words = split_words(arguments);
+    if (words.empty()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < words.size(); ++i) {
+        Criterion criterion;
+        std::string name = lowercase(words[i]);
+        if (name == "all") {
+            criterion.type = Criterion::Type::All;
+            block.criteria.push_back(std::move(criterion));
+            continue;
+        }
+
+        static const std::map<std::string, Criterion::Type> types = {
+            {"user", Criterion::Type::User}, {"group", Criterion::Type::Group}, {"host", Criterion::Type::Host},
+            {"address", Criterion::Type::Address}, {"localaddress", Criterion::Type::LocalAddress},
+            {"localport", Criterion::Type::LocalPort}, {"rdomain", Criterion::Type::RDomain}
+        };
+        auto type = types.find(name);
+        if (type == types.end() || i + 1 == words.size()) {
+            block.criteria.push_back(std::move(criterion));
+            return false;
+        }
+        criterion.type = type->second;
+
+        std::string_view list = words[++i];
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view item = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            if (item.empty()) {
+                continue;
+            }
+            Pattern pattern;
+            pattern.negated = item[0] == '!';
+            if (pattern.negated) {
+                item.remove_prefix(1);
+            }
+            pattern.text = criterion.type == Criterion::Type::Host ? lowercase(item) : std::string(item);
+            if (criterion.type == Criterion::Type::Address || criterion.type == Criterion::Type::LocalAddress) {
+                pattern.is_prefix = IpPrefix::parse(item, pattern.prefix);
+            }
+            criterion.patterns.push_back(std::move(pattern));
+        }
+        block.criteria.push_back(std::move(criterion));
+    }
+    return true;
+}
+
+int SSHConfigResolver::matchList(const std::vector<Pattern>& patterns, std::string_view text, bool lowercase_text) {
+    std::string lowered = lowercase_text ? lowercase(text) : std::string();
+    if (lowercase_text) {
+        text = lowered;
+    }
+    // Как match_pattern_list у sshd: совпадение с отрицанием сразу запрещает
+    int result = 0;
+    for (const Pattern& pattern : patterns) {
+        if (wildcard_match(pattern.text, text)) {
+            if (pattern.negated) {
+                return -1;
+            }
+            result = 1;
+        }
+    }
+    return result;
+}
+
+int SSHConfigResolver::matchAddress(const std::vector<Pattern>& patterns, const IpAddress& address) {
+    std::string text;
+    int result = 0;
+    for (const Pattern& pattern : patterns) {
+        bool matched;
+        if (pattern.is_prefix) {
+            matched = pattern.prefix.contains(address);
+        } else {
+            if (text.empty()) {
+                text = address.toString();
+            }
+            matched = wildcard_match(pattern.text, text);
+        }
+        if (matched) {
+            if (pattern.negated) {
+                return -1;
+            }
+            result = 1;
+        }
+    }
+    return result;
+}
+
+bool SSHConfigResolver::matches(const Block& block, const SSHMatchContext& connection, Part part) const {
+    if (block.criteria.empty()) {
+        return false;
+    }
+    for (const Criterion& criterion : block.criteria) {
+        bool address_side = criterion.type == Criterion::Type::Address || criterion.type == Criterion::Type::Host;
+        if ((part == Part::Context && address_side) || (part == Part::Address && !address_side)) {
+            continue;
+        }
+        bool matched = false;
+        switch (criterion.type) {
+        case Criterion::Type::All:
+            matched = true;
+            break;
+        case Criterion::Type::User:
+            matched = matchList(criterion.patterns, connection.user, false) == 1;
+            break;
+        case Criterion::Type::Group: {
+            // Любая группа подходит, но отрицание для любой группы запрещает
+            int result = 0;
+            for (const auto& group : connection.groups) {
+                int group_result = matchList(criterion.patterns, group, false);
+                if (group_result < 0) {
+                    result = -1;
+                    break;
+                }
+                result |= group_result;
+            }
+            matched = result == 1;
+            break;
+        }
+        case Criterion::Type::Host:
+            matched = matchList(criterion.patterns,
+                                connection.host.empty() ? connection.address.toString() : connection.host, true) == 1;
+            break;
+        case Criterion::Type::Address:
+            matched = matchAddress(criterion.patterns, connection.address) == 1;
+            break;
+        case Criterion::Type::LocalAddress:
+            matched = matchAddress(criterion.patterns, connection.local_address) == 1;
+            break;
+        case Criterion::Type::LocalPort:
+            matched = matchList(criterion.patterns, std::to_string(connection.local_port), false) == 1;
+            break;
+        case Criterion::Type::RDomain:
+            matched = matchList(criterion.patterns, connection.rdomain, false) == 1;
+            break;
+        case Criterion::Type::Invalid:
+            break;
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<int> SSHConfigResolver::matchingBlocks(const SSHMatchContext& connection) const {
+    std::vector<int> result;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        if (matches(blocks_[i], connection, Part::Everything)) {
+            result.push_back(static_cast<int>(i));
+        }
+    }
+    return result;
+}
+
+std::map<std::string, std::string> SSHConfigResolver::globalSettings() const {
+    return effective({}).settings;
+}
+
+SSHEffectiveConfig SSHConfigResolver::resolve(const SSHMatchContext& connection) const {
+    return effective(matchingBlocks(connection));
+}
+
+SSHEffectiveConfig SSHConfigResolver::effective(const std::vector<int>& blocks) const {
+    SSHEffectiveConfig config;
+    config.blocks = blocks;
+
+    // Первое значение параметра действует, списочные параметры накапливаются
+    auto apply = [](SSHEffectiveConfig& target, const SSHDirective& directive) {
+        auto [it, inserted] = target.settings.emplace(directive.key, directive.value);
+        if (inserted) {
+            target.sources[directive.key] = &directive;
+        } else if (is_list_key(directive.key)) {
+            it->second += " " + directive.value;
+        }
+    };
+
+    for (int index : globals_) {
+        apply(config, directives_[index]);
+    }
+
+    // Подошедшие блоки собираются отдельно и целиком заменяют глобальные значения
+    SSHEffectiveConfig overrides;
+    for (int block : blocks) {
+        for (int index : blocks_[block].directives) {
+            apply(overrides, directives_[index]);
+        }
+    }
+    for (auto& [key, value] : overrides.settings) {
+        config.settings[key] = std::move(value);
+        config.sources[key] = overrides.sources[key];
+    }
+    return config;
+}
+
+std::vector<IpAddress> SSHConfigResolver::representativeAddresses(const IpPrefix& network) const {
+    std::set<IpAddress> addresses = {network.network};
+    for (const Block& block : blocks_) {
+        for (const Criterion& criterion : block.criteria) {
+            if (criterion.type != Criterion::Type::Address) {
+                continue;
+            }
+            for (const Pattern& pattern : criterion.patterns) {
+                if (!pattern.is_prefix) {
+                    continue;
+                }
+                if (pattern.prefix.length >= network.length && network.contains(pattern.prefix.network)) {
+                    addresses.insert(pattern.prefix.network);
+                }
+                IpAddress next;
+                if (address_after(pattern.prefix, next) && network.contains(next)) {
+                    addresses.insert(next);
+                }
+            }
+        }
+    }
+    return std::vector<IpAddress>(addresses.begin(), addresses.end());
+}
+
+std::vector<SSHWeakenedOverride> SSHConfigResolver::findWeakenedOverrides(const std::vector<SSHMatchContext>& users,
+                                                                          const std::vector<IpAddress>& addresses) const {
+    std::map<std::string, std::string> global = globalSettings();
+    std::set<std::string> global_issues;
+    for (const auto& issue : SSHConfig::analyzeSettings(global)) {
+        global_issues.insert(issue.key);
+    }
+
+    // Условия блока делятся на зависящие от пользователя и от адреса; каждая
+    // часть считается один раз на пользователя и на адрес, а пользователи и
+    // адреса с одинаковыми масками блоков объединяются в классы. Подключение -
+    // пара классов, набор блоков - AND их масок.
+    size_t words = (blocks_.size() + 63) / 64;
+    auto classify = [&](size_t count, Part part, auto&& context) {
+        std::map<std::vector<uint64_t>, std::vector<size_t>> classes;
+        for (size_t i = 0; i < count; ++i) {
+            std::vector<uint64_t> mask(words);
+            for (size_t block = 0; block < blocks_.size(); ++block) {
+                if (matches(blocks_[block], context(i), part)) {
+                    mask[block / 64] |= 1ULL << (block % 64);
+                }
+            }
+            classes[std::move(mask)].push_back(i);
+        }
+        return classes;
+    };
+    auto user_classes = classify(users.size(), Part::Context, [&](size_t i) -> const SSHMatchContext& { return users[i]; });
+    SSHMatchContext by_address;
+    auto address_classes = classify(addresses.size(), Part::Address, [&](size_t i) -> const SSHMatchContext& {
+        by_address.address = addresses[i];
+        return by_address;
+    });
+
+    struct Found {
+        SSHWeakenedOverride override;
+        std::set<std::string> users;
+        std::set<IpAddress> addresses;
+    };
+    // Анализ - один раз на набор подошедших блоков
+    std::map<std::vector<int>, std::vector<std::pair<SSHSecurityRecommendation, const SSHDirective*>>> analyzed;
+    std::map<const SSHDirective*, std::map<std::string, Found>> found;
+
+    for (const auto& [user_mask, user_indexes] : user_classes) {
+        for (const auto& [address_mask, address_indexes] : address_classes) {
+            std::vector<int> blocks;
+            for (size_t block = 0; block < blocks_.size(); ++block) {
+                if ((user_mask[block / 64] & address_mask[block / 64]) >> (block % 64) & 1) {
+                    blocks.push_back(static_cast<int>(block));
+                }
+            }
+            if (blocks.empty()) {
+                continue;
+            }
+
+            auto cached = analyzed.find(blocks);
+            if (cached == analyzed.end()) {
+                SSHEffectiveConfig config = effective(blocks);
+                std::vector<std::pair<SSHSecurityRecommendation, const SSHDirective*>> weakened;
+                for (auto& issue : SSHConfig::analyzeSettings(config.settings)) {
+                    auto source = config.sources.find(issue.key);
+                    if (source != config.sources.end() && source->second->block >= 0 && !global_issues.count(issue.key)) {
+                        weakened.emplace_back(std::move(issue), source->second);
+                    }
+                }
+                cached = analyzed.emplace(std::move(blocks), std::move(weakened)).first;
+            }
+
+            for (const auto& [issue, directive] : cached->second) {
+                Found& entry = found[directive][issue.key];
+                if (entry.override.connections == 0) {
+                    entry.override.issue = issue;
+                    entry.override.directive = directive;
+                    auto value = global.find(issue.key);
+                    entry.override.global_value = value != global.end() ? value->second : "not set";
+                }
+                entry.override.connections += user_indexes.size() * address_indexes.size();
+                for (size_t i : user_indexes) {
+                    entry.users.insert(users[i].user);
+                }
+                for (size_t i : address_indexes) {
+                    entry.addresses.insert(addresses[i]);
+                }
+            }
+        }
+    }
+
+    std::vector<SSHWeakenedOverride> result;
+    for (auto& [directive, by_key] : found) {
+        for (auto& [key, entry] : by_key) {
+            entry.override.users.assign(entry.users.begin(), entry.users.end());
+            entry.override.addresses.assign(entry.addresses.begin(), entry.addresses.end());
+            result.push_back(std::move(entry.override));
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const SSHWeakenedOverride& a, const SSHWeakenedOverride& b) {
+        int rank_a = severity_rank(a.issue.severity), rank_b = severity_rank(b.issue.severity);
+        if (rank_a != rank_b) {
+            return rank_a > rank_b;
+        }
+        if (a.directive->file != b.directive->file) {
+            return a.directive->file < b.directive->file;
+        }
+        return a.directive->line < b.directive->line;
+    });
+    return result;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file sshConfigResolver.h
+ * @brief Действующие настройки sshd для подключения: блоки Match и директивы Include
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include "sshConfig.h"
+#include "../ipaddress/ipaddress.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Параметры подключения, по которым выбираются блоки Match
+ */
+struct SSHMatchContext {
+    std::string user;
+    std::vector<std::string> groups;  /**< Все группы пользователя, включая основную */
+    std::string host;                 /**< Имя клиента; пустое - как sshd с UseDNS no, сравнивается адрес */
+    IpAddress address;                /**< Адрес клиента */
+    IpAddress local_address;          /**< Адрес, на который пришло подключение */
+    int local_port = 22;
+    std::string rdomain;
+};
+
+/**
+ * @brief Строка конфигурации: параметр и место, откуда он взят
+ */
+struct SSHDirective {
+    std::string key;    /**< Каноническое имя (PermitRootLogin) */
+    std::string value;
+    std::string file;
+    int line = 0;
+    int block = -1;     /**< Номер блока Match, -1 - глобальная настройка */
+};
+
+/**
+ * @brief Действующие настройки для одного подключения
+ */
+struct SSHEffectiveConfig {
+    std::vector<int> blocks;                                /**< Подошедшие блоки Match по порядку */
+    std::map<std::string, std::string> settings;            /**< Параметр - значение */
+    std::map<std::string, const SSHDirective*> sources;     /**< Откуда взято значение */
+};
+
+/**
+ * @brief Ослабление безопасности в блоке Match, сведенное по подключениям
+ */
+struct SSHWeakenedOverride {
+    SSHSecurityRecommendation issue;  /**< current_value - значение из блока */
+    std::string global_value;         /**< Значение вне Match ("not set" если нет) */
+    const SSHDirective* directive = nullptr;
+    std::vector<std::string> users;   /**< По алфавиту */
+    std::vector<IpAddress> addresses; /**< По порядку адресов */
+    size_t connections = 0;
+};
+
+/**
+ * @brief Разбор sshd_config в дерево и вычисление настроек для подключений
+ *
+ * Файл и все файлы из Include (шаблоны раскрываются через glob, относительные
+ * пути - от каталога основного файла, как /etc/ssh у sshd) разбираются один
+ * раз: глобальные директивы и блоки Match с уже разобранными условиями (CIDR
+ * как IpPrefix, списки шаблонов). Правила как у sshd: для каждого параметра
+ * действует первое значение; значения из подошедших блоков Match (тоже первое
+ * по порядку блоков) заменяют глобальные; Match внутри включенного файла
+ * заканчивается вместе с файлом. Списочные параметры (AllowUsers, AcceptEnv и
+ * подобные) накапливаются.
+ *
+ * resolve() не разбирает текст, а только проверяет условия блоков.
+ * findWeakenedOverrides() проверяет условия отдельно по пользователям и по
+ * адресам и анализирует безопасность один раз на набор подошедших блоков,
+ * поэтому все пользователи на несколько сетей проверяются за миллисекунды.
+ */
+class SSHConfigResolver {
+public:
+    SSHConfigResolver() = default;
+
+    /**
+     * @brief Прочитать файл и все включенные файлы
+     * @return False если основной файл не прочитан
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief Разобрать уже прочитанный текст
+     * @param expandIncludes Раскрывать Include (false для конфигураций, собранных с других хостов)
+     */
+    void loadFromString(const std::string& path, const std::string& content, bool expandIncludes = false);
+
+    /**
+     * @brief Настройки вне блоков Match
+     */
+    std::map<std::string, std::string> globalSettings() const;
+
+    /**
+     * @brief Номера блоков Match, подходящих подключению
+     */
+    std::vector<int> matchingBlocks(const SSHMatchContext& connection) const;
+
+    /**
+     * @brief Действующие настройки подключения
+     */
+    SSHEffectiveConfig resolve(const SSHMatchContext& connection) const;
+
+    /**
+     * @brief Настройки при заданном наборе блоков (результат matchingBlocks)
+     */
+    SSHEffectiveConfig effective(const std::vector<int>& blocks) const;
+
+    /**
+     * @brief Проблемы, которых нет в глобальных настройках, но которые появляются из-за блоков Match
+     *
+     * Проверяются все подключения users x addresses; address у users не
+     * используется, а Match Host сравнивается с адресом, как у sshd с UseDNS no.
+     * @return По убыванию серьезности, затем по месту в файле
+     */
+    std::vector<SSHWeakenedOverride> findWeakenedOverrides(const std::vector<SSHMatchContext>& users,
+                                                           const std::vector<IpAddress>& addresses) const;
+
+    /**
+     * @brief Адреса, на которых проверять сеть network: ее начало и начала всех
+     *        сетей из условий Match Address внутри нее
+     *
+     * Условия блоков меняются только на границах этих сетей, поэтому других
+     * адресов из network проверять не нужно (шаблоны вида 10.0.0.* не учитываются).
+     */
+    std::vector<IpAddress> representativeAddresses(const IpPrefix& network) const;
+
+    size_t blockCount() const { return blocks_.size(); }
+    std::string blockText(int block) const { return blocks_[block].text; }
+
+    /**
+     * @brief Прочитанные файлы по порядку включения
+     */
+    const std::vector<std::string>& files() const { return files_; }
+
+    /**
+     * @brief Ошибки разбора: неизвестные условия Match, непрочитанные Include
+     */
+    const std::vector<std::string>& errors() const { return errors_; }
+
+    /**
+     * @brief Имя параметра в написании из документации sshd (permitrootlogin - PermitRootLogin)
+     */
+    static std::string canonicalKey(std::string_view key);
+
+private:
+    struct Pattern {
+        std::string text;
+        IpPrefix prefix;
+        bool negated = false;
+        bool is_prefix = false;
+    };
+
+    struct Criterion {
+        enum class Type { All, User, Group, Host, Address, LocalAddress, LocalPort, RDomain, Invalid };
+        Type type = Type::Invalid;
+        std::vector<Pattern> patterns;
+    };
+
+    struct Block {
+        std::vector<Criterion> criteria;
+        std::vector<int> directives;  /**< Индексы в directives_ по порядку */
+        std::string text;             /**< "Match ..." как в файле */
+        std::string file;
+        int line = 0;
+    };
+
+    /**
+     * @brief Какие условия блока проверять: все, только не зависящие от адреса
+     *        клиента или только Address и Host
+     */
+    enum class Part { Everything, Context, Address };
+
+    void reset();
+    void parseText(const std::string& path, const std::string& content, int block, int depth);
+    void parseInclude(const std::string& from, int line, const std::string& patterns, int block, int depth);
+    bool parseMatch(const std::string& arguments, Block& block);
+    bool matches(const Block& block, const SSHMatchContext& connection, Part part) const;
+
+    static int matchList(const std::vector<Pattern>& patterns, std::string_view text, bool lowercase);
+    static int matchAddress(const std::vector<Pattern>& patterns, const IpAddress& address);
+
+    std::string base_directory_;
+    bool expand_includes_ = true;
+    std::vector<std::string> files_;
+    std::vector<std::string> errors_;
+    std::vector<SSHDirective> directives_;
+    std::vector<int> globals_;  /**< Индексы глобальных директив в directives_ */
+    std::vector<Block> blocks_;
+};
@@ -0,0 +1,486 @@
+/**
+ * @file sshLogParser.cpp
+ * @brief Реализация однопроходного разбора сообщений sshd
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "sshLogParser.h"
+#include <ctime>
+
+namespace {
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool starts_with(std::string_view s, std::string_view prefix) {
+    return s.substr(0, prefix.size()) == prefix;
+}
+
+bool consume(std::string_view& s, std::string_view prefix) {
+    if (!starts_with(s, prefix)) {
+        return false;
+    }
+    s.remove_prefix(prefix.size());
+    return true;
+}
+
+std::string_view next_token(std::string_view& s) {
+    size_t end = s.find(' ');
+    std::string_view token = s.substr(0, end);
+    s.remove_prefix(end == std::string_view::npos ? s.size() : end + 1);
+    return token;
+}
+
+int parse_int(std::string_view s) {
+    int value = 0;
+    for (size_t i = 0; i < s.size() && is_digit(s[i]) && i < 9; ++i) {
+        value = value * 10 + (s[i] - '0');
+    }
+    return value;
+}
+
+/**
+ * @brief Метка "Jan  4 10:15:30"
+ */
+bool is_bsd_timestamp(std::string_view s) {
+    return s.size() >= 15 && s[3] == ' ' && s[6] == ' ' && s[9] == ':' && s[12] == ':' &&
+           is_digit(s[7]) && is_digit(s[13]) && is_digit(s[14]);
+}
+
+/**
+ * @brief Тег процесса sshd: "sshd", "sshd-session", "sshd-auth" с необязательным [pid]
+ */
+bool parse_tag(std::string_view tag, SshLogEvent& event) {
+    if (tag.empty() || tag.back() != ':') {
+        return false;
+    }
+    tag.remove_suffix(1);
+
+    size_t bracket = tag.find('[');
+    std::string_view name = tag.substr(0, bracket);
+    if (name != "sshd" && name != "sshd-session" && name != "sshd-auth") {
+        return false;
+    }
+
+    if (bracket != std::string_view::npos) {
+        if (tag.back() != ']') {
+            return false;
+        }
+        event.pid = tag.substr(bracket + 1, tag.size() - bracket - 2);
+    }
+    return true;
+}
+
+/**
+ * @brief Разобрать хвост "<ip> port <port>" (после адреса может идти что угодно)
+ */
+void parse_address(std::string_view s, SshLogEvent& event) {
+    event.ip = next_token(s);
+    if (consume(s, "port ")) {
+        event.port = parse_int(s);
+    }
+}
+
+/**
+ * @brief "[invalid user ]<user> from <ip> port <port> ..."
+ *
+ * Имя пользователя задает клиент и может содержать пробелы, поэтому
+ * граница ищется по последнему " from ".
+ */
+void parse_user_from(std::string_view s, SshLogEvent& event) {
+    if (consume(s, "invalid user ")) {
+        event.invalid_user = true;
+    }
+
+    size_t from = s.rfind(" from ");
+    if (from == std::string_view::npos) {
+        return;
+    }
+    event.user = s.substr(0, from);
+    parse_address(s.substr(from + 6), event);
+}
+
+/**
+ * @brief "[authenticating user <user> |invalid user <user> |user <user> ]<ip> port <port> ..."
+ *
+ * Адрес - последний токен перед " port ".
+ */
+void parse_user_address(std::string_view s, SshLogEvent& event) {
+    bool has_user = false;
+    if (consume(s, "authenticating user ")) {
+        has_user = true;
+    } else if (consume(s, "invalid user ")) {
+        has_user = true;
+        event.invalid_user = true;
+    } else if (consume(s, "user ")) {
+        has_user = true;
+    }
+
+    size_t port = s.rfind(" port ");
+    std::string_view head = port == std::string_view::npos ? s.substr(0, s.find(' ')) : s.substr(0, port);
+
+    size_t space = head.rfind(' ');
+    if (has_user && space != std::string_view::npos) {
+        event.user = head.substr(0, space);
+        event.ip = head.substr(space + 1);
+    } else {
+        event.ip = head;
+    }
+
+    if (port != std::string_view::npos) {
+        event.port = parse_int(s.substr(port + 6));
+    }
+}
+
+/**
+ * @brief Значение поля "key=value" в строке PAM
+ */
+std::string_view pam_field(std::string_view s, std::string_view key) {
+    size_t pos = 0;
+    while ((pos = s.find(key, pos)) != std::string_view::npos) {
+        if ((pos == 0 || s[pos - 1] == ' ' || s[pos - 1] == ';') &&
+            pos + key.size() < s.size() && s[pos + key.size()] == '=') {
+            std::string_view value = s.substr(pos + key.size() + 1);
+            return value.substr(0, value.find(' '));
+        }
+        pos += key.size();
+    }
+    return {};
+}
+
+bool parse_message(std::string_view message, SshLogEvent& event) {
+    // rsyslog сворачивает повторы: "message repeated 3 times: [ Failed password ... ]"
+    if (consume(message, "message repeated ")) {
+        event.repeats = parse_int(message);
+        size_t open = message.find("[ ");
+        if (open == std::string_view::npos || event.repeats <= 0) {
+            return false;
+        }
+        message.remove_prefix(open + 2);
+        if (!message.empty() && message.back() == ']') {
+            message.remove_suffix(1);
+        }
+        while (!message.empty() && message.back() == ' ') {
+            message.remove_suffix(1);
+        }
+    }
+
+    if (message.size() >= 9 && message.substr(message.size() - 9) == "[preauth]") {
+        event.preauth = true;
+    }
+    consume(message, "error: ");
+
+    switch (message.empty() ? '\0' : message[0]) {
+    case 'F':
+        if (consume(message, "Failed ")) {
+            event.type = SshEventType::Failed;
+            event.method = next_token(message);
+            if (consume(message, "for ")) {
+                parse_user_from(message, event);
+            }
+        }
+        break;
+
+    case 'A':
+        if (consume(message, "Accepted ")) {
+            event.type = SshEventType::Accepted;
+            event.method = next_token(message);
+            if (consume(message, "for ")) {
+                parse_user_from(message, event);
+            }
+        }
+        break;
+
+    case 'I':
+        if (consume(message, "Invalid user ")) {
+            event.type = SshEventType::InvalidUser;
+            event.invalid_user = true;
+            size_t from = message.rfind(" from ");
+            if (from != std::string_view::npos) {
+                event.user = message.substr(0, from);
+                parse_address(message.substr(from + 6), event);
+            } else if (consume(message, "from ")) {
+                // Пустое имя: "Invalid user  from 1.2.3.4"
+                parse_address(message, event);
+            }
+        }
+        break;
+
+    case 'C':
+        if (consume(message, "Connection closed by ") || consume(message, "Connection reset by ")) {
+            event.type = SshEventType::ConnectionClosed;
+            parse_user_address(message, event);
+        }
+        break;
+
+    case 'D':
+        if (consume(message, "Disconnected from ")) {
+            event.type = SshEventType::Disconnected;
+            parse_user_address(message, event);
+        } else if (consume(message, "Disconnecting ")) {
+            if (message.find("Too many authentication failures") != std::string_view::npos) {
+                event.type = SshEventType::MaxAuthExceeded;
+                parse_user_address(message, event);
+            }
+        } else if (consume(message, "Did not receive identification string from ")) {
+            event.type = SshEventType::NoIdentification;
+            parse_address(message, event);
+        }
+        break;
+
+    case 'R':
+        if (consume(message, "Received disconnect from ")) {
+            event.type = SshEventType::Disconnected;
+            event.ip = message.substr(0, message.find(' '));
+            size_t port = message.find(" port ");
+            if (port != std::string_view::npos) {
+                event.port = parse_int(message.substr(port + 6));
+            }
+        }
+        break;
+
+    case 'm':
+        if (consume(message, "maximum authentication attempts exceeded for ")) {
+            event.type = SshEventType::MaxAuthExceeded;
+            parse_user_from(message, event);
+        }
+        break;
+
+    case 'b':
+        if (consume(message, "banner exchange: Connection from ")) {
+            event.type = SshEventType::NoIdentification;
+            parse_address(message, event);
+        }
+        break;
+
+    case 'p':
+    case 'P': {
+        // pam_unix(sshd:auth): authentication failure; ... rhost=... user=...
+        // PAM 2 more authentication failures; ... rhost=... user=...
+        bool pam_unix = starts_with(message, "pam_unix(sshd:auth): authentication failure;");
+        bool pam_more = consume(message, "PAM ") && message.find("more authentication failure") != std::string_view::npos;
+        if (pam_unix || pam_more) {
+            event.type = SshEventType::PamAuthFailure;
+            if (pam_more) {
+                event.repeats *= parse_int(message);
+            }
+            event.ip = pam_field(message, "rhost");
+            event.user = pam_field(message, "user");
+            event.method = "pam";
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    if (event.type == SshEventType::None || event.ip.empty()) {
+        return false;
+    }
+    // Адрес разбирается здесь, в потоке разбора: детектор и дальше работает с двоичным ключом
+    event.has_address = IpAddress::parse(event.ip, event.address);
+    return true;
+}
+
+int parse_fixed(std::string_view s, size_t pos, size_t len) {
+    int value = 0;
+    for (size_t i = pos; i < pos + len; ++i) {
+        if (i >= s.size() || !is_digit(s[i])) {
+            return -1;
+        }
+        value = value * 10 + (s[i] - '0');
+    }
+    return value;
+}
+
+// День месяца и время в своих пределах (секунда 60 - вставная); mktime и
+// timegm молча переносят лишнее в следующий месяц или год
+bool valid_clock(int day, int hour, int minute, int second) {
+    return day >= 1 && day <= 31 && hour >= 0 && hour <= 23 && minute >= 0 && minute <= 59 &&
+           second >= 0 && second <= 60;
+}
+
+int month_index(std::string_view name) {
+    static const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    for (int i = 0; i < 12; ++i) {
+        if (name == months[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief mktime для начала часа местного времени
+ *
+ * mktime обращается к базе часовых поясов и заметен при воспроизведении
+ * больших логов, а переходы на летнее время происходят на границе часа,
+ * поэтому результат кэшируется по часу.
+ */
+time_t local_hour_start(int year, int month, int day, int hour) {
+    thread_local long cached_key = -1;
+    thread_local time_t cached_value = 0;
+
+    long key = ((static_cast<long>(year) * 12 + month) * 31 + day) * 24 + hour;
+    if (key != cached_key) {
+        std::tm tm{};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_isdst = -1;
+        cached_value = mktime(&tm);
+        cached_key = key;
+    }
+    return cached_value;
+}
+
+bool parse_bsd_time(std::string_view s, time_t& result) {
+    int month = month_index(s.substr(0, 3));
+    int day = parse_fixed(s, s[4] == ' ' ? 5 : 4, s[4] == ' ' ? 1 : 2);
+    int hour = parse_fixed(s, 7, 2);
+    int minute = parse_fixed(s, 10, 2);
+    int second = parse_fixed(s, 13, 2);
+    if (month < 0 || !valid_clock(day, hour, minute, second)) {
+        return false;
+    }
+
+    thread_local time_t year_checked = 0;
+    thread_local int year = 0;
+    time_t now = time(nullptr);
+    if (now - year_checked > 3600) {
+        std::tm local{};
+        localtime_r(&now, &local);
+        year = local.tm_year + 1900;
+        year_checked = now;
+    }
+
+    time_t value = local_hour_start(year, month, day, hour) + minute * 60 + second;
+    if (value > now + 86400) {
+        value = local_hour_start(year - 1, month, day, hour) + minute * 60 + second;
+    }
+    result = value;
+    return true;
+}
+
+bool parse_rfc3339_time(std::string_view s, time_t& result) {
+    int year = parse_fixed(s, 0, 4);
+    int month = parse_fixed(s, 5, 2);
+    int day = parse_fixed(s, 8, 2);
+    int hour = parse_fixed(s, 11, 2);
+    int minute = parse_fixed(s, 14, 2);
+    int second = parse_fixed(s, 17, 2);
+    if (s[4] != '-' || s[7] != '-' || s[13] != ':' || s[16] != ':' || year < 0 || month < 1 || month > 12 ||
+        !valid_clock(day, hour, minute, second)) {
+        return false;
+    }
+
+    // Дробные секунды отбрасываются, дальше - Z, +hh:mm или ничего (местное время)
+    size_t pos = 19;
+    if (pos < s.size() && s[pos] == '.') {
+        ++pos;
+        while (pos < s.size() && is_digit(s[pos])) {
+            ++pos;
+        }
+    }
+
+    if (pos >= s.size()) {
+        result = local_hour_start(year, month - 1, day, hour) + minute * 60 + second;
+        return true;
+    }
+
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    time_t value = timegm(&tm);
+
+    if (s[pos] == '+' || s[pos] == '-') {
+        int offset_hours = parse_fixed(s, pos + 1, 2);
+        int offset_minutes = parse_fixed(s, pos + 4, 2);
+        if (offset_hours < 0 || offset_hours > 23 || offset_minutes < 0 || offset_minutes > 59 || s[pos + 3] != ':') {
+            return false;
+        }
+        int offset = offset_hours * 3600 + offset_minutes * 60;
+        value += s[pos] == '+' ? -offset : offset;
+    } else if (s[pos] != 'Z') {
+        return false;
+    }
+
+    result = value;
+    return true;
+}
+
+} // namespace
+
+bool parseSshLogLine(std::string_view line, SshLogEvent& event) {
+    event = SshLogEvent{};
+
+    // <PRI> от сетевого syslog
+    if (!line.empty() && line[0] == '<') {
+        size_t close = line.find('>');
+        if (close != std::string_view::npos && close < 5) {
+            line.remove_prefix(close + 1);
+        }
+    }
+
+    std::string_view rest = line;
+    if (is_bsd_timestamp(rest)) {
+        event.timestamp = rest.substr(0, 15);
+        rest.remove_prefix(rest.size() > 15 ? 16 : 15);
+    } else if (rest.size() > 19 && is_digit(rest[0]) && rest[4] == '-' && rest[10] == 'T') {
+        event.timestamp = next_token(rest);
+    }
+
+    // После метки идет хост, затем тег; без метки (journalctl -o cat) тег может быть первым
+    std::string_view first = next_token(rest);
+    if (!parse_tag(first, event)) {
+        event.host = first;
+        if (!parse_tag(next_token(rest), event)) {
+            return false;
+        }
+    }
+
+    return parse_message(rest, event);
+}
+
+const char* sshEventTypeName(SshEventType type) {
+    switch (type) {
+    case SshEventType::Failed: return "failed";
+    case SshEventType::Accepted: return "accepted";
+    case SshEventType::InvalidUser: return "invalid_user";
+    case SshEventType::ConnectionClosed: return "connection_closed";
+    case SshEventType::Disconnected: return "disconnected";
+    case SshEventType::MaxAuthExceeded: return "max_auth_exceeded";
+    case SshEventType::PamAuthFailure: return "pam_auth_failure";
+    case SshEventType::NoIdentification: return "no_identification";
+    default: return "none";
+    }
+}
+
+bool parseSshTimestamp(std::string_view timestamp, std::chrono::system_clock::time_point& time) {
+    time_t value = 0;
+    bool parsed = false;
+    if (is_bsd_timestamp(timestamp)) {
+        parsed = parse_bsd_time(timestamp, value);
+    } else if (timestamp.size() >= 19 && timestamp[10] == 'T') {
+        parsed = parse_rfc3339_time(timestamp, value);
+    }
+
+    // system_clock считает наносекунды в int64: годы за пределами 1678-2262
+    // переполнили бы from_time_t
+    constexpr time_t kLimit = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::duration::max()).count() - 86400;
+    if (!parsed || value > kLimit || value < -kLimit) {
+        return false;
+    }
+    time = std::chrono::system_clock::from_time_t(value);
+    return true;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file sshLogParser.h
+ * @brief Разбор сообщений sshd за один проход без регулярных выражений
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include <string_view>
+#include <chrono>
+#include "../ipaddress/ipaddress.h"
+
+/**
+ * @brief Тип сообщения sshd
+ */
+enum class SshEventType {
+    None,               /**< Не сообщение sshd или неинтересное сообщение */
+    Failed,             /**< Failed <method> for [invalid user] <user> from <ip> port <port> */
+    Accepted,           /**< Accepted <method> for <user> from <ip> port <port> */
+    InvalidUser,        /**< Invalid user <user> from <ip> [port <port>] */
+    ConnectionClosed,   /**< Connection closed by [authenticating|invalid user <user>] <ip> port <port> */
+    Disconnected,       /**< Disconnected from [authenticating|invalid] user <user> <ip> port <port> */
+    MaxAuthExceeded,    /**< maximum authentication attempts exceeded / Too many authentication failures */
+    PamAuthFailure,     /**< pam_unix(sshd:auth): authentication failure; ... rhost=<ip> user=<user> */
+    NoIdentification    /**< Did not receive identification string / banner exchange (сканеры) */
+};
+
+/**
+ * @brief Разобранное сообщение sshd
+ *
+ * Все строки - срезы исходной строки лога, она должна жить дольше события.
+ */
+struct SshLogEvent {
+    SshEventType type = SshEventType::None;
+    std::string_view timestamp;  /**< Временная метка заголовка syslog */
+    std::string_view host;       /**< Имя хоста из заголовка */
+    std::string_view pid;        /**< PID процесса sshd */
+    std::string_view method;     /**< password, publickey, keyboard-interactive/pam, none */
+    std::string_view user;       /**< Имя пользователя (может быть пустым) */
+    std::string_view ip;         /**< IPv4 или IPv6 адрес клиента */
+    IpAddress address;           /**< ip в двоичном виде (если has_address) */
+    bool has_address = false;    /**< ip - адрес, а не имя хоста (UseDNS) */
+    int port = 0;                /**< Порт клиента, 0 если не указан */
+    int repeats = 1;             /**< "message repeated N times" */
+    bool invalid_user = false;   /**< Пользователь не существует */
+    bool preauth = false;        /**< Сообщение до завершения аутентификации */
+
+    /**
+     * @brief Успешный вход
+     */
+    bool success() const { return type == SshEventType::Accepted; }
+};
+
+/**
+ * @brief Разобрать строку лога с сообщением sshd
+ *
+ * Понимает заголовки syslog (RFC3164 и RFC3339 метки), вывод journalctl
+ * и сообщения процессов sshd, sshd-session и sshd-auth. Диспетчеризация
+ * идет по началу сообщения, каждая строка просматривается один раз.
+ * @param line Строка лога
+ * @param event Событие для заполнения
+ * @return True если распознано сообщение, интересное для обнаружения атак
+ */
+bool parseSshLogLine(std::string_view line, SshLogEvent& event);
+
+/**
+ * @brief Название типа события
+ */
+const char* sshEventTypeName(SshEventType type);
+
+/**
+ * @brief Перевести временную метку заголовка в момент времени
+ *
+ * Метки RFC3164 ("Jan  4 10:15:30") считаются местным временем, год
+ * берется так, чтобы метка не оказалась в будущем больше чем на сутки
+ * (лог за последние 12 месяцев разбирается без года в строке). Метки
+ * RFC3339 учитывают смещение зоны.
+ * @param timestamp Метка из SshLogEvent::timestamp
+ * @param time Результат
+ * @return True если метка разобрана
+ */
+bool parseSshTimestamp(std::string_view timestamp, std::chrono::system_clock::time_point& time);
@@ -0,0 +1,463 @@
+/**
+ * @file sshTrafficGenerator.cpp
+ * @brief Генерация синтетического auth.log с разметкой атак
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#include "sshTrafficGenerator.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using Clock = std::chrono::system_clock;
+
+namespace {
+
+const char* kMonths[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+const char* kEmployees[] = {"alice", "bob", "carol", "dave", "erin", "frank", "grace", "heidi",
+                            "ivan", "judy", "mike", "nina", "oscar", "peggy", "sergey", "victor"};
+
+// Что пробуют словарные атаки; root существует, остальных нет
+const char* kDictionary[] = {"admin", "administrator", "user", "guest", "test", "mysql", "postgres",
+                             "oracle", "ftp", "backup", "git", "jenkins", "docker", "ubuntu",
+                             "centos", "www-data", "nginx", "apache", "system", "root"};
+
+// Имена из сканов по списку сервисов и устройств, которых на сервере нет
+const char* kScanNames[] = {"pi", "ubnt", "support", "sysadmin", "minecraft", "steam", "hadoop", "kafka",
+                            "zabbix", "teamspeak", "odoo", "tomcat", "dev", "vagrant", "ftpuser", "es",
+                            "elastic", "solr", "user1", "test1", "nagios", "ansible", "svn", "web",
+                            "deployer", "sonar", "gitlab-runner", "prometheus", "grafana", "redis"};
+
+const char* kHost = "web01";
+
+std::string bsd_timestamp(Clock::time_point time) {
+    time_t value = Clock::to_time_t(time);
+    std::tm local{};
+    localtime_r(&value, &local);
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%s %2d %02d:%02d:%02d", kMonths[local.tm_mon], local.tm_mday,
+             local.tm_hour, local.tm_min, local.tm_sec);
+    return buffer;
+}
+
+std::tm local_tm(Clock::time_point time) {
+    time_t value = Clock::to_time_t(time);
+    std::tm local{};
+    localtime_r(&value, &local);
+    return local;
+}
+
+// Местное время day дней спустя после полуночи start, mktime учитывает переход на летнее время
+Clock::time_point local_time(Clock::time_point start, int day, int hour, int minute) {
+    std::tm local = local_tm(start);
+    local.tm_mday += day;
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    return Clock::from_time_t(mktime(&local));
+}
+
+}  // namespace
+
+void SSHTrafficMix::scale(int factor) {
+    if (factor <= 1) {
+        return;
+    }
+    users *= factor;
+    brute_force *= factor;
+    dictionary *= factor;
+    spray_campaigns *= factor;
+    off_hours *= factor;
+    user_scans *= factor;
+}
+
+SSHTrafficGenerator::SSHTrafficGenerator(const SSHTrafficMix& mix) : mix_(mix), rng_(mix.seed) {
+    mix_.hours = std::max(1, mix_.hours);
+
+    // По умолчанию - полночь понедельника, закончившаяся не позже чем за сутки
+    // до сейчас: метки syslog без года должны разбираться в текущий год
+    if (mix_.start == Clock::time_point{}) {
+        auto before = Clock::now() - std::chrono::hours(mix_.hours + 24);
+        std::tm local = local_tm(before);
+        mix_.start = local_time(before, -((local.tm_wday + 6) % 7), 0, 0);
+    }
+    end_ = mix_.start + std::chrono::hours(mix_.hours);
+
+    accounts_.push_back("root");
+    for (int i = 0; i < mix_.users; ++i) {
+        std::string name = kEmployees[i % std::size(kEmployees)];
+        if (i >= static_cast<int>(std::size(kEmployees))) {
+            name += std::to_string(i / std::size(kEmployees) + 1);
+        }
+        employees_.push_back(name);
+        accounts_.push_back(name);
+    }
+    accounts_.push_back("deploy");
+
+    generateBackground();
+    generateBruteForce();
+    generateDictionary();
+    generateSpray();
+    generateOffHours();
+    generateUserScans();
+
+    // Сессии добавлялись по порядку, поэтому устойчивая сортировка сохраняет
+    // порядок сообщений внутри одной секунды
+    std::stable_sort(events_.begin(), events_.end(), [](const Line& a, const Line& b) { return a.time < b.time; });
+    lines_.reserve(events_.size());
+    for (auto& event : events_) {
+        lines_.push_back(std::move(event.text));
+    }
+    events_.clear();
+    events_.shrink_to_fit();
+}
+
+int64_t SSHTrafficGenerator::random(int64_t from, int64_t to) {
+    return std::uniform_int_distribution<int64_t>(from, to)(rng_);
+}
+
+int SSHTrafficGenerator::randomPort() {
+    return static_cast<int>(random(32768, 60999));
+}
+
+std::string SSHTrafficGenerator::attackerAddress() {
+    while (true) {
+        std::string address;
+        if (random(0, 9) == 0) {
+            std::ostringstream v6;
+            v6 << std::hex << "2a0" << random(1, 9) << ":" << random(0x1000, 0xffff) << ":" << random(0, 0xffff)
+               << "::" << random(1, 0xffff);
+            address = v6.str();
+        } else {
+            // Без частных, служебных и документационных сетей
+            int first = static_cast<int>(random(1, 223));
+            if (first == 10 || first == 100 || first == 127 || first == 169 || first == 172 ||
+                first == 192 || first == 198 || first == 203) {
+                continue;
+            }
+            address = std::to_string(first) + "." + std::to_string(random(0, 255)) + "." +
+                      std::to_string(random(0, 255)) + "." + std::to_string(random(1, 254));
+        }
+        if (used_addresses_.insert(address).second) {
+            return address;
+        }
+    }
+}
+
+void SSHTrafficGenerator::add(Clock::time_point time, int pid, const std::string& message) {
+    if (time < mix_.start || time >= end_) {
+        return;
+    }
+    events_.push_back({time, bsd_timestamp(time) + " " + kHost + " sshd[" + std::to_string(pid) + "]: " + message});
+}
+
+void SSHTrafficGenerator::attempt(SSHTrafficLabel& label, Clock::time_point time) {
+    if (time < mix_.start || time >= end_) {
+        return;
+    }
+    if (label.attempts == 0) {
+        label.first = time;
+    }
+    label.attempts++;
+    label.last = time;
+}
+
+void SSHTrafficGenerator::generateBackground() {
+    using std::chrono::seconds;
+    using std::chrono::minutes;
+
+    auto session = [&](Clock::time_point time, const std::string& user, int uid, const std::string& ip,
+                       const std::string& key, int64_t min_seconds, int64_t max_seconds) {
+        int pid = nextPid();
+        int port = randomPort();
+        std::string from = " from " + ip + " port " + std::to_string(port);
+
+        // Опечатка в пароле перед входом
+        if (key.empty() && random(0, 9) == 0) {
+            add(time, pid, "Failed password for " + user + from + " ssh2");
+            time += seconds(random(4, 15));
+        }
+        if (key.empty()) {
+            add(time, pid, "Accepted password for " + user + from + " ssh2");
+        } else {
+            add(time, pid, "Accepted publickey for " + user + from + " ssh2: ED25519 SHA256:" + key);
+        }
+        add(time, pid, "pam_unix(sshd:session): session opened for user " + user + "(uid=" + std::to_string(uid) + ") by (uid=0)");
+
+        time += seconds(random(min_seconds, max_seconds));
+        add(time, pid, "Received disconnect from " + ip + " port " + std::to_string(port) + ":11: disconnected by user");
+        add(time, pid, "Disconnected from user " + user + " " + ip + " port " + std::to_string(port));
+        add(time, pid, "pam_unix(sshd:session): session closed for user " + user);
+    };
+
+    // Сотрудники: по будням с 9 до 17:30, каждый со своего адреса; входы
+    // разнесены по отрезкам рабочего дня не меньше чем на полчаса
+    int days = (mix_.hours + 23) / 24 + 1;
+    int logins = std::max(1, mix_.logins_per_user);
+    int64_t slot = 510 / logins;
+    for (int day = 0; day < days; ++day) {
+        std::tm local = local_tm(local_time(mix_.start, day, 12, 0));
+        if (local.tm_wday == 0 || local.tm_wday == 6) {
+            continue;
+        }
+        for (size_t i = 0; i < employees_.size(); ++i) {
+            std::string ip = "10.20." + std::to_string(i / 250) + "." + std::to_string(i % 250 + 1);
+            for (int login = 0; login < logins; ++login) {
+                auto time = local_time(mix_.start, day, 9, 0) + minutes(slot * login + random(0, std::max<int64_t>(0, slot - 30))) +
+                            seconds(random(0, 59));
+                session(time, employees_[i], 1001 + static_cast<int>(i), ip, "", 600, 3 * 3600);
+            }
+        }
+    }
+
+    // CI входит по ключу в начале каждого часа, в том числе ночью
+    for (auto time = mix_.start; time < end_; time += std::chrono::hours(1)) {
+        session(time + seconds(random(0, 20)), "deploy", 1001 + static_cast<int>(employees_.size()), "10.0.0.5", "Xq3PzR8mLkT2vWcYbN5hJ7fGdS4aE1uI9oK6rQ0pZ2w", 20, 90);
+    }
+}
+
+void SSHTrafficGenerator::generateBruteForce() {
+    using std::chrono::seconds;
+
+    // Быстрый перебор пароля одной учетной записи: по три пароля за соединение
+    for (int i = 0; i < mix_.brute_force; ++i) {
+        SSHTrafficLabel label;
+        label.ip = attackerAddress();
+        label.scenario = "brute_force";
+        std::string user = employees_.empty() || random(0, 1) == 0 ? "root" : employees_[random(0, employees_.size() - 1)];
+
+        auto time = mix_.start + seconds(random(0, std::max<int64_t>(0, mix_.hours * 3600 - 3600)));
+        int64_t attempts = random(30, 150);
+        while (attempts > 0) {
+            int pid = nextPid();
+            std::string port = " port " + std::to_string(randomPort());
+            add(time, pid, "pam_unix(sshd:auth): authentication failure; logname= uid=0 euid=0 tty=ssh ruser= rhost=" +
+                               label.ip + "  user=" + user);
+            for (int k = 0; k < 3 && attempts > 0; ++k, --attempts) {
+                add(time, pid, "Failed password for " + user + " from " + label.ip + port + " ssh2");
+                attempt(label, time);
+                time += seconds(random(1, 4));
+            }
+            add(time, pid, "Connection closed by authenticating user " + user + " " + label.ip + port + " [preauth]");
+            time += seconds(random(1, 3));
+        }
+        labels_.push_back(std::move(label));
+    }
+}
+
+void SSHTrafficGenerator::generateDictionary() {
+    using std::chrono::seconds;
+
+    // Распространенные логины по списку, каждый в своем соединении
+    std::vector<std::string> names(std::begin(kDictionary), std::end(kDictionary));
+    for (int i = 0; i < mix_.dictionary; ++i) {
+        SSHTrafficLabel label;
+        label.ip = attackerAddress();
+        label.scenario = "dictionary";
+
+        std::shuffle(names.begin(), names.end(), rng_);
+        int64_t count = random(6, 15);
+        auto time = mix_.start + seconds(random(0, std::max<int64_t>(0, mix_.hours * 3600 - 600)));
+        for (int64_t n = 0; n < count; ++n) {
+            const std::string& user = names[n];
+            bool exists = std::find(accounts_.begin(), accounts_.end(), user) != accounts_.end();
+            int pid = nextPid();
+            std::string port = " port " + std::to_string(randomPort());
+
+            if (!exists) {
+                add(time, pid, "Invalid user " + user + " from " + label.ip + port);
+            }
+            for (int64_t k = random(1, 2); k > 0; --k) {
+                time += seconds(random(1, 3));
+                add(time, pid, "Failed password for " + std::string(exists ? "" : "invalid user ") + user + " from " +
+                                   label.ip + port + " ssh2");
+                attempt(label, time);
+            }
+            add(time, pid, "Connection closed by " + std::string(exists ? "authenticating user " : "invalid user ") +
+                               user + " " + label.ip + port + " [preauth]");
+            time += seconds(random(2, 8));
+        }
+        labels_.push_back(std::move(label));
+    }
+}
+
+void SSHTrafficGenerator::generateSpray() {
+    using std::chrono::minutes;
+    using std::chrono::seconds;
+
+    // Один пароль по всем учетным записям с десятков адресов: каждый адрес
+    // пробует раз в 20-60 минут, поэтому ни один адрес не похож на перебор
+    std::vector<std::string> targets = employees_;
+    targets.push_back("root");
+    for (int campaign = 0; campaign < mix_.spray_campaigns; ++campaign) {
+        size_t next_target = random(0, targets.size() - 1);
+        for (int i = 0; i < mix_.spray_addresses; ++i) {
+            SSHTrafficLabel label;
+            label.ip = attackerAddress();
+            label.scenario = "spray";
+
+            for (auto time = mix_.start + seconds(random(0, 2400)); time < end_; time += minutes(random(20, 60))) {
+                const std::string& user = targets[next_target++ % targets.size()];
+                int pid = nextPid();
+                std::string port = " port " + std::to_string(randomPort());
+                add(time, pid, "Failed password for " + user + " from " + label.ip + port + " ssh2");
+                attempt(label, time);
+                add(time + seconds(1), pid, "Connection closed by authenticating user " + user + " " + label.ip + port + " [preauth]");
+            }
+            labels_.push_back(std::move(label));
+        }
+    }
+}
+
+void SSHTrafficGenerator::generateOffHours() {
+    using std::chrono::seconds;
+
+    // Вход сотрудника между часом и пятью ночи с адреса, которого раньше не было
+    for (int i = 0; i < mix_.off_hours && !employees_.empty(); ++i) {
+        Clock::time_point time;
+        bool found = false;
+        for (int tries = 0; tries < 1000 && !found; ++tries) {
+            time = mix_.start + seconds(random(0, mix_.hours * 3600 - 1));
+            int hour = local_tm(time).tm_hour;
+            found = hour >= 1 && hour < 5 && time + std::chrono::hours(1) < end_;
+        }
+        if (!found) {
+            break;
+        }
+
+        SSHTrafficLabel label;
+        label.ip = attackerAddress();
+        label.scenario = "off_hours";
+        size_t index = random(0, employees_.size() - 1);
+        const std::string& user = employees_[index];
+        int pid = nextPid();
+        int port = randomPort();
+
+        add(time, pid, "Accepted password for " + user + " from " + label.ip + " port " + std::to_string(port) + " ssh2");
+        attempt(label, time);
+        add(time, pid, "pam_unix(sshd:session): session opened for user " + user + "(uid=" + std::to_string(1001 + index) + ") by (uid=0)");
+        time += seconds(random(300, 2400));
+        add(time, pid, "Received disconnect from " + label.ip + " port " + std::to_string(port) + ":11: disconnected by user");
+        add(time, pid, "Disconnected from user " + user + " " + label.ip + " port " + std::to_string(port));
+        add(time, pid, "pam_unix(sshd:session): session closed for user " + user);
+        labels_.push_back(std::move(label));
+    }
+}
+
+void SSHTrafficGenerator::generateUserScans() {
+    using std::chrono::seconds;
+
+    // Имена сервисов, которых на сервере нет, по 2-3 пароля на имя
+    std::vector<std::string> names(std::begin(kScanNames), std::end(kScanNames));
+    for (int i = 0; i < mix_.user_scans; ++i) {
+        SSHTrafficLabel label;
+        label.ip = attackerAddress();
+        label.scenario = "user_scan";
+
+        std::shuffle(names.begin(), names.end(), rng_);
+        int64_t count = random(5, 15);
+        auto time = mix_.start + seconds(random(0, std::max<int64_t>(0, mix_.hours * 3600 - 900)));
+        for (int64_t n = 0; n < count; ++n) {
+            const std::string& user = names[n];
+            int pid = nextPid();
+            std::string port = " port " + std::to_string(randomPort());
+
+            add(time, pid, "Invalid user " + user + " from " + label.ip + port);
+            for (int64_t k = random(2, 3); k > 0; --k) {
+                time += seconds(random(1, 4));
+                add(time, pid, "Failed password for invalid user " + user + " from " + label.ip + port + " ssh2");
+                attempt(label, time);
+            }
+            add(time, pid, "Connection closed by invalid user " + user + " " + label.ip + port + " [preauth]");
+            time += seconds(random(3, 20));
+        }
+        labels_.push_back(std::move(label));
+    }
+}
+
+bool SSHTrafficGenerator::write(const std::string& directory, std::string& error) const {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    std::ofstream log(directory + "/auth.log");
+    std::ofstream labels(directory + "/labels.tsv");
+    if (!log || !labels || !writeAccounts(directory, accounts_)) {
+        error = "cannot write to " + directory;
+        return false;
+    }
+
+    for (const auto& line : lines_) {
+        log << line << '\n';
+    }
+
+    labels << "# ip\tscenario\tattempts\tfirst\tlast\n";
+    for (const auto& label : labels_) {
+        labels << label.ip << '\t' << label.scenario << '\t' << label.attempts << '\t'
+               << Clock::to_time_t(label.first) << '\t' << Clock::to_time_t(label.last) << '\n';
+    }
+
+    if (!log.flush() || !labels.flush()) {
+        error = "cannot write to " + directory;
+        return false;
+    }
+    return true;
+}
+
+bool SSHTrafficGenerator::readLabels(const std::string& path, std::vector<SSHTrafficLabel>& labels) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        SSHTrafficLabel label;
+        time_t first = 0;
+        time_t last = 0;
+        if (fields >> label.ip >> label.scenario >> label.attempts >> first >> last) {
+            label.first = Clock::from_time_t(first);
+            label.last = Clock::from_time_t(last);
+            labels.push_back(std::move(label));
+        }
+    }
+    return true;
+}
+
+bool SSHTrafficGenerator::writeAccounts(const std::string& directory, const std::vector<std::string>& accounts) {
+    std::ofstream passwd(directory + "/passwd");
+    std::ofstream group(directory + "/group");
+    if (!passwd || !group) {
+        return false;
+    }
+
+    int uid = 1000;
+    for (const auto& name : accounts) {
+        if (name == "root") {
+            passwd << "root:x:0:0:root:/root:/bin/bash\n";
+        } else {
+            passwd << name << ":x:" << uid << ":" << uid << "::/home/" << name << ":/bin/bash\n";
+        }
+        uid++;
+    }
+    group << "root:x:0:\nusers:x:100:\n";
+    return static_cast<bool>(passwd.flush()) && static_cast<bool>(group.flush());
+}
+
+std::string SSHTrafficGenerator::expectedAlert(const std::string& scenario) {
+    if (scenario == "brute_force") return "brute_force";
+    if (scenario == "dictionary") return "dictionary_attack";
+    if (scenario == "spray") return "password_spray";
+    if (scenario == "off_hours") return "time_anomaly";
+    if (scenario == "user_scan") return "nonexistent_user";
+    return "";
+}
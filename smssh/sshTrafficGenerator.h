@@ -0,0 +1,129 @@
+/**
+ * @file sshTrafficGenerator.h
+ * @brief Синтетический auth.log с размеченными атаками для замеров детектора
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+
+#pragma once
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Состав трафика
+ *
+ * Числа атак - это число адресов (для распределенной атаки - число атак,
+ * в каждой spray_addresses адресов).
+ */
+struct SSHTrafficMix {
+    int hours = 24;
+    int users = 40;              /**< Учетные записи, входящие в рабочее время */
+    int logins_per_user = 4;     /**< Входов за рабочий день */
+    int brute_force = 10;        /**< Перебор пароля одной учетной записи */
+    int dictionary = 10;         /**< Перебор распространенных логинов */
+    int spray_campaigns = 2;     /**< Медленные распределенные атаки: по одной попытке с адреса раз в 20-60 минут */
+    int spray_addresses = 25;
+    int off_hours = 5;           /**< Вход ночью с нового адреса */
+    int user_scans = 10;         /**< Перебор несуществующих имен */
+    unsigned seed = 42;
+    std::chrono::system_clock::time_point start{};  /**< Пусто - полночь понедельника до начала периода */
+
+    /**
+     * @brief Умножить число пользователей и атак
+     */
+    void scale(int factor);
+};
+
+/**
+ * @brief Разметка: адрес и сценарий, которым он занимался
+ */
+struct SSHTrafficLabel {
+    std::string ip;
+    std::string scenario;  /**< brute_force, dictionary, spray, off_hours, user_scan */
+    int attempts = 0;      /**< Попыток входа (строк Failed/Accepted) */
+    std::chrono::system_clock::time_point first{};
+    std::chrono::system_clock::time_point last{};
+};
+
+/**
+ * @brief Генератор потока sshd для замеров скорости и качества обнаружения
+ *
+ * Строки повторяют настоящий auth.log: заголовок syslog с местным временем,
+ * PID сессии, сообщения PAM и закрытия соединений вокруг попыток, до трех
+ * паролей за соединение. Фон - сотрудники, входящие по будням в рабочее
+ * время со своих адресов (иногда с опечаткой в пароле), и CI, входящий по
+ * ключу каждый час круглые сутки. Атаки идут с публичных адресов, каждый
+ * адрес занят одним сценарием, и разметка говорит, каким. Один seed дает
+ * один и тот же поток.
+ */
+class SSHTrafficGenerator {
+public:
+    explicit SSHTrafficGenerator(const SSHTrafficMix& mix);
+
+    /**
+     * @brief Строки лога по времени
+     */
+    const std::vector<std::string>& lines() const { return lines_; }
+
+    const std::vector<SSHTrafficLabel>& labels() const { return labels_; }
+
+    /**
+     * @brief Существующие учетные записи (root, сотрудники, deploy) для passwd
+     */
+    const std::vector<std::string>& accounts() const { return accounts_; }
+
+    /**
+     * @brief Записать auth.log, labels.tsv, passwd и group в каталог
+     */
+    bool write(const std::string& directory, std::string& error) const;
+
+    /**
+     * @brief Прочитать labels.tsv
+     */
+    static bool readLabels(const std::string& path, std::vector<SSHTrafficLabel>& labels);
+
+    /**
+     * @brief Записать passwd и group для accounts (каталог для UserDirectory)
+     */
+    static bool writeAccounts(const std::string& directory, const std::vector<std::string>& accounts);
+
+    /**
+     * @brief Тип оповещения, которым детектор должен ответить на сценарий
+     */
+    static std::string expectedAlert(const std::string& scenario);
+
+private:
+    struct Line {
+        std::chrono::system_clock::time_point time;
+        std::string text;
+    };
+
+    void generateBackground();
+    void generateBruteForce();
+    void generateDictionary();
+    void generateSpray();
+    void generateOffHours();
+    void generateUserScans();
+
+    std::string attackerAddress();
+    int nextPid() { return pid_++; }
+    int randomPort();
+    int64_t random(int64_t from, int64_t to);
+    void add(std::chrono::system_clock::time_point time, int pid, const std::string& message);
+    void attempt(SSHTrafficLabel& label, std::chrono::system_clock::time_point time);
+
+    SSHTrafficMix mix_;
+    std::chrono::system_clock::time_point end_{};
+    std::mt19937_64 rng_;
+    int pid_ = 2000;
+    std::vector<std::string> employees_;
+    std::vector<std::string> accounts_;
+    std::unordered_set<std::string> used_addresses_;
+    std::vector<Line> events_;
+    std::vector<std::string> lines_;
+    std::vector<SSHTrafficLabel> labels_;
+};
@@ -0,0 +1,342 @@
+/**
+ * @file userdir.cpp
+ * @brief Реализация каталога локальных учетных записей
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#include "userdir.h"
+#include "../logger/logger.h"
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+namespace
+{
+    uint32_t hash_name(std::string_view name)
+    {
+        uint32_t hash = static_cast<uint32_t>(std::hash<std::string_view>{}(name));
+        return hash ? hash : 1;
+    }
+
+    /**
+     * @brief Разбить строку файла вида name:field:... на поля
+     */
+    std::vector<std::string_view> split_fields(std::string_view line)
+    {
+        std::vector<std::string_view> fields;
+        size_t start = 0;
+        while (true)
+        {
+            size_t colon = line.find(':', start);
+            fields.push_back(line.substr(start, colon == std::string_view::npos ? std::string_view::npos : colon - start));
+            if (colon == std::string_view::npos)
+                break;
+            start = colon + 1;
+        }
+        return fields;
+    }
+
+    template <typename Callback>
+    bool for_each_entry(const std::string& path, Callback&& callback)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+            return false;
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            auto fields = split_fields(line);
+            if (!fields[0].empty())
+                callback(fields);
+        }
+        return true;
+    }
+
+    uint32_t parse_id(std::string_view text)
+    {
+        uint32_t value = 0;
+        for (char c : text)
+        {
+            if (c < '0' || c > '9')
+                return UINT32_MAX;
+            value = value * 10 + (c - '0');
+        }
+        return text.empty() ? UINT32_MAX : value;
+    }
+}
+
+const UserAccount* UserSnapshot::find(std::string_view name) const
+{
+    if (slots_.empty())
+        return nullptr;
+
+    uint32_t hash = hash_name(name);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const Slot& slot = slots_[i];
+        if (slot.index == 0)
+            return nullptr;
+        if (slot.hash != hash)
+            continue;
+
+        uint32_t index = slot.index - 1;
+        if (this->name(index) == name)
+            return &accounts_[index];
+    }
+}
+
+bool UserSnapshot::isSuperuser(std::string_view name) const
+{
+    if (name == "root")
+        return true;
+    const UserAccount* account = find(name);
+    return account && account->uid == 0;
+}
+
+std::vector<std::string_view> UserSnapshot::groups(std::string_view name) const
+{
+    std::vector<std::string_view> result;
+    const UserAccount* account = find(name);
+    if (!account)
+        return result;
+    for (uint32_t group : memberships_[account - accounts_.data()])
+        result.push_back(group_names_[group]);
+    return result;
+}
+
+UserAccount* UserSnapshot::findMutable(std::string_view name)
+{
+    return const_cast<UserAccount*>(find(name));
+}
+
+void UserSnapshot::rehash(size_t count)
+{
+    std::vector<Slot> slots(count);
+    size_t mask = count - 1;
+    for (const Slot& slot : slots_)
+    {
+        if (slot.index == 0)
+            continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].index != 0)
+            i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+    slots_ = std::move(slots);
+}
+
+void UserSnapshot::insert(std::string_view name, const UserAccount& account)
+{
+    // Повтор имени в passwd: действует первая запись, как у getpwnam
+    if (find(name))
+        return;
+
+    if ((accounts_.size() + 1) * 2 > slots_.size())
+        rehash(std::max<size_t>(slots_.size() * 2, 64));
+
+    if (offsets_.empty())
+        offsets_.push_back(0);
+    names_.append(name);
+    offsets_.push_back(static_cast<uint32_t>(names_.size()));
+    accounts_.push_back(account);
+    memberships_.emplace_back();
+
+    uint32_t hash = hash_name(name);
+    size_t mask = slots_.size() - 1;
+    size_t i = hash & mask;
+    while (slots_[i].index != 0)
+        i = (i + 1) & mask;
+    slots_[i] = Slot{hash, static_cast<uint32_t>(accounts_.size())};
+}
+
+UserDirectory& UserDirectory::instance()
+{
+    static UserDirectory directory("/etc");
+    return directory;
+}
+
+UserDirectory::UserDirectory(std::string directory)
+    : directory_(std::move(directory))
+{
+    snapshot_.store(std::make_shared<const UserSnapshot>());
+    reload();
+}
+
+UserDirectory::~UserDirectory()
+{
+    stop();
+}
+
+bool UserDirectory::reload()
+{
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+
+    auto snapshot = std::make_shared<UserSnapshot>();
+    bool loaded = for_each_entry(directory_ + "/passwd", [&](const std::vector<std::string_view>& fields)
+    {
+        UserAccount account;
+        if (fields.size() > 3)
+        {
+            account.uid = parse_id(fields[2]);
+            account.gid = parse_id(fields[3]);
+        }
+        snapshot->insert(fields[0], account);
+    });
+    if (!loaded)
+    {
+        // Оставить прежний снимок: пустой каталог превратил бы всех в "несуществующих"
+        LogWarning("Не удалось прочитать " + directory_ + "/passwd");
+        return false;
+    }
+
+    // shadow читает только root; без него блокировки учетных записей неизвестны
+    for_each_entry(directory_ + "/shadow", [&](const std::vector<std::string_view>& fields)
+    {
+        UserAccount* account = snapshot->findMutable(fields[0]);
+        if (account && fields.size() > 1 && !fields[1].empty())
+            account->locked = fields[1][0] == '!' || fields[1][0] == '*';
+    });
+
+    // Основная группа ищется по GID, как getgrgid: при повторе GID действует первая
+    std::set<uint32_t> admin_gids;
+    std::unordered_map<uint32_t, uint32_t> group_by_gid;
+    for_each_entry(directory_ + "/group", [&](const std::vector<std::string_view>& fields)
+    {
+        uint32_t group = static_cast<uint32_t>(snapshot->group_names_.size());
+        snapshot->group_names_.emplace_back(fields[0]);
+        uint32_t gid = fields.size() > 2 ? parse_id(fields[2]) : UINT32_MAX;
+        if (gid != UINT32_MAX)
+            group_by_gid.emplace(gid, group);
+
+        bool admin_group = fields[0] == "sudo" || fields[0] == "wheel" || fields[0] == "admin";
+        if (admin_group && gid != UINT32_MAX)
+            admin_gids.insert(gid);
+        if (fields.size() > 3)
+        {
+            std::string_view members = fields[3];
+            while (!members.empty())
+            {
+                size_t comma = members.find(',');
+                if (UserAccount* account = snapshot->findMutable(members.substr(0, comma)))
+                {
+                    auto& memberships = snapshot->memberships_[account - snapshot->accounts_.data()];
+                    if (std::find(memberships.begin(), memberships.end(), group) == memberships.end())
+                        memberships.push_back(group);
+                    if (admin_group)
+                        account->admin = true;
+                }
+                members = comma == std::string_view::npos ? std::string_view() : members.substr(comma + 1);
+            }
+        }
+    });
+    for (size_t i = 0; i < snapshot->accounts_.size(); ++i)
+    {
+        UserAccount& account = snapshot->accounts_[i];
+        if (admin_gids.count(account.gid))
+            account.admin = true;
+
+        auto primary = group_by_gid.find(account.gid);
+        if (primary == group_by_gid.end())
+            continue;
+        auto& memberships = snapshot->memberships_[i];
+        memberships.erase(std::remove(memberships.begin(), memberships.end(), primary->second), memberships.end());
+        memberships.insert(memberships.begin(), primary->second);
+    }
+
+    snapshot->generation_ = ++generation_;
+    snapshot_.store(std::move(snapshot), std::memory_order_release);
+    return true;
+}
+
+bool UserDirectory::watch()
+{
+    if (watching_.exchange(true))
+        return true;
+
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+    {
+        LogWarning("inotify недоступен, каталог пользователей не будет обновляться");
+        watching_ = false;
+        return false;
+    }
+
+    // Следить за каталогом, а не за файлами: useradd заменяет passwd переименованием
+    if (inotify_add_watch(inotify_fd, directory_.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB) < 0)
+    {
+        LogWarning("Не удалось следить за " + directory_);
+        close(inotify_fd);
+        watching_ = false;
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    watcher_ = std::thread(&UserDirectory::watchLoop, this, inotify_fd);
+    return true;
+}
+
+void UserDirectory::stop()
+{
+    if (!watching_.exchange(false))
+        return;
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0)
+        LogDebug("Не удалось разбудить поток каталога пользователей");
+    if (watcher_.joinable())
+        watcher_.join();
+    close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+void UserDirectory::watchLoop(int inotify_fd)
+{
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+
+    while (watching_)
+    {
+        if (poll(fds, 2, -1) <= 0 || (fds[1].revents & POLLIN))
+            continue;
+
+        // Прочитать пачку событий; утилиты меняют passwd, group и shadow подряд,
+        // поэтому события за короткую паузу сливаются в одну перезагрузку
+        bool relevant = false;
+        do
+        {
+            ssize_t length;
+            while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* ptr = buffer; ptr < buffer + length;)
+                {
+                    auto* event = reinterpret_cast<inotify_event*>(ptr);
+                    if (event->len > 0)
+                    {
+                        std::string_view name(event->name);
+                        relevant |= name == "passwd" || name == "group" || name == "shadow";
+                    }
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+        } while (poll(fds, 1, 50) > 0 && watching_);
+
+        if (relevant && watching_)
+        {
+            reload();
+            LogDebug("Каталог пользователей перечитан: " + std::to_string(snapshot()->size()) + " учетных записей");
+        }
+    }
+
+    close(inotify_fd);
+}
@@ -0,0 +1,157 @@
+/**
+ * @file userdir.h
+ * @brief Каталог локальных учетных записей с перезагрузкой по inotify
+ * @author Tosa5656
+ * @date 18 октября, 2026
+ */
+#ifndef USERDIR_H
+#define USERDIR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Учетная запись из passwd, group и shadow
+ */
+struct UserAccount
+{
+    uint32_t uid = 0;        ///< UID
+    uint32_t gid = 0;        ///< Основная группа
+    bool locked = false;     ///< Пароль заблокирован в shadow ("!" или "*")
+    bool admin = false;      ///< Член групп sudo, wheel или admin
+};
+
+/**
+ * @brief Неизменяемый снимок каталога
+ *
+ * Имена лежат одним буфером, поиск идет по открытой адресации без
+ * выделений памяти. Группы хранятся номерами в общем списке имен групп.
+ * Снимок не меняется после построения, поэтому читается из любых потоков
+ * без блокировок.
+ */
+class UserSnapshot
+{
+public:
+    /**
+     * @brief Найти учетную запись
+     * @return Запись или nullptr если пользователя нет
+     */
+    const UserAccount* find(std::string_view name) const;
+
+    bool exists(std::string_view name) const { return find(name) != nullptr; }
+
+    /**
+     * @brief Root или другая учетная запись с UID 0
+     */
+    bool isSuperuser(std::string_view name) const;
+
+    /**
+     * @brief Группы пользователя: основная, затем дополнительные в порядке group
+     * @return Имена групп (пусто если пользователя нет)
+     */
+    std::vector<std::string_view> groups(std::string_view name) const;
+
+    size_t size() const { return accounts_.size(); }
+    uint64_t generation() const { return generation_; }
+
+    /**
+     * @brief Имя записи с номером index (в порядке passwd)
+     */
+    std::string_view name(size_t index) const
+    {
+        return std::string_view(names_.data() + offsets_[index], offsets_[index + 1] - offsets_[index]);
+    }
+
+private:
+    friend class UserDirectory;
+
+    void insert(std::string_view name, const UserAccount& account);
+    UserAccount* findMutable(std::string_view name);
+    void rehash(size_t slots);
+
+    struct Slot
+    {
+        uint32_t hash = 0;
+        uint32_t index = 0;  ///< Номер записи + 1, 0 - пустой слот
+    };
+
+    std::string names_;                  ///< Имена подряд
+    std::vector<uint32_t> offsets_;      ///< Начало имени в names_ (и конец предыдущего)
+    std::vector<UserAccount> accounts_;
+    std::vector<Slot> slots_;            ///< Размер - степень двойки, заполнено не больше половины
+    std::vector<std::string> group_names_;          ///< Имена групп в порядке group
+    std::vector<std::vector<uint32_t>> memberships_; ///< Номера групп для каждой записи accounts_
+    uint64_t generation_ = 0;
+};
+
+/**
+ * @brief Каталог пользователей, общий для процесса
+ *
+ * Читает passwd, group и shadow (shadow только если доступен) и публикует
+ * снимок атомарной заменой указателя: читатели берут текущий снимок без
+ * мьютекса, а старый освобождается, когда его отпустит последний читатель.
+ * После watch() фоновый поток следит за каталогом файлов через inotify
+ * (useradd и vipw заменяют файл переименованием) и строит новый снимок.
+ */
+class UserDirectory
+{
+public:
+    /**
+     * @brief Общий экземпляр для /etc
+     */
+    static UserDirectory& instance();
+
+    /**
+     * @param directory Каталог с passwd, group и shadow
+     */
+    explicit UserDirectory(std::string directory);
+    ~UserDirectory();
+
+    UserDirectory(const UserDirectory&) = delete;
+    UserDirectory& operator=(const UserDirectory&) = delete;
+
+    /**
+     * @brief Текущий снимок
+     */
+    std::shared_ptr<const UserSnapshot> snapshot() const { return snapshot_.load(std::memory_order_acquire); }
+
+    bool exists(std::string_view name) const { return snapshot()->exists(name); }
+    bool isSuperuser(std::string_view name) const { return snapshot()->isSuperuser(name); }
+
+    /**
+     * @brief Перечитать файлы и опубликовать новый снимок
+     * @return True если passwd прочитан
+     */
+    bool reload();
+
+    /**
+     * @brief Запустить слежение за изменениями (повторный вызов ничего не делает)
+     * @return True если inotify доступен
+     */
+    bool watch();
+
+    /**
+     * @brief Остановить слежение
+     */
+    void stop();
+
+private:
+    void watchLoop(int inotify_fd);
+
+    std::string directory_;
+    std::atomic<std::shared_ptr<const UserSnapshot>> snapshot_;
+    std::mutex reload_mutex_;  ///< Только для писателей: reload из потока слежения и вручную
+    uint64_t generation_ = 0;
+
+    std::atomic<bool> watching_{false};
+    int wake_fd_ = -1;
+    std::thread watcher_;
+};
+
+#endif